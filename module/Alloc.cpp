@@ -0,0 +1,103 @@
+// ------------------------------------------------------------------------------------------------
+#include "Announce.hpp"
+
+/* ------------------------------------------------------------------------------------------------
+ * Allocation accounting. Only compiled with SMOD_ALLOC_STATS. The C allocator entry points are
+ * replaced with versions that count the calls of each thread before handing them to the C library.
+ * The C++ allocation operators end up in malloc as well so they are counted too. This only takes
+ * effect in executables because symbols defined by a plug-in don't take precedence over the host.
+*/
+
+// ------------------------------------------------------------------------------------------------
+#if defined(SMOD_ALLOC_STATS) && defined(__GLIBC__)
+
+// ------------------------------------------------------------------------------------------------
+extern "C" {
+
+// ------------------------------------------------------------------------------------------------
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t count, size_t size);
+void * __libc_realloc(void * ptr, size_t size);
+void * __libc_memalign(size_t alignment, size_t size);
+
+// ------------------------------------------------------------------------------------------------
+static __thread uint64_t t_Count __attribute__((tls_model("initial-exec"))) = 0; // Calls made by this thread.
+static __thread uint64_t t_Bytes __attribute__((tls_model("initial-exec"))) = 0; // Bytes requested by this thread.
+
+// ------------------------------------------------------------------------------------------------
+void * malloc(size_t size)
+{
+    ++t_Count;
+    t_Bytes += size;
+    return __libc_malloc(size);
+}
+
+// ------------------------------------------------------------------------------------------------
+void * calloc(size_t count, size_t size)
+{
+    ++t_Count;
+    t_Bytes += count * size;
+    return __libc_calloc(count, size);
+}
+
+// ------------------------------------------------------------------------------------------------
+void * realloc(void * ptr, size_t size)
+{
+    ++t_Count;
+    t_Bytes += size;
+    return __libc_realloc(ptr, size);
+}
+
+// ------------------------------------------------------------------------------------------------
+void * memalign(size_t alignment, size_t size)
+{
+    ++t_Count;
+    t_Bytes += size;
+    return __libc_memalign(alignment, size);
+}
+
+// ------------------------------------------------------------------------------------------------
+void * aligned_alloc(size_t alignment, size_t size)
+{
+    ++t_Count;
+    t_Bytes += size;
+    return __libc_memalign(alignment, size);
+}
+
+// ------------------------------------------------------------------------------------------------
+int posix_memalign(void ** ptr, size_t alignment, size_t size)
+{
+    ++t_Count;
+    t_Bytes += size;
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+}
+
+} // extern "C"
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+AllocCounters ThreadAllocations()
+{
+    return AllocCounters{t_Count, t_Bytes};
+}
+
+} // Namespace:: SMod
+
+#elif defined(SMOD_ALLOC_STATS)
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+AllocCounters ThreadAllocations()
+{
+    // Only the GNU C library allows the allocator to be hooked this way
+    return AllocCounters{0, 0};
+}
+
+} // Namespace:: SMod
+
+#endif // SMOD_ALLOC_STATS
@@ -0,0 +1,2785 @@
+// ------------------------------------------------------------------------------------------------
+#include "Announce.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cctype>
+
+// ------------------------------------------------------------------------------------------------
+#include <mutex>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#ifndef _WIN32
+    #include <netdb.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif // _WIN32
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+typedef std::vector< std::pair< String, bool > >    Messages;
+
+// ------------------------------------------------------------------------------------------------
+bool                        g_Verbose = false; // Enable or disable verbose messages
+bool                        g_Pacing = false; // Spread announces evenly across the interval.
+unsigned int                g_UpdateInterval = 60; // Default seconds between announces.
+unsigned int                g_MinInterval = 15; // Lowest interval a master-server may ask for.
+unsigned int                g_MaxInterval = 600; // Highest interval a master-server may ask for.
+bool                        g_Hedging = false; // Race a second mirror when the chosen one is slow.
+bool                        g_Pipelining = false; // Share a connection between master-servers on the same host.
+IoBackend                   g_IoBackend = IoSequential; // How the announces of a cycle are carried out.
+unsigned int                g_FrameBudget = 0; // Microseconds to announce for on each server frame.
+
+// ------------------------------------------------------------------------------------------------
+Coordinator                 g_Coordinator; // Shared state with other instances on this machine.
+Recorder                    g_Recorder; // Captures announce traffic when enabled.
+StateFile                   g_State; // What was learned about the master-servers across restarts.
+
+// ------------------------------------------------------------------------------------------------
+static std::mutex           g_Mutex; // Global mutex
+static Messages             g_Messages; // Messages queued from the announce thread
+static size_t               g_Pending = 0; // Slots of the message queue that are in use
+
+// ------------------------------------------------------------------------------------------------
+static void QueueMtText(bool error, bool verbose, CCStr text, size_t length);
+
+// ------------------------------------------------------------------------------------------------
+bool ParseHttpDate(CCStr str, std::time_t & out)
+{
+    static CCStr months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                             "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    char mon[4] = {0};
+    int day = 0, year = 0, hh = 0, mm = 0, ss = 0;
+    // Extract the date components
+    if (sscanf(str, "%*3s, %d %3s %d %d:%d:%d", &day, mon, &year, &hh, &mm, &ss) != 6)
+    {
+        return false;
+    }
+    // Identify the month
+    int m = 0;
+    while (m < 12 && strcmp(mon, months[m]) != 0)
+    {
+        ++m;
+    }
+    // Was this a known month?
+    if (m >= 12)
+    {
+        return false;
+    }
+    // Convert the civil date to days since epoch (no timegm() on every platform)
+    const int y = (m < 2) ? year - 1 : year;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const int yoe = y - era * 400;
+    const int doy = (153 * (m + (m > 1 ? -2 : 10)) + 2) / 5 + day - 1;
+    const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    const long long days = static_cast< long long >(era) * 146097 + doe - 719468;
+    // Combine with the time of day
+    out = static_cast< std::time_t >(days * 86400 + hh * 3600 + mm * 60 + ss);
+    // Successfully parsed
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+long IntervalFromResponse(const Response & res)
+{
+    CCStr value = nullptr;
+    // Our own header takes precedence since it was meant specifically for announcers
+    if ((value = res.Find("VCMP-Announce-Interval")) != nullptr)
+    {
+        return std::strtol(value, nullptr, 10);
+    }
+    // Retry-After can be either a number of seconds or a date
+    if ((value = res.Find("Retry-After")) != nullptr)
+    {
+        // Is this a number of seconds?
+        if (isdigit(static_cast< unsigned char >(value[0])))
+        {
+            return std::strtol(value, nullptr, 10);
+        }
+        std::time_t when = 0;
+        // Is this a date?
+        if (ParseHttpDate(value, when))
+        {
+            const std::time_t now = std::time(nullptr);
+            // Dates in the past simply mean "right away"
+            return when > now ? static_cast< long >(when - now) : 1;
+        }
+    }
+    // Cache-Control can have several directives so we look for the one we need
+    if ((value = res.Find("Cache-Control")) != nullptr)
+    {
+        static const char directive[] = "max-age=";
+        // Directives are case insensitive
+        for (CCStr itr = value; *itr != '\0'; ++itr)
+        {
+            size_t n = 0;
+            // Compare as much of the directive as we can
+            while (n < sizeof(directive) - 1 && tolower(static_cast< unsigned char >(itr[n])) == directive[n])
+            {
+                ++n;
+            }
+            // Is this the max-age directive?
+            if (n == sizeof(directive) - 1)
+            {
+                return std::strtol(itr + n, nullptr, 10);
+            }
+        }
+    }
+    // The master-server has no preference
+    return 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+uint32_t StableHash(const String & str)
+{
+    uint32_t hash = 2166136261u;
+    // Mix every character into the hash
+    for (const char c : str)
+    {
+        hash ^= static_cast< uint8_t >(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// ------------------------------------------------------------------------------------------------
+std::chrono::milliseconds PhaseOffset(uint32_t hash, uint32_t slot)
+{
+    const uint64_t fraction = static_cast< uint32_t >(hash + slot * 2654435769u);
+    return std::chrono::milliseconds((fraction * (g_UpdateInterval * 1000ull)) >> 32);
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Coordinator::Open(CCStr path)
+{
+#ifdef SMOD_OS_WINDOWS
+    OutputError("Announce coordination is not supported on this platform");
+    SMOD_UNUSED_VAR(path);
+    return false;
+#else
+    // Open the file shared by all instances
+    m_File = open(path, O_RDWR | O_CREAT, 0666);
+    // Could we open it?
+    if (m_File < 0)
+    {
+        OutputError("Unable to open announce coordination file: %s", path);
+        return false;
+    }
+    // Grab exclusive access while the file is being prepared
+    flock(m_File, LOCK_EX);
+    // Make sure the file is large enough
+    struct stat st;
+    if (fstat(m_File, &st) != 0 || (static_cast< size_t >(st.st_size) < sizeof(SharedTable) &&
+                                    ftruncate(m_File, sizeof(SharedTable)) != 0))
+    {
+        flock(m_File, LOCK_UN);
+        OutputError("Unable to size announce coordination file: %s", path);
+        Close();
+        return false;
+    }
+    // Map the file into our memory
+    void * data = mmap(nullptr, sizeof(SharedTable), PROT_READ | PROT_WRITE, MAP_SHARED, m_File, 0);
+    // Could we map it?
+    if (data == MAP_FAILED)
+    {
+        flock(m_File, LOCK_UN);
+        OutputError("Unable to map announce coordination file: %s", path);
+        Close();
+        return false;
+    }
+    m_Table = static_cast< SharedTable * >(data);
+    // Is this a new file or one with an incompatible layout?
+    if (m_Table->mMagic != SharedTable::MAGIC || m_Table->mVersion != SharedTable::VERSION ||
+        m_Table->mCount != SharedTable::COUNT)
+    {
+        memset(m_Table, 0, sizeof(SharedTable));
+        m_Table->mMagic = SharedTable::MAGIC;
+        m_Table->mVersion = SharedTable::VERSION;
+        m_Table->mCount = SharedTable::COUNT;
+    }
+    // Allow other instances to use it
+    flock(m_File, LOCK_UN);
+    // File is ready to be used
+    return true;
+#endif // SMOD_OS_WINDOWS
+}
+
+// ------------------------------------------------------------------------------------------------
+void Coordinator::Close()
+{
+#ifndef SMOD_OS_WINDOWS
+    if (m_Table)
+    {
+        munmap(m_Table, sizeof(SharedTable));
+    }
+    if (m_File >= 0)
+    {
+        close(m_File);
+    }
+#endif // SMOD_OS_WINDOWS
+    m_Table = nullptr;
+    m_File = -1;
+}
+
+// ------------------------------------------------------------------------------------------------
+uint32_t Coordinator::Ticket(const URI & addr)
+{
+    Lock lock(m_File);
+    // Locate the master-server entry
+    SharedMaster * m = Find(addr);
+    // Hand out the next slot
+    return m ? m->mTickets++ : 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Coordinator::IsDown(const URI & addr, bool probe)
+{
+    Lock lock(m_File);
+    // Locate the master-server entry
+    SharedMaster * m = Find(addr);
+    // Is it considered to be down?
+    if (!m || m->mDownUntil == 0)
+    {
+        return false;
+    }
+    const int64_t now = static_cast< int64_t >(std::time(nullptr));
+    // Still waiting for it to recover?
+    if (now < m->mDownUntil)
+    {
+        return true;
+    }
+    // We get to probe it while the others wait, if we're going to
+    if (probe)
+    {
+        m->mDownUntil = now + g_UpdateInterval;
+    }
+    return false;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Coordinator::Report(const URI & addr, bool alive)
+{
+    Lock lock(m_File);
+    // Locate the master-server entry
+    SharedMaster * m = Find(addr);
+    // Nothing to update?
+    if (!m)
+    {
+        return;
+    }
+    // Did it respond?
+    if (alive)
+    {
+        m->mFails = 0;
+        m->mDownUntil = 0;
+    }
+    // Has it failed enough times to be considered down?
+    else if (++m->mFails >= DOWN_AFTER)
+    {
+        // Back off exponentially, within the configured ceiling
+        const uint32_t shift = std::min(m->mFails - DOWN_AFTER, 6u);
+        const int64_t wait = std::min(static_cast< int64_t >(g_UpdateInterval) << shift,
+                                      static_cast< int64_t >(g_MaxInterval));
+        m->mDownUntil = static_cast< int64_t >(std::time(nullptr)) + wait;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Coordinator::Resolve(const URI & addr, String & out)
+{
+    const int64_t now = static_cast< int64_t >(std::time(nullptr));
+    {
+        Lock lock(m_File);
+        // Locate the master-server entry
+        SharedMaster * m = Find(addr);
+        // Nowhere to store it?
+        if (!m)
+        {
+            return false;
+        }
+        // Do we have an address that is still fresh?
+        if (m->mResolved[0] != '\0' && now - m->mResolvedAt < RESOLVE_TTL)
+        {
+            out.assign(m->mResolved);
+            return true;
+        }
+        // Let the other instances use the stale address while we resolve it
+        m->mResolvedAt = now;
+    }
+    // Resolve the address without holding the lock
+    if (!ResolveHost(addr, out))
+    {
+        return false;
+    }
+    Lock lock(m_File);
+    // Locate the master-server entry again
+    SharedMaster * m = Find(addr);
+    // Share the resolved address
+    if (m)
+    {
+        snprintf(m->mResolved, sizeof(m->mResolved), "%s", out.c_str());
+        m->mResolvedAt = now;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+Coordinator::Lock::Lock(int file)
+    : m_File(file)
+{
+#ifndef SMOD_OS_WINDOWS
+    flock(m_File, LOCK_EX);
+#endif // SMOD_OS_WINDOWS
+}
+
+// ------------------------------------------------------------------------------------------------
+Coordinator::Lock::~Lock()
+{
+#ifndef SMOD_OS_WINDOWS
+    flock(m_File, LOCK_UN);
+#endif // SMOD_OS_WINDOWS
+}
+
+// ------------------------------------------------------------------------------------------------
+SharedMaster * Coordinator::Find(const URI & addr)
+{
+    // Entries are keyed by host and port only
+    const uint32_t key = StableHash(addr.mAddr) | 1u;
+    // Probe the table starting from the preferred slot
+    for (uint32_t i = 0; i < SharedTable::COUNT; ++i)
+    {
+        SharedMaster & m = m_Table->mMasters[(key + i) % SharedTable::COUNT];
+        // Is this the entry we're looking for? Only as much of the address as fits is kept
+        if (m.mKey == key && strncmp(addr.Addr(), m.mHost, sizeof(m.mHost) - 1) == 0)
+        {
+            return &m;
+        }
+        // Is this slot free?
+        else if (m.mKey == 0)
+        {
+            m.mKey = key;
+            snprintf(m.mHost, sizeof(m.mHost), "%s", addr.Addr());
+            return &m;
+        }
+    }
+    // The table is full
+    return nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool StateFile::Open(CCStr path)
+{
+#ifdef SMOD_OS_WINDOWS
+    OutputError("Announce state file is not supported on this platform");
+    SMOD_UNUSED_VAR(path);
+    return false;
+#else
+    // Open the file left by the previous run
+    m_File = open(path, O_RDWR | O_CREAT, 0644);
+    // Could we open it?
+    if (m_File < 0)
+    {
+        OutputError("Unable to open announce state file: %s", path);
+        return false;
+    }
+    // Entries are updated without locking so only one process may use the file
+    if (flock(m_File, LOCK_EX | LOCK_NB) != 0)
+    {
+        OutputError("Announce state file is used by another process: %s", path);
+        Close();
+        return false;
+    }
+    // Make sure the file is large enough
+    struct stat st;
+    if (fstat(m_File, &st) != 0 || (static_cast< size_t >(st.st_size) < sizeof(SavedTable) &&
+                                    ftruncate(m_File, sizeof(SavedTable)) != 0))
+    {
+        OutputError("Unable to size announce state file: %s", path);
+        Close();
+        return false;
+    }
+    // Map the file into our memory
+    void * data = mmap(nullptr, sizeof(SavedTable), PROT_READ | PROT_WRITE, MAP_SHARED, m_File, 0);
+    // Could we map it?
+    if (data == MAP_FAILED)
+    {
+        OutputError("Unable to map announce state file: %s", path);
+        Close();
+        return false;
+    }
+    m_Table = static_cast< SavedTable * >(data);
+    // Is this a new file or one with an incompatible layout?
+    if (m_Table->mMagic != SavedTable::MAGIC || m_Table->mVersion != SavedTable::VERSION ||
+        m_Table->mCount != SavedTable::COUNT)
+    {
+        memset(m_Table, 0, sizeof(SavedTable));
+        m_Table->mMagic = SavedTable::MAGIC;
+        m_Table->mVersion = SavedTable::VERSION;
+        m_Table->mCount = SavedTable::COUNT;
+    }
+    // File is ready to be used
+    return true;
+#endif // SMOD_OS_WINDOWS
+}
+
+// ------------------------------------------------------------------------------------------------
+void StateFile::Close()
+{
+#ifndef SMOD_OS_WINDOWS
+    if (m_Table)
+    {
+        // The kernel writes the pages eventually, but don't leave it to chance on shutdown
+        msync(m_Table, sizeof(SavedTable), MS_SYNC);
+        munmap(m_Table, sizeof(SavedTable));
+    }
+    if (m_File >= 0)
+    {
+        close(m_File);
+    }
+#endif // SMOD_OS_WINDOWS
+    m_Table = nullptr;
+    m_File = -1;
+}
+
+// ------------------------------------------------------------------------------------------------
+SavedMaster * StateFile::Find(const URI & addr, uint32_t port)
+{
+    // Entries are keyed by the full address and the announced port
+    const uint32_t key = (StableHash(addr.mFull) ^ (port * 0x9E3779B1u)) | 1u;
+    // Probe the table starting from the preferred slot
+    for (uint32_t i = 0; i < SavedTable::COUNT; ++i)
+    {
+        SavedMaster & m = m_Table->mMasters[(key + i) % SavedTable::COUNT];
+        // Is this the entry we're looking for? Only as much of the address as fits is kept
+        if (m.mKey == key && m.mPort == port && strncmp(addr.Full(), m.mFull, sizeof(m.mFull) - 1) == 0)
+        {
+            return &m;
+        }
+        // Is this slot free?
+        else if (m.mKey == 0)
+        {
+            memset(&m, 0, sizeof(m));
+            m.mKey = key;
+            m.mPort = port;
+            snprintf(m.mFull, sizeof(m.mFull), "%s", addr.Full());
+            return &m;
+        }
+    }
+    // The table is full
+    return nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Coordinator::ResolveHost(const URI & addr, String & out)
+{
+    struct addrinfo hints;
+    struct addrinfo * result = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    // Ask the system resolver
+    if (getaddrinfo(addr.Host(), addr.Port(), &hints, &result) != 0 || !result)
+    {
+        return false;
+    }
+    char host[NI_MAXHOST];
+    // Obtain the numeric representation of the first address
+    const int ret = getnameinfo(result->ai_addr, static_cast< socklen_t >(result->ai_addrlen),
+                                host, sizeof(host), nullptr, 0, NI_NUMERICHOST);
+    freeaddrinfo(result);
+    // Was it obtained?
+    if (ret != 0)
+    {
+        return false;
+    }
+    out.assign(host);
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Recorder::Open(CCStr path)
+{
+    // Acquire a global lock
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    // Finish any previous trace
+    if (m_File)
+    {
+        fclose(m_File);
+    }
+    m_Masters.clear();
+    // Create the trace file
+    m_File = fopen(path, "wb");
+    // Could we create it?
+    if (!m_File)
+    {
+        OutputError("Unable to create announce trace file: %s", path);
+        return false;
+    }
+    // Identify the file and layout
+    Put< uint32_t >(SMOD_TRACE_MAGIC);
+    Put< uint32_t >(SMOD_TRACE_VERSION);
+    fflush(m_File);
+    // Ready to capture
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Recorder::Close()
+{
+    // Acquire a global lock
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    // Is there a trace to finish?
+    if (m_File)
+    {
+        fclose(m_File);
+        m_File = nullptr;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Recorder::Capture(const URI & addr, uint64_t time, uint32_t latency, const Response * res)
+{
+    // Acquire a global lock
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    // Was the trace closed in the mean time?
+    if (!m_File)
+    {
+        return;
+    }
+    const String full(addr.Full());
+    auto itr = m_Masters.find(full);
+    // Is this the first time we see this master-server?
+    if (itr == m_Masters.end())
+    {
+        itr = m_Masters.emplace(full, static_cast< uint32_t >(m_Masters.size())).first;
+        // Let the reader know which address the identifier stands for
+        Put< uint8_t >(EntryMaster);
+        Put< uint32_t >(itr->second);
+        Put(full.c_str());
+    }
+    Put< uint8_t >(EntryResponse);
+    Put< uint32_t >(itr->second);
+    Put< uint64_t >(time);
+    Put< uint32_t >(latency);
+    // Was there a response at all?
+    if (!res)
+    {
+        Put< uint16_t >(0);
+        Put< uint32_t >(0);
+        Put< uint16_t >(0);
+    }
+    else
+    {
+        Put< uint16_t >(static_cast< uint16_t >(res->mStatus));
+        Put< uint32_t >(static_cast< uint32_t >(res->mBodySize));
+        Put< uint16_t >(static_cast< uint16_t >(res->mHeaderCount));
+        // Include the response headers
+        for (size_t i = 0; i < res->mHeaderCount; ++i)
+        {
+            Put(res->mHeaders[i].mName);
+            Put(res->mHeaders[i].mValue);
+        }
+    }
+    // Don't lose the entry if the process goes away
+    fflush(m_File);
+}
+
+// ------------------------------------------------------------------------------------------------
+void Recorder::Put(CCStr str)
+{
+    const uint16_t len = static_cast< uint16_t >(std::min< size_t >(strlen(str), UINT16_MAX));
+    // Write the length followed by the characters
+    Put< uint16_t >(len);
+    fwrite(str, 1, len, m_File);
+}
+
+// ------------------------------------------------------------------------------------------------
+Server::Server(URI && addr)
+    : m_Transport()
+    , m_Valid(std::strtoul(addr.mPort.c_str(), nullptr, 10) - 1 < 65535)
+    , m_Addr(std::forward< URI >(addr)), m_Headers{{"User-Agent", "VCMP/0.4"}}, m_Params(), m_Request()
+    , m_Connect(m_Addr.mHost), m_Moved(), m_MovedRequest(), m_MovedPath(), m_Sent()
+    , m_Flight(g_Flight.Master(m_Addr.Full())), m_MovedOnce(false), m_Hops(0)
+{
+    if (!m_Valid)
+    {
+        VerboseError("Master-server '%s' was marked as invalid",
+                        m_Addr.Full());
+    }
+    else
+    {
+        m_Transport.SetTarget(m_Addr.mHost, m_Addr.mPort);
+        m_Transport.SetTimeout(CONNECT_TIMEOUT);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+Server::Server(Server && o)
+    : m_Transport(std::move(o.m_Transport))
+    , m_Valid(o.m_Valid)
+    , m_Addr(std::forward< URI >(o.m_Addr))
+    , m_Headers(std::forward< Headers >(o.m_Headers))
+    , m_Params(std::forward< Params >(o.m_Params))
+    , m_Request(std::forward< String >(o.m_Request))
+    , m_Connect(std::forward< String >(o.m_Connect))
+    , m_Moved(std::move(o.m_Moved))
+    , m_MovedRequest(std::forward< String >(o.m_MovedRequest))
+    , m_MovedPath(std::forward< String >(o.m_MovedPath))
+    , m_Sent(o.m_Sent), m_Flight(o.m_Flight), m_MovedOnce(o.m_MovedOnce), m_Hops(o.m_Hops)
+{
+}
+
+// ------------------------------------------------------------------------------------------------
+Server & Server::operator = (Server && o)
+{
+    if (this != &o)
+    {
+        m_Transport = std::move(o.m_Transport);
+        m_Valid = o.m_Valid;
+        m_Addr = std::forward< URI >(o.m_Addr);
+        m_Headers = std::forward< Headers >(o.m_Headers);
+        m_Params = std::forward< Params >(o.m_Params);
+        m_Request = std::forward< String >(o.m_Request);
+        m_Connect = std::forward< String >(o.m_Connect);
+        m_Moved = std::move(o.m_Moved);
+        m_MovedRequest = std::forward< String >(o.m_MovedRequest);
+        m_MovedPath = std::forward< String >(o.m_MovedPath);
+        m_Sent = o.m_Sent;
+        m_Flight = o.m_Flight;
+        m_MovedOnce = o.m_MovedOnce;
+        m_Hops = o.m_Hops;
+    }
+    return *this;
+}
+
+// ------------------------------------------------------------------------------------------------
+Transport::Socket Server::Begin()
+{
+    // The wait for the answer starts now
+    m_Sent = Clock::now();
+    // Go straight to where the master-server moved, if it did
+    return m_MovedRequest.empty() ? m_Transport.Begin(m_Request) : m_Moved.Begin(m_MovedRequest);
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Server::CanSendAhead(const MasterTable & table, size_t idx) const
+{
+    // Skipped master-servers send nothing and moved ones are announced on somewhere else, unless
+    // there's no thread that could do it and the announce is sent to where they moved instead. The
+    // probe of a master-server that was down is only claimed once the answer is handled
+    return table.mState[idx] == MasterTable::Active && !m_Request.empty() &&
+            (m_MovedRequest.empty() || g_FrameBudget != 0) &&
+            !(g_Coordinator.IsOpen() && g_Coordinator.IsDown(m_Addr, false));
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Server::Prefetch()
+{
+    // The announce goes to where the master-server moved, if it did
+    return (m_MovedRequest.empty() ? m_Transport : m_Moved).Prefetch();
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::Prepare(IoJob & job, Response & res)
+{
+    // The wait for the answer starts now
+    m_Sent = Clock::now();
+    // Go straight to where the master-server moved, if it did
+    const String & request = m_MovedRequest.empty() ? m_Request : m_MovedRequest;
+    job.mTransport = m_MovedRequest.empty() ? &m_Transport : &m_Moved;
+    job.mRequest = request.data();
+    job.mSize = request.size();
+    job.mResponse = &res;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::Queue(String & out, bool more)
+{
+    static CCStr close = "Connection: close\r\n";
+    // The wait for the answer starts now
+    m_Sent = Clock::now();
+    CCStr header = more ? strstr(m_Request.c_str(), close) : nullptr;
+    // Is the connection needed for the requests that follow?
+    if (header)
+    {
+        out.append(m_Request.c_str(), header).append("Connection: keep-alive\r\n");
+        out.append(header + strlen(close), m_Request.c_str() + m_Request.size());
+    }
+    else
+    {
+        out.append(m_Request);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::Failed(MasterTable & table, size_t idx)
+{
+    // After one thousand failed attempts, there's no point in insisting
+    if (++table.mFails[idx] >= INVALID_AFTER)
+    {
+        MtVerboseError("Master-server '%s' was marked as invalid after %u failures",
+                        m_Addr.Full(), static_cast< unsigned >(table.mFails[idx]));
+        // Block further updates
+        table.mState[idx] = MasterTable::Invalid;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::MakeValid(MasterTable & table, size_t idx)
+{
+    // Reset the counter
+    table.mFails[idx] = 0;
+    // Allow further updates
+    table.mState[idx] = MasterTable::Active;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::ConfigureServer(unsigned version, unsigned port)
+{
+    // A new payload replaces the previous one instead of being sent next to it
+    m_Headers.erase("VCMP-Version");
+    m_Params.clear();
+    m_Headers.emplace("VCMP-Version", std::to_string(version));
+    m_Params.emplace("port", std::to_string(port));
+    // Encode the request once instead of on every announce
+    Encode();
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Append the specified path or parameter value, encoded the same way the HTTP client always did.
+*/
+template < typename S > static void AppendPath(S & out, CCStr path)
+{
+    static CCStr hex = "0123456789ABCDEF";
+    // Escape what can't be sent as is
+    for (; *path != '\0'; ++path)
+    {
+        const unsigned char c = static_cast< unsigned char >(*path);
+        // Does this character need to be escaped?
+        if (c >= 0x80 || strchr(" +\r\n',;", c))
+        {
+            out.push_back('%');
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 0xF]);
+        }
+        else
+        {
+            out.push_back(*path);
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Split an absolute address into host, port and path the same way a URI would. Returns false if
+ * the address uses a protocol other than plain HTTP, which can't be followed.
+*/
+static bool SplitAddress(CCStr address, ArenaString & host, ArenaString & port, ArenaString & path)
+{
+    // Skip the protocol if it was specified
+    if (strncmp(address, "http://", 7) == 0)
+    {
+        address += 7;
+    }
+    // Sending it over plain HTTP instead would be a downgrade, not a redirect
+    else if (strstr(address, "://"))
+    {
+        return false;
+    }
+    // Find where the port and path start
+    CCStr sep = strchr(address, ':');
+    CCStr dir = strchr(sep ? sep : address, '/');
+    // Everything until the first separator is the host
+    host.assign(address, sep ? sep : (dir ? dir : address + strlen(address)));
+    // Use the default port unless one was specified
+    if (sep)
+    {
+        port.assign(sep + 1, dir ? dir : sep + strlen(sep));
+    }
+    else
+    {
+        port.assign("80");
+    }
+    // Use the root unless a path was specified
+    path.assign(dir ? dir : "/");
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::Encode()
+{
+    String body;
+    // Form encoded parameters
+    for (const auto & param : m_Params)
+    {
+        // Separate them from the previous one
+        if (!body.empty())
+        {
+            body.push_back('&');
+        }
+        body.append(param.first).push_back('=');
+        AppendPath(body, param.second.c_str());
+    }
+    // Request line
+    m_Request.assign("POST ");
+    AppendPath(m_Request, m_Addr.Path());
+    m_Request.append(" HTTP/1.1\r\n");
+    // Headers the master-server expects from any HTTP client
+    m_Request.append("Accept: */*\r\nConnection: close\r\n");
+    m_Request.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n");
+    m_Request.append("Content-Type: application/x-www-form-urlencoded\r\n");
+    // The master-server must always see the name it is known by
+    if (m_Headers.find("Host") == m_Headers.end())
+    {
+        m_Request.append("Host: ").append(m_Addr.mPort == "80" ? m_Addr.mHost : m_Addr.mAddr).append("\r\n");
+    }
+    // Our own headers
+    for (const auto & hdr : m_Headers)
+    {
+        m_Request.append(hdr.first).append(": ").append(hdr.second).append("\r\n");
+    }
+    // The payload
+    m_Request.append("\r\n").append(body);
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::Start(MasterTable & table, size_t idx, TimePoint now, uint32_t slot)
+{
+    TimePoint & next = table.mNext[idx];
+    next = now;
+    // Stagger our announces with those of other instances on this machine
+    if (g_Coordinator.IsOpen())
+    {
+        next += PhaseOffset(StableHash(m_Addr.mAddr), g_Coordinator.Ticket(m_Addr));
+    }
+    // Give each master-server its own slot within the interval when pacing
+    else if (g_Pacing)
+    {
+        next += PhaseOffset(StableHash(m_Addr.mFull), slot);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::Reconnect(const String & host)
+{
+    // The request already names the master-server so only the destination changes
+    m_Transport.SetTarget(host, m_Addr.mPort);
+    // Remember where we connect to
+    m_Connect = host;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::Schedule(MasterTable & table, size_t idx, TimePoint now)
+{
+    TimePoint & next = table.mNext[idx];
+    next += std::chrono::seconds(table.mInterval[idx]);
+    // Did we fall too far behind? (slow master-servers or the system was suspended)
+    if (next <= now)
+    {
+        next = now + std::chrono::seconds(table.mInterval[idx]);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::Save(const MasterTable & table, size_t idx, SavedMaster & out) const
+{
+    const int64_t now = std::chrono::duration_cast< std::chrono::microseconds >(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+    // The deadline is kept as wall clock time since the steady clock doesn't survive a restart
+    out.mNextAt = now + std::chrono::duration_cast< std::chrono::microseconds >(table.mNext[idx] - Clock::now()).count();
+    out.mFails = table.mFails[idx];
+    out.mState = table.mState[idx];
+    out.mInterval = table.mInterval[idx];
+    out.mLatency = table.mLatency[idx];
+    // Remember where the master-server moved, unless it was only for one announce or doesn't fit
+    out.mMoved = m_MovedRequest.empty() || m_MovedOnce || m_Moved.GetHost().size() >= sizeof(out.mMovedHost) ||
+                    m_Moved.GetPort().size() >= sizeof(out.mMovedPort) ||
+                    m_MovedPath.size() >= sizeof(out.mMovedPath) ? 0 : 1;
+    if (out.mMoved)
+    {
+        snprintf(out.mMovedHost, sizeof(out.mMovedHost), "%s", m_Moved.GetHost().c_str());
+        snprintf(out.mMovedPort, sizeof(out.mMovedPort), "%s", m_Moved.GetPort().c_str());
+        snprintf(out.mMovedPath, sizeof(out.mMovedPath), "%s", m_MovedPath.c_str());
+    }
+    int64_t age = 0;
+    // Remember the address of whichever host is announced on
+    out.mAddressLen = static_cast< uint32_t >((out.mMoved ? m_Moved : m_Transport).ExportAddress(
+                                                out.mAddress, sizeof(out.mAddress), age));
+    out.mResolvedAt = now / 1000000 - age;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::Restore(MasterTable & table, size_t idx, const SavedMaster & in, TimePoint now)
+{
+    // Was anything saved?
+    if (in.mNextAt == 0)
+    {
+        return;
+    }
+    const int64_t wall = std::chrono::duration_cast< std::chrono::microseconds >(
+                            std::chrono::system_clock::now().time_since_epoch()).count();
+    // Keep the learned interval if it's still within the configured limits
+    if (in.mInterval >= g_MinInterval && in.mInterval <= g_MaxInterval)
+    {
+        table.mInterval[idx] = in.mInterval;
+    }
+    // Keep the previous deadline, unless it passed or the clock moved too far
+    const int64_t wait = in.mNextAt - wall;
+    if (wait > 0 && wait <= static_cast< int64_t >(table.mInterval[idx]) * 1000000)
+    {
+        table.mNext[idx] = now + std::chrono::microseconds(wait);
+    }
+    else
+    {
+        table.mNext[idx] = now;
+    }
+    table.mLatency[idx] = in.mLatency;
+    table.mFails[idx] = in.mFails;
+    // Was it given up on? Then probe it once right away, one more failure gives up on it again
+    if (m_Valid && in.mState == MasterTable::Invalid)
+    {
+        table.mFails[idx] = std::max(in.mFails, static_cast< uint16_t >(INVALID_AFTER - 1));
+        table.mNext[idx] = now;
+        VerboseMessage("Master-server '%s' was invalid after %u failures, probing it once", m_Addr.Full(),
+                        static_cast< unsigned >(in.mFails));
+    }
+    // Go straight to where the master-server moved
+    if (in.mMoved && in.mMovedHost[0] != '\0' && memchr(in.mMovedPath, '\0', sizeof(in.mMovedPath)))
+    {
+        const String host(in.mMovedHost, strnlen(in.mMovedHost, sizeof(in.mMovedHost)));
+        const String port(in.mMovedPort, strnlen(in.mMovedPort, sizeof(in.mMovedPort)));
+        Retarget(m_MovedRequest, host.c_str(), port.c_str(), in.mMovedPath);
+        m_MovedPath.assign(in.mMovedPath);
+        m_Moved.SetTarget(host, port);
+        m_Moved.SetTimeout(CONNECT_TIMEOUT);
+        VerboseMessage("Master-server '%s' moved permanently to `%s`", m_Addr.Full(), host.c_str());
+    }
+    // Connect to the last known address without resolving it again while it's fresh
+    (m_MovedRequest.empty() ? m_Transport : m_Moved).ImportAddress(in.mAddress,
+        std::min< size_t >(in.mAddressLen, sizeof(in.mAddress)), wall / 1000000 - in.mResolvedAt);
+}
+
+// ------------------------------------------------------------------------------------------------
+Server::Result Server::Update(MasterTable & table, size_t idx, TimePoint now, Response & res, Arena & arena,
+                                Transport::Socket pending, bool received)
+{
+    uint32_t & interval = table.mInterval[idx];
+    // Remember the previous interval to know when it changes
+    const unsigned previous = interval;
+    // Assume the configured interval unless told otherwise
+    interval = g_UpdateInterval;
+    // Let the log know which master-server the following messages are about
+    SetLogContext(m_Addr.Full(), "skip");
+    // This master-list working?
+    if (table.mState[idx] != MasterTable::Active || m_Request.empty())
+    {
+        MtVerboseMessage("Skipping invalid master-list: `%s`", m_Addr.Full());
+        g_Flight.Record(m_Flight, FlightSkip);
+        // Drop the announce if it was already sent
+        Transport::Abandon(pending);
+        EndRedirects();
+        // Check again after the usual interval
+        Schedule(table, idx, now);
+        return Skipped; // No point int trying to announce to thi server anymore
+    }
+    // Was the announce already sent along with others?
+    const bool sent = pending != Transport::NO_SOCKET || received;
+    // Coordinating with other instances on this machine?
+    if (g_Coordinator.IsOpen())
+    {
+        // Did another instance find this master-server to be down? One that was sent is the probe
+        if (g_Coordinator.IsDown(m_Addr) && !sent)
+        {
+            MtVerboseMessage("Skipping master-list reported as down: `%s`", m_Addr.Full());
+            g_Flight.Record(m_Flight, FlightSkip);
+            // Drop the announce if it was already sent
+            Transport::Abandon(pending);
+            EndRedirects();
+            // Check again after the usual interval
+            Schedule(table, idx, now);
+            return Skipped;
+        }
+        String host;
+        // Use the address resolved by whichever instance got to it first
+        if (g_Coordinator.Resolve(m_Addr, host) && host != m_Connect)
+        {
+            Reconnect(host);
+        }
+    }
+    SetLogContext(m_Addr.Full(), "announce");
+    MtVerboseMessage("Announcing on master-list: `%s`", m_Addr.Full());
+    // An announce that was already sent is timed from when it was sent
+    const TimePoint start = sent ? m_Sent : Clock::now();
+    const bool degraded = GetPath().mDegraded;
+    // Without a thread, nothing may block and every further exchange is left for the next step
+    const bool deferring = g_FrameBudget != 0 && received;
+    // Was the answer to the announce a redirect that must be followed on the next step?
+    if (deferring && res.mStatus > 300 && res.mStatus < 400 && res.Find("Location") &&
+        (m_Hops > 0 || m_MovedRequest.empty()) && m_Hops < REDIRECT_MAX)
+    {
+        SetLogContext(m_Addr.Full(), "redirect", 0, res.mStatus);
+        g_Flight.Record(m_Flight, FlightRedirect, res.mStatus);
+        // Only a chain made entirely of permanent redirects is remembered
+        if (Redirect(res, arena, (res.mStatus == 301 || res.mStatus == 308) && !m_MovedOnce, false))
+        {
+            ++m_Hops;
+            // Send it there as soon as possible
+            interval = previous;
+            table.mNext[idx] = now;
+            return Deferred;
+        }
+        // Otherwise the announce ends here, unanswered
+    }
+    bool ok = false;
+    // Did the master-server move permanently? Then skip the redirects and go there directly
+    if (!m_MovedRequest.empty())
+    {
+        // Was the announce already sent ahead? Then the status tells whether it was answered
+        if (received)
+        {
+            ok = res.mStatus >= 200 && res.mStatus < 300;
+        }
+        else
+        {
+            ok = (pending != Transport::NO_SOCKET ? m_Moved.Finish(pending, res) : m_Moved.Exchange(m_MovedRequest, res))
+                    && res.mStatus >= 200 && res.mStatus < 300;
+        }
+        // The announce that was already sent went there
+        pending = Transport::NO_SOCKET;
+        // Was it where a redirect of this announce led? Then the answer is the outcome either way
+        if (m_Hops > 0)
+        {
+            // Leave the answer for the configured address below, as if it came from there
+            if (ok && m_MovedOnce)
+            {
+                ok = false;
+            }
+            else if (ok)
+            {
+                MtVerboseMessage("Master-server '%s' moved permanently, announcing on `%s` directly",
+                                    m_Addr.Full(), m_Moved.GetHost().c_str());
+                g_Flight.Record(m_Flight, FlightMoved, res.mStatus);
+            }
+            // Don't go there again unless it's where the master-server lives from now on
+            if (!ok)
+            {
+                m_MovedRequest.clear();
+                m_MovedOnce = false;
+            }
+        }
+        // Anything but success means the configured address must be asked again
+        else if (!ok)
+        {
+            MtVerboseMessage("Master-server '%s' failed at `%s`, trying the configured address again",
+                                m_Addr.Full(), m_Moved.GetHost().c_str());
+            g_Flight.Record(m_Flight, FlightRevalidate, res.mStatus);
+            m_MovedRequest.clear();
+            // Ask it on the next step instead of waiting here
+            if (deferring)
+            {
+                ++m_Hops;
+                interval = previous;
+                table.mNext[idx] = now;
+                return Deferred;
+            }
+        }
+    }
+    // Announce on the configured address?
+    if (!ok)
+    {
+        // Was the announce already sent ahead? Then the status tells whether it was answered
+        if (received)
+        {
+            ok = res.mStatus != 0;
+        }
+        else
+        {
+            ok = pending != Transport::NO_SOCKET ? m_Transport.Finish(pending, res) : m_Transport.Exchange(m_Request, res);
+        }
+        // Only a chain made entirely of permanent redirects is remembered
+        bool permanent = true;
+        // Follow redirects like any HTTP client would, unless they must wait for the next step
+        for (unsigned n = deferring ? REDIRECT_MAX : 0; ok && res.mStatus > 300 && res.mStatus < 400 && n < REDIRECT_MAX && res.Find("Location"); ++n)
+        {
+            SetLogContext(m_Addr.Full(), "redirect", 0, res.mStatus);
+            g_Flight.Record(m_Flight, FlightRedirect, res.mStatus);
+            permanent = permanent && (res.mStatus == 301 || res.mStatus == 308);
+            ok = Redirect(res, arena, permanent);
+        }
+        // Was a permanent redirect followed?
+        if (!m_MovedRequest.empty())
+        {
+            // Only go there directly if the master-server accepted the announce
+            if (ok && res.mStatus >= 200 && res.mStatus < 300)
+            {
+                MtVerboseMessage("Master-server '%s' moved permanently, announcing on `%s` directly",
+                                    m_Addr.Full(), m_Moved.GetHost().c_str());
+                g_Flight.Record(m_Flight, FlightMoved, res.mStatus);
+            }
+            else
+            {
+                m_MovedRequest.clear();
+            }
+        }
+    }
+    // The announce ended, wherever it led
+    EndRedirects();
+    const uint32_t latency = static_cast< uint32_t >(std::chrono::duration_cast< std::chrono::microseconds >(
+                                Clock::now() - start).count());
+    // The remaining messages are about the outcome
+    SetLogContext(m_Addr.Full(), "response", latency, ok ? res.mStatus : 0);
+    g_Flight.Record(m_Flight, FlightResponse, ok ? res.mStatus : 0, latency);
+    // Let the user know when the network path to the master-server changes for the worse or better
+    if (GetPath().mDegraded != degraded)
+    {
+        const PathStats & path = GetPath();
+        // Which way did it go?
+        if (path.mDegraded)
+        {
+            MtVerboseError("Network path to master-server '%s' degraded: rtt %u us (best %u us), %u retransmits",
+                            m_Addr.Full(), path.mRtt, path.mMinRtt, path.mLastRetransmits);
+        }
+        else
+        {
+            MtVerboseMessage("Network path to master-server '%s' recovered: rtt %u us", m_Addr.Full(), path.mRtt);
+        }
+    }
+    // Are we capturing the announce traffic?
+    if (g_Recorder.IsOpen())
+    {
+        const auto since = std::chrono::system_clock::now().time_since_epoch();
+        g_Recorder.Capture(m_Addr,
+            static_cast< uint64_t >(std::chrono::duration_cast< std::chrono::microseconds >(since).count()),
+            latency, ok ? &res : nullptr);
+    }
+    // Let the other instances know whether the master-server is alive
+    if (g_Coordinator.IsOpen())
+    {
+        g_Coordinator.Report(m_Addr, ok && res.mStatus < 500);
+    }
+    // Did we even get a response?
+    if (!ok)
+    {
+        MtVerboseError("Master-server '%s' could not be reached", m_Addr.Full());
+        // This operation failed
+        Failed(table, idx);
+        // Try again after the usual interval
+        Schedule(table, idx, now);
+        return Rejected;
+    }
+    MtVerboseMessage("Master-list (%s) responded with code: %d", m_Addr.Full(), res.mStatus);
+    // Identify response code
+    switch (res.mStatus)
+    {
+        case 400:
+        {
+            MtVerboseError("Master-server '%s' denied request due to malformed data", m_Addr.Full());
+            // This operation failed
+            Failed(table, idx);
+        } break;
+        case 403:
+        {
+            MtVerboseError("Master-server '%s' denied request, server version may not have been accepted", m_Addr.Full());
+            // This operation failed
+            Failed(table, idx);
+        } break;
+        case 405:
+        {
+            MtVerboseError("Master-server '%s' denied request, GET is not supported", m_Addr.Full());
+            // This operation failed
+            Failed(table, idx);
+        } break;
+        case 408:
+        {
+            MtVerboseError("Master-server '%s' timed out while trying to reach your server; are your ports forwarded?", m_Addr.Full());
+            // This operation failed
+            Failed(table, idx);
+        } break;
+        case 500:
+        {
+            MtVerboseError("Master-server '%s' had an unexpected error while processing your request", m_Addr.Full());
+            // This operation failed
+            Failed(table, idx);
+        } break;
+        case 200:
+        {
+            MtVerboseMessage("Successfully announced on master-server '%s'", m_Addr.Full());
+            // This operation succeeded. Carry on with the rest
+            MakeValid(table, idx);
+        } break;
+        default: /* Unknown response */ break;
+    }
+    // See if the master-server wants to hear from us at a different pace
+    const long requested = IntervalFromResponse(res);
+    // Was there any preference?
+    if (requested > 0)
+    {
+        // Stay within the configured limits
+        interval = std::min(std::max(static_cast< unsigned long >(requested),
+                                       static_cast< unsigned long >(g_MinInterval)),
+                              static_cast< unsigned long >(g_MaxInterval));
+    }
+    // Let the user know when the pace changes
+    if (interval != previous)
+    {
+        MtVerboseMessage("Master-server '%s' will be announced every %u seconds", m_Addr.Full(), interval);
+    }
+    // Schedule the next announce
+    Schedule(table, idx, now);
+    // Only a 200 means that we're listed
+    return res.mStatus == 200 ? Announced : Rejected;
+}
+
+// ------------------------------------------------------------------------------------------------
+template < typename S > void Server::Retarget(S & out, CCStr host, CCStr port, CCStr path) const
+{
+    CCStr rest = strstr(m_Request.c_str(), "\r\n") + 2;
+    out.reserve(m_Request.size() + strlen(path) * 3 + strlen(host) + strlen(port));
+    out.assign("POST ");
+    AppendPath(out, path);
+    out.append(" HTTP/1.1\r\n");
+    CCStr line = strstr(rest, "\r\nHost: ");
+    // Was the host chosen by us rather than the user?
+    if (line && m_Headers.find("Host") == m_Headers.end())
+    {
+        line += 2;
+        // Replace the host with the new one
+        out.append(rest, line).append("Host: ").append(host);
+        // The port is only mentioned when it isn't the default
+        if (strcmp(port, "80") != 0)
+        {
+            out.append(":").append(port);
+        }
+        rest = strstr(line, "\r\n");
+    }
+    out.append(rest, m_Request.c_str() + m_Request.size());
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Server::Redirect(Response & res, Arena & arena, bool permanent, bool send)
+{
+    const ArenaAllocator< char > alloc(arena);
+    // Copy the location since the response is about to be reused
+    const ArenaString location(res.Find("Location"), alloc);
+    MtVerboseMessage("Master-list (%s) redirected to: `%s`", m_Addr.Full(), location.c_str());
+    ArenaString host(alloc), port(alloc), path(alloc);
+    // Relative locations stay on the same master-server
+    if (location[0] == '/')
+    {
+        host.assign(m_Addr.mHost.c_str());
+        port.assign(m_Addr.mPort.c_str());
+        path.assign(location);
+    }
+    // Can the location be reached the way announces are sent?
+    else if (!SplitAddress(location.c_str(), host, port, path))
+    {
+        MtVerboseError("Master-list (%s) redirected to an unsupported location: `%s`", m_Addr.Full(), location.c_str());
+        // The announce went nowhere
+        res.mStatus = 0;
+        return false;
+    }
+    ArenaString request(alloc);
+    // Headers and payload stay the same, only the request line and host change
+    Retarget(request, host.c_str(), port.c_str(), path.c_str());
+    // Is it sent on the next step instead? Then keep it until then, even if it's only for once
+    if (!send)
+    {
+        m_MovedRequest.assign(request.data(), request.size());
+        m_MovedPath.assign(path.c_str());
+        m_MovedOnce = !permanent;
+        m_Moved.SetTarget(String(host.c_str()), String(port.c_str()));
+        m_Moved.SetTimeout(CONNECT_TIMEOUT);
+        return true;
+    }
+    // Is this where the master-server lives from now on?
+    if (permanent)
+    {
+        // Keep the request and the connection for the following announces
+        m_MovedRequest.assign(request.data(), request.size());
+        m_MovedPath.assign(path.c_str());
+        m_Moved.SetTarget(String(host.c_str()), String(port.c_str()));
+        m_Moved.SetTimeout(CONNECT_TIMEOUT);
+        // Send it there
+        return m_Moved.Exchange(m_MovedRequest, res);
+    }
+    // Forget any permanent redirect that led here
+    m_MovedRequest.clear();
+    // Send it there
+    return Transport::Exchange(host.c_str(), port.c_str(), CONNECT_TIMEOUT, request.data(), request.size(), res);
+}
+
+// ------------------------------------------------------------------------------------------------
+void Server::EndRedirects()
+{
+    // Was the last address only good for this announce?
+    if (m_MovedOnce)
+    {
+        m_MovedRequest.clear();
+        m_MovedOnce = false;
+    }
+    m_Hops = 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+void ConfigureOptions(CSimpleIniA & conf)
+{
+    // See if the plug-in should output verbose information
+    g_Verbose = conf.GetBoolValue("Options", "Verbose", false);
+    // Configure update interval
+    {
+        long value = conf.GetLongValue("Options", "UpdateInterval", 60);
+        // Should there be a limit here, higher than 1 second? (we dumb or evil enough to abuse it?)
+        g_UpdateInterval = value <= 0 ? 1 : static_cast< unsigned int >(value);
+    }
+    // See if announces should be spread across the interval instead of sent all at once
+    g_Pacing = conf.GetBoolValue("Options", "Pacing", false);
+    // See if slow mirrors should be raced against the next best one
+    g_Hedging = conf.GetBoolValue("Options", "Hedging", false);
+    // See if master-servers on the same host should share a connection
+    g_Pipelining = conf.GetBoolValue("Options", "Pipelining", false);
+    // See how the announces of a cycle should be carried out
+    {
+        CCStr engine = conf.GetValue("Options", "Engine", "sequential");
+        // Which backend was requested?
+        if (strcmp(engine, "io_uring") == 0)
+        {
+            g_IoBackend = IoUring;
+        }
+        else if (strcmp(engine, "epoll") == 0)
+        {
+            g_IoBackend = IoEpoll;
+        }
+        else if (strcmp(engine, "coroutine") == 0)
+        {
+            g_IoBackend = IoCoroutine;
+        }
+        else
+        {
+            // Anything else is a mistake, unless it asks for the default
+            if (strcmp(engine, "sequential") != 0)
+            {
+                OutputError("Unknown announce engine '%s', announcing sequentially", engine);
+            }
+            g_IoBackend = IoSequential;
+        }
+    }
+    // See if announces should be made between server frames instead of on a thread of their own
+    {
+        long value = conf.GetLongValue("Options", "FrameBudget", 0);
+        // Anything below a microsecond means the thread
+        g_FrameBudget = value <= 0 ? 0 : static_cast< unsigned int >(std::min(value, 1000000L));
+    }
+    // See how the threads that do announce work should be scheduled, before any is started
+    {
+        CCStr cpus = conf.GetValue("Options", "ThreadCpus", "");
+        // Were the threads pinned to specific CPUs?
+        if (cpus && *cpus != '\0' && !ParseCpuList(cpus, g_ThreadPolicy.mCpus))
+        {
+            OutputError("Invalid CPU list '%s', announce threads may run on any CPU", cpus);
+            g_ThreadPolicy.mCpus.clear();
+        }
+        CCStr policy = conf.GetValue("Options", "ThreadPolicy", "normal");
+        // Which scheduling class was requested?
+        if (strcmp(policy, "idle") == 0)
+        {
+            g_ThreadPolicy.mClass = ThreadIdle;
+        }
+        else if (strcmp(policy, "batch") == 0)
+        {
+            g_ThreadPolicy.mClass = ThreadBatch;
+        }
+        else
+        {
+            // Anything else is a mistake, unless it asks for the default
+            if (strcmp(policy, "normal") != 0)
+            {
+                OutputError("Unknown thread policy '%s', scheduling announce threads normally", policy);
+            }
+            g_ThreadPolicy.mClass = ThreadNormal;
+        }
+        CCStr nice = conf.GetValue("Options", "ThreadNice", "");
+        // Was a nice value chosen? Zero is a choice too
+        g_ThreadPolicy.mNiced = nice && *nice != '\0';
+        g_ThreadPolicy.mNice = static_cast< int >(std::min(std::max(conf.GetLongValue("Options", "ThreadNice", 0), -20L), 19L));
+        const long stack = conf.GetLongValue("Options", "ThreadStack", 0);
+        // The stack size is given in KiB
+        g_ThreadPolicy.mStack = stack <= 0 ? 0 : static_cast< size_t >(std::min(stack, 65536L)) * 1024;
+    }
+    // See if announces should be coordinated with other instances on this machine
+    {
+        CCStr path = conf.GetValue("Options", "Coordinate", "");
+        // Was a coordination file specified? Its lock and lookups may wait, which server frames can't
+        if (path && *path != '\0' && g_FrameBudget != 0)
+        {
+            OutputError("Coordinate is ignored with FrameBudget, its file lock and name lookups would block server frames");
+        }
+        else if (path && *path != '\0' && g_Coordinator.Open(path))
+        {
+            VerboseMessage("Coordinating announces through: %s", path);
+        }
+    }
+    // See if what was learned about the master-servers should survive restarts
+    {
+        CCStr path = conf.GetValue("Options", "State", "");
+        // Was a state file specified?
+        if (path && *path != '\0' && g_State.Open(path))
+        {
+            VerboseMessage("Keeping announce state in: %s", path);
+        }
+    }
+    // See if what the announcer does should be recorded for later inspection
+    {
+        CCStr path = conf.GetValue("Options", "Flight", "");
+        // Was a flight recorder file specified?
+        if (path && *path != '\0')
+        {
+            const long events = conf.GetLongValue("Options", "FlightEvents", 65536);
+            // Open the recorder with the requested room
+            if (g_Flight.Open(path, events <= 0 ? 0 : static_cast< uint32_t >(events)))
+            {
+                VerboseMessage("Recording announce events into: %s", path);
+            }
+        }
+    }
+    // See if the announce traffic should be captured into a trace
+    {
+        CCStr path = conf.GetValue("Options", "Capture", "");
+        // Was a trace file specified? Every answer is flushed to it, which server frames can't wait on
+        if (path && *path != '\0' && g_FrameBudget != 0)
+        {
+            OutputError("Capture is ignored with FrameBudget, writing the trace would block server frames");
+        }
+        else if (path && *path != '\0' && g_Recorder.Open(path))
+        {
+            VerboseMessage("Capturing announce traffic into: %s", path);
+        }
+    }
+    // See if the announce events should be written to a JSON-lines file
+    {
+        // Verbose events may go to the log even if the console doesn't show them
+        g_LogVerbose = conf.GetBoolValue("Options", "LogVerbose", true);
+        CCStr path = conf.GetValue("Options", "LogFile", "");
+        // Was a log file specified?
+        if (path && *path != '\0')
+        {
+            const long size = conf.GetLongValue("Options", "LogMaxSize", 10485760);
+            const long keep = conf.GetLongValue("Options", "LogKeep", 3);
+            std::unique_ptr< FileSink > sink(new FileSink());
+            FileSink * writer = sink.get();
+            // Could the file be opened?
+            if (sink->Open(path, size <= 0 ? 0 : static_cast< size_t >(size), keep <= 0 ? 0 : static_cast< unsigned >(keep)))
+            {
+                // Everything the sink is read through is settled before its writer starts
+                AddLogSink(std::move(sink));
+                writer->Start();
+                VerboseMessage("Logging announce events into: %s", path);
+            }
+            else
+            {
+                OutputError("Unable to open the log file: %s", path);
+            }
+        }
+        // Repeated messages may be suppressed for a while
+        const long window = conf.GetLongValue("Options", "LogRepeatWindow", 0);
+        g_LogRepeatWindow = window <= 0 ? 0 : static_cast< unsigned >(window);
+    }
+    // Configure the limits within which master-servers may change the update interval
+    {
+        long floor = conf.GetLongValue("Options", "MinInterval", 15);
+        long ceiling = conf.GetLongValue("Options", "MaxInterval", 600);
+        g_MinInterval = floor <= 0 ? 1 : static_cast< unsigned int >(floor);
+        g_MaxInterval = ceiling <= 0 ? 1 : static_cast< unsigned int >(ceiling);
+        // The configured interval must always be within the limits
+        g_MinInterval = std::min(g_MinInterval, g_UpdateInterval);
+        g_MaxInterval = std::max(g_MaxInterval, g_UpdateInterval);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void ConfigureMasters(CSimpleIniA & conf, std::vector< String > & out)
+{
+    CSimpleIniA::TNamesDepend servers, mirrors;
+    // Attempt to retrieve the list of specified master-servers
+    conf.GetAllValues("Servers", "Address", servers);
+    // Groups of mirrors are kept as a single entry with every address in it
+    conf.GetAllValues("Servers", "Mirrors", mirrors);
+    servers.splice(servers.end(), mirrors);
+    // Sort the list in it's original order
+    servers.sort(CSimpleIniA::Entry::LoadOrder());
+    // Process each specified server addresses
+    for (const auto & elem : servers)
+    {
+        // See if there's even something that could resemble a server address
+        if (elem.pItem)
+        {
+            out.emplace_back(elem.pItem);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Announcer::AddMaster(CCStr address)
+{
+    // Is this a group of mirrors?
+    if (strpbrk(address, " \t,"))
+    {
+        return AddMirrors(address);
+    }
+    // Attempt to extract URI information from the specified address
+    URI addr(address);
+    // See if a valid host could be extracted
+    if (addr.mHost.empty())
+    {
+        VerboseError("Master-server '%s' is an ill formed address", address);
+        // Nothing to add
+        return false;
+    }
+    // Show which master-server is added to the list
+    VerboseMessage("Master-server '%s' added to the announce list", addr.Full());
+    // Create the server instance
+    m_Servers.emplace_back(std::move(addr));
+    // Give it a row in the scheduling table
+    m_Table.Add(static_cast< bool >(m_Servers.back()), g_UpdateInterval);
+    // Server was added
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Announcer::AddMirrors(CCStr addresses)
+{
+    const uint32_t group = static_cast< uint32_t >(m_Groups.size());
+    MirrorGroup mirrors;
+    mirrors.mCycles = 0;
+    String address;
+    // Add each address in the list
+    for (CCStr itr = addresses + strspn(addresses, " \t,"); *itr != '\0'; itr += strspn(itr, " \t,"))
+    {
+        const size_t len = strcspn(itr, " \t,");
+        address.assign(itr, len);
+        itr += len;
+        // Attempt to extract URI information from the address
+        URI addr(address.c_str());
+        // See if a valid host could be extracted
+        if (addr.mHost.empty())
+        {
+            VerboseError("Mirror '%s' is an ill formed address", address.c_str());
+            continue;
+        }
+        VerboseMessage("Mirror '%s' added to the announce list", addr.Full());
+        // Create the server instance and give it a row in the scheduling table
+        m_Servers.emplace_back(std::move(addr));
+        m_Table.Add(static_cast< bool >(m_Servers.back()), g_UpdateInterval, group);
+        // Nothing is known about it yet, which makes it worth trying first
+        MirrorGroup::Member member{};
+        member.mIndex = m_Servers.size() - 1;
+        member.mSuccess = 1.0;
+        mirrors.mMembers.push_back(member);
+    }
+    // Was anything added?
+    if (mirrors.mMembers.empty())
+    {
+        return false;
+    }
+    // A single mirror is just a master-server
+    else if (mirrors.mMembers.size() == 1)
+    {
+        m_Table.mGroup.back() = MasterTable::NO_GROUP;
+        return true;
+    }
+    // Size these once so that ranking the members doesn't allocate
+    mirrors.mOrder.resize(mirrors.mMembers.size());
+    mirrors.mTried.resize(mirrors.mMembers.size());
+    m_Groups.push_back(std::move(mirrors));
+    // Group was added
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Announcer::SetPayload(unsigned version, unsigned port)
+{
+    // Grab the current time point
+    const Server::TimePoint now = Server::Clock::now();
+    // Generate the payload and schedule the first announce
+    for (size_t i = 0; i < m_Servers.size(); ++i)
+    {
+        m_Servers[i].ConfigureServer(version, port);
+        m_Servers[i].Start(m_Table, i, now, port);
+    }
+    // Pick up where the previous run left off
+    m_Saved.assign(m_Servers.size(), nullptr);
+    for (size_t i = 0; g_State.IsOpen() && i < m_Servers.size(); ++i)
+    {
+        m_Saved[i] = g_State.Find(m_Servers[i].GetURI(), port);
+        // Was there room for it?
+        if (m_Saved[i])
+        {
+            m_Servers[i].Restore(m_Table, i, *m_Saved[i], now);
+        }
+    }
+    // Mirrors follow the schedule of the first member of their group
+    for (auto & mirrors : m_Groups)
+    {
+        for (size_t i = 0; i < mirrors.mMembers.size(); ++i)
+        {
+            MirrorGroup::Member & member = mirrors.mMembers[i];
+            m_Table.mNext[member.mIndex] = m_Table.mNext[mirrors.mMembers.front().mIndex];
+            const SavedMaster * saved = m_Saved[member.mIndex];
+            // Start from the previous estimates, the percentile is learned again
+            if (saved && saved->mNextAt != 0 && saved->mMirrorSuccess > 0.0)
+            {
+                member.mLatency = saved->mMirrorLatency;
+                member.mSuccess = saved->mMirrorSuccess;
+                member.mHistory[0] = static_cast< uint32_t >(saved->mMirrorLatency);
+                member.mSamples = 1;
+            }
+        }
+    }
+    // Share connections between the master-servers on the same host, unless nothing may block
+    if (g_Pipelining && g_FrameBudget == 0)
+    {
+        AddPipelines();
+    }
+    // Announce on many master-servers at once? Always the case when announcing between frames, where
+    // only an engine that stops polling when the frame's time is up will do
+    m_Engine = IoEngine::Create(g_FrameBudget != 0 && (g_IoBackend == IoSequential || g_IoBackend == IoCoroutine)
+                                ? IoEpoll : g_IoBackend);
+    if (m_Engine)
+    {
+        VerboseMessage("Announcing concurrently through %s", m_Engine->Name());
+    }
+    else if (g_FrameBudget != 0)
+    {
+        OutputError("No I/O engine is available, announces will block the server frames");
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Announcer::AddPipelines()
+{
+    m_Pipelines.clear();
+    for (auto & pipeline : m_Table.mPipeline)
+    {
+        pipeline = MasterTable::NO_PIPELINE;
+    }
+    // Look for master-servers that come after each one on the same host and port
+    for (size_t i = 0; i < m_Servers.size(); ++i)
+    {
+        // Mirrors are raced against each other instead and invalid addresses are never announced on
+        if (m_Table.mGroup[i] != MasterTable::NO_GROUP || m_Table.mPipeline[i] != MasterTable::NO_PIPELINE ||
+            m_Table.mState[i] != MasterTable::Active)
+        {
+            continue;
+        }
+        const URI & addr = m_Servers[i].GetURI();
+        HostPipeline pipeline;
+        pipeline.mMembers.push_back(i);
+        for (size_t j = i + 1; j < m_Servers.size(); ++j)
+        {
+            const URI & other = m_Servers[j].GetURI();
+            // Is this one reached through the same connection?
+            if (m_Table.mGroup[j] == MasterTable::NO_GROUP && m_Table.mState[j] == MasterTable::Active &&
+                other.mHost == addr.mHost && other.mPort == addr.mPort)
+            {
+                pipeline.mMembers.push_back(j);
+            }
+        }
+        // Is there anything to share?
+        if (pipeline.mMembers.size() < 2)
+        {
+            continue;
+        }
+        VerboseMessage("Announces to %u master-servers on '%s:%s' share a connection",
+                        static_cast< unsigned >(pipeline.mMembers.size()), addr.mHost.c_str(), addr.mPort.c_str());
+        const uint32_t index = static_cast< uint32_t >(m_Pipelines.size());
+        for (const size_t member : pipeline.mMembers)
+        {
+            m_Table.mPipeline[member] = index;
+        }
+        // Size these once so that announcing doesn't allocate
+        pipeline.mBatch.reserve(pipeline.mMembers.size());
+        pipeline.mResponses.resize(pipeline.mMembers.size());
+        m_Pipelines.push_back(std::move(pipeline));
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Allocations made by the calling thread since the specified counters were taken.
+*/
+static AllocCounters AllocationsSince(const AllocCounters & before)
+{
+    const AllocCounters after = ThreadAllocations();
+    return AllocCounters{after.mCount - before.mCount, after.mBytes - before.mBytes};
+}
+
+// ------------------------------------------------------------------------------------------------
+Server::TimePoint Announcer::Process(Server::TimePoint now, Server::TimePoint next)
+{
+    const Server::TimePoint start = Server::Clock::now();
+    const AllocCounters before = ThreadAllocations();
+    bool any = false;
+    // Send the plain announces that are due all at once, when there's an engine for it
+    if (m_Engine)
+    {
+        m_Arena.Reset();
+        any = UpdateBatch(now, now) > 0;
+    }
+    // Only the deadlines are scanned so the master-servers themselves are not touched unless due
+    const size_t count = m_Table.Size();
+    // Tell the master-lists that are due that we're alive
+    for (size_t i = 0; i < count; ++i)
+    {
+        // Is this master-server expecting an announce?
+        if (m_Table.mNext[i] <= now)
+        {
+            // Start the cycle with an empty arena
+            if (!any)
+            {
+                m_Arena.Reset();
+            }
+            Dispatch(i, now, now);
+            any = true;
+        }
+        // Wake up for whichever master-server is due first
+        if (m_Table.mNext[i] < next)
+        {
+            next = m_Table.mNext[i];
+        }
+    }
+    // Account for the cycle if there was any work
+    if (any)
+    {
+        Account(start, AllocationsSince(before));
+    }
+    return next;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Announcer::Cycle()
+{
+    const Server::TimePoint start = Server::Clock::now();
+    const AllocCounters before = ThreadAllocations();
+    // Start the cycle with an empty arena
+    m_Arena.Reset();
+    // Send the plain announces all at once, when there's an engine for it
+    const size_t batch = m_Engine ? UpdateBatch(start, Server::TimePoint::max()) : 0;
+    // Announce on every other master-server
+    for (size_t i = 0, k = 0; i < m_Servers.size(); ++i)
+    {
+        const uint32_t group = m_Table.mGroup[i], pipeline = m_Table.mPipeline[i];
+        // Was it announced on with the batch? (the batch is in the same order)
+        if (k < batch && m_Batch[k] == i)
+        {
+            ++k;
+        }
+        // Mirror groups and host pipelines are only announced on once, through their first member
+        else if ((group == MasterTable::NO_GROUP || m_Groups[group].mMembers.front().mIndex == i) &&
+                 (pipeline == MasterTable::NO_PIPELINE || m_Pipelines[pipeline].mMembers.front() == i))
+        {
+            Dispatch(i, Server::Clock::now(), Server::TimePoint::max());
+        }
+    }
+    // Account for the cycle
+    Account(start, AllocationsSince(before));
+}
+
+// ------------------------------------------------------------------------------------------------
+void Announcer::Step(unsigned budget)
+{
+    const Server::TimePoint now = Server::Clock::now();
+    // Is there anything going on or due?
+    if (!m_Stepping && now < m_Wake)
+    {
+        return;
+    }
+    // Without an engine the announces can only be made the blocking way
+    if (!m_Engine)
+    {
+        m_Wake = Process(now, now + std::chrono::seconds(g_UpdateInterval));
+        return;
+    }
+    const Server::TimePoint until = now + std::chrono::microseconds(budget);
+    const AllocCounters before = ThreadAllocations();
+    // Start on the master-servers that are due
+    if (!m_Stepping)
+    {
+        m_Arena.Reset();
+        m_StepStart = now;
+        m_StepAllocs = AllocCounters{0, 0};
+        // Those that send nothing are dealt with right away, they don't wait on anything
+        for (size_t i = 0; i < m_Servers.size(); ++i)
+        {
+            const uint32_t group = m_Table.mGroup[i];
+            // Is this master-server expecting an announce? Mirror groups only through their first member
+            if (m_Table.mNext[i] > now || (group != MasterTable::NO_GROUP && m_Groups[group].mMembers.front().mIndex != i))
+            {
+                continue;
+            }
+            else if (group == MasterTable::NO_GROUP)
+            {
+                // Will it be sent with the others?
+                if (!m_Servers[i].CanSendAhead(m_Table, i))
+                {
+                    Update(i, now);
+                    Save(i);
+                }
+                continue;
+            }
+            bool any = false;
+            // Could any of the mirrors take the announce?
+            for (const auto & member : m_Groups[group].mMembers)
+            {
+                any = any || m_Servers[member.mIndex].CanSendAhead(m_Table, member.mIndex);
+            }
+            // Was every mirror given up on? Let the first one account for it
+            if (!any)
+            {
+                Update(i, now);
+                for (const auto & member : m_Groups[group].mMembers)
+                {
+                    m_Table.mNext[member.mIndex] = m_Table.mNext[i];
+                    m_Table.mInterval[member.mIndex] = m_Table.mInterval[i];
+                    Save(member.mIndex);
+                }
+            }
+        }
+        // Hand the rest to the engine without waiting on any of them
+        const size_t count = CollectBatch(now, true);
+        m_Engine->Begin(m_Jobs.data(), count, Server::CONNECT_TIMEOUT + Transport::IO_TIMEOUT);
+        m_Stepping = true;
+        m_Polling = count > 0;
+        m_Done = 0;
+    }
+    // Look at the sockets once per frame, sockets still ready when time runs out wait for the next one
+    if (m_Polling)
+    {
+        m_Polling = !m_Engine->Poll(std::chrono::duration_cast< std::chrono::nanoseconds >(
+                                        until.time_since_epoch()).count(), false);
+    }
+    // Hand out the responses while there's time left, at least one per frame
+    for (bool first = true; !m_Polling && m_Done < m_Batch.size() && (first || Server::Clock::now() < until); first = false)
+    {
+        CompleteBatch(m_Done++, now);
+    }
+    const AllocCounters used = AllocationsSince(before);
+    // Count the allocations towards the whole batch
+    m_StepAllocs.mCount += used.mCount;
+    m_StepAllocs.mBytes += used.mBytes;
+    const uint64_t elapsed = static_cast< uint64_t >(std::chrono::duration_cast< std::chrono::microseconds >(
+                                Server::Clock::now() - now).count());
+    // Count the frame and how long it took
+    ++m_Stats.mSteps;
+    m_Stats.mStepTime += elapsed;
+    m_Stats.mMaxStep = std::max(m_Stats.mMaxStep, elapsed);
+    // Is the batch done?
+    if (m_Polling || m_Done < m_Batch.size())
+    {
+        return;
+    }
+    m_Stepping = false;
+    Account(m_StepStart, m_StepAllocs);
+    // Sleep until whichever master-server is due first, announces that went on elsewhere are due now
+    m_Wake = now + std::chrono::seconds(g_UpdateInterval);
+    for (size_t i = 0; i < m_Servers.size(); ++i)
+    {
+        if (m_Table.mNext[i] < m_Wake)
+        {
+            m_Wake = m_Table.mNext[i];
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Announcer::Account(Server::TimePoint start, const AllocCounters & used)
+{
+    // Count the cycle and how long it took
+    ++m_Stats.mCycles;
+    m_Stats.mLastCycle = static_cast< uint64_t >(std::chrono::duration_cast< std::chrono::microseconds >(
+                            Server::Clock::now() - start).count());
+    // Count what it took from the heap
+    m_Stats.mLastAllocations = used.mCount;
+    m_Stats.mLastAllocatedBytes = used.mBytes;
+    m_Stats.mAllocations += m_Stats.mLastAllocations;
+    m_Stats.mAllocatedBytes += m_Stats.mLastAllocatedBytes;
+    // Count what it took from the arena
+    m_Stats.mLastArena = m_Arena.GetUsed();
+    m_Stats.mArenaHighWater = m_Arena.GetHighWater();
+    // Summarize the messages that kept repeating
+    if (g_LogRepeatWindow)
+    {
+        SweepRepeats(QueueMtText);
+    }
+    // Count the master-servers that are reached through a degraded path
+    m_Stats.mDegraded = 0;
+    for (const auto & server : m_Servers)
+    {
+        m_Stats.mDegraded += server.GetPath().mDegraded ? 1 : 0;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Announcer::Dispatch(size_t idx, Server::TimePoint now, Server::TimePoint due)
+{
+    const uint32_t group = m_Table.mGroup[idx];
+    // Does this one share a connection with others on the same host?
+    if (m_Table.mPipeline[idx] != MasterTable::NO_PIPELINE)
+    {
+        UpdatePipeline(m_Table.mPipeline[idx], now, due);
+    }
+    // Is this one of several mirrors?
+    else if (group == MasterTable::NO_GROUP)
+    {
+        Update(idx, now);
+        Save(idx);
+    }
+    else
+    {
+        UpdateGroup(group, now);
+        // Every member may have changed
+        for (const auto & member : m_Groups[group].mMembers)
+        {
+            Save(member.mIndex);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Announcer::Save(size_t idx)
+{
+    SavedMaster * saved = idx < m_Saved.size() ? m_Saved[idx] : nullptr;
+    // Is this master-server kept in the state file?
+    if (!saved)
+    {
+        return;
+    }
+    m_Servers[idx].Save(m_Table, idx, *saved);
+    const uint32_t group = m_Table.mGroup[idx];
+    // Mirrors also keep what decides which one is announced on
+    if (group != MasterTable::NO_GROUP)
+    {
+        for (const auto & member : m_Groups[group].mMembers)
+        {
+            if (member.mIndex == idx)
+            {
+                saved->mMirrorLatency = member.mLatency;
+                saved->mMirrorSuccess = member.mSuccess;
+            }
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+Server::Result Announcer::Update(size_t idx, Server::TimePoint now, Transport::Socket pending, Response * received)
+{
+    // An announce that was already sent is timed from when it was sent
+    const Server::TimePoint start = pending != Transport::NO_SOCKET || received ? m_Servers[idx].GetSent()
+                                                                                  : Server::Clock::now();
+    // Perform the update
+    const Server::Result result = m_Servers[idx].Update(m_Table, idx, now, received ? *received : *m_Response,
+                                                        m_Arena, pending, received != nullptr);
+    // Messages that follow are no longer about this master-server
+    SetLogContext(nullptr, nullptr);
+    // Was anything sent?
+    if (result == Server::Skipped)
+    {
+        ++m_Stats.mSkipped;
+        return result;
+    }
+    // Is the outcome yet to come from somewhere else?
+    else if (result == Server::Deferred)
+    {
+        return result;
+    }
+    // How long did it take?
+    const uint64_t latency = static_cast< uint64_t >(std::chrono::duration_cast< std::chrono::microseconds >(
+                                Server::Clock::now() - start).count());
+    // Keep it next to the schedule of the master-server
+    m_Table.mLatency[idx] = static_cast< uint32_t >(std::min(latency, static_cast< uint64_t >(UINT32_MAX)));
+    // Account for it
+    ++m_Stats.mAnnounces;
+    ++(result == Server::Announced ? m_Stats.mSuccesses : m_Stats.mFailures);
+    m_Stats.mLatency += latency;
+    m_Stats.mMaxLatency = std::max(m_Stats.mMaxLatency, latency);
+    return result;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Microseconds elapsed since the specified time-point.
+*/
+static uint32_t ElapsedSince(Server::TimePoint start)
+{
+    const auto elapsed = std::chrono::duration_cast< std::chrono::microseconds >(Server::Clock::now() - start);
+    return static_cast< uint32_t >(std::min(static_cast< int64_t >(elapsed.count()), static_cast< int64_t >(UINT32_MAX)));
+}
+
+// ------------------------------------------------------------------------------------------------
+void Announcer::UpdateGroup(uint32_t group, Server::TimePoint now)
+{
+    MirrorGroup & mirrors = m_Groups[group];
+    const size_t count = mirrors.mMembers.size();
+    ++mirrors.mCycles;
+    // Decide which mirrors to try first
+    mirrors.Rank();
+    std::fill(mirrors.mTried.begin(), mirrors.mTried.end(), false);
+    Server::Result result = Server::Skipped;
+    // The member whose schedule the group follows
+    size_t last = count;
+    // Go down the list until one of the mirrors accepts the announce
+    for (size_t k = 0; k < count && result != Server::Announced; ++k)
+    {
+        const size_t first = mirrors.mOrder[k];
+        // Was this one tried already or given up on?
+        if (mirrors.mTried[first] || m_Table.mState[mirrors.mMembers[first].mIndex] != MasterTable::Active)
+        {
+            continue;
+        }
+        size_t second = count;
+        // Look for the next best mirror to hedge with
+        for (size_t j = k + 1; g_Hedging && j < count && second == count; ++j)
+        {
+            const size_t c = mirrors.mOrder[j];
+            // Could this one take the announce?
+            if (!mirrors.mTried[c] && m_Table.mState[mirrors.mMembers[c].mIndex] == MasterTable::Active)
+            {
+                second = c;
+            }
+        }
+        size_t winner = first;
+        Transport::Socket pending = Transport::NO_SOCKET;
+        Server::TimePoint sent = Server::Clock::now();
+        // Is there anything to hedge with?
+        if (second < count)
+        {
+            Transport::Socket socks[2] = { m_Servers[mirrors.mMembers[first].mIndex].Begin(), Transport::NO_SOCKET };
+            const int wait = static_cast< int >((mirrors.P95(first) + 999) / 1000);
+            pending = socks[0];
+            // Could the announce not even be sent to the first mirror? Then it failed, go to the next one
+            if (socks[0] == Transport::NO_SOCKET)
+            {
+                const size_t idx = mirrors.mMembers[first].mIndex;
+                m_Response->Clear();
+                // Account for it like an announce that got no answer instead of sending it again
+                result = Update(idx, now, Transport::NO_SOCKET, m_Response.get());
+                mirrors.Observe(first, ElapsedSince(sent), false);
+                mirrors.mTried[first] = true;
+                mirrors.mMembers[first].mLastUsed = mirrors.mCycles;
+                last = idx;
+                continue;
+            }
+            // Did the first mirror fail to answer within the time it usually takes?
+            if (socks[0] != Transport::NO_SOCKET && Transport::WaitAny(socks, 1, wait) < 0 &&
+                (socks[1] = m_Servers[mirrors.mMembers[second].mIndex].Begin()) != Transport::NO_SOCKET)
+            {
+                const Server::TimePoint hedged = Server::Clock::now();
+                MtVerboseMessage("Mirror '%s' did not answer within %d ms, hedging with '%s'",
+                                    m_Servers[mirrors.mMembers[first].mIndex].GetURI().Full(), wait,
+                                    m_Servers[mirrors.mMembers[second].mIndex].GetURI().Full());
+                ++m_Stats.mHedged;
+                g_Flight.Record(m_Servers[mirrors.mMembers[second].mIndex].GetFlight(), FlightHedge, 0, wait * 1000);
+                // Take whichever answers first (the first one if neither does)
+                const int w = Transport::WaitAny(socks, 2, static_cast< int >(Transport::IO_TIMEOUT * 1000));
+                const size_t loser = w == 1 ? first : second;
+                const Transport::Socket lost = socks[w == 1 ? 0 : 1];
+                // Did the other one answer just as well? Then account for how it really went
+                if (w >= 0 && Transport::WaitAny(&lost, 1, 0) == 0)
+                {
+                    const uint32_t latency = ElapsedSince(w == 1 ? sent : hedged);
+                    const bool ok = m_Servers[mirrors.mMembers[loser].mIndex].Finish(lost, *m_Response);
+                    mirrors.Observe(loser, latency, ok && m_Response->mStatus >= 200 && m_Response->mStatus < 300);
+                }
+                // Otherwise nothing is known about it, other than it was slower
+                else
+                {
+                    Transport::Abandon(lost);
+                }
+                mirrors.mTried[loser] = true;
+                mirrors.mMembers[loser].mLastUsed = mirrors.mCycles;
+                // Did the hedge win?
+                if (w == 1)
+                {
+                    ++m_Stats.mHedgeWins;
+                    winner = second;
+                    sent = hedged;
+                }
+                pending = socks[w == 1 ? 1 : 0];
+            }
+        }
+        const size_t idx = mirrors.mMembers[winner].mIndex;
+        // Receive the answer, or announce now if nothing was sent yet
+        result = Update(idx, now, pending);
+        // Remember how it went
+        mirrors.Observe(winner, ElapsedSince(sent), result == Server::Announced);
+        mirrors.mTried[winner] = true;
+        mirrors.mMembers[winner].mLastUsed = mirrors.mCycles;
+        last = idx;
+    }
+    // Was every mirror given up on? Let the first one account for it
+    if (last == count)
+    {
+        last = mirrors.mMembers.front().mIndex;
+        Update(last, now);
+    }
+    // Every member follows the schedule of the one announced on last
+    for (const auto & member : mirrors.mMembers)
+    {
+        m_Table.mNext[member.mIndex] = m_Table.mNext[last];
+        m_Table.mInterval[member.mIndex] = m_Table.mInterval[last];
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Announcer::UpdatePipeline(uint32_t pipeline, Server::TimePoint now, Server::TimePoint due)
+{
+    HostPipeline & p = m_Pipelines[pipeline];
+    p.mBatch.clear();
+    // Find the members that are due
+    for (const size_t idx : p.mMembers)
+    {
+        // Is this one expecting an announce?
+        if (m_Table.mNext[idx] > due)
+        {
+            continue;
+        }
+        // Can it share the connection? Otherwise it's skipped or announced on somewhere else
+        else if (m_Servers[idx].CanSendAhead(m_Table, idx))
+        {
+            p.mBatch.push_back(idx);
+        }
+        else
+        {
+            Update(idx, now);
+            Save(idx);
+        }
+    }
+    const size_t count = p.mBatch.size();
+    size_t received = 0;
+    // Is there more than one announce to send?
+    if (count > 1)
+    {
+        p.mRequests.clear();
+        // Send them back to back, only the last one closes the connection
+        for (size_t k = 0; k < count; ++k)
+        {
+            m_Servers[p.mBatch[k]].Queue(p.mRequests, k + 1 < count);
+        }
+        received = m_Servers[p.mBatch.front()].Pipeline(p.mRequests, p.mResponses.data(), count);
+        ++m_Stats.mPipelines;
+        m_Stats.mPipelined += received;
+        // Did the master-server stop answering part way through?
+        if (received < count)
+        {
+            const URI & addr = m_Servers[p.mBatch.front()].GetURI();
+            MtVerboseMessage("Only %u of %u pipelined announces to '%s:%s' were answered, sending the rest on their own",
+                                static_cast< unsigned >(received), static_cast< unsigned >(count),
+                                addr.mHost.c_str(), addr.mPort.c_str());
+        }
+    }
+    // Hand each member its response, or let it announce on its own
+    for (size_t k = 0; k < count; ++k)
+    {
+        Update(p.mBatch[k], now, Transport::NO_SOCKET, k < received ? &p.mResponses[k] : nullptr);
+        Save(p.mBatch[k]);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+size_t Announcer::UpdateBatch(Server::TimePoint now, Server::TimePoint due)
+{
+    const size_t count = CollectBatch(due, false);
+    // Is there anything to send?
+    if (count == 0)
+    {
+        return 0;
+    }
+    // Send every announce and wait for all of them to be answered or given up on
+    m_Engine->Run(m_Jobs.data(), count, Server::CONNECT_TIMEOUT + Transport::IO_TIMEOUT);
+    // Let each master-server handle its response
+    for (size_t k = 0; k < count; ++k)
+    {
+        CompleteBatch(k, now);
+    }
+    return count;
+}
+
+// ------------------------------------------------------------------------------------------------
+size_t Announcer::CollectBatch(Server::TimePoint due, bool grouped)
+{
+    m_Batch.clear();
+    // Find the master-servers that are due
+    for (size_t i = 0; i < m_Servers.size(); ++i)
+    {
+        const uint32_t group = m_Table.mGroup[i];
+        // Is this one expecting an announce and not part of a host pipeline?
+        if (m_Table.mNext[i] > due || m_Table.mPipeline[i] != MasterTable::NO_PIPELINE)
+        {
+            continue;
+        }
+        else if (group == MasterTable::NO_GROUP)
+        {
+            if (m_Servers[i].CanSendAhead(m_Table, i))
+            {
+                // Is its address known? Otherwise look at it again once the lookup had some time
+                if (Addressed(i))
+                {
+                    m_Batch.push_back(i);
+                }
+                else
+                {
+                    m_Table.mNext[i] = due + std::chrono::milliseconds(Transport::LOOKUP_WAIT);
+                }
+            }
+        }
+        // Mirror groups are announced on once, through the best mirror that can take it
+        else if (grouped && m_Groups[group].mMembers.front().mIndex == i)
+        {
+            MirrorGroup & mirrors = m_Groups[group];
+            const size_t before = m_Batch.size();
+            ++mirrors.mCycles;
+            // Decide which mirror to try
+            mirrors.Rank();
+            for (const size_t member : mirrors.mOrder)
+            {
+                const size_t idx = mirrors.mMembers[member].mIndex;
+                // Could this one take the announce? Not before its address is known
+                if (m_Servers[idx].CanSendAhead(m_Table, idx) && Addressed(idx))
+                {
+                    m_Batch.push_back(idx);
+                    break;
+                }
+            }
+            // Were the addresses of all of them still being looked up? Then look again in a while
+            for (size_t m = 0; m_Batch.size() == before && m < mirrors.mMembers.size(); ++m)
+            {
+                m_Table.mNext[mirrors.mMembers[m].mIndex] = due + std::chrono::milliseconds(Transport::LOOKUP_WAIT);
+            }
+        }
+    }
+    const size_t count = m_Batch.size();
+    // Grow the exchanges and responses to the largest batch so far
+    if (m_Jobs.size() < count)
+    {
+        m_Jobs.resize(count);
+        m_Responses.resize(count);
+    }
+    for (size_t k = 0; k < count; ++k)
+    {
+        m_Servers[m_Batch[k]].Prepare(m_Jobs[k], m_Responses[k]);
+    }
+    return count;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Announcer::Addressed(size_t idx)
+{
+    // Only server frames must never wait on the system resolver
+    return g_FrameBudget == 0 || m_Servers[idx].Prefetch();
+}
+
+// ------------------------------------------------------------------------------------------------
+void Announcer::CompleteBatch(size_t k, Server::TimePoint now)
+{
+    const size_t idx = m_Batch[k];
+    const uint32_t group = m_Table.mGroup[idx];
+    const Server::TimePoint sent = m_Servers[idx].GetSent();
+    const Server::Result result = Update(idx, now, Transport::NO_SOCKET, &m_Responses[k]);
+    // Nothing is saved until the announce is over
+    const bool over = result != Server::Deferred;
+    // Is this one of several mirrors?
+    if (group == MasterTable::NO_GROUP)
+    {
+        if (over)
+        {
+            Save(idx);
+        }
+        return;
+    }
+    MirrorGroup & mirrors = m_Groups[group];
+    for (size_t member = 0; over && member < mirrors.mMembers.size(); ++member)
+    {
+        // Remember how it went
+        if (mirrors.mMembers[member].mIndex == idx)
+        {
+            mirrors.Observe(member, ElapsedSince(sent), result == Server::Announced);
+            mirrors.mMembers[member].mLastUsed = mirrors.mCycles;
+        }
+    }
+    // Every member follows the schedule of the one announced on
+    for (const auto & member : mirrors.mMembers)
+    {
+        m_Table.mNext[member.mIndex] = m_Table.mNext[idx];
+        m_Table.mInterval[member.mIndex] = m_Table.mInterval[idx];
+        if (over)
+        {
+            Save(member.mIndex);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void MirrorGroup::Observe(size_t member, uint32_t latency, bool success)
+{
+    Member & m = mMembers[member];
+    // The first observation replaces the initial guess
+    if (m.mSamples == 0)
+    {
+        m.mLatency = latency;
+        m.mSuccess = success ? 1.0 : 0.0;
+    }
+    else
+    {
+        m.mLatency += SMOOTHING * (latency - m.mLatency);
+        m.mSuccess += SMOOTHING * ((success ? 1.0 : 0.0) - m.mSuccess);
+    }
+    // Remember the latency for the percentile
+    m.mHistory[m.mSamples % HISTORY] = latency;
+    ++m.mSamples;
+}
+
+// ------------------------------------------------------------------------------------------------
+uint32_t MirrorGroup::P95(size_t member) const
+{
+    const Member & m = mMembers[member];
+    // Is there enough to go on?
+    if (m.mSamples < HEDGE_SAMPLES)
+    {
+        return HEDGE_DEFAULT;
+    }
+    const size_t n = static_cast< size_t >(std::min< uint64_t >(m.mSamples, static_cast< uint64_t >(HISTORY)));
+    uint32_t sorted[HISTORY];
+    // Find the percentile in a copy so the history stays in order
+    std::copy(m.mHistory, m.mHistory + n, sorted);
+    const size_t k = (n * 95 + 99) / 100 - 1;
+    std::nth_element(sorted, sorted + k, sorted + n);
+    return sorted[k];
+}
+
+// ------------------------------------------------------------------------------------------------
+void MirrorGroup::Rank()
+{
+    // Expected time to get an announce accepted, lower is better
+    auto score = [this](size_t i) {
+        return mMembers[i].mLatency / std::max(mMembers[i].mSuccess, 0.01);
+    };
+    // Groups are small so a simple insertion sort will do and doesn't allocate
+    for (size_t i = 0; i < mOrder.size(); ++i)
+    {
+        size_t j = i;
+        // Ties keep the order in which the mirrors were specified
+        for (; j > 0 && score(mOrder[j - 1]) > score(i); --j)
+        {
+            mOrder[j] = mOrder[j - 1];
+        }
+        mOrder[j] = i;
+    }
+    // Every now and then try the mirror that went the longest without an announce
+    if (mCycles % PROBE_EVERY == 0)
+    {
+        size_t oldest = 0;
+        for (size_t i = 1; i < mOrder.size(); ++i)
+        {
+            if (mMembers[mOrder[i]].mLastUsed < mMembers[mOrder[oldest]].mLastUsed)
+            {
+                oldest = i;
+            }
+        }
+        std::rotate(mOrder.begin(), mOrder.begin() + oldest, mOrder.begin() + oldest + 1);
+    }
+}
+
+#ifndef SMOD_ALLOC_STATS
+
+// ------------------------------------------------------------------------------------------------
+AllocCounters ThreadAllocations()
+{
+    // Allocations are not being counted
+    return AllocCounters{0, 0};
+}
+
+#endif // SMOD_ALLOC_STATS
+
+// ------------------------------------------------------------------------------------------------
+void OutputMessageImpl(CCStr msg, va_list args)
+{
+#if defined(WIN32) || defined(_WIN32)
+    HANDLE hstdout = GetStdHandle(STD_OUTPUT_HANDLE);
+
+    CONSOLE_SCREEN_BUFFER_INFO csb_before;
+    GetConsoleScreenBufferInfo( hstdout, &csb_before);
+    SetConsoleTextAttribute(hstdout, FOREGROUND_GREEN);
+    printf("[ANNOUNCE] ");
+
+    SetConsoleTextAttribute(hstdout, FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_RED | FOREGROUND_INTENSITY);
+    vprintf(msg, args);
+    puts("");
+
+    SetConsoleTextAttribute(hstdout, csb_before.wAttributes);
+#else
+    printf("%c[0;32m[ANNOUNCE]%c[0;37m", 27, 27);
+    vprintf(msg, args);
+    puts("");
+#endif
+}
+
+// ------------------------------------------------------------------------------------------------
+void OutputErrorImpl(CCStr msg, va_list args)
+{
+#if defined(WIN32) || defined(_WIN32)
+    HANDLE hstdout = GetStdHandle(STD_OUTPUT_HANDLE);
+
+    CONSOLE_SCREEN_BUFFER_INFO csb_before;
+    GetConsoleScreenBufferInfo( hstdout, &csb_before);
+    SetConsoleTextAttribute(hstdout, FOREGROUND_RED | FOREGROUND_INTENSITY);
+    printf("[ANNOUNCE] ");
+
+    SetConsoleTextAttribute(hstdout, FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_RED | FOREGROUND_INTENSITY);
+    vprintf(msg, args);
+    puts("");
+
+    SetConsoleTextAttribute(hstdout, csb_before.wAttributes);
+#else
+    printf("%c[0;32m[ANNOUNCE]%c[0;37m", 27, 27);
+    vprintf(msg, args);
+    puts("");
+#endif
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a formatted message to the console only.
+*/
+static void OutputConsole(bool type, CCStr msg, ...)
+{
+    // Initialize the arguments list
+    va_list args;
+    va_start(args, msg);
+    // Call the output function
+    if (type)
+    {
+        OutputMessageImpl(msg, args);
+    }
+    else
+    {
+        OutputErrorImpl(msg, args);
+    }
+    // Finalize the arguments list
+    va_end(args);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Format a message and hand it to the log sinks. Messages longer than the buffer are cut short.
+*/
+static void DispatchFormatted(bool type, bool verbose, CCStr msg, va_list args)
+{
+    char buffer[1024];
+    // Attempt to run the specified format
+    const int size = vsnprintf(buffer, sizeof(buffer), msg, args);
+    // Did the format succeed?
+    if (size >= 0)
+    {
+        DispatchLog(!type, verbose, buffer, std::min(static_cast< size_t >(size), sizeof(buffer) - 1));
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a formatted message to the console and the log sinks, whichever want to see it.
+*/
+static void OutputMsg(bool type, bool verbose, CCStr msg, va_list args)
+{
+    // Do the sinks want to see this?
+    if (HasLogSinks() && (!verbose || g_Verbose || g_LogVerbose))
+    {
+        va_list args_cpy;
+        va_copy(args_cpy, args);
+        DispatchFormatted(type, verbose, msg, args_cpy);
+        va_end(args_cpy);
+    }
+    // Does the console want to see this?
+    if (!verbose || g_Verbose)
+    {
+        if (type)
+        {
+            OutputMessageImpl(msg, args);
+        }
+        else
+        {
+            OutputErrorImpl(msg, args);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void FlushMessages()
+{
+    // Acquire a global lock
+    std::lock_guard< std::mutex > lock(g_Mutex);
+    // Output any queued messages
+    for (size_t i = 0; i < g_Pending; ++i)
+    {
+        // The sinks saw these messages when they were queued
+        OutputConsole(g_Messages[i].second, "%s", g_Messages[i].first.c_str());
+    }
+    // The slots are kept, along with their storage, for the next messages
+    g_Pending = 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+void OutputDebug(CCStr msg, ...)
+{
+#ifdef _DEBUG
+    // Initialize the arguments list
+    va_list args;
+    va_start(args, msg);
+    // Call the output function
+    OutputMessageImpl(msg, args);
+    // Finalize the arguments list
+    va_end(args);
+#else
+    SMOD_UNUSED_VAR(msg);
+#endif
+}
+
+// ------------------------------------------------------------------------------------------------
+void OutputMessage(CCStr msg, ...)
+{
+    // Initialize the arguments list
+    va_list args;
+    va_start(args, msg);
+    // Call the output function
+    OutputMsg(true, false, msg, args);
+    // Finalize the arguments list
+    va_end(args);
+}
+
+// ------------------------------------------------------------------------------------------------
+void OutputError(CCStr msg, ...)
+{
+    // Initialize the arguments list
+    va_list args;
+    va_start(args, msg);
+    // Call the output function
+    OutputMsg(false, false, msg, args);
+    // Finalize the arguments list
+    va_end(args);
+}
+
+// ------------------------------------------------------------------------------------------------
+void VerboseMessage(CCStr msg, ...)
+{
+    // Are verbose messages wanted anywhere?
+    if (!g_Verbose && !g_LogVerbose)
+    {
+        return;
+    }
+    // Initialize the arguments list
+    va_list args;
+    va_start(args, msg);
+    // Call the output function
+    OutputMsg(true, true, msg, args);
+    // Finalize the arguments list
+    va_end(args);
+}
+
+// ------------------------------------------------------------------------------------------------
+void VerboseError(CCStr msg, ...)
+{
+    // Are verbose messages wanted anywhere?
+    if (!g_Verbose && !g_LogVerbose)
+    {
+        return;
+    }
+    // Initialize the arguments list
+    va_list args;
+    va_start(args, msg);
+    // Call the output function
+    OutputMsg(false, true, msg, args);
+    // Finalize the arguments list
+    va_end(args);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Queue an already formatted message and hand it to the log sinks, whichever want to see it.
+*/
+static void QueueMtText(bool error, bool verbose, CCStr text, size_t length)
+{
+    // Do the sinks want to see this?
+    if (HasLogSinks() && (!verbose || g_Verbose || g_LogVerbose))
+    {
+        DispatchLog(error, verbose, text, length);
+    }
+    // Does the console want to see this?
+    if (verbose && !g_Verbose)
+    {
+        return;
+    }
+    // Is there no thread? Then this is the server thread and there's nothing to queue for
+    else if (g_FrameBudget != 0)
+    {
+        OutputConsole(!error, "%.*s", static_cast< int >(length), text);
+        return;
+    }
+    // Acquire a global lock
+    std::lock_guard< std::mutex > lock(g_Mutex);
+    // Do we need a new slot?
+    if (g_Pending >= g_Messages.size())
+    {
+        g_Messages.emplace_back(String(), !error);
+    }
+    std::pair< String, bool > & slot = g_Messages[g_Pending++];
+    // Reuse the storage of the slot
+    slot.first.assign(text, length);
+    slot.second = !error;
+}
+
+// ------------------------------------------------------------------------------------------------
+static void QueueMtMsg(bool type, bool verbose, CCStr msg, va_list args)
+{
+    const bool sinks = HasLogSinks() && (!verbose || g_Verbose || g_LogVerbose);
+    const bool console = !verbose || g_Verbose;
+    // Does anyone want to see this?
+    if (!sinks && !console)
+    {
+        return;
+    }
+    // Was the same message let through not long ago? Then don't even bother formatting it
+    if (g_LogRepeatWindow && SuppressRepeat(msg, !type, verbose, QueueMtText))
+    {
+        return;
+    }
+    // Create a copy of the specified arguments list
+    va_list args_cpy;
+    va_copy(args_cpy, args);
+    // Format on the stack first since most messages are short
+    char buffer[1024];
+    // Attempt to run the specified format
+    Int32 size = vsnprintf(buffer, sizeof(buffer), msg, args);
+    // See if the format failed
+    if (size < 0)
+    {
+        va_end(args_cpy);
+        return;
+    }
+    const size_t length = std::min(static_cast< size_t >(size), sizeof(buffer) - 1);
+    // Let the summary of later repeats quote this message
+    if (g_LogRepeatWindow)
+    {
+        RememberRepeat(buffer, length);
+    }
+    // Give the sinks a copy
+    if (sinks)
+    {
+        DispatchLog(!type, verbose, buffer, length);
+    }
+    // Does the console want to see this?
+    if (!console)
+    {
+        va_end(args_cpy);
+        return;
+    }
+    // Is there no thread? Then this is the server thread and there's nothing to queue for
+    else if (g_FrameBudget != 0)
+    {
+        // Did the message fit on the stack?
+        if (static_cast< unsigned >(size) < sizeof(buffer))
+        {
+            OutputConsole(type, "%s", buffer);
+        }
+        else if (type)
+        {
+            OutputMessageImpl(msg, args_cpy);
+        }
+        else
+        {
+            OutputErrorImpl(msg, args_cpy);
+        }
+        va_end(args_cpy);
+        return;
+    }
+    // Acquire a global lock
+    std::lock_guard< std::mutex > lock(g_Mutex);
+    // Do we need a new slot?
+    if (g_Pending >= g_Messages.size())
+    {
+        g_Messages.emplace_back(String(), type);
+    }
+    std::pair< String, bool > & slot = g_Messages[g_Pending++];
+    // Reuse the storage of the slot
+    slot.second = type;
+    // See if a larger buffer is necessary
+    if (static_cast< unsigned >(size) >= sizeof(buffer))
+    {
+        // Resize the slot to the required size
+        slot.first.resize(static_cast< unsigned >(size+1), '\0');
+        // Attempt to run the specified format
+        size = vsnprintf(&slot.first[0], slot.first.size(), msg, args_cpy);
+        // Remove unwanted characters
+        slot.first.resize(size < 0 ? 0 : static_cast< unsigned >(size));
+    }
+    else
+    {
+        slot.first.assign(buffer, static_cast< unsigned >(size));
+    }
+    // Finalize the arguments list copy
+    va_end(args_cpy);
+}
+
+// ------------------------------------------------------------------------------------------------
+void MtOutputMessage(CCStr msg, ...)
+{
+    // Initialize the arguments list
+    va_list args;
+    va_start(args, msg);
+    // Attempt to generate and queue the message
+    QueueMtMsg(true, false, msg, args);
+    // Finalize the arguments list
+    va_end(args);
+}
+
+// ------------------------------------------------------------------------------------------------
+void MtOutputError(CCStr msg, ...)
+{
+    // Initialize the arguments list
+    va_list args;
+    va_start(args, msg);
+    // Attempt to generate and queue the message
+    QueueMtMsg(false, false, msg, args);
+    // Finalize the arguments list
+    va_end(args);
+}
+
+// ------------------------------------------------------------------------------------------------
+void MtVerboseMessage(CCStr msg, ...)
+{
+    // Are verbose messages wanted anywhere?
+    if (!g_Verbose && !g_LogVerbose)
+    {
+        return;
+    }
+    // Initialize the arguments list
+    va_list args;
+    va_start(args, msg);
+    // Attempt to generate and queue the message
+    QueueMtMsg(true, true, msg, args);
+    // Finalize the arguments list
+    va_end(args);
+}
+
+// ------------------------------------------------------------------------------------------------
+void MtVerboseError(CCStr msg, ...)
+{
+    // Are verbose messages wanted anywhere?
+    if (!g_Verbose && !g_LogVerbose)
+    {
+        return;
+    }
+    // Initialize the arguments list
+    va_list args;
+    va_start(args, msg);
+    // Attempt to generate and queue the message
+    QueueMtMsg(false, true, msg, args);
+    // Finalize the arguments list
+    va_end(args);
+}
+
+} // Namespace:: SMod
@@ -0,0 +1,1339 @@
+#ifndef _LIBRARY_ANNOUNCE_HPP_
+#define _LIBRARY_ANNOUNCE_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+#include "Arena.hpp"
+#include "Engine.hpp"
+#include "Flight.hpp"
+#include "Log.hpp"
+#include "Thread.hpp"
+#include "Transport.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <ctime>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#include <SimpleIni.h>
+
+/* ------------------------------------------------------------------------------------------------
+ * ANNOUNCE DAEMON
+*/
+#define SMOD_DAEMON_PROTOCOL 1
+#define SMOD_DAEMON_SOCKET "/tmp/vcmp-announced.sock"
+
+/* ------------------------------------------------------------------------------------------------
+ * ANNOUNCE TRACE
+*/
+#define SMOD_TRACE_MAGIC 0x43524156
+#define SMOD_TRACE_VERSION 1
+
+#if defined(MSG_NOSIGNAL)
+    #define SMOD_MSG_NOSIGNAL MSG_NOSIGNAL
+#else
+    #define SMOD_MSG_NOSIGNAL 0
+#endif
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+typedef ::std::string String;
+
+/* ------------------------------------------------------------------------------------------------
+ * Order header names regardless of case, since that's how HTTP compares them.
+*/
+struct HeaderLess
+{
+    bool operator () (const String & a, const String & b) const
+    {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) {
+            return ::tolower(x) < ::tolower(y);
+        });
+    }
+};
+
+// ------------------------------------------------------------------------------------------------
+typedef std::multimap< String, String, HeaderLess > Headers; // Request headers by name.
+typedef std::multimap< String, String > Params; // Request parameters by name.
+
+// ------------------------------------------------------------------------------------------------
+extern bool                 g_Verbose; // Enable or disable verbose messages
+extern bool                 g_Pacing; // Spread announces evenly across the interval.
+extern unsigned int         g_UpdateInterval; // Default seconds between announces.
+extern unsigned int         g_MinInterval; // Lowest interval a master-server may ask for.
+extern unsigned int         g_MaxInterval; // Highest interval a master-server may ask for.
+extern bool                 g_Hedging; // Race a second mirror when the chosen one is slow.
+extern bool                 g_Pipelining; // Share a connection between master-servers on the same host.
+extern IoBackend            g_IoBackend; // How the announces of a cycle are carried out.
+extern unsigned int         g_FrameBudget; // Microseconds to announce for on each server frame or 0 to use a thread.
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a message only if the _DEBUG was defined.
+*/
+void OutputDebug(CCStr msg, ...);
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a formatted user message to the console.
+*/
+void OutputMessage(CCStr msg, ...);
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a formatted error message to the console.
+*/
+void OutputError(CCStr msg, ...);
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a formatted verbose user message to the console.
+*/
+void VerboseMessage(CCStr msg, ...);
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a formatted verbose error message to the console.
+*/
+void VerboseError(CCStr msg, ...);
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a formatted user message to the console in a thread safe manner.
+*/
+void MtOutputMessage(CCStr msg, ...);
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a formatted error message to the console in a thread safe manner.
+*/
+void MtOutputError(CCStr msg, ...);
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a formatted verbose user message to the console in a thread safe manner.
+*/
+void MtVerboseMessage(CCStr msg, ...);
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a formatted verbose error message to the console in a thread safe manner.
+*/
+void MtVerboseError(CCStr msg, ...);
+
+/* ------------------------------------------------------------------------------------------------
+ * Flush queued messages to the console output.
+*/
+void FlushMessages();
+
+/* ------------------------------------------------------------------------------------------------
+ * Parse a HTTP date (IMF-fixdate, ex: "Sun, 06 Nov 1994 08:49:37 GMT") into seconds since epoch.
+*/
+bool ParseHttpDate(CCStr str, std::time_t & out);
+
+/* ------------------------------------------------------------------------------------------------
+ * Extract the announce interval a master-server asked for in its response. Zero if there's none.
+ * Looked up in order: "VCMP-Announce-Interval: <seconds>", "Retry-After: <seconds|http-date>"
+ * and finally "Cache-Control: max-age=<seconds>".
+*/
+long IntervalFromResponse(const Response & res);
+
+/* ------------------------------------------------------------------------------------------------
+ * Compute a hash of the specified string that is stable across processes and runs. (FNV-1a)
+*/
+uint32_t StableHash(const String & str);
+
+/* ------------------------------------------------------------------------------------------------
+ * Compute the offset of a phase slot within the update interval. Consecutive slots are spread
+ * using the golden ratio so any number of instances end up evenly staggered.
+*/
+std::chrono::milliseconds PhaseOffset(uint32_t hash, uint32_t slot);
+
+/* ------------------------------------------------------------------------------------------------
+ * Simple parser that extracts URI information from a string.
+*/
+struct URI
+{
+    /* ---------------------------------------------------------------------------------------------
+     * Base constructor.
+    */
+    URI(CCStr address)
+        : mHost()
+        , mPort()
+        , mPath()
+        , mFull()
+        , mAddr()
+    {
+        // Is there even an address to parse?
+        if (!address || strlen(address) <= 0)
+        {
+            return;
+        }
+        // Skip the protocol if it was specified
+        if (strncmp(address, "http://", 7) == 0)
+        {
+            address += 7; // Skip the protocol
+        }
+        else if (strncmp(address, "https://", 8) == 0)
+        {
+            address += 8; // Skip the protocol
+        }
+        // Find where the port starts
+        CCStr port = strchr(address, ':');
+        // Find where the path starts
+        CCStr path = strchr(port ? port : address, '/');
+        // Did we find the port separator?
+        if (port)
+        {
+            // Copy everything until the port separator
+            mHost.assign(address, port - address);
+        }
+        // Did we find the path separator?
+        else if(path)
+        {
+            // Copy everything until the path separator
+            mHost.assign(address, path - address);
+        }
+        // The entire address is the host
+        else
+        {
+            // Copy the entire address
+            mHost.assign(address);
+        }
+        // Should we skip the port separator?
+        if (port)
+        {
+            ++port;
+        }
+        // Did we find both a port and path?
+        if (port && path)
+        {
+            // Copy everything between the port and path separators
+            mPort.assign(port, path - port);
+        }
+        else if (port)
+        {
+            // Copy everything after the port separator
+            mPort.assign(port);
+        }
+        // Assign the default port
+        else
+        {
+            mPort.assign("80");
+        }
+        // Copy the path if necessary
+        if (path)
+        {
+            mPath.assign(path);
+        }
+        // Assign a default path just in case
+        else
+        {
+            mPath.assign(1, '/');
+        }
+        // Generate the full URI
+        mFull.assign("http://");
+        mFull.append(mHost);
+        mFull += ':';
+        mFull.append(mPort);
+        mFull.append(mPath);
+        mAddr.append(mHost);
+        // Generate the connect address
+        mAddr += ':';
+        mAddr.append(mPort);
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor.
+    */
+    URI(const URI & o)
+        : mHost(o.mHost)
+        , mPort(o.mPort)
+        , mPath(o.mPath)
+        , mFull(o.mFull)
+        , mAddr(o.mAddr)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Move constructor.
+    */
+    URI(URI && o)
+        : mHost(std::forward< std::string >(o.mHost))
+        , mPort(std::forward< std::string >(o.mPort))
+        , mPath(std::forward< std::string >(o.mPath))
+        , mFull(std::forward< std::string >(o.mFull))
+        , mAddr(std::forward< std::string >(o.mAddr))
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator.
+    */
+    URI & operator = (const URI & o)
+    {
+        if (this != &o)
+        {
+            mHost = o.mHost;
+            mPort = o.mPort;
+            mPath = o.mPath;
+            mFull = o.mFull;
+            mAddr = o.mAddr;
+        }
+        return *this;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Move assignment operator.
+    */
+    URI & operator = (URI && o)
+    {
+        if (this != &o)
+        {
+            mHost = std::forward< std::string >(o.mHost);
+            mPort = std::forward< std::string >(o.mPort);
+            mPath = std::forward< std::string >(o.mPath);
+            mFull = std::forward< std::string >(o.mFull);
+            mAddr = std::forward< std::string >(o.mAddr);
+        }
+        return *this;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the protocol as a c string.
+    */
+    CCStr Protocol() const
+    {
+        return "http://";
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the host address as a c string.
+    */
+    CCStr Host() const
+    {
+        return mHost.c_str();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the port number as a c string.
+    */
+    CCStr Port() const
+    {
+        return mPort.c_str();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the request path as a c string.
+    */
+    CCStr Path() const
+    {
+        return mPath.c_str();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the full address as a c string.
+    */
+    CCStr Full() const
+    {
+        return mFull.c_str();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the connect address as a c string.
+    */
+    CCStr Addr() const
+    {
+        return mAddr.c_str();
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    String          mHost; // The host name.
+    String          mPort; // The port number.
+    String          mPath; // The request path.
+    String          mFull; // The full address.
+    String          mAddr; // The address used to connect to.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Knowledge about a master-server that is shared between all announcer instances on this machine.
+*/
+struct SharedMaster
+{
+    uint32_t        mKey; // Hash of the host and port below. Zero if the entry is unused.
+    uint32_t        mTickets; // How many phase slots were handed out to instances.
+    uint32_t        mFails; // Consecutive failures observed by any instance.
+    uint32_t        mReserved; // Padding.
+    int64_t         mDownUntil; // Unix time until which the master-server should be left alone.
+    int64_t         mResolvedAt; // Unix time when the numeric address below was obtained.
+    char            mHost[112]; // The host and port this entry belongs to, cut short if longer.
+    char            mResolved[64]; // Numeric address the host resolved to.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Layout of the shared coordination file.
+*/
+struct SharedTable
+{
+    // ---------------------------------------------------------------------------------------------
+    static constexpr uint32_t MAGIC = 0x4E4E4156; // "VANN"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t COUNT = 256;
+    // ---------------------------------------------------------------------------------------------
+    uint32_t        mMagic; // Identifies the file as ours.
+    uint32_t        mVersion; // Layout version.
+    uint32_t        mCount; // Number of entries.
+    uint32_t        mReserved; // Padding.
+    SharedMaster    mMasters[COUNT]; // Open addressed table keyed by master-server host.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Coordinates announces between several announcer instances running on the same machine through
+ * a memory mapped file. Instances share phase assignment, resolved addresses and which master-
+ * servers are currently down so they don't all hammer the same dead master-server.
+*/
+class Coordinator
+{
+public:
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr int64_t RESOLVE_TTL = 300; // Seconds a resolved address is shared.
+    static constexpr uint32_t DOWN_AFTER = 3; // Consecutive failures before a master is down.
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    Coordinator()
+        : m_File(-1), m_Table(nullptr)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    Coordinator(const Coordinator &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~Coordinator()
+    {
+        Close();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    Coordinator & operator = (const Coordinator &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether the coordination file is in use.
+    */
+    bool IsOpen() const
+    {
+        return m_Table != nullptr;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Open (or create) the coordination file at the specified path.
+    */
+    bool Open(CCStr path);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Release the coordination file.
+    */
+    void Close();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Claim a phase slot on the specified master-server. Each instance receives a different one.
+    */
+    uint32_t Ticket(const URI & addr);
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether the specified master-server is known to be down and should be skipped. When it is
+     * time to probe it again, the caller is given the probe and other instances keep skipping it,
+     * unless it only wanted to look.
+    */
+    bool IsDown(const URI & addr, bool probe = true);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Share the outcome of an announce on the specified master-server.
+    */
+    void Report(const URI & addr, bool alive);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Obtain the numeric address of the specified master-server, resolving it only if no other
+     * instance did so recently.
+    */
+    bool Resolve(const URI & addr, String & out);
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Hold an exclusive lock on the coordination file for the duration of a scope.
+    */
+    struct Lock
+    {
+        explicit Lock(int file);
+        ~Lock();
+        int m_File;
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Find or create the entry for the specified master-server. Must be called under lock.
+    */
+    SharedMaster * Find(const URI & addr);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Resolve the host of the specified address to a numeric address.
+    */
+    static bool ResolveHost(const URI & addr, String & out);
+
+    // ---------------------------------------------------------------------------------------------
+    int             m_File; // Descriptor of the coordination file.
+    SharedTable *   m_Table; // The mapped coordination table.
+};
+
+// ------------------------------------------------------------------------------------------------
+extern Coordinator          g_Coordinator; // Shared state with other instances on this machine.
+
+/* ------------------------------------------------------------------------------------------------
+ * What an announcer learned about a master-server, kept in the state file across restarts.
+*/
+struct SavedMaster
+{
+    uint32_t        mKey; // Hash of the address and port below. Zero if the entry is unused.
+    uint32_t        mPort; // Port of the game server announced on the master-server.
+    uint16_t        mFails; // Failures since the last success.
+    uint8_t         mState; // What is done with the master-server. (MasterTable::State)
+    uint8_t         mMoved; // Whether the master-server moved permanently to the address below.
+    uint32_t        mInterval; // Seconds between announces, as learned from the master-server.
+    uint32_t        mLatency; // Latency of the last announce. (microseconds)
+    uint32_t        mAddressLen; // Size of the resolved address or 0.
+    int64_t         mNextAt; // When the next announce is due. (microseconds since epoch, 0 if never saved)
+    int64_t         mResolvedAt; // When the address was resolved. (seconds since epoch)
+    double          mMirrorLatency; // Smoothed latency as a mirror. (microseconds)
+    double          mMirrorSuccess; // Smoothed success rate as a mirror.
+    uint8_t         mAddress[32]; // The resolved address. (sockaddr)
+    char            mFull[128]; // The address this entry belongs to, cut short if longer.
+    char            mMovedHost[64]; // Host the master-server moved to.
+    char            mMovedPort[8]; // Port the master-server moved to.
+    char            mMovedPath[224]; // Path the master-server moved to.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Layout of the state file.
+*/
+struct SavedTable
+{
+    // ---------------------------------------------------------------------------------------------
+    static constexpr uint32_t MAGIC = 0x54534156; // "VAST"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t COUNT = 256;
+    // ---------------------------------------------------------------------------------------------
+    uint32_t        mMagic; // Identifies the file as ours.
+    uint32_t        mVersion; // Layout version.
+    uint32_t        mCount; // Number of entries.
+    uint32_t        mReserved; // Padding.
+    SavedMaster     mMasters[COUNT]; // Open addressed table keyed by master-server and game server port.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Keeps what the announcer learned about the master-servers in a memory mapped file so that a
+ * restart picks up where the previous run left off instead of starting cold. Entries are updated
+ * in place after every announce by the thread that owns the master-server.
+*/
+class StateFile
+{
+public:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    StateFile()
+        : m_File(-1), m_Table(nullptr)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    StateFile(const StateFile &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~StateFile()
+    {
+        Close();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    StateFile & operator = (const StateFile &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether the state file is in use.
+    */
+    bool IsOpen() const
+    {
+        return m_Table != nullptr;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Open (or create) the state file at the specified path. Only one process may use it.
+    */
+    bool Open(CCStr path);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Write the state to disk and release the file.
+    */
+    void Close();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Find or create the entry of the specified master-server as announced by the game server on
+     * the specified port. Returns null if the table is full.
+    */
+    SavedMaster * Find(const URI & addr, uint32_t port);
+
+private:
+
+    // ---------------------------------------------------------------------------------------------
+    int             m_File; // Descriptor of the state file.
+    SavedTable *    m_Table; // The mapped state table.
+};
+
+// ------------------------------------------------------------------------------------------------
+extern StateFile            g_State; // What was learned about the master-servers across restarts.
+
+/* ------------------------------------------------------------------------------------------------
+ * Captures how every master-server answered into a compact binary trace that can be replayed later.
+ *
+ * Layout (host byte order): uint32 magic, uint32 version, followed by entries starting with a uint8:
+ *  EntryMaster:    uint32 id, uint16 length, address
+ *  EntryResponse:  uint32 id, uint64 time (us since epoch), uint32 latency (us), uint16 status (0 if
+ *                  unreachable), uint32 body size, uint16 header count, then each header as
+ *                  uint16 length, name, uint16 length, value
+*/
+class Recorder
+{
+public:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Type of the entries found in a trace.
+    */
+    enum Entry
+    {
+        EntryMaster = 1, // Assigns an identifier to a master-server address.
+        EntryResponse // How a master-server answered an announce.
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    Recorder()
+        : m_File(nullptr), m_Mutex(), m_Masters()
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    Recorder(const Recorder &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~Recorder()
+    {
+        Close();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    Recorder & operator = (const Recorder &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether announces are being captured.
+    */
+    bool IsOpen() const
+    {
+        return m_File != nullptr;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Create the trace file at the specified path, replacing any previous one.
+    */
+    bool Open(CCStr path);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Finish the trace file.
+    */
+    void Close();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Append the outcome of an announce. A null response means the master-server was unreachable.
+    */
+    void Capture(const URI & addr, uint64_t time, uint32_t latency, const Response * res);
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Append an integer to the trace.
+    */
+    template < typename T > void Put(T value)
+    {
+        fwrite(&value, sizeof(value), 1, m_File);
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Append a length prefixed string to the trace.
+    */
+    void Put(CCStr str);
+
+    // ---------------------------------------------------------------------------------------------
+    std::FILE *                     m_File; // The trace file.
+    std::mutex                      m_Mutex; // Announcers may capture from different threads.
+    std::map< String, uint32_t >    m_Masters; // Identifiers assigned to master-servers.
+};
+
+// ------------------------------------------------------------------------------------------------
+extern Recorder             g_Recorder; // Captures announce traffic when enabled.
+
+/* ------------------------------------------------------------------------------------------------
+ * Scheduling state of the master-servers of an announcer. Each field is kept in its own array, in
+ * the same order as the master-servers, so that finding the ones that are due only walks through a
+ * few contiguous cache lines instead of every master-server and its strings.
+*/
+struct MasterTable
+{
+    /* ---------------------------------------------------------------------------------------------
+     * What is done with a master-server.
+    */
+    enum State : uint8_t
+    {
+        Active = 0, // Announces are sent.
+        Invalid // The address is unusable or it failed too many times.
+    };
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr uint32_t NO_GROUP = UINT32_MAX; // The master-server is not a mirror.
+    static constexpr uint32_t NO_PIPELINE = UINT32_MAX; // The master-server has a host of its own.
+
+    /* ---------------------------------------------------------------------------------------------
+     * Append the state of a new master-server and the mirror group it belongs to, if any.
+    */
+    void Add(bool valid, unsigned interval, uint32_t group = NO_GROUP)
+    {
+        mNext.push_back(std::chrono::steady_clock::now());
+        mInterval.push_back(interval);
+        mLatency.push_back(0);
+        mFails.push_back(0);
+        mState.push_back(valid ? Active : Invalid);
+        mGroup.push_back(group);
+        mPipeline.push_back(static_cast< uint32_t >(NO_PIPELINE));
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the number of master-servers.
+    */
+    size_t Size() const
+    {
+        return mNext.size();
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    std::vector< std::chrono::steady_clock::time_point >    mNext; // When the next announce is due.
+    std::vector< uint32_t >                                 mInterval; // Seconds between announces.
+    std::vector< uint32_t >                                 mLatency; // Latency of the last announce. (microseconds)
+    std::vector< uint16_t >                                 mFails; // Failures since the last success.
+    std::vector< uint8_t >                                  mState; // What is done with the master-server.
+    std::vector< uint32_t >                                 mGroup; // Mirror group or NO_GROUP.
+    std::vector< uint32_t >                                 mPipeline; // Host pipeline or NO_PIPELINE.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Mirrors of the same master-list. Only one of them is announced on each cycle, chosen by the
+ * smoothed latency and success rate observed so far. The members share a single schedule.
+*/
+struct MirrorGroup
+{
+    // ---------------------------------------------------------------------------------------------
+    static constexpr size_t HISTORY = 32; // Latencies remembered to estimate the 95th percentile.
+    static constexpr size_t HEDGE_SAMPLES = 8; // Latencies needed before trusting the estimate.
+    static constexpr uint32_t HEDGE_DEFAULT = 1000000; // Hedge delay until then. (microseconds)
+    static constexpr unsigned PROBE_EVERY = 20; // Cycles between announces on the least recent member.
+    static constexpr double SMOOTHING = 0.2; // Weight of a new observation in the averages.
+
+    /* ---------------------------------------------------------------------------------------------
+     * What was observed about a single mirror.
+    */
+    struct Member
+    {
+        size_t      mIndex; // Index of the master-server.
+        double      mLatency; // Smoothed latency. (microseconds)
+        double      mSuccess; // Smoothed success rate. (0 to 1)
+        uint64_t    mSamples; // Announces observed.
+        uint64_t    mLastUsed; // Cycle of the last announce.
+        uint32_t    mHistory[HISTORY]; // Most recent latencies. (microseconds)
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Account for an announce on the specified member.
+    */
+    void Observe(size_t member, uint32_t latency, bool success);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Estimate how long the specified member takes to answer 95% of the time. (microseconds)
+    */
+    uint32_t P95(size_t member) const;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Sort the members from the most to the least promising into mOrder.
+    */
+    void Rank();
+
+    // ---------------------------------------------------------------------------------------------
+    std::vector< Member >   mMembers; // The mirrors, in the order they were specified.
+    std::vector< size_t >   mOrder; // Members from the most to the least promising.
+    std::vector< bool >     mTried; // Members already tried during this cycle.
+    uint64_t                mCycles; // Times the group was announced on.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Master-servers that are reached through the same host and port, such as several announce paths
+ * of one operator. Their announces are pipelined over a single connection.
+*/
+struct HostPipeline
+{
+    std::vector< size_t >   mMembers; // Indexes of the master-servers.
+    std::vector< size_t >   mBatch; // Members whose announces are pipelined this time.
+    std::vector< Response > mResponses; // Responses of the batch, in the same order.
+    String                  mRequests; // Encoded requests of the batch.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Manages a connection to a master-server. Only what is needed to talk to the master-server lives
+ * here. The scheduling state is kept by the announcer in a MasterTable.
+*/
+struct Server
+{
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Outcome of an update.
+    */
+    enum Result
+    {
+        Skipped = 0, // Nothing was sent.
+        Rejected, // The master-server could not be reached or refused the announce.
+        Announced, // The master-server accepted the announce.
+        Deferred // The announce goes on to another address on the next step. (FrameBudget only)
+    };
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr time_t CONNECT_TIMEOUT = 5; // Seconds to wait for a connection.
+    static constexpr unsigned REDIRECT_MAX = 20; // Most redirects followed in a single announce.
+    static constexpr unsigned INVALID_AFTER = 1000; // Failures in a row before giving up on a master-server.
+
+    /* ---------------------------------------------------------------------------------------------
+     * Base constructor.
+    */
+    Server(URI && addr);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    Server(const Server &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Move constructor.
+    */
+    Server(Server && o);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~Server()
+    {
+
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    Server & operator = (const Server &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Move assignment operator.
+    */
+    Server & operator = (Server && o);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Implicit conversion to boolean. Whether the address can be used at all.
+    */
+    operator bool () const
+    {
+        return m_Valid;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the associated master-server address.
+    */
+    const URI & GetURI() const
+    {
+        return m_Addr;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the encoded request that is sent on each announce.
+    */
+    const String & GetRequest() const
+    {
+        return m_Request;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the index of the master-server in the flight recorder.
+    */
+    uint16_t GetFlight() const
+    {
+        return m_Flight;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve when the last announce started by Begin() was sent.
+    */
+    TimePoint GetSent() const
+    {
+        return m_Sent;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the network path quality to this master-server, or to where it permanently moved.
+    */
+    const PathStats & GetPath() const
+    {
+        return m_MovedRequest.empty() ? m_Transport.GetPath() : m_Moved.GetPath();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether announces go straight to where the master-server permanently moved.
+    */
+    bool HasMoved() const
+    {
+        return !m_MovedRequest.empty();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Send the announce without waiting for the response. The returned socket, unless NO_SOCKET,
+     * must be handed to Update() or Transport::Abandon().
+    */
+    Transport::Socket Begin();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Receive the raw response to an announce sent by Begin() and close the connection, without
+     * acting on it. Returns whether a response was received.
+    */
+    bool Finish(Transport::Socket sock, Response & res)
+    {
+        return (m_MovedRequest.empty() ? m_Transport : m_Moved).Finish(sock, res);
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether the announce can be sent ahead of Update(), together with others, because it goes
+     * to the configured address and isn't skipped. Without a thread to block, announces to where the
+     * master-server moved are sent ahead too.
+    */
+    bool CanSendAhead(const MasterTable & table, size_t idx) const;
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether the address the announce goes to is known, looking it up in the background if it
+     * isn't. Meant for server frames, which must never wait on the system resolver.
+    */
+    bool Prefetch();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Describe the announce to an I/O engine that sends it ahead of Update().
+    */
+    void Prepare(IoJob & job, Response & res);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Append the announce to requests that are pipelined over a single connection. The connection
+     * is kept open after the response unless this is the last request.
+    */
+    void Queue(String & out, bool more);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Send requests queued by several master-servers on this host through one connection and receive
+     * their responses in the same order. Returns how many responses were received.
+    */
+    size_t Pipeline(const String & requests, Response * res, size_t count)
+    {
+        return m_Transport.Pipeline(requests, res, count);
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Increase the failure count and see whether updates should stop being sent on this server.
+    */
+    void Failed(MasterTable & table, size_t idx);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Make the server valid again and continue to send updates.
+    */
+    void MakeValid(MasterTable & table, size_t idx);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Create the server version header and the port parameter.
+    */
+    void ConfigureServer(unsigned version, unsigned port);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Encode the request sent on each announce from the headers and parameters.
+    */
+    void Encode();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Schedule the first announce. The slot separates announces of different game servers on the
+     * same master-server when pacing.
+    */
+    void Start(MasterTable & table, size_t idx, TimePoint now, uint32_t slot);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Connect to the master-server through the specified host address from now on.
+    */
+    void Reconnect(const String & host);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Schedule the next announce relative to the previous deadline to preserve the phase.
+    */
+    void Schedule(MasterTable & table, size_t idx, TimePoint now);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Store what was learned about this master-server into the specified state file entry.
+    */
+    void Save(const MasterTable & table, size_t idx, SavedMaster & out) const;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Pick up what was learned about this master-server by a previous run.
+    */
+    void Restore(MasterTable & table, size_t idx, const SavedMaster & in, TimePoint now);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Send the payload to the associated server to keep the server alive in the master-list. The
+     * scheduling state is found at the specified index of the table. The response storage and the
+     * arena for temporaries are supplied by the caller so that they can be shared between servers.
+     * If the announce was already sent by Begin(), its socket is passed along to receive the answer.
+     * If it was pipelined, the response storage already holds the answer and received is true.
+     * Without a thread to block, a redirect in a received answer is only prepared and Deferred is
+     * returned so that the caller sends the announce there on its next step.
+    */
+    Result Update(MasterTable & table, size_t idx, TimePoint now, Response & res, Arena & arena,
+                    Transport::Socket pending = Transport::NO_SOCKET, bool received = false);
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Send the request to the address found in the Location header of a redirect response. When
+     * every redirect so far was permanent, the request and the connection to the new address are
+     * kept so that later announces can go there directly. If it shouldn't be sent right away, the
+     * request is kept either way and a temporary redirect is only used by the next announce.
+    */
+    bool Redirect(Response & res, Arena & arena, bool permanent, bool send = true);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Forget the redirects followed by the announce that just ended, unless they were permanent.
+    */
+    void EndRedirects();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Generate the request for the specified address from the one sent to the master-server.
+    */
+    template < typename S > void Retarget(S & out, CCStr host, CCStr port, CCStr path) const;
+
+    // ---------------------------------------------------------------------------------------------
+    Transport           m_Transport; // The associated server connection.
+    bool                m_Valid; // Whether the address can be used at all.
+    URI                 m_Addr; // The master-server address information.
+    Headers             m_Headers; // Request headers.
+    Params              m_Params; // Request parameters.
+    String              m_Request; // The encoded announce request.
+    String              m_Connect; // The host address used to connect to the master-server.
+    Transport           m_Moved; // Connection to where the master-server permanently moved.
+    String              m_MovedRequest; // The request sent there or empty if it didn't move.
+    String              m_MovedPath; // The path requested there.
+    TimePoint           m_Sent; // When Begin() last sent the announce.
+    uint16_t            m_Flight; // Index of the master-server in the flight recorder.
+    bool                m_MovedOnce; // Whether only the next announce goes to where it moved.
+    uint8_t             m_Hops; // Announces deferred to another address since the last outcome.
+};
+
+// ------------------------------------------------------------------------------------------------
+typedef std::vector< Server >                       Servers;
+
+/* ------------------------------------------------------------------------------------------------
+ * Load the announce options from the [Options] section of the specified configuration.
+*/
+void ConfigureOptions(CSimpleIniA & conf);
+
+/* ------------------------------------------------------------------------------------------------
+ * Retrieve the master-server addresses from the [Servers] section of the specified configuration,
+ * in the order they were specified.
+*/
+void ConfigureMasters(CSimpleIniA & conf, std::vector< String > & out);
+
+/* ------------------------------------------------------------------------------------------------
+ * Heap allocations made by a thread.
+*/
+struct AllocCounters
+{
+    uint64_t        mCount; // Number of allocations.
+    uint64_t        mBytes; // Bytes requested.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Retrieve the heap allocations made so far by the calling thread. Always zero unless the library
+ * was built with SMOD_ALLOC_STATS, which hooks the allocator of the executable it is linked into.
+*/
+AllocCounters ThreadAllocations();
+
+/* ------------------------------------------------------------------------------------------------
+ * Counters describing the work done by an announcer.
+*/
+struct AnnounceStats
+{
+    uint64_t        mCycles; // How many times the master-servers were processed.
+    uint64_t        mAnnounces; // Announces that were sent.
+    uint64_t        mSuccesses; // Announces accepted by the master-server.
+    uint64_t        mFailures; // Announces that failed or were refused.
+    uint64_t        mSkipped; // Announces that were due but not sent.
+    uint64_t        mLatency; // Total time spent waiting for master-servers. (microseconds)
+    uint64_t        mMaxLatency; // Longest time spent on a single master-server. (microseconds)
+    uint64_t        mLastCycle; // Time spent on the last cycle. (microseconds)
+    uint64_t        mAllocations; // Heap allocations made while announcing. (SMOD_ALLOC_STATS only)
+    uint64_t        mAllocatedBytes; // Bytes requested by those allocations.
+    uint64_t        mLastAllocations; // Heap allocations made during the last cycle.
+    uint64_t        mLastAllocatedBytes; // Bytes requested during the last cycle.
+    uint64_t        mArenaHighWater; // Most arena memory used by a single cycle. (bytes)
+    uint64_t        mLastArena; // Arena memory used by the last cycle. (bytes)
+    uint64_t        mDegraded; // Master-servers whose network path is currently degraded.
+    uint64_t        mHedged; // Announces raced against a second mirror.
+    uint64_t        mHedgeWins; // Races won by the second mirror.
+    uint64_t        mPipelines; // Connections that carried the announces of several master-servers.
+    uint64_t        mPipelined; // Announces answered through those connections.
+    uint64_t        mSteps; // Server frames spent announcing. (FrameBudget only)
+    uint64_t        mStepTime; // Time spent announcing during those frames. (microseconds)
+    uint64_t        mMaxStep; // Longest time spent announcing in a single frame. (microseconds)
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Announces a single game server on a list of master-servers.
+*/
+class Announcer
+{
+public:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    Announcer()
+        : m_Servers(), m_Table(), m_Groups(), m_Pipelines(), m_Saved(), m_Stats(), m_Response(new Response())
+        , m_Arena(), m_Engine(), m_Batch(), m_Jobs(), m_Responses(), m_Stepping(false), m_Polling(false), m_Done(0)
+        , m_Wake(), m_StepStart(), m_StepAllocs()
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Parse the specified master-server address and add it to the list if it looks valid. Several
+     * addresses separated by white space or commas are added as a group of mirrors.
+    */
+    bool AddMaster(CCStr address);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Specify the game server version and port that are announced and schedule the first announce.
+    */
+    void SetPayload(unsigned version, unsigned port);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Announce on every master-server that is due and return the earliest of the next deadlines and
+     * the specified time-point.
+    */
+    Server::TimePoint Process(Server::TimePoint now, Server::TimePoint next);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Announce on every master-server right away, regardless of their schedule.
+    */
+    void Cycle();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Make progress on the announces without ever blocking, for about the specified number of
+     * microseconds at most. Meant to be called on every server frame instead of running a thread.
+    */
+    void Step(unsigned budget);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the number of master-servers.
+    */
+    size_t Count() const
+    {
+        return m_Servers.size();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the master-servers.
+    */
+    const Servers & GetServers() const
+    {
+        return m_Servers;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the scheduling state of the master-servers.
+    */
+    const MasterTable & GetTable() const
+    {
+        return m_Table;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the mirror groups.
+    */
+    const std::vector< MirrorGroup > & GetGroups() const
+    {
+        return m_Groups;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the groups of master-servers that share a connection.
+    */
+    const std::vector< HostPipeline > & GetPipelines() const
+    {
+        return m_Pipelines;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the work counters.
+    */
+    const AnnounceStats & GetStats() const
+    {
+        return m_Stats;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the engine that carries out the announces concurrently, if any.
+    */
+    const IoEngine * GetEngine() const
+    {
+        return m_Engine.get();
+    }
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Add the specified addresses as a group of mirrors.
+    */
+    bool AddMirrors(CCStr addresses);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Group the master-servers that are reached through the same host and port.
+    */
+    void AddPipelines();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Update the master-server at the specified index, or its whole mirror group or host pipeline.
+     * Members of a pipeline are only included if they are due by the specified time-point.
+    */
+    void Dispatch(size_t idx, Server::TimePoint now, Server::TimePoint due);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Update the master-server at the specified index and account for it. A response that was
+     * already received through a pipeline is passed along instead of announcing again.
+    */
+    Server::Result Update(size_t idx, Server::TimePoint now, Transport::Socket pending = Transport::NO_SOCKET,
+                            Response * received = nullptr);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Announce on the most promising member of the specified mirror group, hedged by the next one.
+    */
+    void UpdateGroup(uint32_t group, Server::TimePoint now);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Announce on the members of the specified host pipeline that are due, through one connection.
+    */
+    void UpdatePipeline(uint32_t pipeline, Server::TimePoint now, Server::TimePoint due);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Announce at once, through the I/O engine, on every master-server that is due by the specified
+     * time-point and isn't a mirror or part of a host pipeline. Returns how many were announced on.
+    */
+    size_t UpdateBatch(Server::TimePoint now, Server::TimePoint due);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Find the master-servers that are due by the specified time-point and whose announces can be
+     * sent ahead, and prepare them for the I/O engine. Mirror groups are only included when asked
+     * to, through their most promising member. Returns how many were found.
+    */
+    size_t CollectBatch(Server::TimePoint due, bool mirrors);
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether the announce on the specified master-server can be sent without waiting on the
+     * system resolver. Only server frames ever have to wait for the address.
+    */
+    bool Addressed(size_t idx);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Hand the response received by the I/O engine to the master-server at the specified position
+     * of the batch.
+    */
+    void CompleteBatch(size_t k, Server::TimePoint now);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Store what was learned about the master-server at the specified index into the state file.
+    */
+    void Save(size_t idx);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Account for the duration of a cycle and the allocations it made.
+    */
+    void Account(Server::TimePoint start, const AllocCounters & used);
+
+    // ---------------------------------------------------------------------------------------------
+    Servers                     m_Servers; // Master-servers to announce on.
+    MasterTable                 m_Table; // Scheduling state of the master-servers.
+    std::vector< MirrorGroup >  m_Groups; // Groups of mirrors among the master-servers.
+    std::vector< HostPipeline > m_Pipelines; // Master-servers that share a host and port.
+    std::vector< SavedMaster * > m_Saved; // State file entries of the master-servers or null.
+    AnnounceStats               m_Stats; // Work counters.
+    std::unique_ptr< Response > m_Response; // Response storage shared by the master-servers.
+    Arena                       m_Arena; // Temporaries of the current cycle.
+    std::unique_ptr< IoEngine > m_Engine; // Carries out concurrent announces or null.
+    std::vector< size_t >       m_Batch; // Master-servers announced on at once by the engine.
+    std::vector< IoJob >        m_Jobs; // Exchanges of the batch.
+    std::vector< Response >     m_Responses; // Responses of the batch.
+    bool                        m_Stepping; // Whether Step() has a batch going.
+    bool                        m_Polling; // Whether the I/O engine has exchanges of the batch going.
+    size_t                      m_Done; // Responses of the batch already handed to their master-server.
+    Server::TimePoint           m_Wake; // When Step() needs to look at the schedule again.
+    Server::TimePoint           m_StepStart; // When the batch of Step() was started.
+    AllocCounters               m_StepAllocs; // Allocations made by the steps of the batch so far.
+};
+
+} // Namespace:: SMod
+
+#endif // _LIBRARY_ANNOUNCE_HPP_
@@ -0,0 +1,69 @@
+// ------------------------------------------------------------------------------------------------
+#include "Arena.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdlib>
+
+// ------------------------------------------------------------------------------------------------
+#include <new>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+Arena::~Arena()
+{
+    for (auto & block : m_Blocks)
+    {
+        std::free(block.mData);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void * Arena::Allocate(size_t size, size_t align)
+{
+    // Look for a block with enough room, starting with the current one
+    for (; m_Current < m_Blocks.size(); ++m_Current, m_Offset = 0)
+    {
+        const Block & block = m_Blocks[m_Current];
+        // Where would this allocation start?
+        const size_t start = (m_Offset + align - 1) & ~(align - 1);
+        // Does it fit?
+        if (start + size <= block.mSize)
+        {
+            m_Used += start + size - m_Offset;
+            m_Offset = start + size;
+            m_HighWater = std::max(m_HighWater, m_Used);
+            return block.mData + start;
+        }
+    }
+    // Every block is full so get another one, large enough for this allocation
+    Block block;
+    block.mSize = std::max(static_cast< size_t >(BLOCK_SIZE), size + align);
+    block.mData = static_cast< char * >(std::malloc(block.mSize));
+    // Did the heap run out?
+    if (!block.mData)
+    {
+        throw std::bad_alloc();
+    }
+    m_Blocks.push_back(block);
+    m_Current = m_Blocks.size() - 1;
+    m_Offset = 0;
+    // Try again now that there's room
+    return Allocate(size, align);
+}
+
+// ------------------------------------------------------------------------------------------------
+size_t Arena::GetReserved() const
+{
+    size_t size = 0;
+    // Add up the size of every block
+    for (const auto & block : m_Blocks)
+    {
+        size += block.mSize;
+    }
+    return size;
+}
+
+} // Namespace:: SMod
@@ -0,0 +1,209 @@
+#ifndef _LIBRARY_ARENA_HPP_
+#define _LIBRARY_ARENA_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstddef>
+
+// ------------------------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <utility>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * Monotonic memory arena for the short lived data of an announce cycle. Memory is handed out from
+ * large blocks and only given back all at once when the arena is reset at the start of the next
+ * cycle. The blocks are kept between cycles so a steady workload stops touching the heap entirely.
+*/
+class Arena
+{
+public:
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr size_t BLOCK_SIZE = 16384; // Size of the blocks requested from the heap.
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    Arena()
+        : m_Blocks(), m_Current(0), m_Offset(0), m_Used(0), m_HighWater(0)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    Arena(const Arena & o) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Move constructor.
+    */
+    Arena(Arena && o)
+        : m_Blocks(std::move(o.m_Blocks)), m_Current(o.m_Current), m_Offset(o.m_Offset)
+        , m_Used(o.m_Used), m_HighWater(o.m_HighWater)
+    {
+        o.m_Blocks.clear();
+        o.Reset();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~Arena();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    Arena & operator = (const Arena & o) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Move assignment operator.
+    */
+    Arena & operator = (Arena && o)
+    {
+        // Our blocks are released by the other arena
+        std::swap(m_Blocks, o.m_Blocks);
+        std::swap(m_HighWater, o.m_HighWater);
+        std::swap(m_Current, o.m_Current);
+        std::swap(m_Offset, o.m_Offset);
+        std::swap(m_Used, o.m_Used);
+        return *this;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve memory for the specified number of bytes with the specified alignment.
+    */
+    void * Allocate(size_t size, size_t align);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Forget everything that was allocated. The blocks are kept for the next cycle.
+    */
+    void Reset()
+    {
+        m_Current = 0;
+        m_Offset = 0;
+        m_Used = 0;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the number of bytes handed out since the last reset.
+    */
+    size_t GetUsed() const
+    {
+        return m_Used;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the most bytes that were ever handed out between two resets.
+    */
+    size_t GetHighWater() const
+    {
+        return m_HighWater;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the number of bytes held by the arena.
+    */
+    size_t GetReserved() const;
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * A block of memory received from the heap.
+    */
+    struct Block
+    {
+        char *  mData; // Start of the block.
+        size_t  mSize; // Size of the block.
+    };
+
+    // ---------------------------------------------------------------------------------------------
+    std::vector< Block >    m_Blocks; // Blocks received from the heap.
+    size_t                  m_Current; // Block that memory is currently taken from.
+    size_t                  m_Offset; // Bytes taken from the current block.
+    size_t                  m_Used; // Bytes handed out since the last reset.
+    size_t                  m_HighWater; // Most bytes handed out between two resets.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Allocator that takes its memory from an arena so that standard containers can be used for the
+ * temporaries of an announce cycle. Memory is never given back individually.
+*/
+template < typename T > class ArenaAllocator
+{
+public:
+
+    // ---------------------------------------------------------------------------------------------
+    typedef T value_type;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Base constructor.
+    */
+    explicit ArenaAllocator(Arena & arena)
+        : m_Arena(&arena)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Conversion constructor.
+    */
+    template < typename U > ArenaAllocator(const ArenaAllocator< U > & o)
+        : m_Arena(o.m_Arena)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve memory for the specified number of elements.
+    */
+    T * allocate(size_t n)
+    {
+        return static_cast< T * >(m_Arena->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Memory is given back when the arena is reset.
+    */
+    void deallocate(T *, size_t)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether both allocators take memory from the same arena.
+    */
+    template < typename U > bool operator == (const ArenaAllocator< U > & o) const
+    {
+        return m_Arena == o.m_Arena;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether the allocators take memory from different arenas.
+    */
+    template < typename U > bool operator != (const ArenaAllocator< U > & o) const
+    {
+        return m_Arena != o.m_Arena;
+    }
+
+private:
+
+    // ---------------------------------------------------------------------------------------------
+    template < typename U > friend class ArenaAllocator;
+
+    // ---------------------------------------------------------------------------------------------
+    Arena * m_Arena; // Where the memory comes from.
+};
+
+// ------------------------------------------------------------------------------------------------
+typedef std::basic_string< char, std::char_traits< char >, ArenaAllocator< char > > ArenaString;
+
+} // Namespace:: SMod
+
+#endif // _LIBRARY_ARENA_HPP_
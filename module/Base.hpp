@@ -246,7 +246,7 @@ typedef const WcharT *              CCWStr;
 #if defined(_MSMOD_VER)
     #define SMOD_API_EXPORT     extern "C" __declspec(dllexport)
 #elif defined(__GNUC__)
-    #define SMOD_API_EXPORT     extern "C"
+    #define SMOD_API_EXPORT     extern "C" __attribute__((visibility("default")))
 #endif
 
 /* ------------------------------------------------------------------------------------------------
@@ -0,0 +1,204 @@
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+#include "Announce.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+
+// ------------------------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+/* ------------------------------------------------------------------------------------------------
+ * SOFTWARE INFORMATION
+*/
+#define SMOD_NAME "Master-server Announce Tool"
+#define SMOD_AUTHOR "Sandu Liviu Catalin (S.L.C)"
+#define SMOD_COPYRIGHT "Copyright (C) 2016 Sandu Liviu Catalin"
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+static volatile sig_atomic_t g_Running = 1; // Allow the announce loop to continue
+
+/* ------------------------------------------------------------------------------------------------
+ * Stop the announce loop when asked to terminate.
+*/
+static void StopHandler(int)
+{
+    g_Running = 0;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Output the work counters of the announcer.
+*/
+static void OutputStats(const Announcer & announcer, double wall, double cpu)
+{
+    const AnnounceStats & stats = announcer.GetStats();
+    // Average latency of the announces that were sent
+    const uint64_t avg = stats.mAnnounces ? stats.mLatency / stats.mAnnounces : 0;
+    OutputMessage("------------------------------------------------------------------");
+    OutputMessage("Master-servers: %u", static_cast< unsigned >(announcer.Count()));
+    OutputMessage("Cycles: %llu", static_cast< unsigned long long >(stats.mCycles));
+    OutputMessage("Announces: %llu (%llu succeeded, %llu failed, %llu skipped)",
+                    static_cast< unsigned long long >(stats.mAnnounces),
+                    static_cast< unsigned long long >(stats.mSuccesses),
+                    static_cast< unsigned long long >(stats.mFailures),
+                    static_cast< unsigned long long >(stats.mSkipped));
+    OutputMessage("Latency: %llu us average, %llu us max",
+                    static_cast< unsigned long long >(avg),
+                    static_cast< unsigned long long >(stats.mMaxLatency));
+    OutputMessage("Last cycle: %llu us", static_cast< unsigned long long >(stats.mLastCycle));
+    OutputMessage("Allocations: %llu (%llu bytes), last cycle %llu (%llu bytes)",
+                    static_cast< unsigned long long >(stats.mAllocations),
+                    static_cast< unsigned long long >(stats.mAllocatedBytes),
+                    static_cast< unsigned long long >(stats.mLastAllocations),
+                    static_cast< unsigned long long >(stats.mLastAllocatedBytes));
+    OutputMessage("Arena: %llu bytes last cycle, %llu bytes high-water",
+                    static_cast< unsigned long long >(stats.mLastArena),
+                    static_cast< unsigned long long >(stats.mArenaHighWater));
+    OutputMessage("Time: %.3f s wall, %.3f s cpu", wall, cpu);
+    OutputMessage("Degraded paths: %llu", static_cast< unsigned long long >(stats.mDegraded));
+    OutputMessage("Hedged: %llu (%llu won by the second mirror)",
+                    static_cast< unsigned long long >(stats.mHedged),
+                    static_cast< unsigned long long >(stats.mHedgeWins));
+    OutputMessage("Pipelined: %llu announces over %llu shared connections",
+                    static_cast< unsigned long long >(stats.mPipelined),
+                    static_cast< unsigned long long >(stats.mPipelines));
+    // Network path quality of each master-server, to help choose which ones to keep
+    for (const auto & server : announcer.GetServers())
+    {
+        const PathStats & path = server.GetPath();
+        // Was anything learned about this path?
+        if (path.mSamples == 0)
+        {
+            continue;
+        }
+        OutputMessage("  %s: rtt %u us +/- %u (best %u), %llu retransmits, %llu bytes acked, %llu bytes received%s",
+                        server.GetURI().Full(), path.mRtt, path.mRttVar, path.mMinRtt,
+                        static_cast< unsigned long long >(path.mRetransmits),
+                        static_cast< unsigned long long >(path.mBytesAcked),
+                        static_cast< unsigned long long >(path.mBytesReceived),
+                        path.mDegraded ? " (degraded)" : "");
+    }
+    OutputMessage("------------------------------------------------------------------");
+}
+
+} // Namespace:: SMod
+
+// ------------------------------------------------------------------------------------------------
+int main(int argc, char ** argv)
+{
+    using namespace SMod;
+    CCStr config = "announce.ini";
+    unsigned long cycles = 0;
+    unsigned port = 8192;
+    unsigned version = 0;
+    bool verbose = false;
+    // Process the command line
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            config = argv[++i];
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            cycles = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            port = static_cast< unsigned >(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-V") == 0 && i + 1 < argc)
+        {
+            version = static_cast< unsigned >(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else
+        {
+            printf("Usage: %s [-c announce.ini] [-n cycles] [-p port] [-V version] [-v]\n", argv[0]);
+            printf("  Without -n the master-servers are announced on schedule until interrupted.\n");
+            return EXIT_FAILURE;
+        }
+    }
+    // Create the configuration loader
+    CSimpleIniA conf(false, true, true);
+    // Attempt to load the configurations from disk
+    if (conf.LoadFile(config) < 0)
+    {
+        OutputError("Failed to load the configuration file: %s", config);
+        return EXIT_FAILURE;
+    }
+    // Load the announce options
+    ConfigureOptions(conf);
+    // Allow the command line to enable verbose messages
+    g_Verbose = g_Verbose || verbose;
+    // Attempt to retrieve the list of specified master-servers
+    std::vector< String > servers;
+    ConfigureMasters(conf, servers);
+    // Create the announcer
+    Announcer announcer;
+    for (const auto & address : servers)
+    {
+        announcer.AddMaster(address.c_str());
+    }
+    // See if any server was valid
+    if (announcer.Count() <= 0)
+    {
+        OutputError("No valid master-servers specified in: %s", config);
+        return EXIT_FAILURE;
+    }
+    // Generate the update payload
+    announcer.SetPayload(version, port);
+    // Stop gracefully when asked to
+    signal(SIGINT, StopHandler);
+    signal(SIGTERM, StopHandler);
+    // Take note of when we started
+    const auto wall = std::chrono::steady_clock::now();
+    const std::clock_t cpu = std::clock();
+    // Should we run a fixed number of cycles?
+    if (cycles > 0)
+    {
+        for (unsigned long n = 0; n < cycles && g_Running; ++n)
+        {
+            announcer.Cycle();
+            FlushMessages();
+        }
+    }
+    // Announce on schedule until interrupted
+    else
+    {
+        while (g_Running)
+        {
+            // Grab the current time point
+            const Server::TimePoint now = Server::Clock::now();
+            // Announce on whatever is due
+            const Server::TimePoint next = announcer.Process(now, now + std::chrono::seconds(g_UpdateInterval));
+            // Output whatever the announces produced
+            FlushMessages();
+            // Sleep in small steps so that an interruption is noticed
+            while (g_Running && Server::Clock::now() < next)
+            {
+                std::this_thread::sleep_for(std::min(std::chrono::duration_cast< std::chrono::milliseconds >(
+                                                next - Server::Clock::now()), std::chrono::milliseconds(250)));
+            }
+        }
+    }
+    // Output the results
+    OutputStats(announcer,
+                std::chrono::duration< double >(std::chrono::steady_clock::now() - wall).count(),
+                static_cast< double >(std::clock() - cpu) / CLOCKS_PER_SEC);
+    // Done!
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,457 @@
+// ------------------------------------------------------------------------------------------------
+#include "Coro.hpp"
+#include "Announce.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cerrno>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <chrono>
+
+// ------------------------------------------------------------------------------------------------
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/epoll.h>
+    #include <sys/socket.h>
+#endif // __linux__
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+#if defined(__linux__)
+
+// ------------------------------------------------------------------------------------------------
+Executor::~Executor()
+{
+    // Release the coroutines that are still waiting
+    for (auto handle : m_Ready)
+    {
+        handle.destroy();
+    }
+    for (auto waiter : m_Timers)
+    {
+        waiter->mHandle.destroy();
+    }
+    // Release the recycled frames
+    while (m_Frames)
+    {
+        Frame * frame = m_Frames;
+        m_Frames = frame->mNext;
+        ::operator delete(frame);
+    }
+    if (m_Epoll >= 0)
+    {
+        close(m_Epoll);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Executor::Init()
+{
+    m_Epoll = epoll_create1(EPOLL_CLOEXEC);
+    return m_Epoll >= 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+int64_t Executor::Now()
+{
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ------------------------------------------------------------------------------------------------
+void * Executor::Allocate(size_t size)
+{
+    // Every frame of a coroutine has the same size, so the first one decides what is recycled
+    if (m_FrameSize == 0)
+    {
+        m_FrameSize = size;
+    }
+    // Is there a released frame to reuse?
+    if (size == m_FrameSize && m_Frames)
+    {
+        Frame * frame = m_Frames;
+        m_Frames = frame->mNext;
+        return frame;
+    }
+    return ::operator new(size);
+}
+
+// ------------------------------------------------------------------------------------------------
+void Executor::Deallocate(void * frame, size_t size)
+{
+    // Keep it for the next coroutine of this size
+    if (size == m_FrameSize)
+    {
+        Frame * released = static_cast< Frame * >(frame);
+        released->mNext = m_Frames;
+        m_Frames = released;
+    }
+    else
+    {
+        ::operator delete(frame);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Executor::Spawn(Task && task)
+{
+    m_Ready.push_back(task.Release());
+    ++m_Alive;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Executor::Step(bool wait)
+{
+    // Resume every coroutine that can go on
+    m_Resuming.swap(m_Ready);
+    for (auto handle : m_Resuming)
+    {
+        handle.resume();
+        // Did it return? Then its frame can be reused
+        if (handle.done())
+        {
+            handle.destroy();
+            --m_Alive;
+        }
+    }
+    m_Resuming.clear();
+    // Is anything left to wait for?
+    if (m_Alive == 0 || !m_Ready.empty())
+    {
+        return;
+    }
+    int64_t now = Now();
+    // Wait until the earliest deadline at most, if waiting at all
+    const int ms = !wait ? 0 : (m_Timers.empty() ? -1 : static_cast< int >(m_Timers.front()->mDeadline > now ?
+                                    (m_Timers.front()->mDeadline - now + 999999) / 1000000 : 0));
+    struct epoll_event events[64];
+    const int n = epoll_wait(m_Epoll, events, sizeof(events) / sizeof(events[0]), ms);
+    // Wake the coroutines whose sockets are ready
+    for (int i = 0; i < n; ++i)
+    {
+        Waiter & waiter = *static_cast< Waiter * >(events[i].data.ptr);
+        // Is the coroutine waiting for this? Otherwise it finds out on its next attempt
+        if (waiter.mHandle && (events[i].events & (waiter.mEvents | EPOLLERR | EPOLLHUP)))
+        {
+            Wake(waiter, false);
+        }
+    }
+    now = Now();
+    // Wake the coroutines that ran out of time
+    while (!m_Timers.empty() && m_Timers.front()->mDeadline <= now)
+    {
+        Wake(*m_Timers.front(), true);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Executor::Watch(int sock, Waiter & waiter)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    ev.data.ptr = &waiter;
+    // The socket stays in the set until it's closed
+    return epoll_ctl(m_Epoll, EPOLL_CTL_ADD, sock, &ev) == 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Executor::Suspend(Waiter & waiter, std::coroutine_handle< > handle, uint32_t events, int64_t deadline)
+{
+    waiter.mHandle = handle;
+    waiter.mEvents = events;
+    waiter.mDeadline = deadline;
+    waiter.mExpired = false;
+    PushTimer(waiter);
+}
+
+// ------------------------------------------------------------------------------------------------
+void Executor::Wake(Waiter & waiter, bool expired)
+{
+    // The other reason to wake up no longer matters
+    if (waiter.mTimer != NO_TIMER)
+    {
+        RemoveTimer(waiter);
+    }
+    waiter.mExpired = expired;
+    m_Ready.push_back(waiter.mHandle);
+    waiter.mHandle = nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Executor::PushTimer(Waiter & waiter)
+{
+    waiter.mTimer = m_Timers.size();
+    m_Timers.push_back(&waiter);
+    SiftUp(waiter.mTimer);
+}
+
+// ------------------------------------------------------------------------------------------------
+void Executor::RemoveTimer(Waiter & waiter)
+{
+    const size_t pos = waiter.mTimer;
+    Waiter * last = m_Timers.back();
+    m_Timers.pop_back();
+    waiter.mTimer = NO_TIMER;
+    // Was it the last one? Otherwise the last one takes its place
+    if (last != &waiter)
+    {
+        m_Timers[pos] = last;
+        last->mTimer = pos;
+        SiftDown(pos);
+        SiftUp(last->mTimer);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void Executor::SiftUp(size_t pos)
+{
+    Waiter * waiter = m_Timers[pos];
+    // Move it up while its parent is due later
+    while (pos > 0)
+    {
+        const size_t parent = (pos - 1) / 2;
+        // Is it in the right place?
+        if (m_Timers[parent]->mDeadline <= waiter->mDeadline)
+        {
+            break;
+        }
+        m_Timers[pos] = m_Timers[parent];
+        m_Timers[pos]->mTimer = pos;
+        pos = parent;
+    }
+    m_Timers[pos] = waiter;
+    waiter->mTimer = pos;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Executor::SiftDown(size_t pos)
+{
+    const size_t count = m_Timers.size();
+    Waiter * waiter = m_Timers[pos];
+    // Move it down while a child is due earlier
+    for (;;)
+    {
+        size_t child = pos * 2 + 1;
+        // Is there any child?
+        if (child >= count)
+        {
+            break;
+        }
+        // Pick the child that is due first
+        if (child + 1 < count && m_Timers[child + 1]->mDeadline < m_Timers[child]->mDeadline)
+        {
+            ++child;
+        }
+        // Is it in the right place?
+        if (waiter->mDeadline <= m_Timers[child]->mDeadline)
+        {
+            break;
+        }
+        m_Timers[pos] = m_Timers[child];
+        m_Timers[pos]->mTimer = pos;
+        pos = child;
+    }
+    m_Timers[pos] = waiter;
+    waiter->mTimer = pos;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Carries out each exchange as a coroutine that reads top to bottom: resolve, connect, send, wait
+ * for the response, decide whether the failure was transient and back off before trying again.
+ * Thousands of exchanges only cost a recycled frame each.
+*/
+class CoroEngine : public IoEngine
+{
+public:
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr unsigned RETRY_MAX = 2; // Most times a transient failure is tried again.
+    static constexpr int64_t BACKOFF = 250000000; // Wait before the first retry, doubled every time. (ns)
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    CoroEngine()
+        : IoEngine(), m_Executor()
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Create the executor.
+    */
+    bool Init()
+    {
+        return m_Executor.Init();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the name of the backend.
+    */
+    CCStr Name() const override
+    {
+        return "coroutines";
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Make progress on the exchanges.
+    */
+    bool Poll(int64_t until, bool wait) override;
+
+protected:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Forget the exchanges of the previous Begin(). Every coroutine returned by then.
+    */
+    void Reset() override
+    {
+        /* ... */
+    }
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether an exchange that ended with the specified status is worth trying again.
+    */
+    static bool IsTransient(int status)
+    {
+        // No response at all, or a gateway that couldn't reach the master-server in time
+        return status == 0 || status == 502 || status == 504;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * The whole life of a single exchange.
+    */
+    static Task Exchange(Executor & executor, CoroEngine & engine, IoJob & job, int64_t deadline);
+
+    // ---------------------------------------------------------------------------------------------
+    Executor    m_Executor; // Runs the exchanges.
+};
+
+// ------------------------------------------------------------------------------------------------
+bool CoroEngine::Poll(int64_t until, bool wait)
+{
+    // Start more exchanges while there's room
+    for (; m_Next < m_Count && m_Executor.Alive() < MAX_ACTIVE; ++m_Next)
+    {
+        m_Executor.Spawn(Exchange(m_Executor, *this, m_Jobs[m_Next], Now() + m_Span));
+    }
+    // Readiness is only reported once, so whatever is ready is taken regardless of the time
+    SMOD_UNUSED_VAR(until);
+    m_Executor.Step(wait);
+    return m_Executor.Alive() == 0 && m_Next >= m_Count;
+}
+
+// ------------------------------------------------------------------------------------------------
+Task CoroEngine::Exchange(Executor & executor, CoroEngine & engine, IoJob & job, int64_t deadline)
+{
+    Executor::Waiter waiter;
+    int64_t backoff = BACKOFF;
+    for (unsigned attempt = 0;; ++attempt)
+    {
+        socklen_t len = 0;
+        // Resolve the address, unless it's known, and create the socket
+        const struct sockaddr_storage * addr = Open(job, deadline, false, len);
+        // Start connecting
+        if (addr && (connect(job.mSocket, reinterpret_cast< const struct sockaddr * >(addr), len) == 0 ||
+            errno == EINPROGRESS) && executor.Watch(job.mSocket, waiter))
+        {
+            // Wait for the connection to be established
+            if (co_await executor.Ready(waiter, EPOLLOUT, deadline))
+            {
+                int error = 0;
+                socklen_t size = sizeof(error);
+                // Find out how it ended
+                if (getsockopt(job.mSocket, SOL_SOCKET, SO_ERROR, &error, &size) == 0 && error == 0)
+                {
+                    job.mStage = Sending;
+                }
+            }
+            // Send the request
+            while (job.mStage == Sending)
+            {
+                const ssize_t n = send(job.mSocket, job.mRequest + job.mDone, job.mSize - job.mDone, MSG_NOSIGNAL);
+                // Did some of it go out?
+                if (n > 0)
+                {
+                    Sent(job, static_cast< size_t >(n));
+                }
+                // Is the socket full? Then wait for room
+                else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                {
+                    if (!co_await executor.Ready(waiter, EPOLLOUT, deadline))
+                    {
+                        break;
+                    }
+                }
+                else
+                {
+                    break;
+                }
+            }
+            // Receive the response
+            while (job.mStage == Heading || job.mStage == Reading)
+            {
+                size_t size = 0;
+                char * const buffer = engine.Buffer(job, size);
+                // Do the headers still fit?
+                if (!buffer)
+                {
+                    break;
+                }
+                const ssize_t n = recv(job.mSocket, buffer, size, 0);
+                // Did anything arrive, or did the connection end?
+                if (n >= 0)
+                {
+                    Received(job, static_cast< size_t >(n));
+                }
+                // Is there nothing more for now? Then wait for it
+                else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                {
+                    if (!co_await executor.Ready(waiter, EPOLLIN, deadline))
+                    {
+                        break;
+                    }
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+        // Did it end without a complete response?
+        if (job.mStage != Finished)
+        {
+            Finish(job, false);
+        }
+        // Is it worth trying again, and is there time to?
+        if (!IsTransient(job.mResponse->mStatus) || attempt >= RETRY_MAX || Now() + backoff >= deadline)
+        {
+            co_return;
+        }
+        // Back off before the next attempt
+        co_await executor.Sleep(waiter, Now() + backoff);
+        backoff *= 2;
+    }
+}
+
+#endif // __linux__
+
+// ------------------------------------------------------------------------------------------------
+std::unique_ptr< IoEngine > CreateCoroEngine()
+{
+#if defined(__linux__)
+    std::unique_ptr< CoroEngine > engine(new CoroEngine());
+    // Could we create the executor?
+    if (engine->Init())
+    {
+        return std::unique_ptr< IoEngine >(engine.release());
+    }
+#endif // __linux__
+    return nullptr;
+}
+
+} // Namespace:: SMod
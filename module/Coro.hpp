@@ -0,0 +1,363 @@
+#ifndef _LIBRARY_CORO_HPP_
+#define _LIBRARY_CORO_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Engine.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <vector>
+#include <memory>
+#include <coroutine>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+class Executor;
+
+/* ------------------------------------------------------------------------------------------------
+ * A coroutine that runs on an executor. It starts suspended and the executor resumes it until it
+ * returns. The first parameter of the coroutine must be the executor, which supplies the memory of
+ * its frame so that frames are recycled instead of taken from the heap on every announce.
+*/
+class Task
+{
+public:
+
+    /* ---------------------------------------------------------------------------------------------
+     * What the compiler keeps in the frame of the coroutine besides its locals.
+    */
+    struct promise_type
+    {
+        /* -----------------------------------------------------------------------------------------
+         * Take the frame from the executor the coroutine runs on.
+        */
+        template < typename... Args > static void * operator new(size_t size, Executor & executor, Args &&...);
+
+        /* -----------------------------------------------------------------------------------------
+         * Give the frame back to the executor it was taken from.
+        */
+        static void operator delete(void * frame, size_t size);
+
+        /* -----------------------------------------------------------------------------------------
+         * Create the task that refers to the coroutine.
+        */
+        Task get_return_object() noexcept
+        {
+            return Task(std::coroutine_handle< promise_type >::from_promise(*this));
+        }
+
+        /* -----------------------------------------------------------------------------------------
+         * Wait for the executor to resume the coroutine the first time.
+        */
+        std::suspend_always initial_suspend() const noexcept
+        {
+            return {};
+        }
+
+        /* -----------------------------------------------------------------------------------------
+         * Leave the frame for the executor to release once the coroutine returned.
+        */
+        std::suspend_always final_suspend() const noexcept
+        {
+            return {};
+        }
+
+        /* -----------------------------------------------------------------------------------------
+         * Nothing is returned.
+        */
+        void return_void() const noexcept
+        {
+            /* ... */
+        }
+
+        /* -----------------------------------------------------------------------------------------
+         * Exceptions are not used.
+        */
+        void unhandled_exception() const noexcept
+        {
+            std::terminate();
+        }
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    Task(const Task &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Move constructor.
+    */
+    Task(Task && o) noexcept
+        : m_Handle(o.m_Handle)
+    {
+        o.m_Handle = nullptr;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor. Releases the coroutine if it was never handed to an executor.
+    */
+    ~Task()
+    {
+        if (m_Handle)
+        {
+            m_Handle.destroy();
+        }
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    Task & operator = (const Task &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Give up the coroutine to whoever resumes it from now on.
+    */
+    std::coroutine_handle< > Release() noexcept
+    {
+        std::coroutine_handle< > handle = m_Handle;
+        m_Handle = nullptr;
+        return handle;
+    }
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Base constructor.
+    */
+    explicit Task(std::coroutine_handle< promise_type > handle) noexcept
+        : m_Handle(handle)
+    {
+        /* ... */
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    std::coroutine_handle< promise_type > m_Handle; // The coroutine or null once it was released.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Runs coroutines on the calling thread, resuming each one when the socket it waits on is ready or
+ * when its deadline passes. Sockets are watched through epoll in edge-triggered mode, so coroutines
+ * must try an operation first and only wait once it would block.
+*/
+class Executor
+{
+public:
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr size_t NO_TIMER = SIZE_MAX; // The waiter has no deadline pending.
+
+    /* ---------------------------------------------------------------------------------------------
+     * What a coroutine waits on. Kept in the frame of the coroutine for as long as it runs.
+    */
+    struct Waiter
+    {
+        /* -----------------------------------------------------------------------------------------
+         * Default constructor.
+        */
+        Waiter()
+            : mHandle(), mDeadline(0), mTimer(NO_TIMER), mEvents(0), mExpired(false)
+        {
+            /* ... */
+        }
+
+        // -----------------------------------------------------------------------------------------
+        std::coroutine_handle< >    mHandle; // The coroutine while it waits or null.
+        int64_t                     mDeadline; // When the wait is given up on. (monotonic nanoseconds)
+        size_t                      mTimer; // Position in the deadline heap or NO_TIMER.
+        uint32_t                    mEvents; // Socket events waited on or 0 to only wait for the deadline.
+        bool                        mExpired; // Whether the last wait ended because of the deadline.
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Suspends the calling coroutine until the waiter is woken. Resumes with true if the socket
+     * became ready or false if the deadline passed first.
+    */
+    struct Wait
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle< > handle)
+        {
+            mExecutor.Suspend(mWaiter, handle, mEvents, mDeadline);
+        }
+
+        bool await_resume() const noexcept
+        {
+            return !mWaiter.mExpired;
+        }
+
+        // -----------------------------------------------------------------------------------------
+        Executor &  mExecutor; // The executor that resumes the coroutine.
+        Waiter &    mWaiter; // What the coroutine waits on.
+        uint32_t    mEvents; // Socket events waited on.
+        int64_t     mDeadline; // When the wait is given up on.
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    Executor()
+        : m_Epoll(-1), m_Alive(0), m_Ready(), m_Resuming(), m_Timers(), m_Frames(nullptr), m_FrameSize(0)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    Executor(const Executor &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor. Coroutines that didn't finish are released.
+    */
+    ~Executor();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    Executor & operator = (const Executor &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Create the epoll instance.
+    */
+    bool Init();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the number of coroutines that didn't finish yet.
+    */
+    size_t Alive() const
+    {
+        return m_Alive;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the size of the coroutine frames that are recycled.
+    */
+    size_t FrameSize() const
+    {
+        return m_FrameSize;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Take over the specified coroutine and run it on the next step.
+    */
+    void Spawn(Task && task);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Resume the coroutines that can go on, then look for sockets that are ready and deadlines that
+     * passed. Waits for the first of them if asked to and any coroutine is left.
+    */
+    void Step(bool wait);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Watch the specified socket on behalf of the specified waiter until the socket is closed.
+    */
+    bool Watch(int sock, Waiter & waiter);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Wait for the watched socket to become ready for the specified events, at most until the
+     * specified deadline.
+    */
+    Wait Ready(Waiter & waiter, uint32_t events, int64_t deadline)
+    {
+        return Wait{*this, waiter, events, deadline};
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Wait until the specified time-point.
+    */
+    Wait Sleep(Waiter & waiter, int64_t until)
+    {
+        return Wait{*this, waiter, 0, until};
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the current monotonic time in nanoseconds.
+    */
+    static int64_t Now();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Obtain memory for a coroutine frame.
+    */
+    void * Allocate(size_t size);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Release the memory of a coroutine frame.
+    */
+    void Deallocate(void * frame, size_t size);
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * A released frame waiting to be reused.
+    */
+    struct Frame
+    {
+        Frame * mNext; // The next released frame.
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Suspend the specified coroutine on the specified waiter.
+    */
+    void Suspend(Waiter & waiter, std::coroutine_handle< > handle, uint32_t events, int64_t deadline);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Schedule the coroutine of the specified waiter to be resumed.
+    */
+    void Wake(Waiter & waiter, bool expired);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Add the specified waiter to the deadline heap.
+    */
+    void PushTimer(Waiter & waiter);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Remove the specified waiter from the deadline heap.
+    */
+    void RemoveTimer(Waiter & waiter);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Restore the order of the deadline heap around the specified position.
+    */
+    void SiftUp(size_t pos);
+    void SiftDown(size_t pos);
+
+    // ---------------------------------------------------------------------------------------------
+    int                                     m_Epoll; // The epoll instance.
+    size_t                                  m_Alive; // Coroutines that didn't finish yet.
+    std::vector< std::coroutine_handle< > > m_Ready; // Coroutines to resume on the next step.
+    std::vector< std::coroutine_handle< > > m_Resuming; // Coroutines being resumed by the current step.
+    std::vector< Waiter * >                 m_Timers; // Waiters with a deadline, the earliest first.
+    Frame *                                 m_Frames; // Released frames of the recycled size.
+    size_t                                  m_FrameSize; // Size of the recycled frames.
+};
+
+// ------------------------------------------------------------------------------------------------
+template < typename... Args > void * Task::promise_type::operator new(size_t size, Executor & executor, Args &&...)
+{
+    // Remember where the frame came from so it can be given back
+    void * block = executor.Allocate(size + sizeof(void *) * 2);
+    *static_cast< Executor ** >(block) = &executor;
+    return static_cast< char * >(block) + sizeof(void *) * 2;
+}
+
+// ------------------------------------------------------------------------------------------------
+inline void Task::promise_type::operator delete(void * frame, size_t size)
+{
+    void * block = static_cast< char * >(frame) - sizeof(void *) * 2;
+    (*static_cast< Executor ** >(block))->Deallocate(block, size + sizeof(void *) * 2);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Create the engine that carries out each exchange as a coroutine on a single-threaded executor.
+ * Returns null if the executor could not be created.
+*/
+std::unique_ptr< IoEngine > CreateCoroEngine();
+
+} // Namespace:: SMod
+
+#endif // _LIBRARY_CORO_HPP_
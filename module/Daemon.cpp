@@ -0,0 +1,389 @@
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+#include "Announce.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+
+// ------------------------------------------------------------------------------------------------
+#include <list>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+/* ------------------------------------------------------------------------------------------------
+ * SOFTWARE INFORMATION
+*/
+#define SMOD_NAME "Master-server Announce Daemon"
+#define SMOD_AUTHOR "Sandu Liviu Catalin (S.L.C)"
+#define SMOD_COPYRIGHT "Copyright (C) 2016 Sandu Liviu Catalin"
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+static constexpr size_t     MAX_REGISTRATION = 64 * 1024; // Largest registration accepted from a client.
+static constexpr mode_t     SOCKET_UMASK = 0117; // Leaves the socket readable and writable by owner and group.
+
+/* ------------------------------------------------------------------------------------------------
+ * A game server connected to the daemon and the master-servers it wants to be announced on.
+*/
+struct Peer
+{
+    /* ---------------------------------------------------------------------------------------------
+     * Base constructor.
+    */
+    explicit Peer(int sock)
+        : mSocket(sock), mVersion(0), mPort(0), mProtocol(0), mInput(), mMasters(), mAnnouncer()
+    {
+        /* ... */
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    int                     mSocket; // Connection to the game server.
+    unsigned                mVersion; // Version of the game server.
+    unsigned                mPort; // Port of the game server.
+    unsigned                mProtocol; // Protocol version used by the plug-in.
+    String                  mInput; // Partial commands received from the game server.
+    std::vector< String >   mMasters; // Master-server addresses received so far.
+    Announcer               mAnnouncer; // Master-servers being announced on.
+};
+
+// ------------------------------------------------------------------------------------------------
+typedef std::list< Peer >   Peers;
+
+// ------------------------------------------------------------------------------------------------
+static volatile sig_atomic_t g_Running = 1; // Allow the event loop to continue
+
+/* ------------------------------------------------------------------------------------------------
+ * Stop the event loop when asked to terminate.
+*/
+static void StopHandler(int)
+{
+    g_Running = 0;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Send a reply to the specified game server. Replies are tiny so they are never left pending.
+*/
+static void Reply(Peer & peer, const String & line)
+{
+    const String out = line + "\n";
+    // A failure here will be noticed on the next read
+    if (send(peer.mSocket, out.data(), out.size(), MSG_DONTWAIT | SMOD_MSG_NOSIGNAL) < 0)
+    {
+        VerboseError("Unable to reply to the game server on port %u", peer.mPort);
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Process a single command received from a game server. Returns false if the peer must be dropped.
+*/
+static bool Command(Peer & peer, const String & line)
+{
+    // Separate the command from its argument
+    const String::size_type sep = line.find(' ');
+    const String cmd(line, 0, sep);
+    const String arg(sep == String::npos ? String() : line.substr(sep + 1));
+    // Identify the command
+    if (cmd == "ANNOUNCE")
+    {
+        peer.mProtocol = static_cast< unsigned >(std::strtoul(arg.c_str(), nullptr, 10));
+        // Do we speak the same language?
+        if (peer.mProtocol != SMOD_DAEMON_PROTOCOL)
+        {
+            Reply(peer, "ERROR unsupported protocol version " + arg);
+            return false;
+        }
+        // Start a new registration
+        peer.mMasters.clear();
+    }
+    else if (peer.mProtocol == 0)
+    {
+        Reply(peer, "ERROR expected ANNOUNCE");
+        return false;
+    }
+    else if (cmd == "VERSION")
+    {
+        peer.mVersion = static_cast< unsigned >(std::strtoul(arg.c_str(), nullptr, 10));
+    }
+    else if (cmd == "PORT")
+    {
+        peer.mPort = static_cast< unsigned >(std::strtoul(arg.c_str(), nullptr, 10));
+    }
+    else if (cmd == "MASTER")
+    {
+        peer.mMasters.push_back(arg);
+    }
+    else if (cmd == "COMMIT")
+    {
+        // Drop whatever was being announced before
+        peer.mAnnouncer = Announcer();
+        // Create the master-server instances
+        for (const auto & master : peer.mMasters)
+        {
+            peer.mAnnouncer.AddMaster(master.c_str());
+        }
+        // Generate the payload and schedule the first announce
+        peer.mAnnouncer.SetPayload(peer.mVersion, peer.mPort);
+        OutputMessage("Game server on port %u registered %u master-servers",
+                        peer.mPort, static_cast< unsigned >(peer.mAnnouncer.Count()));
+        // Let the game server know
+        Reply(peer, "OK " + std::to_string(peer.mAnnouncer.Count()));
+    }
+    else
+    {
+        Reply(peer, "ERROR unknown command " + cmd);
+    }
+    // Keep the peer
+    return true;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Read whatever the game server sent. Returns false if the peer must be dropped.
+*/
+static bool Receive(Peer & peer)
+{
+    char buffer[4096];
+    // Read what is available
+    const ssize_t n = recv(peer.mSocket, buffer, sizeof(buffer), MSG_DONTWAIT);
+    // Did the game server go away?
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+        return false;
+    }
+    else if (n > 0)
+    {
+        peer.mInput.append(buffer, static_cast< size_t >(n));
+    }
+    // Process complete commands
+    for (String::size_type pos = peer.mInput.find('\n'); pos != String::npos; pos = peer.mInput.find('\n'))
+    {
+        const String line(peer.mInput, 0, pos);
+        // Remove it from the input
+        peer.mInput.erase(0, pos + 1);
+        // Process the command
+        if (!Command(peer, line))
+        {
+            return false;
+        }
+    }
+    // Is someone trying to make us run out of memory?
+    return peer.mInput.size() < MAX_REGISTRATION;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Create the listening unix socket.
+*/
+static int Listen(CCStr path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    // Will the path fit?
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        OutputError("Socket path is too long: %s", path);
+        return -1;
+    }
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    // Create the socket
+    const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    // Could we create it?
+    if (sock < 0)
+    {
+        OutputError("Unable to create the listening socket");
+        return -1;
+    }
+    struct stat st;
+    // Is there something at that path already?
+    if (lstat(path, &st) == 0)
+    {
+        // Never remove what isn't a socket or a socket that another daemon still listens on
+        if (!S_ISSOCK(st.st_mode))
+        {
+            OutputError("Not a socket, refusing to replace it: %s", path);
+            close(sock);
+            return -1;
+        }
+        else if (connect(sock, reinterpret_cast< struct sockaddr * >(&addr), sizeof(addr)) == 0 || errno != ECONNREFUSED)
+        {
+            OutputError("Another daemon is listening on: %s", path);
+            close(sock);
+            return -1;
+        }
+        // Remove the socket left behind by a previous run
+        unlink(path);
+    }
+    // Only the owner and group of the daemon may register game servers
+    const mode_t mask = umask(SOCKET_UMASK);
+    // Bind and listen for game servers
+    const bool bound = bind(sock, reinterpret_cast< struct sockaddr * >(&addr), sizeof(addr)) == 0;
+    umask(mask);
+    if (!bound || listen(sock, 64) != 0)
+    {
+        OutputError("Unable to listen on: %s", path);
+        close(sock);
+        return -1;
+    }
+    // Never block the event loop
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+    // Socket is ready
+    return sock;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * The event loop. Serves the game servers and announces on their behalf from a single thread.
+*/
+static void Run(int listener)
+{
+    Peers peers;
+    std::vector< struct pollfd > fds;
+    // Enter the event loop
+    while (g_Running)
+    {
+        // Grab the current time point
+        const Server::TimePoint now = Server::Clock::now();
+        // Announce on whatever is due, but look at the sockets at least once per second
+        Server::TimePoint next = now + std::chrono::seconds(1);
+        for (auto & peer : peers)
+        {
+            next = peer.mAnnouncer.Process(now, next);
+        }
+        // Output whatever the announces produced
+        FlushMessages();
+        // Wait for game servers until the next announce is due
+        const auto wait = std::chrono::duration_cast< std::chrono::milliseconds >(next - Server::Clock::now());
+        // Build the list of sockets to watch
+        fds.clear();
+        fds.push_back({listener, POLLIN, 0});
+        for (const auto & peer : peers)
+        {
+            fds.push_back({peer.mSocket, POLLIN, 0});
+        }
+        // Wait for something to happen
+        if (poll(fds.data(), fds.size(), std::max(static_cast< int >(wait.count()), 0)) <= 0)
+        {
+            continue;
+        }
+        // Service the game servers
+        size_t idx = 1;
+        for (auto itr = peers.begin(); itr != peers.end(); ++idx)
+        {
+            // Anything to read or did it hang up?
+            if (fds[idx].revents && !Receive(*itr))
+            {
+                OutputMessage("Game server on port %u disconnected", itr->mPort);
+                close(itr->mSocket);
+                itr = peers.erase(itr);
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+        // Accept new game servers
+        if (fds[0].revents & POLLIN)
+        {
+            for (int sock = accept(listener, nullptr, nullptr); sock >= 0; sock = accept(listener, nullptr, nullptr))
+            {
+                fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+                peers.emplace_back(sock);
+            }
+        }
+    }
+    // Release the game servers
+    for (auto & peer : peers)
+    {
+        close(peer.mSocket);
+    }
+}
+
+} // Namespace:: SMod
+
+// ------------------------------------------------------------------------------------------------
+int main(int argc, char ** argv)
+{
+    using namespace SMod;
+    CCStr config = "announced.ini";
+    CCStr path = nullptr;
+    bool explicit_config = false;
+    // Process the command line
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            config = argv[++i];
+            explicit_config = true;
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            path = argv[++i];
+        }
+        else
+        {
+            printf("Usage: %s [-c announced.ini] [-s socket]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    // Output is usually redirected to a log file so don't hold messages back
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    // Output daemon header
+    OutputMessage("------------------------------------------------------------------");
+    OutputMessage("Daemon: %s", SMOD_NAME);
+    OutputMessage("Author: %s", SMOD_AUTHOR);
+    OutputMessage("Legal: %s", SMOD_COPYRIGHT);
+    OutputMessage("------------------------------------------------------------------");
+    // Create the configuration loader
+    CSimpleIniA conf(false, true, true);
+    // Attempt to load the configurations from disk. Defaults are fine if there's none
+    if (conf.LoadFile(config) < 0 && explicit_config)
+    {
+        OutputError("Failed to load the configuration file: %s", config);
+        return EXIT_FAILURE;
+    }
+    // Load the announce options
+    ConfigureOptions(conf);
+    // Every game server is served from one thread, so one slow master-server must not hold up the rest
+    if (!conf.GetValue("Options", "Engine", nullptr))
+    {
+        g_IoBackend = IoEpoll;
+    }
+    // Find out where to listen for game servers
+    if (!path)
+    {
+        path = conf.GetValue("Options", "Socket", SMOD_DAEMON_SOCKET);
+    }
+    // Stop gracefully when asked to
+    signal(SIGINT, StopHandler);
+    signal(SIGTERM, StopHandler);
+    signal(SIGPIPE, SIG_IGN);
+    // Start listening for game servers
+    const int listener = Listen(path);
+    // Could we listen?
+    if (listener < 0)
+    {
+        return EXIT_FAILURE;
+    }
+    OutputMessage("Listening for game servers on: %s", path);
+    // Serve game servers until asked to stop
+    Run(listener);
+    // Clean up
+    close(listener);
+    unlink(path);
+    FlushMessages();
+    // Done!
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,859 @@
+// ------------------------------------------------------------------------------------------------
+#include "Engine.hpp"
+#include "Announce.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#ifdef SMOD_COROUTINES
+    #include "Coro.hpp"
+#endif
+
+// ------------------------------------------------------------------------------------------------
+#include <cerrno>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <vector>
+#include <chrono>
+
+// ------------------------------------------------------------------------------------------------
+#if defined(__linux__)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/epoll.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #ifdef SMOD_IO_URING
+        #include <sys/mman.h>
+        #include <sys/syscall.h>
+        #include <linux/io_uring.h>
+    #endif
+#endif // __linux__
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+#if defined(__linux__)
+
+// ------------------------------------------------------------------------------------------------
+int64_t IoEngine::Now()
+{
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ------------------------------------------------------------------------------------------------
+const struct sockaddr_storage * IoEngine::Open(IoJob & job, int64_t deadline, bool blocking, socklen_t & len)
+{
+    job.mSocket = Transport::NO_SOCKET;
+    job.mStage = Connecting;
+    job.mDone = 0;
+    job.mBody = 0;
+    job.mLength = -1;
+    job.mChunked = false;
+    job.mStatus = 0;
+    job.mDeadline = deadline;
+    job.mResponse->Clear();
+    // Find out where to connect
+    const struct sockaddr_storage * addr = job.mTransport->Address(len);
+    // Could the host be resolved?
+    if (addr)
+    {
+        job.mSocket = socket(addr->ss_family, SOCK_STREAM | SOCK_CLOEXEC | (blocking ? 0 : SOCK_NONBLOCK), IPPROTO_TCP);
+    }
+    // Was the socket created?
+    if (job.mSocket == Transport::NO_SOCKET)
+    {
+        Finish(job, false);
+        return nullptr;
+    }
+    return addr;
+}
+
+// ------------------------------------------------------------------------------------------------
+void IoEngine::Sent(IoJob & job, size_t size)
+{
+    job.mDone += size;
+    // Was the whole request sent?
+    if (job.mDone >= job.mSize)
+    {
+        job.mStage = Heading;
+        job.mDone = 0;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+char * IoEngine::Buffer(IoJob & job, size_t & size)
+{
+    // The body is discarded
+    if (job.mStage != Heading)
+    {
+        size = sizeof(m_Scratch);
+        return m_Scratch;
+    }
+    size = Response::BUFFER_SIZE - 1 - job.mDone;
+    // Do the headers still fit?
+    return size > 0 ? job.mResponse->mBuffer + job.mDone : nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------
+void IoEngine::Received(IoJob & job, size_t size)
+{
+    // Did the connection end?
+    if (size == 0)
+    {
+        // The body is only complete if it was meant to end with the connection
+        Finish(job, job.mStage == Reading && (job.mChunked || job.mLength < 0));
+        return;
+    }
+    // Still waiting for the headers?
+    else if (job.mStage == Heading)
+    {
+        Response & res = *job.mResponse;
+        job.mDone += size;
+        res.mBuffer[job.mDone] = '\0';
+        // Did the headers end?
+        if (!strstr(res.mBuffer, "\r\n\r\n"))
+        {
+            return;
+        }
+        char * const rest = Transport::ParseHead(res, job.mStatus, job.mLength, job.mChunked);
+        // Did it even resemble a response?
+        if (!rest)
+        {
+            Finish(job, false);
+            return;
+        }
+        // Whatever follows the headers is the start of the body
+        job.mBody = job.mDone - static_cast< size_t >(rest - res.mBuffer);
+        job.mStage = Reading;
+    }
+    else
+    {
+        job.mBody += size;
+    }
+    // Is the body complete? Without a length it ends when the connection is closed
+    if (!job.mChunked && job.mLength >= 0 && job.mBody >= static_cast< size_t >(job.mLength))
+    {
+        Finish(job, true);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void IoEngine::Finish(IoJob & job, bool received)
+{
+    Response & res = *job.mResponse;
+    // Hand over what was received
+    if (received)
+    {
+        res.mStatus = job.mStatus;
+        res.mBodySize = job.mBody;
+    }
+    else
+    {
+        res.Clear();
+    }
+    // Let the transport sample the path or forget the address
+    job.mTransport->Conclude(job.mSocket, received);
+    // Only one request is sent per connection
+    if (job.mSocket != Transport::NO_SOCKET)
+    {
+        close(job.mSocket);
+        job.mSocket = Transport::NO_SOCKET;
+    }
+    job.mStage = Finished;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Waits on every connection through a single epoll instance. Sockets are non-blocking and each
+ * one is driven as far as it goes whenever it becomes ready.
+*/
+class EpollEngine : public IoEngine
+{
+public:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    EpollEngine()
+        : IoEngine(), m_Epoll(-1), m_Oldest(0), m_Active(0)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~EpollEngine()
+    {
+        if (m_Epoll >= 0)
+        {
+            close(m_Epoll);
+        }
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Create the epoll instance.
+    */
+    bool Init()
+    {
+        m_Epoll = epoll_create1(EPOLL_CLOEXEC);
+        return m_Epoll >= 0;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the name of the backend.
+    */
+    CCStr Name() const override
+    {
+        return "epoll";
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Make progress on the exchanges.
+    */
+    bool Poll(int64_t until, bool wait) override;
+
+protected:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Forget the exchanges of the previous Begin().
+    */
+    void Reset() override
+    {
+        m_Oldest = 0;
+        m_Active = 0;
+    }
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Start connecting. Returns false if the exchange already finished.
+    */
+    bool Start(IoJob & job, size_t index, int64_t deadline);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Drive the exchange as far as it goes without blocking.
+    */
+    void Advance(IoJob & job, size_t index);
+
+    // ---------------------------------------------------------------------------------------------
+    int     m_Epoll; // The epoll instance.
+    size_t  m_Oldest; // The oldest exchange that may still be going.
+    size_t  m_Active; // Exchanges started and not finished.
+};
+
+// ------------------------------------------------------------------------------------------------
+bool EpollEngine::Poll(int64_t until, bool wait)
+{
+    // Start more exchanges while there's room and time, resolving a host may take a while
+    for (const size_t first = m_Next; m_Next < m_Count && m_Active < MAX_ACTIVE; ++m_Next)
+    {
+        const int64_t now = Now();
+        // Out of time? At least one is started on every call
+        if (m_Next > first && now >= until)
+        {
+            break;
+        }
+        m_Active += Start(m_Jobs[m_Next], m_Next, now + m_Span) ? 1 : 0;
+    }
+    const int64_t now = Now();
+    // Give up on the exchanges that ran out of time. They were started in order, so the oldest
+    // unfinished one is always the first to run out
+    for (; m_Oldest < m_Next && m_Active > 0; ++m_Oldest)
+    {
+        IoJob & job = m_Jobs[m_Oldest];
+        // Is this one still going and out of time?
+        if (job.mStage == Finished)
+        {
+            continue;
+        }
+        else if (job.mDeadline > now)
+        {
+            break;
+        }
+        Finish(job, false);
+        --m_Active;
+    }
+    // Is anything left to wait on?
+    if (m_Active == 0)
+    {
+        return m_Next >= m_Count;
+    }
+    struct epoll_event events[64];
+    // Wait until the oldest one runs out of time at most, if waiting at all
+    const int ms = wait ? static_cast< int >((m_Jobs[m_Oldest].mDeadline - now + 999999) / 1000000) : 0;
+    const int n = epoll_wait(m_Epoll, events, sizeof(events) / sizeof(events[0]), ms);
+    // Drive the connections that are ready
+    for (int i = 0; i < n; ++i)
+    {
+        // Out of time? The rest are reported again by the next wait
+        if (i > 0 && until != INT64_MAX && Now() >= until)
+        {
+            break;
+        }
+        const size_t index = static_cast< size_t >(events[i].data.u64);
+        Advance(m_Jobs[index], index);
+        // Did it finish?
+        if (m_Jobs[index].mStage == Finished)
+        {
+            --m_Active;
+        }
+    }
+    return m_Active == 0 && m_Next >= m_Count;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool EpollEngine::Start(IoJob & job, size_t index, int64_t deadline)
+{
+    socklen_t len = 0;
+    const struct sockaddr_storage * addr = Open(job, deadline, false, len);
+    // Was the socket created?
+    if (!addr)
+    {
+        return false;
+    }
+    // Start connecting
+    if (connect(job.mSocket, reinterpret_cast< const struct sockaddr * >(addr), len) == 0)
+    {
+        job.mStage = Sending;
+    }
+    else if (errno != EINPROGRESS)
+    {
+        Finish(job, false);
+        return false;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLOUT;
+    ev.data.u64 = index;
+    // Wait for the connection to be established or for room to send the request
+    if (epoll_ctl(m_Epoll, EPOLL_CTL_ADD, job.mSocket, &ev) != 0)
+    {
+        Finish(job, false);
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void EpollEngine::Advance(IoJob & job, size_t index)
+{
+    // Did the connection attempt end?
+    if (job.mStage == Connecting)
+    {
+        int error = 0;
+        socklen_t size = sizeof(error);
+        // Find out how it ended
+        if (getsockopt(job.mSocket, SOL_SOCKET, SO_ERROR, &error, &size) != 0 || error != 0)
+        {
+            Finish(job, false);
+            return;
+        }
+        job.mStage = Sending;
+    }
+    // Send as much of the request as the socket takes
+    if (job.mStage == Sending)
+    {
+        while (job.mStage == Sending)
+        {
+            const ssize_t n = send(job.mSocket, job.mRequest + job.mDone, job.mSize - job.mDone, MSG_NOSIGNAL);
+            // Is the socket full?
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            {
+                return;
+            }
+            // Did the connection break?
+            else if (n <= 0)
+            {
+                Finish(job, false);
+                return;
+            }
+            Sent(job, static_cast< size_t >(n));
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = index;
+        // Wait for the response
+        if (epoll_ctl(m_Epoll, EPOLL_CTL_MOD, job.mSocket, &ev) != 0)
+        {
+            Finish(job, false);
+        }
+        return;
+    }
+    // Receive whatever arrived
+    while (job.mStage == Heading || job.mStage == Reading)
+    {
+        size_t size = 0;
+        char * const buffer = Buffer(job, size);
+        // Do the headers still fit?
+        if (!buffer)
+        {
+            Finish(job, false);
+            return;
+        }
+        const ssize_t n = recv(job.mSocket, buffer, size, 0);
+        // Is there nothing more for now?
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            return;
+        }
+        // Did the connection break?
+        else if (n < 0)
+        {
+            Finish(job, false);
+            return;
+        }
+        Received(job, static_cast< size_t >(n));
+    }
+}
+
+#ifdef SMOD_IO_URING
+
+/* ------------------------------------------------------------------------------------------------
+ * Batches the connects, sends and receives of every connection through io_uring, each one linked
+ * to a timeout at the deadline of its exchange. The kernel headers are used directly so that no
+ * library is needed.
+*/
+class UringEngine : public IoEngine
+{
+public:
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr unsigned ENTRIES = 256; // Size of the submission queue.
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    UringEngine()
+        : IoEngine(), m_Ring(-1), m_SqMap(nullptr), m_SqSize(0), m_CqMap(nullptr), m_CqSize(0)
+        , m_Sqes(nullptr), m_SqesSize(0), m_SqHead(nullptr), m_SqTail(nullptr), m_SqArray(nullptr)
+        , m_SqMask(0), m_SqEntries(0), m_CqHead(nullptr), m_CqTail(nullptr), m_Cqes(nullptr), m_CqMask(0)
+        , m_Prepared(0), m_Inflight(0), m_Active(0), m_Generation(0), m_Times()
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~UringEngine();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Create the ring. Returns false if the kernel doesn't support what is needed.
+    */
+    bool Init();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the name of the backend.
+    */
+    CCStr Name() const override
+    {
+        return "io_uring";
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Make progress on the exchanges.
+    */
+    bool Poll(int64_t until, bool wait) override;
+
+protected:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Forget the exchanges of the previous Begin().
+    */
+    void Reset() override;
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Start connecting. Returns false if the exchange already finished.
+    */
+    bool Start(IoJob & job, size_t index, int64_t deadline);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Take the outcome of the last operation of an exchange and queue the next one.
+    */
+    void Complete(IoJob & job, size_t index, int result);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Queue an operation on the socket of an exchange, linked to the timeout of the exchange.
+    */
+    void Queue(IoJob & job, size_t index, uint8_t opcode, const void * addr, size_t len, uint64_t off, uint32_t flags);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Submit the queued operations and wait for the specified number of completions.
+    */
+    int Enter(unsigned wait);
+
+    // ---------------------------------------------------------------------------------------------
+    int                                 m_Ring; // The ring descriptor.
+    void *                              m_SqMap; // Mapped submission queue.
+    size_t                              m_SqSize; // Size of the mapped submission queue.
+    void *                              m_CqMap; // Mapped completion queue.
+    size_t                              m_CqSize; // Size of the mapped completion queue.
+    struct io_uring_sqe *               m_Sqes; // Mapped submission entries.
+    size_t                              m_SqesSize; // Size of the mapped submission entries.
+    unsigned *                          m_SqHead; // Submissions consumed by the kernel.
+    unsigned *                          m_SqTail; // Submissions queued by us.
+    unsigned *                          m_SqArray; // Indexes of the queued submission entries.
+    unsigned                            m_SqMask; // Turns a position into a submission entry.
+    unsigned                            m_SqEntries; // Number of submission entries.
+    unsigned *                          m_CqHead; // Completions consumed by us.
+    unsigned *                          m_CqTail; // Completions posted by the kernel.
+    struct io_uring_cqe *               m_Cqes; // Mapped completion entries.
+    unsigned                            m_CqMask; // Turns a position into a completion entry.
+    unsigned                            m_Prepared; // Operations queued but not submitted.
+    size_t                              m_Inflight; // Operations and timeouts without a completion.
+    size_t                              m_Active; // Exchanges started and not finished.
+    uint32_t                            m_Generation; // Tells the completions of each run apart.
+    std::vector< struct __kernel_timespec > m_Times; // Deadlines of the exchanges, read on submission.
+};
+
+// ------------------------------------------------------------------------------------------------
+UringEngine::~UringEngine()
+{
+    if (m_Sqes)
+    {
+        munmap(m_Sqes, m_SqesSize);
+    }
+    if (m_CqMap && m_CqMap != m_SqMap)
+    {
+        munmap(m_CqMap, m_CqSize);
+    }
+    if (m_SqMap)
+    {
+        munmap(m_SqMap, m_SqSize);
+    }
+    if (m_Ring >= 0)
+    {
+        close(m_Ring);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+bool UringEngine::Init()
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    // Every active exchange has at most an operation and two timeouts waiting to be reaped
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = static_cast< unsigned >(MAX_ACTIVE * 4);
+    m_Ring = static_cast< int >(syscall(__NR_io_uring_setup, ENTRIES, &p));
+    // Is io_uring available at all? (old kernel, seccomp or kernel.io_uring_disabled)
+    if (m_Ring < 0)
+    {
+        return false;
+    }
+    // Sockets must be polled by the kernel (5.7), which also brings connect, send, recv and linked timeouts
+    else if (!(p.features & IORING_FEAT_FAST_POLL))
+    {
+        return false;
+    }
+    m_SqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    m_CqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    // Can both queues be mapped at once?
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        m_SqSize = m_CqSize = m_SqSize > m_CqSize ? m_SqSize : m_CqSize;
+    }
+    m_SqMap = mmap(nullptr, m_SqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_SQ_RING);
+    // Could we map the submission queue?
+    if (m_SqMap == MAP_FAILED)
+    {
+        m_SqMap = nullptr;
+        return false;
+    }
+    m_CqMap = (p.features & IORING_FEAT_SINGLE_MMAP) ? m_SqMap :
+                mmap(nullptr, m_CqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_CQ_RING);
+    // Could we map the completion queue?
+    if (m_CqMap == MAP_FAILED)
+    {
+        m_CqMap = nullptr;
+        return false;
+    }
+    m_SqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    void * sqes = mmap(nullptr, m_SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_SQES);
+    // Could we map the submission entries?
+    if (sqes == MAP_FAILED)
+    {
+        return false;
+    }
+    m_Sqes = static_cast< struct io_uring_sqe * >(sqes);
+    char * const sq = static_cast< char * >(m_SqMap);
+    char * const cq = static_cast< char * >(m_CqMap);
+    m_SqHead = reinterpret_cast< unsigned * >(sq + p.sq_off.head);
+    m_SqTail = reinterpret_cast< unsigned * >(sq + p.sq_off.tail);
+    m_SqArray = reinterpret_cast< unsigned * >(sq + p.sq_off.array);
+    m_SqMask = *reinterpret_cast< unsigned * >(sq + p.sq_off.ring_mask);
+    m_SqEntries = p.sq_entries;
+    m_CqHead = reinterpret_cast< unsigned * >(cq + p.cq_off.head);
+    m_CqTail = reinterpret_cast< unsigned * >(cq + p.cq_off.tail);
+    m_Cqes = reinterpret_cast< struct io_uring_cqe * >(cq + p.cq_off.cqes);
+    m_CqMask = *reinterpret_cast< unsigned * >(cq + p.cq_off.ring_mask);
+    // The ring is ready
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void UringEngine::Reset()
+{
+    // Completions left over from an earlier run are told apart by this
+    ++m_Generation;
+    m_Inflight = 0;
+    m_Active = 0;
+    // Make room for the deadlines
+    if (m_Times.size() < m_Count)
+    {
+        m_Times.resize(m_Count);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+bool UringEngine::Poll(int64_t until, bool wait)
+{
+    // Start more exchanges while there's room and time, resolving a host may take a while
+    for (const size_t first = m_Next; m_Next < m_Count && m_Active < MAX_ACTIVE; ++m_Next)
+    {
+        const int64_t now = Now();
+        // Out of time? At least one is started on every call
+        if (m_Next > first && now >= until)
+        {
+            break;
+        }
+        m_Active += Start(m_Jobs[m_Next], m_Next, now + m_Span) ? 1 : 0;
+    }
+    // Is anything left? Every timeout must be reaped too
+    if (m_Inflight == 0)
+    {
+        return m_Next >= m_Count;
+    }
+    // Submit what was queued and wait for something to complete, if asked to
+    else if ((wait || m_Prepared > 0) && Enter(wait ? 1 : 0) < 0 && errno != EAGAIN && errno != EBUSY)
+    {
+        OutputError("io_uring failed (%s), giving up on %u announces", strerror(errno),
+                    static_cast< unsigned >(m_Active + m_Count - m_Next));
+        // Make the operations in flight end without touching the buffers of the exchanges
+        for (size_t i = 0; i < m_Next; ++i)
+        {
+            if (m_Jobs[i].mStage != Finished)
+            {
+                shutdown(m_Jobs[i].mSocket, SHUT_RDWR);
+                Finish(m_Jobs[i], false);
+            }
+        }
+        // The ones that weren't started end without a response as well
+        for (; m_Next < m_Count; ++m_Next)
+        {
+            m_Jobs[m_Next].mResponse->Clear();
+            m_Jobs[m_Next].mStage = Finished;
+        }
+        m_Inflight = 0;
+        m_Active = 0;
+        return true;
+    }
+    unsigned head = *m_CqHead;
+    const unsigned tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+    // Reap the completions
+    for (const unsigned first = head; head != tail; ++head)
+    {
+        // Out of time? The rest stay in the queue for the next call
+        if (head != first && until != INT64_MAX && Now() >= until)
+        {
+            break;
+        }
+        const struct io_uring_cqe & cqe = m_Cqes[head & m_CqMask];
+        const uint64_t data = cqe.user_data;
+        // Does it belong to this run?
+        if ((data >> 32) != m_Generation)
+        {
+            continue;
+        }
+        --m_Inflight;
+        // Timeouts only tell that an operation ran out of time, which the operation tells too
+        if (data & 1)
+        {
+            continue;
+        }
+        const size_t index = static_cast< size_t >((data & 0xFFFFFFFF) >> 1);
+        Complete(m_Jobs[index], index, cqe.res);
+        // Did it finish?
+        if (m_Jobs[index].mStage == Finished)
+        {
+            --m_Active;
+        }
+    }
+    __atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+    return m_Inflight == 0 && m_Next >= m_Count;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool UringEngine::Start(IoJob & job, size_t index, int64_t deadline)
+{
+    socklen_t len = 0;
+    // The kernel polls the socket by itself so it's left blocking
+    const struct sockaddr_storage * addr = Open(job, deadline, true, len);
+    // Was the socket created?
+    if (!addr)
+    {
+        return false;
+    }
+    m_Times[index].tv_sec = deadline / 1000000000LL;
+    m_Times[index].tv_nsec = deadline % 1000000000LL;
+    Queue(job, index, IORING_OP_CONNECT, addr, 0, len, 0);
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void UringEngine::Complete(IoJob & job, size_t index, int result)
+{
+    // Did the operation fail or run out of time?
+    if (result < 0 || (result == 0 && job.mStage == Sending))
+    {
+        Finish(job, false);
+        return;
+    }
+    // Take the outcome
+    switch (job.mStage)
+    {
+        case Connecting: job.mStage = Sending; break;
+        case Sending: Sent(job, static_cast< size_t >(result)); break;
+        default: Received(job, static_cast< size_t >(result)); break;
+    }
+    // Queue whatever comes next
+    if (job.mStage == Sending)
+    {
+        Queue(job, index, IORING_OP_SEND, job.mRequest + job.mDone, job.mSize - job.mDone, 0, MSG_NOSIGNAL);
+    }
+    else if (job.mStage == Heading || job.mStage == Reading)
+    {
+        size_t size = 0;
+        char * const buffer = Buffer(job, size);
+        // Do the headers still fit?
+        if (!buffer)
+        {
+            Finish(job, false);
+            return;
+        }
+        Queue(job, index, IORING_OP_RECV, buffer, size, 0, 0);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void UringEngine::Queue(IoJob & job, size_t index, uint8_t opcode, const void * addr, size_t len, uint64_t off,
+                        uint32_t flags)
+{
+    unsigned tail = *m_SqTail;
+    // Make room for the operation and its timeout
+    if (tail + 2 - __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE) > m_SqEntries)
+    {
+        Enter(0);
+    }
+    const uint64_t data = (static_cast< uint64_t >(m_Generation) << 32) | (static_cast< uint64_t >(index) << 1);
+    struct io_uring_sqe * sqe = &m_Sqes[tail & m_SqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = job.mSocket;
+    sqe->addr = reinterpret_cast< uintptr_t >(addr);
+    sqe->len = static_cast< uint32_t >(len);
+    sqe->off = off;
+    sqe->msg_flags = flags;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = data;
+    m_SqArray[tail & m_SqMask] = tail & m_SqMask;
+    ++tail;
+    // The operation is cancelled if it's still going at the deadline of the exchange
+    sqe = &m_Sqes[tail & m_SqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast< uintptr_t >(&m_Times[index]);
+    sqe->len = 1;
+    sqe->timeout_flags = IORING_TIMEOUT_ABS;
+    sqe->user_data = data | 1;
+    m_SqArray[tail & m_SqMask] = tail & m_SqMask;
+    ++tail;
+    // Let the kernel see them on the next submission
+    __atomic_store_n(m_SqTail, tail, __ATOMIC_RELEASE);
+    m_Prepared += 2;
+    m_Inflight += 2;
+}
+
+// ------------------------------------------------------------------------------------------------
+int UringEngine::Enter(unsigned wait)
+{
+    long ret;
+    // Submit and wait, unless interrupted
+    do
+    {
+        ret = syscall(__NR_io_uring_enter, m_Ring, m_Prepared, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    } while (ret < 0 && errno == EINTR);
+    // Were the operations consumed?
+    if (ret > 0)
+    {
+        m_Prepared -= static_cast< unsigned >(ret) < m_Prepared ? static_cast< unsigned >(ret) : m_Prepared;
+    }
+    return static_cast< int >(ret);
+}
+
+#endif // SMOD_IO_URING
+
+#endif // __linux__
+
+// ------------------------------------------------------------------------------------------------
+std::unique_ptr< IoEngine > IoEngine::Create(IoBackend backend)
+{
+#if defined(__linux__)
+    // Run each exchange as a coroutine, if asked to
+    if (backend == IoCoroutine)
+    {
+    #ifdef SMOD_COROUTINES
+        std::unique_ptr< IoEngine > engine = CreateCoroEngine();
+        // Could we create the executor?
+        if (engine)
+        {
+            return engine;
+        }
+        OutputError("Unable to create an epoll instance, announcing sequentially");
+        return nullptr;
+    #else
+        OutputMessage("Built without coroutines, announcing through epoll instead");
+        backend = IoEpoll;
+    #endif // SMOD_COROUTINES
+    }
+    // Try io_uring first, if asked to
+    if (backend == IoUring)
+    {
+    #ifdef SMOD_IO_URING
+        std::unique_ptr< UringEngine > engine(new UringEngine());
+        // Does the kernel support it?
+        if (engine->Init())
+        {
+            return std::unique_ptr< IoEngine >(engine.release());
+        }
+        OutputMessage("io_uring is not available, announcing through epoll instead");
+    #else
+        OutputMessage("Built without io_uring, announcing through epoll instead");
+    #endif // SMOD_IO_URING
+        backend = IoEpoll;
+    }
+    // Use epoll then?
+    if (backend == IoEpoll)
+    {
+        std::unique_ptr< EpollEngine > engine(new EpollEngine());
+        // Could we create the epoll instance?
+        if (engine->Init())
+        {
+            return std::unique_ptr< IoEngine >(engine.release());
+        }
+        OutputError("Unable to create an epoll instance, announcing sequentially");
+    }
+#else
+    // Concurrent announces need epoll at least
+    if (backend != IoSequential)
+    {
+        OutputError("Concurrent announces are not supported on this platform, announcing sequentially");
+    }
+#endif // __linux__
+    return nullptr;
+}
+
+} // Namespace:: SMod
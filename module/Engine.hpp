@@ -0,0 +1,184 @@
+#ifndef _LIBRARY_ENGINE_HPP_
+#define _LIBRARY_ENGINE_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Transport.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <memory>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * How the announces of a cycle are carried out.
+*/
+enum IoBackend
+{
+    IoSequential = 0, // One master-server after the other, each with blocking waits.
+    IoEpoll, // All at once, waiting on every connection through epoll.
+    IoUring, // All at once, with the connects, sends, receives and timeouts batched through io_uring.
+    IoCoroutine // All at once, each one a coroutine on a single-threaded executor. (COROUTINES builds)
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * A single exchange carried out by an I/O engine. The caller fills in the first fields and the
+ * engine keeps its progress in the rest.
+*/
+struct IoJob
+{
+    Transport *         mTransport; // Where to connect and where the path quality is kept.
+    CCStr               mRequest; // The encoded request.
+    size_t              mSize; // Size of the encoded request.
+    Response *          mResponse; // Receives the response. The status remains 0 if none arrived.
+    // ---------------------------------------------------------------------------------------------
+    Transport::Socket   mSocket; // The connection.
+    uint8_t             mStage; // What the exchange is waiting for.
+    size_t              mDone; // Bytes of the request sent or of the headers received.
+    size_t              mBody; // Bytes of the body received.
+    long                mLength; // Expected size of the body or -1 if it ends with the connection.
+    bool                mChunked; // Whether the body ends with the connection because it's chunked.
+    int                 mStatus; // Status code parsed from the headers.
+    int64_t             mDeadline; // When the exchange is given up on. (monotonic nanoseconds)
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Carries out many exchanges at once instead of waiting on each master-server in turn. What an
+ * exchange goes through is the same for every backend, only how the sockets are waited on differs.
+*/
+class IoEngine
+{
+public:
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr size_t MAX_ACTIVE = 512; // Most connections open at the same time.
+    static constexpr size_t SCRATCH_SIZE = 4096; // Room for the discarded bodies of the responses.
+
+    /* ---------------------------------------------------------------------------------------------
+     * Stages of an exchange.
+    */
+    enum Stage : uint8_t
+    {
+        Connecting = 0, // Waiting for the connection to be established.
+        Sending, // Waiting to send the rest of the request.
+        Heading, // Waiting for the status line and headers.
+        Reading, // Waiting for the rest of the body.
+        Finished // Done, with or without a response.
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    IoEngine()
+        : m_Jobs(nullptr), m_Count(0), m_Next(0), m_Span(0)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    virtual ~IoEngine()
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the name of the backend.
+    */
+    virtual CCStr Name() const = 0;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Carry out the specified exchanges and return once all of them are finished. Each exchange is
+     * given up on after the specified number of seconds.
+    */
+    void Run(IoJob * jobs, size_t count, time_t timeout)
+    {
+        Begin(jobs, count, timeout);
+        // Wait on the sockets until there's nothing left
+        while (!Poll(INT64_MAX, true))
+        {
+            /* ... */
+        }
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Take the specified exchanges without starting any. Each exchange is given up on after the
+     * specified number of seconds from when Poll() starts it.
+    */
+    void Begin(IoJob * jobs, size_t count, time_t timeout)
+    {
+        m_Jobs = jobs;
+        m_Count = count;
+        m_Next = 0;
+        m_Span = static_cast< int64_t >(timeout) * 1000000000LL;
+        Reset();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Start exchanges while there's room, give up on those out of time and drive the sockets that
+     * are ready. Only waits for a socket or a deadline if asked to, otherwise just looks. Sockets
+     * still ready once the specified time-point passes are left for the next call, where the backend
+     * allows it. (monotonic nanoseconds) Returns true once every exchange finished.
+    */
+    virtual bool Poll(int64_t until, bool wait) = 0;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Create an engine for the specified backend. io_uring falls back to epoll where the kernel
+     * doesn't support it and coroutines fall back to epoll where they weren't built. Returns null
+     * for the sequential backend or where neither is available.
+    */
+    static std::unique_ptr< IoEngine > Create(IoBackend backend);
+
+protected:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Forget the exchanges of the previous Begin().
+    */
+    virtual void Reset() = 0;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Prepare the specified exchange, create its socket and retrieve the address to connect to.
+     * Returns null if the exchange already finished because the host could not be resolved or the
+     * socket could not be created.
+    */
+    static const struct sockaddr_storage * Open(IoJob & job, int64_t deadline, bool blocking, socklen_t & len);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Account for the specified number of bytes of the request that were sent.
+    */
+    static void Sent(IoJob & job, size_t size);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve where the next bytes of the response are received and how many fit. Returns null if
+     * the headers grew too large.
+    */
+    char * Buffer(IoJob & job, size_t & size);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Account for the specified number of bytes of the response that were received, where 0 means
+     * the connection was closed. Finishes the exchange once the response is complete.
+    */
+    static void Received(IoJob & job, size_t size);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Finish the specified exchange, with a response or without, and close its socket.
+    */
+    static void Finish(IoJob & job, bool received);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the current monotonic time in nanoseconds.
+    */
+    static int64_t Now();
+
+    // ---------------------------------------------------------------------------------------------
+    IoJob *     m_Jobs; // The exchanges being carried out.
+    size_t      m_Count; // Number of exchanges.
+    size_t      m_Next; // The first exchange that wasn't started yet.
+    int64_t     m_Span; // How long each exchange may take. (nanoseconds)
+    char        m_Scratch[SCRATCH_SIZE]; // Where the bodies of the responses are received and discarded.
+};
+
+} // Namespace:: SMod
+
+#endif // _LIBRARY_ENGINE_HPP_
@@ -0,0 +1,141 @@
+// ------------------------------------------------------------------------------------------------
+#include "Flight.hpp"
+#include "Announce.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/file.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+FlightRecorder              g_Flight; // Always-on record of what the announcer did.
+
+// ------------------------------------------------------------------------------------------------
+bool FlightRecorder::Open(CCStr path, uint32_t capacity)
+{
+#ifdef SMOD_OS_WINDOWS
+    OutputError("Announce flight recorder is not supported on this platform");
+    SMOD_UNUSED_VAR(path);
+    SMOD_UNUSED_VAR(capacity);
+    return false;
+#else
+    // Round the capacity up to a power of two so that slots are found with a mask
+    uint32_t slots = 1024;
+    while (slots < capacity && slots < (1u << 24))
+    {
+        slots <<= 1;
+    }
+    // Open the file left by the previous run
+    m_File = open(path, O_RDWR | O_CREAT, 0644);
+    // Could we open it?
+    if (m_File < 0)
+    {
+        OutputError("Unable to open announce flight recorder: %s", path);
+        return false;
+    }
+    // The ring is only shared between the threads of one process
+    if (flock(m_File, LOCK_EX | LOCK_NB) != 0)
+    {
+        OutputError("Announce flight recorder is used by another process: %s", path);
+        Close();
+        return false;
+    }
+    m_Size = FlightHeader::EVENTS_OFFSET + slots * sizeof(FlightEvent);
+    // Make sure the file has exactly the size we need
+    struct stat st;
+    if (fstat(m_File, &st) != 0 || (static_cast< size_t >(st.st_size) != m_Size && ftruncate(m_File, m_Size) != 0))
+    {
+        OutputError("Unable to size announce flight recorder: %s", path);
+        Close();
+        return false;
+    }
+    // Map the file into our memory
+    void * data = mmap(nullptr, m_Size, PROT_READ | PROT_WRITE, MAP_SHARED, m_File, 0);
+    // Could we map it?
+    if (data == MAP_FAILED)
+    {
+        OutputError("Unable to map announce flight recorder: %s", path);
+        m_Size = 0;
+        Close();
+        return false;
+    }
+    m_Header = static_cast< FlightHeader * >(data);
+    // Is this a new file or one with a different layout?
+    if (m_Header->mMagic != FlightHeader::MAGIC || m_Header->mVersion != FlightHeader::VERSION ||
+        m_Header->mCapacity != slots || m_Header->mEventSize != sizeof(FlightEvent))
+    {
+        memset(data, 0, m_Size);
+        m_Header->mMagic = FlightHeader::MAGIC;
+        m_Header->mVersion = FlightHeader::VERSION;
+        m_Header->mCapacity = slots;
+        m_Header->mEventSize = sizeof(FlightEvent);
+    }
+    m_Events = reinterpret_cast< FlightEvent * >(static_cast< char * >(data) + FlightHeader::EVENTS_OFFSET);
+    m_Mask = slots - 1;
+    // File is ready to be used
+    return true;
+#endif // SMOD_OS_WINDOWS
+}
+
+// ------------------------------------------------------------------------------------------------
+void FlightRecorder::Close()
+{
+#ifndef SMOD_OS_WINDOWS
+    if (m_Header)
+    {
+        munmap(m_Header, m_Size);
+    }
+    if (m_File >= 0)
+    {
+        close(m_File);
+    }
+#endif // SMOD_OS_WINDOWS
+    m_File = -1;
+    m_Size = 0;
+    m_Header = nullptr;
+    m_Events = nullptr;
+    m_Mask = 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+uint16_t FlightRecorder::Master(CCStr address)
+{
+    // Is anything being recorded?
+    if (!m_Header)
+    {
+        return NO_MASTER;
+    }
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    char name[FlightHeader::NAME_SIZE];
+    snprintf(name, sizeof(name), "%s", address);
+    const uint32_t count = m_Header->mMasterCount < FlightHeader::MASTERS ? m_Header->mMasterCount : FlightHeader::MASTERS;
+    // Reuse the index this address had before, even in a previous run
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (strncmp(m_Header->mMasters[i], name, sizeof(name)) == 0)
+        {
+            return static_cast< uint16_t >(i);
+        }
+    }
+    // Is there room for another one?
+    if (count >= FlightHeader::MASTERS)
+    {
+        return NO_MASTER;
+    }
+    memcpy(m_Header->mMasters[count], name, sizeof(name));
+    m_Header->mMasterCount = count + 1;
+    return static_cast< uint16_t >(count);
+}
+
+} // Namespace:: SMod
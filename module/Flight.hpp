@@ -0,0 +1,173 @@
+#ifndef _LIBRARY_FLIGHT_HPP_
+#define _LIBRARY_FLIGHT_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * What an announce was doing when a flight event was recorded.
+*/
+enum FlightPhase : uint8_t
+{
+    FlightSkip = 1, // The master-server was skipped.
+    FlightRedirect, // The master-server answered with a redirect. (status)
+    FlightResponse, // The announce ended. (status or 0 if unreachable, latency)
+    FlightHedge, // A second mirror was raced against a slow one.
+    FlightMoved, // Announces go straight to where the master-server moved.
+    FlightRevalidate // The master-server failed where it moved so the configured address is used.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * A single compact event. The sequence number is written last so that a reader can tell whether the
+ * slot holds a complete event of the expected lap around the ring.
+*/
+struct FlightEvent
+{
+    uint64_t        mTime; // When it happened. (microseconds since epoch)
+    uint32_t        mLatency; // Time spent waiting for the master-server. (microseconds)
+    uint16_t        mMaster; // Index of the master-server in the file header.
+    uint16_t        mStatus; // Status code received from the master-server or 0.
+    uint8_t         mPhase; // What the announce was doing. (FlightPhase)
+    uint8_t         mReserved[3]; // Padding.
+    uint32_t        mSeq; // Position in the ring plus one, truncated.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Layout of the start of the flight recorder file. The events follow right after it.
+*/
+struct FlightHeader
+{
+    // ---------------------------------------------------------------------------------------------
+    static constexpr uint32_t MAGIC = 0x4C464156; // "VAFL"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t MASTERS = 256; // Most master-servers that can be told apart.
+    static constexpr uint32_t NAME_SIZE = 120; // Room for the address of a master-server.
+    static constexpr size_t EVENTS_OFFSET = 32768; // Where the events start in the file.
+    // ---------------------------------------------------------------------------------------------
+    uint32_t                mMagic; // Identifies the file as ours.
+    uint32_t                mVersion; // Layout version.
+    uint32_t                mCapacity; // Number of event slots. (power of two)
+    uint32_t                mEventSize; // Size of an event.
+    std::atomic< uint64_t > mHead; // Events written so far.
+    uint32_t                mMasterCount; // Master-server addresses below that are in use.
+    uint32_t                mReserved; // Padding.
+    char                    mMasters[MASTERS][NAME_SIZE]; // Addresses of the master-servers.
+};
+
+// ------------------------------------------------------------------------------------------------
+static_assert(sizeof(FlightHeader) <= FlightHeader::EVENTS_OFFSET, "Flight header overlaps the events");
+
+/* ------------------------------------------------------------------------------------------------
+ * Always-on record of what the announcer did, kept as fixed-size binary events in a ring inside a
+ * memory mapped file. Recording an event is a handful of stores and never formats text, so it can
+ * be left on where verbose messages can't. The file outlives the process, including a crash, and
+ * flight-dump decodes it.
+*/
+class FlightRecorder
+{
+public:
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr uint16_t NO_MASTER = 0xFFFF; // The master-server could not be registered.
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    FlightRecorder()
+        : m_File(-1), m_Size(0), m_Header(nullptr), m_Events(nullptr), m_Mask(0), m_Mutex()
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    FlightRecorder(const FlightRecorder &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~FlightRecorder()
+    {
+        Close();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    FlightRecorder & operator = (const FlightRecorder &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether events are being recorded.
+    */
+    bool IsOpen() const
+    {
+        return m_Events != nullptr;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Open (or create) the file at the specified path with room for at least the specified number
+     * of events. Events left by a previous run are kept if the layout matches.
+    */
+    bool Open(CCStr path, uint32_t capacity);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Release the file.
+    */
+    void Close();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the index under which events about the specified master-server are recorded.
+    */
+    uint16_t Master(CCStr address);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Record an event. Safe to call from several threads at once.
+    */
+    void Record(uint16_t master, FlightPhase phase, int status = 0, uint32_t latency = 0)
+    {
+        // Is there anywhere to record it?
+        if (!m_Events)
+        {
+            return;
+        }
+        const uint64_t seq = m_Header->mHead.fetch_add(1, std::memory_order_relaxed);
+        FlightEvent & ev = m_Events[seq & m_Mask];
+        // Mark the slot as being written in case we crash half way through
+        reinterpret_cast< std::atomic< uint32_t > & >(ev.mSeq).store(0, std::memory_order_relaxed);
+        ev.mTime = static_cast< uint64_t >(std::chrono::duration_cast< std::chrono::microseconds >(
+                    std::chrono::system_clock::now().time_since_epoch()).count());
+        ev.mLatency = latency;
+        ev.mMaster = master;
+        ev.mStatus = static_cast< uint16_t >(status);
+        ev.mPhase = phase;
+        // Publish the event
+        reinterpret_cast< std::atomic< uint32_t > & >(ev.mSeq).store(static_cast< uint32_t >(seq + 1),
+                                                                    std::memory_order_release);
+    }
+
+private:
+
+    // ---------------------------------------------------------------------------------------------
+    int             m_File; // Descriptor of the file.
+    size_t          m_Size; // Size of the mapping.
+    FlightHeader *  m_Header; // The mapped header.
+    FlightEvent *   m_Events; // The mapped events.
+    uint64_t        m_Mask; // Turns a sequence number into a slot.
+    std::mutex      m_Mutex; // Serializes the registration of master-servers.
+};
+
+// ------------------------------------------------------------------------------------------------
+extern FlightRecorder       g_Flight; // Always-on record of what the announcer did.
+
+} // Namespace:: SMod
+
+#endif // _LIBRARY_FLIGHT_HPP_
@@ -0,0 +1,438 @@
+// ------------------------------------------------------------------------------------------------
+#include "Log.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <map>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * What a thread is doing when it produces messages.
+*/
+struct LogContext
+{
+    CCStr       mMaster; // Master-server being announced on or null.
+    CCStr       mPhase; // What the announce is doing or null.
+    uint32_t    mLatency; // Time spent waiting for the master-server. (microseconds)
+    int         mStatus; // Status code received from the master-server or 0.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Identifies the messages that count as repeats of each other.
+*/
+struct RepeatKey
+{
+    CCStr       mSite; // Format string of the call site.
+    CCStr       mMaster; // Master-server the message is about or null.
+    int         mStatus; // Status code the message is about or 0.
+
+    /* ---------------------------------------------------------------------------------------------
+     * Ordering required by the map.
+    */
+    bool operator < (const RepeatKey & o) const
+    {
+        return mSite != o.mSite ? mSite < o.mSite : (mMaster != o.mMaster ? mMaster < o.mMaster : mStatus < o.mStatus);
+    }
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * What is known about the repeats of a message.
+*/
+struct RepeatEntry
+{
+    std::chrono::steady_clock::time_point   mSince; // When the current window started.
+    uint64_t                                mRepeats; // Repeats suppressed in the current window.
+    bool                                    mError; // Whether the message is an error.
+    bool                                    mVerbose; // Whether the message is a verbose message.
+    CCStr                                   mPhase; // Phase of the message.
+    String                                  mMaster; // Master-server the message is about.
+    String                                  mText; // Text of the last message that was let through.
+};
+
+// ------------------------------------------------------------------------------------------------
+typedef std::map< RepeatKey, RepeatEntry > Repeats;
+
+// ------------------------------------------------------------------------------------------------
+bool                                            g_LogVerbose = false;
+unsigned                                        g_LogRepeatWindow = 0;
+
+// ------------------------------------------------------------------------------------------------
+static std::vector< std::unique_ptr< LogSink > > g_Sinks; // Registered sinks.
+static thread_local LogContext                  t_Context = {nullptr, nullptr, 0, 0}; // Context of this thread.
+static thread_local String                      t_Line; // Reused storage of formatted events.
+static thread_local Repeats                     t_Repeats; // Messages produced by this thread.
+static thread_local RepeatEntry *               t_Repeat = nullptr; // Message that was let through last.
+
+/* ------------------------------------------------------------------------------------------------
+ * Hand the summary of the suppressed repeats of a message to the specified handler.
+*/
+static void SummarizeRepeat(const RepeatKey & key, RepeatEntry & entry, RepeatHandler handler)
+{
+    const LogContext context = t_Context;
+    // The summary is about the same master-server as the message
+    t_Context.mMaster = key.mMaster ? entry.mMaster.c_str() : nullptr;
+    t_Context.mPhase = entry.mPhase;
+    t_Context.mLatency = 0;
+    t_Context.mStatus = key.mStatus;
+    char buffer[1024];
+    // Quote the last message that was let through
+    const int size = snprintf(buffer, sizeof(buffer), "Repeated %llu times in the last %u seconds: %s",
+                                static_cast< unsigned long long >(entry.mRepeats), g_LogRepeatWindow,
+                                entry.mText.c_str());
+    // Did the format succeed?
+    if (size >= 0)
+    {
+        handler(entry.mError, entry.mVerbose, buffer, std::min(static_cast< size_t >(size), sizeof(buffer) - 1));
+    }
+    entry.mRepeats = 0;
+    // Restore the context of the caller
+    t_Context = context;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Append the specified text as a quoted JSON string.
+*/
+static void AppendQuoted(String & out, CCStr text, size_t length)
+{
+    static CCStr hex = "0123456789abcdef";
+    out.push_back('"');
+    // Escape whatever JSON doesn't allow as is
+    for (size_t i = 0; i < length; ++i)
+    {
+        const unsigned char c = static_cast< unsigned char >(text[i]);
+        // Does this character need to be escaped?
+        if (c == '"' || c == '\\')
+        {
+            out.push_back('\\');
+            out.push_back(static_cast< char >(c));
+        }
+        else if (c < 0x20)
+        {
+            out.append("\\u00");
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 0xF]);
+        }
+        else
+        {
+            out.push_back(static_cast< char >(c));
+        }
+    }
+    out.push_back('"');
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Append the current time as an ISO 8601 UTC timestamp with microseconds.
+*/
+static void AppendTimestamp(String & out)
+{
+    const auto now = std::chrono::duration_cast< std::chrono::microseconds >(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::time_t sec = static_cast< std::time_t >(now / 1000000);
+    std::tm tm;
+#ifdef SMOD_OS_WINDOWS
+    gmtime_s(&tm, &sec);
+#else
+    gmtime_r(&sec, &tm);
+#endif // SMOD_OS_WINDOWS
+    char buffer[40];
+    // Format the date and time followed by the fraction
+    const size_t len = strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(buffer + len, sizeof(buffer) - len, ".%06uZ", static_cast< unsigned >(now % 1000000));
+    out.append(buffer);
+}
+
+// ------------------------------------------------------------------------------------------------
+FileSink::FileSink()
+    : m_Path(), m_MaxSize(0), m_Keep(0), m_File(nullptr), m_Size(0), m_Pending(), m_Writing()
+    , m_Dropped(0), m_Stop(false), m_Mutex(), m_Wake(), m_Thread()
+{
+    /* ... */
+}
+
+// ------------------------------------------------------------------------------------------------
+FileSink::~FileSink()
+{
+    // Tell the writer to finish up
+    {
+        std::lock_guard< std::mutex > lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Wake.notify_one();
+    // Wait for whatever is left to be written
+    m_Thread.Join();
+    // Close the file
+    if (m_File)
+    {
+        fclose(m_File);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+bool FileSink::Open(CCStr path, size_t max_size, unsigned keep)
+{
+    m_File = fopen(path, "ab");
+    // Could we open the file?
+    if (!m_File)
+    {
+        return false;
+    }
+    m_Path.assign(path);
+    m_MaxSize = max_size;
+    m_Keep = keep;
+    // Continue where the file left off
+    fseek(m_File, 0, SEEK_END);
+    m_Size = static_cast< size_t >(std::max(0L, ftell(m_File)));
+    // Reserve the buffers up front
+    m_Pending.reserve(BATCH_SIZE * 2);
+    m_Writing.reserve(BATCH_SIZE * 2);
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool FileSink::Start()
+{
+    return m_Thread.Start(&FileSink::Writer, this, "log writer");
+}
+
+// ------------------------------------------------------------------------------------------------
+void FileSink::Write(const LogEvent & ev)
+{
+    String & line = t_Line;
+    // Format the event outside the lock
+    line.assign("{\"ts\":\"");
+    AppendTimestamp(line);
+    line.append(ev.mError ? "\",\"level\":\"error\"" : "\",\"level\":\"info\"");
+    // Verbose messages are marked so they can be told apart from regular ones
+    if (ev.mVerbose)
+    {
+        line.append(",\"verbose\":true");
+    }
+    // Add the announce context, if any
+    if (ev.mMaster)
+    {
+        line.append(",\"master\":");
+        AppendQuoted(line, ev.mMaster, strlen(ev.mMaster));
+    }
+    if (ev.mPhase)
+    {
+        line.append(",\"phase\":");
+        AppendQuoted(line, ev.mPhase, strlen(ev.mPhase));
+    }
+    if (ev.mLatency)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), ",\"latency_us\":%u", static_cast< unsigned >(ev.mLatency));
+        line.append(buffer);
+    }
+    if (ev.mStatus)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), ",\"status\":%d", ev.mStatus);
+        line.append(buffer);
+    }
+    line.append(",\"msg\":");
+    AppendQuoted(line, ev.mText, ev.mLength);
+    line.append("}\n");
+    bool wake;
+    // Queue the event
+    {
+        std::lock_guard< std::mutex > lock(m_Mutex);
+        // Drop events rather than grow without bounds if the disk can't keep up
+        if (m_Pending.size() + line.size() > MAX_PENDING)
+        {
+            ++m_Dropped;
+            return;
+        }
+        m_Pending.append(line);
+        wake = m_Pending.size() >= BATCH_SIZE;
+    }
+    // Is there enough to be worth writing right away?
+    if (wake)
+    {
+        m_Wake.notify_one();
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void FileSink::Run()
+{
+    std::unique_lock< std::mutex > lock(m_Mutex);
+    // Keep writing until told to stop
+    for (bool stop = false; !stop;)
+    {
+        // Wait for a batch or the flush interval
+        m_Wake.wait_for(lock, std::chrono::seconds(FLUSH_INTERVAL), [this]() {
+            return m_Stop || m_Pending.size() >= BATCH_SIZE;
+        });
+        stop = m_Stop;
+        // Take the pending events and let the producers continue
+        m_Writing.swap(m_Pending);
+        const uint64_t dropped = m_Dropped;
+        m_Dropped = 0;
+        lock.unlock();
+        // Let the reader know that events were lost
+        if (dropped)
+        {
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), "%llu events dropped", static_cast< unsigned long long >(dropped));
+            String & line = t_Line;
+            line.assign("{\"ts\":\"");
+            AppendTimestamp(line);
+            line.append("\",\"level\":\"error\",\"msg\":");
+            AppendQuoted(line, buffer, strlen(buffer));
+            line.append("}\n");
+            m_Writing.append(line);
+        }
+        // Anything to write?
+        if (!m_Writing.empty())
+        {
+            // Start a new file if this one grew too large
+            if (m_MaxSize && m_Size > 0 && m_Size + m_Writing.size() > m_MaxSize)
+            {
+                Rotate();
+            }
+            // Write the batch
+            if (m_File)
+            {
+                m_Size += fwrite(m_Writing.data(), 1, m_Writing.size(), m_File);
+                fflush(m_File);
+            }
+            m_Writing.clear();
+        }
+        lock.lock();
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void FileSink::Rotate()
+{
+    fclose(m_File);
+    // Shift the older files by one, dropping the oldest
+    for (unsigned n = m_Keep; n > 0; --n)
+    {
+        const String to = m_Path + "." + std::to_string(n);
+        const String from = n > 1 ? m_Path + "." + std::to_string(n - 1) : m_Path;
+        // Some systems refuse to rename over an existing file
+        std::remove(to.c_str());
+        std::rename(from.c_str(), to.c_str());
+    }
+    // Start over
+    m_File = fopen(m_Path.c_str(), "wb");
+    m_Size = 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+void SetLogContext(CCStr master, CCStr phase, uint32_t latency, int status)
+{
+    t_Context.mMaster = master;
+    t_Context.mPhase = master ? phase : nullptr;
+    t_Context.mLatency = latency;
+    t_Context.mStatus = status;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool SuppressRepeat(CCStr site, bool error, bool verbose, RepeatHandler handler)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const RepeatKey key{site, t_Context.mMaster, t_Context.mStatus};
+    auto itr = t_Repeats.find(key);
+    // Is this the first time the message is seen?
+    if (itr == t_Repeats.end())
+    {
+        itr = t_Repeats.emplace(key, RepeatEntry{now, 0, error, verbose, t_Context.mPhase,
+                                    String(key.mMaster ? key.mMaster : ""), String()}).first;
+    }
+    // Did the master-server go away and another one take its place in memory?
+    else if (key.mMaster && itr->second.mMaster.compare(key.mMaster) != 0)
+    {
+        itr->second.mSince = now;
+        itr->second.mRepeats = 0;
+        itr->second.mMaster.assign(key.mMaster);
+    }
+    // Was it let through recently?
+    else if (now - itr->second.mSince < std::chrono::seconds(g_LogRepeatWindow))
+    {
+        ++itr->second.mRepeats;
+        return true;
+    }
+    // Tell what was suppressed before the message is let through again
+    else
+    {
+        if (itr->second.mRepeats)
+        {
+            SummarizeRepeat(itr->first, itr->second, handler);
+        }
+        itr->second.mSince = now;
+    }
+    // Remember which message the text will belong to
+    t_Repeat = &itr->second;
+    return false;
+}
+
+// ------------------------------------------------------------------------------------------------
+void RememberRepeat(CCStr text, size_t length)
+{
+    // Was the message checked first?
+    if (t_Repeat)
+    {
+        t_Repeat->mText.assign(text, length);
+        t_Repeat = nullptr;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void SweepRepeats(RepeatHandler handler)
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    // Look for windows that ran out while repeats were being suppressed
+    for (auto & repeat : t_Repeats)
+    {
+        if (repeat.second.mRepeats && now - repeat.second.mSince >= std::chrono::seconds(g_LogRepeatWindow))
+        {
+            SummarizeRepeat(repeat.first, repeat.second, handler);
+            // Keep suppressing for another window
+            repeat.second.mSince = now;
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void AddLogSink(std::unique_ptr< LogSink > && sink)
+{
+    g_Sinks.push_back(std::move(sink));
+}
+
+// ------------------------------------------------------------------------------------------------
+void ClearLogSinks()
+{
+    g_Sinks.clear();
+}
+
+// ------------------------------------------------------------------------------------------------
+bool HasLogSinks()
+{
+    return !g_Sinks.empty();
+}
+
+// ------------------------------------------------------------------------------------------------
+void DispatchLog(bool error, bool verbose, CCStr text, size_t length)
+{
+    const LogEvent ev{error, verbose, text, length, t_Context.mMaster, t_Context.mPhase,
+                        t_Context.mLatency, t_Context.mStatus};
+    // Give every sink a copy
+    for (auto & sink : g_Sinks)
+    {
+        sink->Write(ev);
+    }
+}
+
+} // Namespace:: SMod
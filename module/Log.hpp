@@ -0,0 +1,200 @@
+#ifndef _LIBRARY_LOG_HPP_
+#define _LIBRARY_LOG_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+#include "Thread.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+
+// ------------------------------------------------------------------------------------------------
+#include <mutex>
+#include <string>
+#include <memory>
+#include <condition_variable>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+typedef ::std::string String;
+
+// ------------------------------------------------------------------------------------------------
+extern bool                 g_LogVerbose; // Send verbose events to the sinks even if the console hides them.
+extern unsigned             g_LogRepeatWindow; // Seconds during which repeated messages are suppressed. (0 disables)
+
+// ------------------------------------------------------------------------------------------------
+typedef void (*RepeatHandler)(bool error, bool verbose, CCStr text, size_t length); // Receives repeat summaries.
+
+/* ------------------------------------------------------------------------------------------------
+ * A message produced by the plug-in along with what was being done when it was produced.
+*/
+struct LogEvent
+{
+    bool        mError; // Whether this is an error.
+    bool        mVerbose; // Whether this is a verbose message.
+    CCStr       mText; // The formatted message. (not null terminated)
+    size_t      mLength; // Length of the formatted message.
+    CCStr       mMaster; // Master-server being announced on or null.
+    CCStr       mPhase; // What the announce was doing or null.
+    uint32_t    mLatency; // Time spent waiting for the master-server. (microseconds)
+    int         mStatus; // Status code received from the master-server or 0.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Receives a copy of every message. Sinks are called from whichever thread produced the message
+ * and must never block that thread for long.
+*/
+class LogSink
+{
+public:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    virtual ~LogSink()
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Receive an event.
+    */
+    virtual void Write(const LogEvent & ev) = 0;
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Writes events to a file as one JSON object per line. Events are only appended to a memory buffer
+ * by the threads that produce them. A background thread writes the buffer in batches and rotates
+ * the file once it grows past the configured size.
+*/
+class FileSink : public LogSink
+{
+public:
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr size_t MAX_PENDING = 4 * 1024 * 1024; // Most bytes waiting to be written.
+    static constexpr size_t BATCH_SIZE = 64 * 1024; // Bytes that wake up the writer early.
+    static constexpr unsigned FLUSH_INTERVAL = 1; // Seconds between writes when it's quiet.
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    FileSink();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    FileSink(const FileSink & o) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor. Writes whatever is left.
+    */
+    ~FileSink();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    FileSink & operator = (const FileSink & o) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Open the file. It's rotated once it grows past the specified size and that many older files
+     * are kept as path.1, path.2 and so on.
+    */
+    bool Open(CCStr path, size_t max_size, unsigned keep);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Start the writer. Only once the sink was added where messages are dispatched, since the new
+     * thread may output messages of its own.
+    */
+    bool Start();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Receive an event.
+    */
+    void Write(const LogEvent & ev) override;
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Body of the writer thread.
+    */
+    void Run();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Run the writer of the specified sink.
+    */
+    static void Writer(void * sink)
+    {
+        static_cast< FileSink * >(sink)->Run();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Move the current file out of the way and start a new one.
+    */
+    void Rotate();
+
+    // ---------------------------------------------------------------------------------------------
+    String                      m_Path; // Where the events are written.
+    size_t                      m_MaxSize; // Size that causes the file to be rotated.
+    unsigned                    m_Keep; // Rotated files that are kept.
+    FILE *                      m_File; // The file being written.
+    size_t                      m_Size; // Size of the file being written.
+    String                      m_Pending; // Events waiting to be written.
+    String                      m_Writing; // Events being written.
+    uint64_t                    m_Dropped; // Events dropped because the writer fell behind.
+    bool                        m_Stop; // Whether the writer should stop.
+    std::mutex                  m_Mutex; // Guards the pending events.
+    std::condition_variable     m_Wake; // Wakes up the writer.
+    Thread                      m_Thread; // The writer.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Describe what the calling thread is doing so that its messages carry it. Pass a null master to
+ * forget it once the announce is done.
+*/
+void SetLogContext(CCStr master, CCStr phase, uint32_t latency = 0, int status = 0);
+
+/* ------------------------------------------------------------------------------------------------
+ * See whether a message from the specified call site, about the master-server and status in the
+ * log context of the calling thread, repeats one that was let through less than g_LogRepeatWindow
+ * seconds ago. Such repeats are only counted and the caller should not even format them. Otherwise
+ * the summary of any repeats that were suppressed before is handed to the specified handler.
+*/
+bool SuppressRepeat(CCStr site, bool error, bool verbose, RepeatHandler handler);
+
+/* ------------------------------------------------------------------------------------------------
+ * Remember the text of the message that was just let through so that its summary can quote it.
+*/
+void RememberRepeat(CCStr text, size_t length);
+
+/* ------------------------------------------------------------------------------------------------
+ * Hand out the summaries of suppressed repeats whose window ran out. Called by the thread that
+ * produced them, at the end of each announce cycle.
+*/
+void SweepRepeats(RepeatHandler handler);
+
+/* ------------------------------------------------------------------------------------------------
+ * Register a sink. Sinks must be registered before announcing starts.
+*/
+void AddLogSink(std::unique_ptr< LogSink > && sink);
+
+/* ------------------------------------------------------------------------------------------------
+ * Release every registered sink.
+*/
+void ClearLogSinks();
+
+/* ------------------------------------------------------------------------------------------------
+ * See whether any sink was registered.
+*/
+bool HasLogSinks();
+
+/* ------------------------------------------------------------------------------------------------
+ * Hand a formatted message to every registered sink along with the context of the calling thread.
+*/
+void DispatchLog(bool error, bool verbose, CCStr text, size_t length);
+
+} // Namespace:: SMod
+
+#endif // _LIBRARY_LOG_HPP_
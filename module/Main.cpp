@@ -1,14 +1,13 @@
 // ------------------------------------------------------------------------------------------------
 #include "Base.hpp"
+#include "Announce.hpp"
 
 // ------------------------------------------------------------------------------------------------
+#include <cerrno>
 #include <cstdio>
 #include <cstdlib>
-#include <cstdarg>
 
 // ------------------------------------------------------------------------------------------------
-#include <queue>
-#include <mutex>
 #include <string>
 #include <vector>
 #include <chrono>
@@ -17,16 +16,15 @@
 
 // ------------------------------------------------------------------------------------------------
 #ifndef _WIN32
+    #include <fcntl.h>
     #include <unistd.h>
     #include <signal.h>
+    #include <sys/un.h>
+    #include <sys/socket.h>
 #endif // _WIN32
 
-// ------------------------------------------------------------------------------------------------
-#include <httplib.h>
-
 // ------------------------------------------------------------------------------------------------
 #include <vcmp.h>
-#include <SimpleIni.h>
 
 /* ------------------------------------------------------------------------------------------------
  * SOFTWARE INFORMATION
@@ -48,9 +46,6 @@
 // ------------------------------------------------------------------------------------------------
 namespace SMod {
 
-// ------------------------------------------------------------------------------------------------
-typedef ::std::string String;
-
 // ------------------------------------------------------------------------------------------------
 PluginFuncs*        _Func = nullptr;
 PluginCallbacks*    _Clbk = nullptr;
@@ -59,484 +54,279 @@ PluginInfo*         _Info = nullptr;
 // ------------------------------------------------------------------------------------------------
 static ServerSettings       g_Settings;
 static unsigned int         g_ServerVersion;
-static unsigned int         g_UpdateInterval;
-
-/* ------------------------------------------------------------------------------------------------
- * Output a message only if the _DEBUG was defined.
-*/
-void OutputDebug(CCStr msg, ...);
-
-/* ------------------------------------------------------------------------------------------------
- * Output a formatted user message to the console.
-*/
-void OutputMessage(CCStr msg, ...);
 
 /* ------------------------------------------------------------------------------------------------
- * Output a formatted error message to the console.
+ * Thin client that hands the announce work over to the announce daemon through a unix socket.
+ * Everything is non-blocking and driven from the server frame so no thread is needed.
+ *
+ * Protocol (one command per line):
+ *  ANNOUNCE <protocol>, VERSION <server version>, PORT <server port>, MASTER <address>..., COMMIT
+ * The daemon replies with "OK <master-servers>" or "ERROR <reason>" and keeps announcing until
+ * the connection is closed.
 */
-void OutputError(CCStr msg, ...);
-
-/* ------------------------------------------------------------------------------------------------
- * Output a formatted verbose user message to the console.
-*/
-void VerboseMessage(CCStr msg, ...);
-
-/* ------------------------------------------------------------------------------------------------
- * Output a formatted verbose error message to the console.
-*/
-void VerboseError(CCStr msg, ...);
-
-/* ------------------------------------------------------------------------------------------------
- * Output a formatted user message to the console in a thread safe manner.
-*/
-void MtOutputMessage(CCStr msg, ...);
-
-/* ------------------------------------------------------------------------------------------------
- * Output a formatted error message to the console in a thread safe manner.
-*/
-void MtOutputError(CCStr msg, ...);
-
-/* ------------------------------------------------------------------------------------------------
- * Output a formatted verbose user message to the console in a thread safe manner.
-*/
-void MtVerboseMessage(CCStr msg, ...);
-
-/* ------------------------------------------------------------------------------------------------
- * Output a formatted verbose error message to the console in a thread safe manner.
-*/
-void MtVerboseError(CCStr msg, ...);
-
-/* ------------------------------------------------------------------------------------------------
- * Simple parser that extracts URI information from a string.
-*/
-struct URI
+class DaemonLink
 {
-    /* ---------------------------------------------------------------------------------------------
-     * Base constructor.
-    */
-    URI(CCStr address)
-        : mHost()
-        , mPort()
-        , mPath()
-        , mFull()
-        , mAddr()
-    {
-        // Is there even an address to parse?
-        if (!address || strlen(address) <= 0)
-        {
-            return;
-        }
-        // Skip the protocol if it was specified
-        if (strncmp(address, "http://", 7) == 0)
-        {
-            address += 7; // Skip the protocol
-        }
-        else if (strncmp(address, "https://", 8) == 0)
-        {
-            address += 8; // Skip the protocol
-        }
-        // Find where the port starts
-        CCStr port = strchr(address, ':');
-        // Find where the path starts
-        CCStr path = strchr(port ? port : address, '/');
-        // Did we find the port separator?
-        if (port)
-        {
-            // Copy everything until the port separator
-            mHost.assign(address, port - address);
-        }
-        // Did we find the path separator?
-        else if(path)
-        {
-            // Copy everything until the path separator
-            mHost.assign(address, path - address);
-        }
-        // The entire address is the host
-        else
-        {
-            // Copy the entire address
-            mHost.assign(address);
-        }
-        // Should we skip the port separator?
-        if (port)
-        {
-            ++port;
-        }
-        // Did we find both a port and path?
-        if (port && path)
-        {
-            // Copy everything between the port and path separators
-            mPort.assign(port, path - port);
-        }
-        else if (port)
-        {
-            // Copy everything after the port separator
-            mPort.assign(port);
-        }
-        // Assign the default port
-        else
-        {
-            mPort.assign("80");
-        }
-        // Copy the path if necessary
-        if (path)
-        {
-            mPath.assign(path);
-        }
-        // Assign a default path just in case
-        else
-        {
-            mPath.assign("/");
-        }
-        // Generate the full URI
-        mFull.assign("http://");
-        mFull.append(mHost);
-        mFull += ':';
-        mFull.append(mPort);
-        mFull.append(mPath);
-        mAddr.append(mHost);
-        // Generate the connect address
-        mAddr += ':';
-        mAddr.append(mPort);
-    }
+public:
 
-    /* ---------------------------------------------------------------------------------------------
-     * Copy constructor.
-    */
-    URI(const URI & o)
-        : mHost(o.mHost)
-        , mPort(o.mPort)
-        , mPath(o.mPath)
-        , mFull(o.mFull)
-        , mAddr(o.mAddr)
-    {
-        /* ... */
-    }
+    // ---------------------------------------------------------------------------------------------
+    using Clock = std::chrono::steady_clock;
 
     /* ---------------------------------------------------------------------------------------------
-     * Move constructor.
+     * Default constructor.
     */
-    URI(URI && o)
-        : mHost(std::forward< std::string >(o.mHost))
-        , mPort(std::forward< std::string >(o.mPort))
-        , mPath(std::forward< std::string >(o.mPath))
-        , mFull(std::forward< std::string >(o.mFull))
-        , mAddr(std::forward< std::string >(o.mAddr))
+    DaemonLink()
+        : m_Socket(-1), m_Warned(false), m_Path(), m_Payload(), m_Input(), m_Sent(0)
+        , m_Check(), m_Retry(), m_Masters()
     {
         /* ... */
     }
 
     /* ---------------------------------------------------------------------------------------------
-     * Copy assignment operator.
+     * Copy constructor. (disabled)
     */
-    URI & operator = (const URI & o)
-    {
-        if (this != &o)
-        {
-            mHost = o.mHost;
-            mPort = o.mPort;
-            mPath = o.mPath;
-            mFull = o.mFull;
-            mAddr = o.mAddr;
-        }
-        return *this;
-    }
+    DaemonLink(const DaemonLink &) = delete;
 
     /* ---------------------------------------------------------------------------------------------
-     * Move assignment operator.
+     * Destructor.
     */
-    URI & operator = (URI && o)
+    ~DaemonLink()
     {
-        if (this != &o)
-        {
-            mHost = std::forward< std::string >(o.mHost);
-            mPort = std::forward< std::string >(o.mPort);
-            mPath = std::forward< std::string >(o.mPath);
-            mFull = std::forward< std::string >(o.mFull);
-            mAddr = std::forward< std::string >(o.mAddr);
-        }
-        return *this;
+        Disconnect();
     }
 
     /* ---------------------------------------------------------------------------------------------
-     * Retrieve the protocol as a c string.
+     * Copy assignment operator. (disabled)
     */
-    CCStr Protocol() const
-    {
-        return "http://";
-    }
+    DaemonLink & operator = (const DaemonLink &) = delete;
 
     /* ---------------------------------------------------------------------------------------------
-     * Retrieve the host address as a c string.
+     * See whether the announce work is handed over to the daemon.
     */
-    CCStr Host() const
+    bool IsEnabled() const
     {
-        return mHost.c_str();
+        return !m_Path.empty();
     }
 
     /* ---------------------------------------------------------------------------------------------
-     * Retrieve the port number as a c string.
+     * Specify the path to the unix socket of the daemon.
     */
-    CCStr Port() const
+    void SetPath(CCStr path)
     {
-        return mPort.c_str();
+        m_Path.assign(path);
     }
 
     /* ---------------------------------------------------------------------------------------------
-     * Retrieve the request path as a c string.
+     * Remember a master-server that the daemon should announce on.
     */
-    CCStr Path() const
+    void AddMaster(CCStr address)
     {
-        return mPath.c_str();
+        m_Masters.emplace_back(address);
     }
 
     /* ---------------------------------------------------------------------------------------------
-     * Retrieve the full address as a c string.
+     * Retrieve the number of master-servers handed over to the daemon.
     */
-    CCStr Full() const
+    size_t Count() const
     {
-        return mFull.c_str();
+        return m_Masters.size();
     }
 
     /* ---------------------------------------------------------------------------------------------
-     * Retrieve the connect address as a c string.
+     * Generate the registration that is sent to the daemon every time we connect.
     */
-    CCStr Addr() const
+    void SetPayload(unsigned version, unsigned port)
     {
-        return mAddr.c_str();
+        m_Payload.assign("ANNOUNCE " + std::to_string(SMOD_DAEMON_PROTOCOL) + "\n");
+        m_Payload.append("VERSION " + std::to_string(version) + "\n");
+        m_Payload.append("PORT " + std::to_string(port) + "\n");
+        // Include every master-server
+        for (const auto & master : m_Masters)
+        {
+            m_Payload.append("MASTER " + master + "\n");
+        }
+        m_Payload.append("COMMIT\n");
     }
 
-    // ---------------------------------------------------------------------------------------------
-    String          mHost; // The host name.
-    String          mPort; // The port number.
-    String          mPath; // The request path.
-    String          mFull; // The full address.
-    String          mAddr; // The address used to connect to.
-};
-
-/* ------------------------------------------------------------------------------------------------
- * Manages a connection to a master-server.
-*/
-struct Server
-{
-    using ClientPtr = std::unique_ptr< httplib::Client >;
     /* ---------------------------------------------------------------------------------------------
-     * Base constructor.
+     * Connect, push the registration and look for replies. Cheap enough to call every frame.
     */
-    Server(URI && addr)
-        : m_Client(new httplib::Client(addr.mHost, std::stoi(addr.mPort)))
-        , m_Fails(0), m_Valid(m_Client->is_valid())
-        , m_Addr(std::forward< URI >(addr)), m_Headers{{"User-Agent", "VCMP/0.4"}}, m_Params()
+    void Process()
     {
-        if (!m_Valid)
+#ifndef SMOD_OS_WINDOWS
+        const Clock::time_point now = Clock::now();
+        // Don't bother the socket more than a few times per second
+        if (now < m_Check)
         {
-            VerboseError("Master-server '%s' was marked as invalid",
-                            m_Addr.Full());
+            return;
         }
-        else
+        m_Check = now + std::chrono::milliseconds(250);
+        // Should we (re)connect?
+        if (m_Socket < 0)
         {
-            m_Client->set_follow_location(true);
-            m_Client->set_compress(false);
+            // Too soon to try again?
+            if (now < m_Retry || Connect())
+            {
+                return;
+            }
+            // Try again later
+            m_Retry = now + std::chrono::seconds(5);
+            return;
         }
-    }
-
-    /* ---------------------------------------------------------------------------------------------
-     * Copy constructor. (disabled)
-    */
-    Server(const Server &) = delete;
-
-    /* ---------------------------------------------------------------------------------------------
-     * Move constructor.
-    */
-    Server(Server && o)
-        : m_Client(std::forward< ClientPtr >(o.m_Client))
-        , m_Fails(o.m_Fails), m_Valid(o.m_Valid)
-        , m_Addr(std::forward< URI >(o.m_Addr))
-        , m_Headers(std::forward< httplib::Headers >(o.m_Headers))
-        , m_Params(std::forward< httplib::Params >(o.m_Params))
-    {
-    }
-
-    /* ---------------------------------------------------------------------------------------------
-     * Destructor.
-    */
-    ~Server()
-    {
-
-    }
-
-    /* ---------------------------------------------------------------------------------------------
-     * Copy assignment operator. (disabled)
-    */
-    Server & operator = (const Server &) = delete;
-
-    /* ---------------------------------------------------------------------------------------------
-     * Move assignment operator.
-    */
-    Server & operator = (Server && o)
-    {
-        if (this != &o)
+        // Push whatever is left of the registration
+        if (m_Sent < m_Payload.size())
         {
-            m_Client = std::forward< ClientPtr >(o.m_Client);
-            m_Fails = o.m_Fails;
-            m_Valid = o.m_Valid;
-            m_Addr = std::forward< URI >(o.m_Addr);
-            m_Headers = std::forward< httplib::Headers >(o.m_Headers);
-            m_Params = std::forward< httplib::Params >(o.m_Params);
+            const ssize_t n = send(m_Socket, m_Payload.data() + m_Sent, m_Payload.size() - m_Sent,
+                                   MSG_DONTWAIT | SMOD_MSG_NOSIGNAL);
+            // Did something go wrong?
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                Lost(now);
+                return;
+            }
+            m_Sent += n > 0 ? static_cast< size_t >(n) : 0;
         }
-        return *this;
-    }
-
-    /* ---------------------------------------------------------------------------------------------
-     * Implicit conversion to boolean.
-    */
-    operator bool () const
-    {
-        return m_Valid;
-    }
-
-    /* ---------------------------------------------------------------------------------------------
-     * Retrieve the associated master-server address.
-    */
-    const URI & GetURI() const
-    {
-        return m_Addr;
-    }
-
-    /* ---------------------------------------------------------------------------------------------
-     * Increase the failure count and see whether updates should stop being sent on this server.
-    */
-    void Failed()
-    {
-        // After one thousand failed attempts, there's no point in insisting
-        if (++m_Fails >= 1000)
+        char buffer[256];
+        // Look for replies from the daemon
+        const ssize_t n = recv(m_Socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+        // Did the daemon go away?
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+        {
+            Lost(now);
+            return;
+        }
+        else if (n > 0)
         {
-            MtVerboseError("Master-server '%s' was marked as invalid after %u failures",
-                            m_Addr.Full(), m_Fails);
-            // Block further updates
-            m_Valid = false;
+            m_Input.append(buffer, static_cast< size_t >(n));
+        }
+        // Process complete replies
+        for (String::size_type pos = m_Input.find('\n'); pos != String::npos; pos = m_Input.find('\n'))
+        {
+            const String line(m_Input, 0, pos);
+            // Remove it from the input
+            m_Input.erase(0, pos + 1);
+            // Identify the reply
+            if (line.compare(0, 3, "OK ") == 0)
+            {
+                VerboseMessage("Announce daemon accepted %s master-servers", line.c_str() + 3);
+            }
+            else
+            {
+                OutputError("Announce daemon: %s", line.c_str());
+            }
         }
+#endif // SMOD_OS_WINDOWS
     }
 
     /* ---------------------------------------------------------------------------------------------
-     * Make the server valid again and continue to send updates.
+     * Close the connection to the daemon, which stops the announces.
     */
-    void MakeValid()
+    void Disconnect()
     {
-        // Reset the counter
-        m_Fails = 0;
-        // Allow further updates
-        m_Valid = true;
+#ifndef SMOD_OS_WINDOWS
+        if (m_Socket >= 0)
+        {
+            close(m_Socket);
+        }
+#endif // SMOD_OS_WINDOWS
+        m_Socket = -1;
+        m_Input.clear();
     }
 
-    /* ---------------------------------------------------------------------------------------------
-     * Create the server version header.
-    */
-    void ConfigureServer()
-    {
-        m_Headers.emplace("VCMP-Version", std::to_string(g_ServerVersion));
-        m_Params.emplace("port", std::to_string(g_Settings.port));
-    }
+private:
 
     /* ---------------------------------------------------------------------------------------------
-     * Send the payload to the associated server to keep the server alive in the master-list.
+     * Attempt to connect to the daemon.
     */
-    void Update()
+    bool Connect()
     {
-        // This master-list working?
-        if (!m_Valid || !m_Client)
+#ifdef SMOD_OS_WINDOWS
+        return false;
+#else
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", m_Path.c_str());
+        // Create the socket
+        m_Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+        // Could we create it?
+        if (m_Socket < 0)
         {
-            MtVerboseMessage("Skipping invalid master-list: `%s`", m_Addr.Full());
-            return; // No point int trying to announce to thi server anymore
-        } else MtVerboseMessage("Announcing on master-list: `%s`", m_Addr.Full());
-        auto res = m_Client->Post(m_Addr.Path(), m_Headers, m_Params);
-        MtVerboseMessage("Master-list (%s) responded with code: %d", m_Addr.Full(), res->status);
-        // Identify response code
-        switch (res->status)
+            return false;
+        }
+        // Never block the server thread
+        fcntl(m_Socket, F_SETFL, fcntl(m_Socket, F_GETFL, 0) | O_NONBLOCK);
+#if defined(SO_NOSIGPIPE)
+        int on = 1;
+        setsockopt(m_Socket, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        // Attempt to connect
+        if (connect(m_Socket, reinterpret_cast< struct sockaddr * >(&addr), sizeof(addr)) != 0 &&
+            errno != EINPROGRESS)
         {
-            case 400:
-            {
-                MtVerboseError("Master-server '%s' denied request due to malformed data", m_Addr.Full());
-                // This operation failed
-                Failed();
-            } break;
-            case 403:
-            {
-                MtVerboseError("Master-server '%s' denied request, server version may not have been accepted", m_Addr.Full());
-                // This operation failed
-                Failed();
-            } break;
-            case 405:
-            {
-                MtVerboseError("Master-server '%s' denied request, GET is not supported", m_Addr.Full());
-                // This operation failed
-                Failed();
-            } break;
-            case 408:
-            {
-                MtVerboseError("Master-server '%s' timed out while trying to reach your server; are your ports forwarded?", m_Addr.Full());
-                // This operation failed
-                Failed();
-            } break;
-            case 500:
-            {
-                MtVerboseError("Master-server '%s' had an unexpected error while processing your request", m_Addr.Full());
-                // This operation failed
-                Failed();
-            } break;
-            case 200:
+            // Complain only once until the daemon shows up
+            if (!m_Warned)
             {
-                MtVerboseMessage("Successfully announced on master-server '%s'", m_Addr.Full());
-                // This operation succeeded. Carry on with the rest
-                MakeValid();
-            } break;
-            default: /* Unknown response */ break;
+                OutputError("Unable to reach the announce daemon at: %s", m_Path.c_str());
+                m_Warned = true;
+            }
+            Disconnect();
+            return false;
         }
+        VerboseMessage("Connected to the announce daemon at: %s", m_Path.c_str());
+        // Send the registration from the beginning
+        m_Sent = 0;
+        m_Warned = false;
+        // Connection established
+        return true;
+#endif // SMOD_OS_WINDOWS
     }
 
-private:
+    /* ---------------------------------------------------------------------------------------------
+     * The connection to the daemon was lost.
+    */
+    void Lost(Clock::time_point now)
+    {
+        OutputError("Lost the connection to the announce daemon");
+        Disconnect();
+        // Reconnect shortly after
+        m_Retry = now + std::chrono::seconds(1);
+    }
 
     // ---------------------------------------------------------------------------------------------
-    ClientPtr           m_Client; // The associated server connection.
-    unsigned            m_Fails; // How many attempts to create a connection failed.
-    bool                m_Valid; // Whether we should completely ignore this master-server.
-    URI                 m_Addr; // The master-server address information.
-    httplib::Headers    m_Headers; // Request headers.
-    httplib::Params     m_Params; // Request parameters.
+    int                     m_Socket; // Connection to the daemon.
+    bool                    m_Warned; // Whether the user was told that the daemon is unreachable.
+    String                  m_Path; // Path to the unix socket of the daemon.
+    String                  m_Payload; // Registration sent to the daemon.
+    String                  m_Input; // Partial replies from the daemon.
+    size_t                  m_Sent; // How much of the registration was sent.
+    Clock::time_point       m_Check; // When to look at the connection again.
+    Clock::time_point       m_Retry; // When to attempt to connect again.
+    std::vector< String >   m_Masters; // Master-server addresses handed over to the daemon.
 };
 
 // ------------------------------------------------------------------------------------------------
-typedef std::vector< Server >                       Servers;
-typedef std::queue< std::pair< String, bool > >     Messages;
-
-// ------------------------------------------------------------------------------------------------
-static bool                 g_Verbose = false; // Enable or disable verbose messages
 static bool                 g_Announce = false; // Allow the announce loop to continue
-static std::thread          g_Thread; // Announce thread
-static std::mutex           g_Mutex; // Global mutex
+static Thread               g_Thread; // Announce thread
 
 // ------------------------------------------------------------------------------------------------
-static Servers              g_Servers; // List of servers to be updated
-static Messages             g_Messages; // Messages queued from the announce thread
+static Announcer            g_Announcer; // Master-servers to be updated
+static DaemonLink           g_Daemon; // Connection to the announce daemon, if used
 
 /* ------------------------------------------------------------------------------------------------
  * The main thread responsible for updating the specified master-servers.
 */
-void AnnounceThread(Servers && servers)
+static void AnnounceThread(void * arg)
 {
+    // The server thread leaves the announcer alone until this thread is joined
+    Announcer & announcer = *static_cast< Announcer * >(arg);
     MtVerboseMessage("Announce thread started.");
     // Enter the announcement loop
     while (g_Announce)
     {
         // Grab the current time point
-        std::chrono::time_point< std::chrono::steady_clock > next = std::chrono::steady_clock::now();
-        // Set the time-point for next update
-        next += std::chrono::seconds(g_UpdateInterval);
-        // Tell the master-list we're alive
-        for (auto & server : servers)
-        {
-            server.Update();
-        }
+        const Server::TimePoint now = Server::Clock::now();
+        // Announce on whatever is due, but never wait longer than the configured interval
+        const Server::TimePoint next = announcer.Process(now, now + std::chrono::seconds(g_UpdateInterval));
         // Grab the current time point
         std::chrono::time_point<std::chrono::steady_clock> curr;
         // Sleep until the next appointed update time point
@@ -549,30 +339,6 @@ void AnnounceThread(Servers && servers)
     }
 }
 
-/* ------------------------------------------------------------------------------------------------
- * Flush queued messages to the console output.
-*/
-void FlushMessages()
-{
-    // Acquire a global lock
-    std::lock_guard< std::mutex > lock(g_Mutex);
-    // Output any queued messages
-    while (!g_Messages.empty())
-    {
-        // Identify the message type and send it
-        if (g_Messages.front().second)
-        {
-            OutputMessage("%s", g_Messages.front().first.c_str());
-        }
-        else
-        {
-            OutputError("%s", g_Messages.front().first.c_str());
-        }
-        // Pop the message from the queue
-        g_Messages.pop();
-    }
-}
-
 /* ------------------------------------------------------------------------------------------------
  * The server was initialized and this plug-in must initialize as well.
 */
@@ -582,26 +348,41 @@ static uint8_t OnServerInitialise(void)
     _Func->GetServerSettings(&g_Settings);
     // Obtain the server version. This doesn't change much
     g_ServerVersion = _Func->GetServerVersion();
-    // Attempt to generate the update payload
-    for (auto & server : g_Servers)
+    // Is the announce work handed over to the daemon?
+    if (g_Daemon.IsEnabled())
     {
-        // Attempt to generate the payload
-        server.ConfigureServer();
+        // Generate the registration payload
+        g_Daemon.SetPayload(g_ServerVersion, g_Settings.port);
+        // Attempt to connect right away
+        g_Daemon.Process();
+        // Notify that the plug-in was successfully initialized
+        VerboseMessage("Announce plug-in was successfully initialized");
+        // Allow the server to continue
+        return 1;
     }
+    // Attempt to generate the update payload
+    g_Announcer.SetPayload(g_ServerVersion, g_Settings.port);
     // See if any servers are left
-    if (g_Servers.empty())
+    if (g_Announcer.Count() <= 0)
     {
         // We don't want to receive events anymore
         _Clbk->OnServerInitialise       = nullptr;
         _Clbk->OnServerShutdown         = nullptr;
         _Clbk->OnServerFrame            = nullptr;
     }
+    // Announce between server frames instead?
+    else if (g_FrameBudget != 0)
+    {
+        VerboseMessage("Announcing for up to %u us on each server frame", g_FrameBudget);
+        // Notify that the plug-in was successfully initialized
+        VerboseMessage("Announce plug-in was successfully initialized");
+    }
     else
     {
         // Enable the announce thread to run if there are servers
         g_Announce = true;
-        // Create the announce thread
-        g_Thread = std::thread(AnnounceThread, std::move(g_Servers));
+        // Create the announce thread, scheduled by the configured policy
+        g_Thread.Start(AnnounceThread, &g_Announcer, "announce");
         // Notify that the plug-in was successfully initialized
         VerboseMessage("Announce plug-in was successfully initialized");
     }
@@ -618,232 +399,42 @@ static void OnServerShutdown(void)
     _Clbk->OnServerInitialise       = nullptr;
     _Clbk->OnServerShutdown         = nullptr;
     _Clbk->OnServerFrame            = nullptr;
+    // Tell the daemon to stop announcing this server
+    g_Daemon.Disconnect();
     // Tell the announce thread to stop
     g_Announce = false;
     // Wait for the announce thread to finish
-    if (g_Thread.joinable())
+    g_Thread.Join();
+    // Let the user know what announcing between frames cost them
+    if (g_FrameBudget != 0 && g_Announcer.GetStats().mSteps)
     {
-        g_Thread.join();
+        const AnnounceStats & stats = g_Announcer.GetStats();
+        VerboseMessage("Announced during %llu server frames, %llu us on average, %llu us at most",
+                        static_cast< unsigned long long >(stats.mSteps),
+                        static_cast< unsigned long long >(stats.mStepTime / stats.mSteps),
+                        static_cast< unsigned long long >(stats.mMaxStep));
     }
     // Flush any remaining messages
     FlushMessages();
+    // Write whatever the log sinks still hold
+    ClearLogSinks();
 }
 
 static void OnServerFrame(float /*delta*/)
 {
-    // Flush any queued messages
-    FlushMessages();
-}
-
-// ------------------------------------------------------------------------------------------------
-void OutputMessageImpl(CCStr msg, va_list args)
-{
-#if defined(WIN32) || defined(_WIN32)
-    HANDLE hstdout = GetStdHandle(STD_OUTPUT_HANDLE);
-
-    CONSOLE_SCREEN_BUFFER_INFO csb_before;
-    GetConsoleScreenBufferInfo( hstdout, &csb_before);
-    SetConsoleTextAttribute(hstdout, FOREGROUND_GREEN);
-    printf("[ANNOUNCE] ");
-
-    SetConsoleTextAttribute(hstdout, FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_RED | FOREGROUND_INTENSITY);
-    vprintf(msg, args);
-    puts("");
-
-    SetConsoleTextAttribute(hstdout, csb_before.wAttributes);
-#else
-    printf("%c[0;32m[ANNOUNCE]%c[0;37m", 27, 27);
-    vprintf(msg, args);
-    puts("");
-#endif
-}
-
-// ------------------------------------------------------------------------------------------------
-void OutputErrorImpl(CCStr msg, va_list args)
-{
-#if defined(WIN32) || defined(_WIN32)
-    HANDLE hstdout = GetStdHandle(STD_OUTPUT_HANDLE);
-
-    CONSOLE_SCREEN_BUFFER_INFO csb_before;
-    GetConsoleScreenBufferInfo( hstdout, &csb_before);
-    SetConsoleTextAttribute(hstdout, FOREGROUND_RED | FOREGROUND_INTENSITY);
-    printf("[ANNOUNCE] ");
-
-    SetConsoleTextAttribute(hstdout, FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_RED | FOREGROUND_INTENSITY);
-    vprintf(msg, args);
-    puts("");
-
-    SetConsoleTextAttribute(hstdout, csb_before.wAttributes);
-#else
-    printf("%c[0;32m[ANNOUNCE]%c[0;37m", 27, 27);
-    vprintf(msg, args);
-    puts("");
-#endif
-}
-
-// ------------------------------------------------------------------------------------------------
-void OutputDebug(CCStr msg, ...)
-{
-#ifdef _DEBUG
-    // Initialize the arguments list
-    va_list args;
-    va_start(args, msg);
-    // Call the output function
-    OutputMessageImpl(msg, args);
-    // Finalize the arguments list
-    va_end(args);
-#else
-    SMOD_UNUSED_VAR(msg);
-#endif
-}
-
-// ------------------------------------------------------------------------------------------------
-void OutputMessage(CCStr msg, ...)
-{
-    // Initialize the arguments list
-    va_list args;
-    va_start(args, msg);
-    // Call the output function
-    OutputMessageImpl(msg, args);
-    // Finalize the arguments list
-    va_end(args);
-}
-
-// ------------------------------------------------------------------------------------------------
-void OutputError(CCStr msg, ...)
-{
-    // Initialize the arguments list
-    va_list args;
-    va_start(args, msg);
-    // Call the output function
-    OutputErrorImpl(msg, args);
-    // Finalize the arguments list
-    va_end(args);
-}
-
-// ------------------------------------------------------------------------------------------------
-void VerboseMessage(CCStr msg, ...)
-{
-    // Are verbose messages allowed?
-    if (!g_Verbose)
-    {
-        return;
-    }
-    // Initialize the arguments list
-    va_list args;
-    va_start(args, msg);
-    // Call the output function
-    OutputMessageImpl(msg, args);
-    // Finalize the arguments list
-    va_end(args);
-}
-
-// ------------------------------------------------------------------------------------------------
-void VerboseError(CCStr msg, ...)
-{
-    // Are verbose messages allowed?
-    if (!g_Verbose)
-    {
-        return;
-    }
-    // Initialize the arguments list
-    va_list args;
-    va_start(args, msg);
-    // Call the output function
-    OutputErrorImpl(msg, args);
-    // Finalize the arguments list
-    va_end(args);
-}
-
-// ------------------------------------------------------------------------------------------------
-static void QueueMtMsg(bool type, CCStr msg, va_list args)
-{
-    // Create a copy of the specified arguments list
-    va_list args_cpy;
-    va_copy(args_cpy, args);
-    // Allocate a moderately large string
-    String buffer(128, '\0');
-    // Attempt to run the specified format
-    Int32 size = vsnprintf(&buffer[0], buffer.size(), msg, args);
-    // See if a larger buffer is necessary
-    if (size > 0 && static_cast< unsigned >(size) > buffer.size())
-    {
-        // Resize the string buffer to the required size
-        buffer.resize(static_cast< unsigned >(size+1), '\0');
-        // Attempt to run the specified format
-        size = vsnprintf(&buffer[0], buffer.size(), msg, args_cpy);
-    }
-    // Finalize the arguments list copy
-    va_end(args_cpy);
-    // See if the format failed
-    if (size < 0)
-    {
-        return;
-    }
-    // Remove unwanted characters
-    buffer.resize(size+1);
-    // Acquire a global lock
-    std::lock_guard< std::mutex > lock(g_Mutex);
-    // Emplace the message into the message queue
-    g_Messages.emplace(std::move(buffer), type);
-}
-
-// ------------------------------------------------------------------------------------------------
-void MtOutputMessage(CCStr msg, ...)
-{
-    // Initialize the arguments list
-    va_list args;
-    va_start(args, msg);
-    // Attempt to generate and queue the message
-    QueueMtMsg(true, msg, args);
-    // Finalize the arguments list
-    va_end(args);
-}
-
-// ------------------------------------------------------------------------------------------------
-void MtOutputError(CCStr msg, ...)
-{
-    // Initialize the arguments list
-    va_list args;
-    va_start(args, msg);
-    // Attempt to generate and queue the message
-    QueueMtMsg(false, msg, args);
-    // Finalize the arguments list
-    va_end(args);
-}
-
-// ------------------------------------------------------------------------------------------------
-void MtVerboseMessage(CCStr msg, ...)
-{
-    // Are verbose messages allowed?
-    if (!g_Verbose)
+    // Talk to the daemon, if used
+    if (g_Daemon.IsEnabled())
     {
-        return;
+        g_Daemon.Process();
     }
-    // Initialize the arguments list
-    va_list args;
-    va_start(args, msg);
-    // Attempt to generate and queue the message
-    QueueMtMsg(true, msg, args);
-    // Finalize the arguments list
-    va_end(args);
-}
-
-// ------------------------------------------------------------------------------------------------
-void MtVerboseError(CCStr msg, ...)
-{
-    // Are verbose messages allowed?
-    if (!g_Verbose)
+    // Announce from here when there's no thread, nothing is queued then
+    else if (g_FrameBudget != 0)
     {
+        g_Announcer.Step(g_FrameBudget);
         return;
     }
-    // Initialize the arguments list
-    va_list args;
-    va_start(args, msg);
-    // Attempt to generate and queue the message
-    QueueMtMsg(false, msg, args);
-    // Finalize the arguments list
-    va_end(args);
+    // Flush any queued messages
+    FlushMessages();
 }
 
 } // Namespace:: SMod
@@ -857,6 +448,7 @@ BOOL WINAPI ConsoleHandler(DWORD signal) {
 }
 #else
 void ConsoleHandler(int s){
+    SMOD_UNUSED_VAR(s);
     SMod::g_Announce = false;
 }
 #endif // SMOD_OS_WINDOWS
@@ -903,17 +495,33 @@ SMOD_API_EXPORT unsigned int VcmpPluginInit(PluginFuncs* functions, PluginCallba
         // Plug-in failed to load configurations
         return SMOD_FAILURE;
     }
-    // See if the plug-in should output verbose information
-    g_Verbose = conf.GetBoolValue("Options", "Verbose", false);
-    // Configure update interval
+    // See whether the announce work should be handed over to the announce daemon
     {
-        long value = conf.GetLongValue("Options", "UpdateInterval", 60);
-        // Should there be a limit here, higher than 1 second? (we dumb or evil enough to abuse it?)
-        g_UpdateInterval = value <= 0 ? 1 : static_cast< unsigned int >(value);
+        CCStr path = conf.GetValue("Options", "Daemon", "");
+        // Was a daemon socket specified?
+        if (path && *path != '\0')
+        {
+#ifdef SMOD_OS_WINDOWS
+            OutputError("The announce daemon is not supported on this platform");
+#else
+            g_Daemon.SetPath(path);
+#endif // SMOD_OS_WINDOWS
+        }
+    }
+    // The daemon has its own announce options
+    if (g_Daemon.IsEnabled())
+    {
+        // See if the plug-in should output verbose information
+        g_Verbose = conf.GetBoolValue("Options", "Verbose", false);
+    }
+    else
+    {
+        // Load the announce options
+        ConfigureOptions(conf);
     }
     // Attempt to retrieve the list of specified master-servers
-    CSimpleIniA::TNamesDepend servers;
-    conf.GetAllValues("Servers", "Address", servers);
+    std::vector< String > servers;
+    ConfigureMasters(conf, servers);
     // See if any server address was specified
     if (servers.size() <= 0)
     {
@@ -921,34 +529,22 @@ SMOD_API_EXPORT unsigned int VcmpPluginInit(PluginFuncs* functions, PluginCallba
         // No point in loading the plug-in
         return SMOD_FAILURE;
     }
-    // Sort the list in it's original order
-    servers.sort(CSimpleIniA::Entry::LoadOrder());
     // Process each specified server addresses
-    for (const auto & elem : servers)
+    for (const auto & address : servers)
     {
-        // See if there's even something that could resemble a server address
-        if (!elem.pItem)
-        {
-            continue;
-        }
-        // Attempt to extract URI information from the currently processed address
-        URI addr(elem.pItem);
-        // See if a valid host could be extracted
-        if (addr.mHost.empty())
+        // Should the daemon take care of it?
+        if (g_Daemon.IsEnabled())
         {
-            VerboseError("Master-server '%s' is an ill formed address", elem.pItem);
+            g_Daemon.AddMaster(address.c_str());
         }
         // Construct a server instance using this address
         else
         {
-            // Show which master-server is added to the list
-            VerboseMessage("Master-server '%s' added to the announce list", addr.Full());
-            // Create the server instance
-            g_Servers.emplace_back(std::move(addr));
+            g_Announcer.AddMaster(address.c_str());
         }
     }
     // See if any server was valid
-    if (g_Servers.size() <= 0)
+    if (g_Announcer.Count() <= 0 && g_Daemon.Count() <= 0)
     {
         VerboseError("No master-servers specified. No reason to load the plug-in.");
         // No point in loading the plug-in
@@ -0,0 +1,47 @@
+# report how much of the plug-in is code and data, what the loader relocates and what is exported
+# cmake -DREADELF=<readelf> -DBINARY=<plug-in> [-DEXPORTS=<count>] -P SizeReport.cmake
+# fails when EXPORTS is given and a different number of symbols is exported
+
+get_filename_component(SMOD_NAME ${BINARY} NAME)
+file(SIZE ${BINARY} SMOD_FILE_SIZE)
+
+# sizes of the sections that end up in memory
+execute_process(COMMAND ${READELF} -SW ${BINARY} OUTPUT_VARIABLE SMOD_SECTIONS)
+string(REPLACE "\n" ";" SMOD_SECTIONS "${SMOD_SECTIONS}")
+set(SMOD_SECTION_LIST "")
+
+foreach(line IN LISTS SMOD_SECTIONS)
+	if(line MATCHES "\\] +(\\.text|\\.rodata|\\.eh_frame|\\.gcc_except_table|\\.data\\.rel\\.ro|\\.data|\\.bss) +[A-Z_]+ +[0-9a-f]+ +[0-9a-f]+ +([0-9a-f]+)")
+		math(EXPR size "0x${CMAKE_MATCH_2}")
+		string(APPEND SMOD_SECTION_LIST " ${CMAKE_MATCH_1} ${size}")
+	endif()
+endforeach()
+
+# relocations applied when the plug-in is loaded
+execute_process(COMMAND ${READELF} -rW ${BINARY} OUTPUT_VARIABLE SMOD_RELOCS)
+string(REGEX MATCHALL "\n[0-9a-f]+ +[0-9a-f]+ +R_[A-Z0-9_]+" SMOD_RELOCS "${SMOD_RELOCS}")
+list(LENGTH SMOD_RELOCS SMOD_RELOC_COUNT)
+set(SMOD_RELATIVE 0)
+
+foreach(reloc IN LISTS SMOD_RELOCS)
+	if(reloc MATCHES "_RELATIVE$")
+		math(EXPR SMOD_RELATIVE "${SMOD_RELATIVE} + 1")
+	endif()
+endforeach()
+
+math(EXPR SMOD_SYMBOLIC "${SMOD_RELOC_COUNT} - ${SMOD_RELATIVE}")
+
+# symbols that other modules could bind to
+execute_process(COMMAND ${READELF} --dyn-syms -W ${BINARY} OUTPUT_VARIABLE SMOD_SYMBOLS)
+string(REGEX MATCHALL "\n +[0-9]+: [0-9a-f]+ +[0-9]+ [A-Z]+ +(GLOBAL|WEAK) +DEFAULT +[0-9]+" SMOD_SYMBOLS "${SMOD_SYMBOLS}")
+list(LENGTH SMOD_SYMBOLS SMOD_EXPORTED)
+
+message(STATUS "${SMOD_NAME}: ${SMOD_FILE_SIZE} bytes")
+message(STATUS "  sections:${SMOD_SECTION_LIST}")
+message(STATUS "  load time relocations: ${SMOD_RELOC_COUNT} (${SMOD_RELATIVE} relative, ${SMOD_SYMBOLIC} symbolic)")
+message(STATUS "  exported symbols: ${SMOD_EXPORTED}")
+
+# was the plug-in expected to export something else?
+if(DEFINED EXPORTS AND NOT SMOD_EXPORTED EQUAL EXPORTS)
+	message(FATAL_ERROR "${SMOD_NAME} exports ${SMOD_EXPORTED} symbols instead of ${EXPORTS}")
+endif()
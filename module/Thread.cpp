@@ -0,0 +1,280 @@
+// ------------------------------------------------------------------------------------------------
+#include "Thread.hpp"
+#include "Announce.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cerrno>
+#include <cstdio>
+#include <cstdarg>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#ifdef SMOD_OS_LINUX
+    #include <sched.h>
+    #include <unistd.h>
+    #include <sys/syscall.h>
+    #include <sys/resource.h>
+#endif
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+ThreadPolicy                g_ThreadPolicy; // How the threads that do announce work are scheduled.
+
+// ------------------------------------------------------------------------------------------------
+static constexpr unsigned   MAX_CPU = 1024; // Highest CPU number that can be pinned to, plus one.
+
+// ------------------------------------------------------------------------------------------------
+void ThreadPolicy::Describe(std::string & out) const
+{
+    static CCStr classes[] = {"normal", "batch", "idle"};
+    char buffer[64];
+    out.assign("cpus ");
+    // List the CPUs, collapsing runs of them into ranges
+    for (size_t i = 0; i < mCpus.size(); ++i)
+    {
+        size_t j = i;
+        // Find where the run ends
+        while (j + 1 < mCpus.size() && mCpus[j + 1] == mCpus[j] + 1)
+        {
+            ++j;
+        }
+        snprintf(buffer, sizeof(buffer), j > i ? "%s%u-%u" : "%s%u", i ? "," : "", mCpus[i], mCpus[j]);
+        out.append(buffer);
+        i = j;
+    }
+    if (mCpus.empty())
+    {
+        out.append("any");
+    }
+    out.append(", class ").append(classes[mClass]);
+    // Only mention what was configured
+    if (mNiced)
+    {
+        snprintf(buffer, sizeof(buffer), ", nice %d", mNice);
+        out.append(buffer);
+    }
+    if (mStack)
+    {
+        snprintf(buffer, sizeof(buffer), ", stack %u KiB", static_cast< unsigned >(mStack / 1024));
+        out.append(buffer);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+bool ParseCpuList(CCStr list, std::vector< unsigned > & out)
+{
+    out.clear();
+    // Go through each number or range
+    while (*list != '\0')
+    {
+        char * end = nullptr;
+        const unsigned long first = std::strtoul(list, &end, 10);
+        unsigned long last = first;
+        // Was there a number at all?
+        if (end == list)
+        {
+            return false;
+        }
+        // Is it a range?
+        else if (*end == '-')
+        {
+            list = end + 1;
+            last = std::strtoul(list, &end, 10);
+            // Does the range make sense?
+            if (end == list || last < first)
+            {
+                return false;
+            }
+        }
+        // Only so many CPUs can be told apart
+        if (last >= MAX_CPU)
+        {
+            return false;
+        }
+        for (unsigned long cpu = first; cpu <= last; ++cpu)
+        {
+            out.push_back(static_cast< unsigned >(cpu));
+        }
+        // Skip the separator
+        list = *end == ',' ? end + 1 : end;
+        // Anything else is a mistake
+        if (*end != ',' && *end != '\0')
+        {
+            return false;
+        }
+    }
+    // Keep them in order and only once
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return !out.empty();
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Remember a part of the policy that couldn't be applied, to be shown by the thread that started
+ * this one. Nothing is output from here because the messages may go to the thread being started.
+*/
+static void Failure(std::vector< std::string > & out, CCStr fmt, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    out.emplace_back(buffer);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Schedule the calling thread by the configured policy and describe how it went.
+*/
+static void ApplyPolicy(CCStr name, std::vector< std::string > & failures, std::string & report)
+{
+    const ThreadPolicy & policy = g_ThreadPolicy;
+    // Is there anything to change?
+    if (!policy.IsSet())
+    {
+        return;
+    }
+#ifdef SMOD_OS_LINUX
+    // Keep the thread on the specified CPUs
+    if (!policy.mCpus.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (const unsigned cpu : policy.mCpus)
+        {
+            CPU_SET(cpu, &set);
+        }
+        // Only the calling thread is affected
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        {
+            Failure(failures, "Unable to pin the %s thread to its CPUs: %s", name, strerror(errno));
+        }
+    }
+    // Change the scheduling class
+    if (policy.mClass != ThreadNormal)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        // Only the calling thread is affected
+        if (sched_setscheduler(0, policy.mClass == ThreadIdle ? SCHED_IDLE : SCHED_BATCH, &param) != 0)
+        {
+            Failure(failures, "Unable to change the scheduling class of the %s thread: %s", name, strerror(errno));
+        }
+    }
+    // Change the nice value, which Linux keeps for each thread
+    if (policy.mNiced && setpriority(PRIO_PROCESS, static_cast< id_t >(syscall(SYS_gettid)), policy.mNice) != 0)
+    {
+        Failure(failures, "Unable to change the nice value of the %s thread: %s", name, strerror(errno));
+    }
+#else
+    // Only the stack size can be chosen elsewhere
+    if (!policy.mCpus.empty() || policy.mClass != ThreadNormal || policy.mNiced)
+    {
+        Failure(failures, "Scheduling the %s thread is not supported on this platform", name);
+    }
+#endif // SMOD_OS_LINUX
+    policy.Describe(report);
+}
+
+// ------------------------------------------------------------------------------------------------
+Thread::Thread()
+    : m_Handle(), m_Running(false), m_Entry(nullptr), m_Arg(nullptr), m_Name(nullptr)
+    , m_Mutex(), m_Applied(), m_Scheduled(false), m_Failures(), m_Report()
+{
+    /* ... */
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Thread::Start(Entry entry, void * arg, CCStr name)
+{
+    m_Entry = entry;
+    m_Arg = arg;
+    m_Name = name;
+    m_Scheduled = false;
+    m_Failures.clear();
+    m_Report.clear();
+#ifdef SMOD_THREAD_POSIX
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    // Was a stack size chosen? The system has a lower limit of its own
+    if (g_ThreadPolicy.mStack)
+    {
+        const size_t size = std::max(g_ThreadPolicy.mStack, static_cast< size_t >(PTHREAD_STACK_MIN));
+        // Could the size be used?
+        if (pthread_attr_setstacksize(&attr, size) != 0)
+        {
+            OutputError("Unable to use a stack of %u bytes for the %s thread", static_cast< unsigned >(size), name);
+        }
+    }
+    const int result = pthread_create(&m_Handle, &attr, &Thread::Run, this);
+    pthread_attr_destroy(&attr);
+    // Was the thread created?
+    if (result != 0)
+    {
+        OutputError("Unable to create the %s thread: %s", name, strerror(result));
+        return false;
+    }
+#else
+    m_Handle = std::thread(&Thread::Run, this);
+#endif // SMOD_THREAD_POSIX
+    m_Running = true;
+    // Wait for the thread to schedule itself, then let the user know how it went from here
+    {
+        std::unique_lock< std::mutex > lock(m_Mutex);
+        m_Applied.wait(lock, [this]() { return m_Scheduled; });
+    }
+    for (const auto & failure : m_Failures)
+    {
+        OutputError("%s", failure.c_str());
+    }
+    if (!m_Report.empty())
+    {
+        OutputMessage("The %s thread runs with %s", name, m_Report.c_str());
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Thread::Join()
+{
+    // Is there anything to wait for?
+    if (!m_Running)
+    {
+        return;
+    }
+#ifdef SMOD_THREAD_POSIX
+    pthread_join(m_Handle, nullptr);
+#else
+    m_Handle.join();
+#endif // SMOD_THREAD_POSIX
+    m_Running = false;
+}
+
+// ------------------------------------------------------------------------------------------------
+void * Thread::Run(void * self)
+{
+    Thread & thread = *static_cast< Thread * >(self);
+    std::vector< std::string > failures;
+    std::string report;
+    // Get out of the way of the game before doing anything else
+    ApplyPolicy(thread.m_Name, failures, report);
+    // Hand what happened to the thread that started this one
+    {
+        std::lock_guard< std::mutex > lock(thread.m_Mutex);
+        thread.m_Failures.swap(failures);
+        thread.m_Report.swap(report);
+        thread.m_Scheduled = true;
+    }
+    thread.m_Applied.notify_one();
+    thread.m_Entry(thread.m_Arg);
+    return nullptr;
+}
+
+} // Namespace:: SMod
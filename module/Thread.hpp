@@ -0,0 +1,158 @@
+#ifndef _LIBRARY_THREAD_HPP_
+#define _LIBRARY_THREAD_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <mutex>
+#include <string>
+#include <vector>
+#include <condition_variable>
+
+// ------------------------------------------------------------------------------------------------
+#ifdef SMOD_THREAD_POSIX
+    #include <pthread.h>
+#else
+    #include <thread>
+#endif
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * Scheduling class of the threads that do announce work.
+*/
+enum ThreadClass
+{
+    ThreadNormal = 0, // Whatever the game thread uses.
+    ThreadBatch, // Treated as CPU bound and preempted less eagerly, never at the expense of others. (Linux)
+    ThreadIdle // Only runs when nothing else wants the CPU. (Linux)
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * How the threads that do announce work are scheduled, so that they don't compete with the game.
+*/
+struct ThreadPolicy
+{
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor. Threads are scheduled like the one that starts them.
+    */
+    ThreadPolicy()
+        : mCpus(), mClass(ThreadNormal), mNice(0), mNiced(false), mStack(0)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether anything differs from how the starting thread is scheduled.
+    */
+    bool IsSet() const
+    {
+        return !mCpus.empty() || mClass != ThreadNormal || mNiced || mStack != 0;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Describe the policy in a way that can be shown to the user.
+    */
+    void Describe(std::string & out) const;
+
+    // ---------------------------------------------------------------------------------------------
+    std::vector< unsigned > mCpus; // CPUs the threads may run on or empty for any of them.
+    ThreadClass             mClass; // Scheduling class.
+    int                     mNice; // Nice value, if one was configured.
+    bool                    mNiced; // Whether a nice value was configured.
+    size_t                  mStack; // Stack size in bytes or 0 for the default.
+};
+
+// ------------------------------------------------------------------------------------------------
+extern ThreadPolicy         g_ThreadPolicy; // How the threads that do announce work are scheduled.
+
+/* ------------------------------------------------------------------------------------------------
+ * Parse a list of CPUs such as "0,2-3" into the specified list. Returns false if it's malformed.
+*/
+bool ParseCpuList(CCStr list, std::vector< unsigned > & out);
+
+/* ------------------------------------------------------------------------------------------------
+ * A thread that does announce work. It's created with the configured stack size and schedules
+ * itself by the configured policy before it does anything else.
+*/
+class Thread
+{
+public:
+
+    /* ---------------------------------------------------------------------------------------------
+     * What the thread runs.
+    */
+    typedef void (*Entry)(void *);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    Thread();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    Thread(const Thread &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Destructor. Waits for the thread to finish, if it's still running.
+    */
+    ~Thread()
+    {
+        Join();
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    Thread & operator = (const Thread &) = delete;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Start running the specified function with the specified argument. The name is only used to
+     * tell the user which thread the policy was applied to, which is done from the calling thread
+     * once the new one scheduled itself.
+    */
+    bool Start(Entry entry, void * arg, CCStr name);
+
+    /* ---------------------------------------------------------------------------------------------
+     * See whether the thread was started and not joined yet.
+    */
+    bool Joinable() const
+    {
+        return m_Running;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Wait for the thread to finish.
+    */
+    void Join();
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Apply the policy and run the function of the specified thread.
+    */
+    static void * Run(void * self);
+
+    // ---------------------------------------------------------------------------------------------
+#ifdef SMOD_THREAD_POSIX
+    pthread_t       m_Handle; // The thread.
+#else
+    std::thread     m_Handle; // The thread.
+#endif
+    bool            m_Running; // Whether the thread was started and not joined yet.
+    Entry           m_Entry; // What the thread runs.
+    void *          m_Arg; // What it runs with.
+    CCStr           m_Name; // What the thread is called in messages.
+    std::mutex      m_Mutex; // Guards what the thread reports about its policy.
+    std::condition_variable     m_Applied; // Signaled once the thread scheduled itself.
+    bool            m_Scheduled; // Whether the thread scheduled itself.
+    std::vector< std::string >  m_Failures; // What couldn't be applied.
+    std::string     m_Report; // How the thread ended up scheduled, if a policy was applied.
+};
+
+} // Namespace:: SMod
+
+#endif // _LIBRARY_THREAD_HPP_
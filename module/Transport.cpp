@@ -0,0 +1,841 @@
+// ------------------------------------------------------------------------------------------------
+#include "Transport.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cerrno>
+#include <cctype>
+#include <cstdlib>
+
+// ------------------------------------------------------------------------------------------------
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#ifdef SMOD_OS_WINDOWS
+    #define SMOD_INVALID_SOCKET INVALID_SOCKET
+    #define SMOD_CLOSE_SOCKET closesocket
+    #define SMOD_POLL WSAPoll
+    #define SMOD_IN_PROGRESS (WSAGetLastError() == WSAEWOULDBLOCK)
+    #define SMOD_SEND_FLAGS 0
+#else
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <netdb.h>
+    #include <unistd.h>
+    #if defined(__linux__)
+        #include <linux/tcp.h>
+    #endif
+    #define SMOD_INVALID_SOCKET (-1)
+    #define SMOD_CLOSE_SOCKET close
+    #define SMOD_POLL poll
+    #define SMOD_IN_PROGRESS (errno == EINPROGRESS)
+    #if defined(MSG_NOSIGNAL)
+        #define SMOD_SEND_FLAGS MSG_NOSIGNAL
+    #else
+        #define SMOD_SEND_FLAGS 0
+    #endif
+#endif // SMOD_OS_WINDOWS
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * A lookup made by the system resolver in the background. It must stay where it is until it ends.
+*/
+struct PendingLookup
+{
+#ifdef SMOD_GETADDRINFO_A
+    struct gaicb    mRequest; // What the system resolver was asked and what it found.
+    struct addrinfo mHints; // How the host is resolved.
+#endif // SMOD_GETADDRINFO_A
+    String          mHost; // Host that is looked up.
+    String          mPort; // Port that is looked up.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Wait until the specified socket is ready for the specified events.
+*/
+static bool WaitFor(Transport::Socket sock, short events, time_t sec)
+{
+    struct pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = events;
+    pfd.revents = 0;
+    // Wait for the socket to become ready
+    int ret;
+    do
+    {
+        ret = SMOD_POLL(&pfd, 1, static_cast< int >(sec * 1000));
+    } while (ret < 0 && errno == EINTR);
+    // Did anything happen before the time ran out?
+    return ret > 0;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Follows the framing of a chunked body as it's received, without keeping any of it, to find out
+ * where the body ends while the connection stays open for the responses that follow.
+*/
+struct ChunkReader
+{
+    // ---------------------------------------------------------------------------------------------
+    enum Stage
+    {
+        ChunkSize, // Reading the hexadecimal size of the next chunk.
+        ChunkExtension, // Skipping the rest of the size line.
+        ChunkData, // Skipping the data of the chunk.
+        ChunkEnd, // Expecting the line break after the data.
+        ChunkTrailer, // Skipping the trailer lines after the last chunk.
+        ChunkDone, // The body ended.
+        ChunkBad // The body isn't chunked the way it claims.
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    ChunkReader()
+        : mStage(ChunkSize), mLeft(0), mDigits(false), mBlank(true)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Follow the specified bytes of the body. Returns how many belong to it, which is less than
+     * the specified size only if the body ended part way through them.
+    */
+    size_t Feed(CCStr data, size_t size)
+    {
+        size_t i = 0;
+        while (i < size && mStage != ChunkDone && mStage != ChunkBad)
+        {
+            const char c = data[i];
+            // Whole runs of data are skipped at once
+            if (mStage == ChunkData)
+            {
+                const size_t n = static_cast< size_t >(std::min< uint64_t >(mLeft, size - i));
+                mLeft -= n;
+                i += n;
+                mStage = mLeft == 0 ? ChunkEnd : ChunkData;
+                continue;
+            }
+            ++i;
+            // Line breaks are only looked at by their last character
+            if (c == '\r')
+            {
+                continue;
+            }
+            else if (mStage == ChunkSize && isxdigit(static_cast< unsigned char >(c)))
+            {
+                // Refuse sizes no master-server would ever send
+                if (mLeft > (UINT64_C(1) << 40))
+                {
+                    mStage = ChunkBad;
+                    break;
+                }
+                mLeft = mLeft * 16 + static_cast< uint64_t >(isdigit(static_cast< unsigned char >(c)) ? c - '0' : (tolower(c) - 'a' + 10));
+                mDigits = true;
+            }
+            else if ((mStage == ChunkSize || mStage == ChunkExtension) && c == '\n')
+            {
+                // The last chunk is followed by the trailer, if any
+                mStage = !mDigits ? ChunkBad : (mLeft == 0 ? ChunkTrailer : ChunkData);
+                mBlank = true;
+            }
+            else if (mStage == ChunkSize)
+            {
+                mStage = mDigits && (c == ';' || c == ' ' || c == '\t') ? ChunkExtension : ChunkBad;
+            }
+            else if (mStage == ChunkEnd)
+            {
+                mStage = c == '\n' ? ChunkSize : ChunkBad;
+                mDigits = false;
+            }
+            else if (mStage == ChunkTrailer)
+            {
+                // An empty line ends the trailer and with it the body
+                if (c == '\n')
+                {
+                    mStage = mBlank ? ChunkDone : ChunkTrailer;
+                    mBlank = true;
+                }
+                else
+                {
+                    mBlank = false;
+                }
+            }
+        }
+        return i;
+    }
+
+    // ---------------------------------------------------------------------------------------------
+    Stage       mStage; // What is expected next.
+    uint64_t    mLeft; // Size of the chunk or what is left of it.
+    bool        mDigits; // Whether the size line had any digits.
+    bool        mBlank; // Whether the trailer line is empty so far.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Case insensitive comparison of the first characters of two strings.
+*/
+static bool SameText(CCStr a, CCStr b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (tolower(static_cast< unsigned char >(a[i])) != tolower(static_cast< unsigned char >(b[i])))
+        {
+            return false;
+        }
+        // Both strings ended at the same time
+        else if (a[i] == '\0')
+        {
+            break;
+        }
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+CCStr Response::Find(CCStr name) const
+{
+    const size_t len = strlen(name);
+    // Look through the received headers
+    for (size_t i = 0; i < mHeaderCount; ++i)
+    {
+        if (SameText(mHeaders[i].mName, name, len + 1))
+        {
+            return mHeaders[i].mValue;
+        }
+    }
+    // Not found
+    return nullptr;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Transport::Exchange(const String & request, Response & res)
+{
+    const Socket sock = Begin(request);
+    // Was the request sent?
+    if (sock == SMOD_INVALID_SOCKET)
+    {
+        res.Clear();
+        return false;
+    }
+    // Wait for the response
+    return Finish(sock, res);
+}
+
+// ------------------------------------------------------------------------------------------------
+Transport::Socket Transport::Begin(const String & request)
+{
+    // Make sure we know where to connect
+    if (!Resolve())
+    {
+        return SMOD_INVALID_SOCKET;
+    }
+    const Socket sock = Connect(m_Address, m_AddressLen, m_Timeout);
+    // Could we connect and send the request?
+    if (sock == SMOD_INVALID_SOCKET || !Send(sock, request.data(), request.size()))
+    {
+        Abandon(sock);
+        Forget();
+        return SMOD_INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Transport::Finish(Socket sock, Response & res)
+{
+    res.Clear();
+    // Wait for the response
+    const bool ret = Receive(sock, res);
+    // Find out how the path behaved while the connection is still around
+    if (ret)
+    {
+        Sample(sock);
+    }
+    // Only one request is sent per connection
+    SMOD_CLOSE_SOCKET(sock);
+    // Look up the address again next time if something went wrong
+    if (!ret)
+    {
+        Forget();
+    }
+    return ret;
+}
+
+// ------------------------------------------------------------------------------------------------
+size_t Transport::Pipeline(const String & requests, Response * res, size_t count)
+{
+    const Socket sock = Begin(requests);
+    // Were the requests sent?
+    if (sock == SMOD_INVALID_SOCKET)
+    {
+        return 0;
+    }
+    char carry[Response::BUFFER_SIZE];
+    size_t carried = 0, received = 0;
+    // Receive the responses in the order the requests were sent
+    for (; received < count; ++received)
+    {
+        res[received].Clear();
+        // Did the master-server stop answering or close the connection?
+        if (!Receive(sock, res[received], carry, &carried))
+        {
+            break;
+        }
+    }
+    // Find out how the path behaved while the connection is still around
+    if (received > 0)
+    {
+        Sample(sock);
+    }
+    SMOD_CLOSE_SOCKET(sock);
+    // Look up the address again next time if nothing came back
+    if (received == 0)
+    {
+        Forget();
+    }
+    return received;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Transport::Exchange(CCStr host, CCStr port, time_t timeout, CCStr request, size_t size, Response & res)
+{
+    res.Clear();
+    struct sockaddr_storage addr;
+    socklen_t len = 0;
+    // Find out where to connect
+    if (!Lookup(host, port, addr, len))
+    {
+        return false;
+    }
+    const Socket sock = Connect(addr, len, timeout);
+    // Could we connect?
+    if (sock == SMOD_INVALID_SOCKET)
+    {
+        return false;
+    }
+    // Send the request and wait for the response
+    const bool ret = Communicate(sock, request, size, res);
+    // Only one request is sent per connection
+    SMOD_CLOSE_SOCKET(sock);
+    return ret;
+}
+
+// ------------------------------------------------------------------------------------------------
+size_t Transport::ExportAddress(void * out, size_t size, int64_t & age) const
+{
+    // Is there an address and does it fit?
+    if (m_AddressLen == 0 || m_AddressLen > size)
+    {
+        return 0;
+    }
+    memcpy(out, &m_Address, m_AddressLen);
+    age = std::chrono::duration_cast< std::chrono::seconds >(std::chrono::steady_clock::now() - m_Resolved).count();
+    return m_AddressLen;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Transport::ImportAddress(const void * in, size_t size, int64_t age)
+{
+    // Ignore anything that can't be an address or is too old to be used anyway
+    if (size == 0 || size > sizeof(m_Address) || age < 0 || age >= RESOLVE_TTL)
+    {
+        return;
+    }
+    memcpy(&m_Address, in, size);
+    m_AddressLen = static_cast< socklen_t >(size);
+    m_Resolved = std::chrono::steady_clock::now() - std::chrono::seconds(age);
+}
+
+// ------------------------------------------------------------------------------------------------
+void Transport::Abandon(Socket sock)
+{
+    // Was there even a connection?
+    if (sock != SMOD_INVALID_SOCKET)
+    {
+        SMOD_CLOSE_SOCKET(sock);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+int Transport::WaitAny(const Socket * socks, size_t count, int ms)
+{
+    struct pollfd pfd[2];
+    // Only a request and its hedge are ever raced
+    count = count < 2 ? count : 2;
+    for (size_t i = 0; i < count; ++i)
+    {
+        pfd[i].fd = socks[i];
+        pfd[i].events = POLLIN;
+        pfd[i].revents = 0;
+    }
+    // Wait for either of them to start answering
+    int ret;
+    do
+    {
+        ret = SMOD_POLL(pfd, static_cast< unsigned >(count), ms);
+    } while (ret < 0 && errno == EINTR);
+    // Which one was first? (errors count too, receiving will find out)
+    for (size_t i = 0; ret > 0 && i < count; ++i)
+    {
+        if (pfd[i].revents != 0)
+        {
+            return static_cast< int >(i);
+        }
+    }
+    // The time ran out
+    return -1;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Transport::Resolve()
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    // Is the address we have still good, or is a newer one already being looked up?
+    if (m_AddressLen > 0 && (now - m_Resolved < std::chrono::seconds(RESOLVE_TTL) || m_Lookup))
+    {
+        return true;
+    }
+    // Did the lookup in the background find nothing? Then it isn't asked for again right away
+    else if (m_LookupFailed)
+    {
+        m_LookupFailed = false;
+        return m_AddressLen > 0;
+    }
+    struct sockaddr_storage addr;
+    socklen_t len = 0;
+    // Ask the system resolver, the last good address is better than none
+    if (!Lookup(m_Host.c_str(), m_Port.c_str(), addr, len))
+    {
+        return m_AddressLen > 0;
+    }
+    memcpy(&m_Address, &addr, len);
+    m_AddressLen = len;
+    m_Resolved = now;
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Transport::Prefetch()
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+#ifdef SMOD_GETADDRINFO_A
+    // Did the lookup started earlier end?
+    if (m_Lookup && gai_error(&m_Lookup->mRequest) != EAI_INPROGRESS)
+    {
+        const struct addrinfo * result = m_Lookup->mRequest.ar_result;
+        // The target may have changed while it was looked up
+        const bool current = m_Lookup->mHost == m_Host && m_Lookup->mPort == m_Port;
+        // Did it find anything? Keep the first address
+        if (current && gai_error(&m_Lookup->mRequest) == 0 && result && result->ai_addrlen <= sizeof(m_Address))
+        {
+            memcpy(&m_Address, result->ai_addr, result->ai_addrlen);
+            m_AddressLen = static_cast< socklen_t >(result->ai_addrlen);
+            m_Resolved = now;
+        }
+        else if (current)
+        {
+            m_LookupFailed = true;
+        }
+        m_Lookup.reset();
+    }
+#endif // SMOD_GETADDRINFO_A
+    // Is the address we have still good, or is a newer one already being looked up?
+    if (m_AddressLen > 0 && (now - m_Resolved < std::chrono::seconds(RESOLVE_TTL) || m_Lookup))
+    {
+        return true;
+    }
+    // Did the last lookup find nothing? Then the exchange goes ahead and fails without asking again
+    else if (m_LookupFailed)
+    {
+        return true;
+    }
+    // Is a lookup still under way?
+    else if (m_Lookup)
+    {
+        return false;
+    }
+    struct sockaddr_storage addr;
+    socklen_t len = 0;
+    // Literal addresses are known without asking anyone
+    if (Lookup(m_Host.c_str(), m_Port.c_str(), addr, len, false))
+    {
+        memcpy(&m_Address, &addr, len);
+        m_AddressLen = len;
+        m_Resolved = now;
+        return true;
+    }
+#ifdef SMOD_GETADDRINFO_A
+    m_Lookup.reset(new PendingLookup());
+    m_Lookup->mHost = m_Host;
+    m_Lookup->mPort = m_Port;
+    m_Lookup->mHints.ai_family = AF_UNSPEC;
+    m_Lookup->mHints.ai_socktype = SOCK_STREAM;
+    m_Lookup->mRequest.ar_name = m_Lookup->mHost.c_str();
+    m_Lookup->mRequest.ar_service = m_Lookup->mPort.c_str();
+    m_Lookup->mRequest.ar_request = &m_Lookup->mHints;
+    struct gaicb * list[1] = { &m_Lookup->mRequest };
+    // Have the system resolver look it up in the background, the last good address is used meanwhile
+    if (getaddrinfo_a(GAI_NOWAIT, list, 1, nullptr) != 0)
+    {
+        m_Lookup.reset();
+        m_LookupFailed = true;
+        return true;
+    }
+    return m_AddressLen > 0;
+#else
+    // There's no way to look it up in the background here, so it's looked up when connecting
+    return true;
+#endif // SMOD_GETADDRINFO_A
+}
+
+// ------------------------------------------------------------------------------------------------
+void Transport::LookupEnd::operator () (PendingLookup * lookup) const
+{
+#ifdef SMOD_GETADDRINFO_A
+    // A lookup that can't be called off writes into its request when it ends, so it must end first
+    if (gai_cancel(&lookup->mRequest) == EAI_NOTCANCELED)
+    {
+        const struct gaicb * list[1] = { &lookup->mRequest };
+        while (gai_error(&lookup->mRequest) == EAI_INPROGRESS)
+        {
+            gai_suspend(list, 1, nullptr);
+        }
+    }
+    // Release whatever it found
+    if (lookup->mRequest.ar_result)
+    {
+        freeaddrinfo(lookup->mRequest.ar_result);
+    }
+#endif // SMOD_GETADDRINFO_A
+    delete lookup;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Transport::Lookup(CCStr host, CCStr port, struct sockaddr_storage & addr, socklen_t & len, bool ask)
+{
+    struct addrinfo hints;
+    struct addrinfo * result = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICHOST;
+    // Literal addresses don't need the system resolver, which may read files or ask the network
+    if (getaddrinfo(host, port, &hints, &result) != 0 || !result)
+    {
+        // May it be asked?
+        if (!ask)
+        {
+            return false;
+        }
+        hints.ai_flags = 0;
+        result = nullptr;
+        // Ask the system resolver
+        if (getaddrinfo(host, port, &hints, &result) != 0 || !result)
+        {
+            return false;
+        }
+    }
+    // Keep the first address
+    memcpy(&addr, result->ai_addr, result->ai_addrlen);
+    len = static_cast< socklen_t >(result->ai_addrlen);
+    freeaddrinfo(result);
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+Transport::Socket Transport::Connect(const struct sockaddr_storage & addr, socklen_t len, time_t timeout)
+{
+    const Socket sock = socket(addr.ss_family, SOCK_STREAM, IPPROTO_TCP);
+    // Could we create the socket?
+    if (sock == SMOD_INVALID_SOCKET)
+    {
+        return SMOD_INVALID_SOCKET;
+    }
+    // Never block longer than the configured timeouts
+#ifdef SMOD_OS_WINDOWS
+    u_long mode = 1;
+    ioctlsocket(sock, FIONBIO, &mode);
+#else
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif // SMOD_OS_WINDOWS
+    // Start connecting
+    if (connect(sock, reinterpret_cast< const struct sockaddr * >(&addr), len) != 0)
+    {
+        // Did the connection fail right away?
+        if (!SMOD_IN_PROGRESS || !WaitFor(sock, POLLOUT, timeout))
+        {
+            SMOD_CLOSE_SOCKET(sock);
+            return SMOD_INVALID_SOCKET;
+        }
+        int error = 0;
+        socklen_t size = sizeof(error);
+        // Find out how the connection attempt ended
+        if (getsockopt(sock, SOL_SOCKET, SO_ERROR, reinterpret_cast< char * >(&error), &size) != 0 || error != 0)
+        {
+            SMOD_CLOSE_SOCKET(sock);
+            return SMOD_INVALID_SOCKET;
+        }
+    }
+    // We're connected
+    return sock;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Transport::Communicate(Socket sock, CCStr request, size_t size, Response & res)
+{
+    return Send(sock, request, size) && Receive(sock, res);
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Transport::Send(Socket sock, CCStr request, size_t size)
+{
+    // Send the whole request
+    for (size_t sent = 0; sent < size;)
+    {
+        // Wait until the socket can take more
+        if (!WaitFor(sock, POLLOUT, IO_TIMEOUT))
+        {
+            return false;
+        }
+        const auto n = send(sock, request + sent, static_cast< int >(size - sent), SMOD_SEND_FLAGS);
+        // Did the connection break?
+        if (n <= 0)
+        {
+            return false;
+        }
+        sent += static_cast< size_t >(n);
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+char * Transport::ParseHead(Response & res, int & status, long & length, bool & chunked)
+{
+    char * end = strstr(res.mBuffer, "\r\n\r\n");
+    // Were the headers received completely?
+    if (!end)
+    {
+        return nullptr;
+    }
+    // Terminate the headers
+    end[2] = '\0';
+    // Parse the status line (HTTP/1.x 200 OK)
+    if (strncmp(res.mBuffer, "HTTP/1.", 7) != 0 || !strchr(res.mBuffer, ' '))
+    {
+        return nullptr;
+    }
+    status = std::atoi(strchr(res.mBuffer, ' ') + 1);
+    length = -1;
+    chunked = false;
+    // Parse the headers in place
+    for (char * line = strstr(res.mBuffer, "\r\n"); line && line[2] != '\0'; )
+    {
+        char * name = line + 2;
+        char * next = strstr(name, "\r\n");
+        // Terminate this line
+        *next = '\0';
+        line = next;
+        char * sep = strchr(name, ':');
+        // Ignore anything that doesn't resemble a header
+        if (!sep)
+        {
+            continue;
+        }
+        *sep = '\0';
+        // Skip the white space before the value
+        char * value = sep + 1;
+        while (*value == ' ' || *value == '\t')
+        {
+            ++value;
+        }
+        // Remember the header if there's room
+        if (res.mHeaderCount < Response::MAX_HEADERS)
+        {
+            res.mHeaders[res.mHeaderCount].mName = name;
+            res.mHeaders[res.mHeaderCount].mValue = value;
+            ++res.mHeaderCount;
+        }
+        // Look for what tells us how large the body is
+        if (SameText(name, "Content-Length", 15))
+        {
+            length = std::strtol(value, nullptr, 10);
+        }
+        else if (SameText(name, "Transfer-Encoding", 18) && SameText(value, "chunked", 7))
+        {
+            chunked = true;
+        }
+    }
+    // The body follows
+    return end + 4;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Transport::Receive(Socket sock, Response & res, char * carry, size_t * carried)
+{
+    size_t received = 0;
+    char * end = nullptr;
+    // Start with whatever was read past the end of the previous response on this connection
+    if (carried && *carried > 0)
+    {
+        memcpy(res.mBuffer, carry, *carried);
+        received = *carried;
+        *carried = 0;
+        res.mBuffer[received] = '\0';
+        end = strstr(res.mBuffer, "\r\n\r\n");
+    }
+    // Receive until the end of the headers
+    while (!end)
+    {
+        // Is there room for more?
+        if (received + 1 >= Response::BUFFER_SIZE || !WaitFor(sock, POLLIN, IO_TIMEOUT))
+        {
+            return false;
+        }
+        const auto n = recv(sock, res.mBuffer + received, static_cast< int >(Response::BUFFER_SIZE - 1 - received), 0);
+        // Did the connection end before the headers?
+        if (n <= 0)
+        {
+            return false;
+        }
+        received += static_cast< size_t >(n);
+        res.mBuffer[received] = '\0';
+        end = strstr(res.mBuffer, "\r\n\r\n");
+    }
+    int status = 0;
+    long length = -1;
+    bool chunked = false;
+    // Parse the status line and headers
+    char * const rest = ParseHead(res, status, length, chunked);
+    // Did it even resemble a response?
+    if (!rest)
+    {
+        return false;
+    }
+    // Whatever follows the headers is the start of the body
+    size_t body = received - static_cast< size_t >(rest - res.mBuffer);
+    // Does the next response already start in what was received?
+    if (carried && !chunked && length >= 0 && body > static_cast< size_t >(length))
+    {
+        *carried = body - static_cast< size_t >(length);
+        memcpy(carry, rest + length, *carried);
+        body = static_cast< size_t >(length);
+    }
+    // A chunked body must be followed to its end when the connection is kept for more responses
+    else if (carried && chunked)
+    {
+        return ReceiveChunks(sock, res, status, rest, body, carry, carried);
+    }
+    char scratch[2048];
+    // Discard the body. Without a length it ends when the connection is closed
+    while (chunked || length < 0 || body < static_cast< size_t >(length))
+    {
+        // Wait for more of the body
+        if (!WaitFor(sock, POLLIN, IO_TIMEOUT))
+        {
+            return false;
+        }
+        size_t want = sizeof(scratch);
+        // Never read into the next response
+        if (carried && !chunked && length >= 0 && static_cast< size_t >(length) - body < want)
+        {
+            want = static_cast< size_t >(length) - body;
+        }
+        const auto n = recv(sock, scratch, static_cast< int >(want), 0);
+        // Did the body end?
+        if (n <= 0)
+        {
+            // The body is only complete if we didn't expect more
+            if (n < 0 || length >= 0)
+            {
+                return false;
+            }
+            break;
+        }
+        body += static_cast< size_t >(n);
+    }
+    res.mStatus = status;
+    res.mBodySize = body;
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Transport::ReceiveChunks(Socket sock, Response & res, int status, CCStr rest, size_t size,
+                                char * carry, size_t * carried)
+{
+    ChunkReader reader;
+    // Follow what was received along with the headers
+    size_t body = reader.Feed(rest, size);
+    // Does the next response already start in there?
+    if (body < size)
+    {
+        *carried = size - body;
+        memcpy(carry, rest + body, *carried);
+    }
+    char scratch[2048];
+    // Discard the body until its last chunk
+    while (reader.mStage != ChunkReader::ChunkDone)
+    {
+        // Is the body malformed or taking too long?
+        if (reader.mStage == ChunkReader::ChunkBad || !WaitFor(sock, POLLIN, IO_TIMEOUT))
+        {
+            return false;
+        }
+        const auto n = recv(sock, scratch, static_cast< int >(sizeof(scratch)), 0);
+        // Did the connection end before the body?
+        if (n <= 0)
+        {
+            return false;
+        }
+        const size_t used = reader.Feed(scratch, static_cast< size_t >(n));
+        body += used;
+        // Keep whatever belongs to the next response
+        if (used < static_cast< size_t >(n))
+        {
+            *carried = static_cast< size_t >(n) - used;
+            memcpy(carry, scratch + used, *carried);
+        }
+    }
+    res.mStatus = status;
+    res.mBodySize = body;
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void Transport::Sample(Socket sock)
+{
+#if defined(__linux__) && defined(TCP_INFO)
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    // Older kernels fill less of the structure
+    memset(&info, 0, sizeof(info));
+    // Ask the kernel what it knows about the connection
+    if (getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &len) != 0)
+    {
+        return;
+    }
+    ++m_Path.mSamples;
+    m_Path.mRtt = info.tcpi_rtt;
+    m_Path.mRttVar = info.tcpi_rttvar;
+    m_Path.mLastRetransmits = info.tcpi_total_retrans;
+    m_Path.mRetransmits += info.tcpi_total_retrans;
+    m_Path.mBytesAcked += info.tcpi_bytes_acked;
+    m_Path.mBytesReceived += info.tcpi_bytes_received;
+    // Remember the best round trip time to compare against
+    if (m_Path.mMinRtt == 0 || (info.tcpi_rtt > 0 && info.tcpi_rtt < m_Path.mMinRtt))
+    {
+        m_Path.mMinRtt = info.tcpi_rtt;
+    }
+    // Count the connections in a row that had to retransmit
+    m_Path.mLossy = info.tcpi_total_retrans > 0 ? m_Path.mLossy + 1 : 0;
+    // A path is degraded while it keeps losing segments or takes much longer than it used to
+    m_Path.mDegraded = m_Path.mLossy >= DEGRADE_LOSSY ||
+                        (m_Path.mRtt > m_Path.mMinRtt * DEGRADE_RTT_FACTOR &&
+                         m_Path.mRtt > m_Path.mMinRtt + DEGRADE_RTT_MARGIN);
+#else
+    // The system doesn't tell us anything about the path
+    SMOD_UNUSED_VAR(sock);
+#endif // __linux__
+}
+
+} // Namespace:: SMod
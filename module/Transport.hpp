@@ -0,0 +1,359 @@
+#ifndef _LIBRARY_TRANSPORT_HPP_
+#define _LIBRARY_TRANSPORT_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <ctime>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <string>
+#include <chrono>
+#include <memory>
+
+// ------------------------------------------------------------------------------------------------
+#ifdef SMOD_OS_WINDOWS
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/types.h>
+    #include <sys/socket.h>
+#endif // SMOD_OS_WINDOWS
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+typedef ::std::string String;
+
+// ------------------------------------------------------------------------------------------------
+struct PendingLookup;
+
+/* ------------------------------------------------------------------------------------------------
+ * A response received from a master-server. The status line and headers are parsed in place so the
+ * same instance can be reused for every announce without touching the heap.
+*/
+struct Response
+{
+    // ---------------------------------------------------------------------------------------------
+    static constexpr size_t BUFFER_SIZE = 8192; // Largest status line and headers accepted.
+    static constexpr size_t MAX_HEADERS = 48; // Most headers remembered from a response.
+
+    /* ---------------------------------------------------------------------------------------------
+     * A header found in the response. Both strings point inside the response buffer.
+    */
+    struct Header
+    {
+        CCStr   mName; // Null terminated header name.
+        CCStr   mValue; // Null terminated header value.
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    Response()
+        : mStatus(0), mHeaderCount(0), mBodySize(0), mHeaders(), mBuffer()
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Forget the previous response.
+    */
+    void Clear()
+    {
+        mStatus = 0;
+        mHeaderCount = 0;
+        mBodySize = 0;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the value of the specified header (case insensitive) or null if it wasn't sent.
+    */
+    CCStr Find(CCStr name) const;
+
+    // ---------------------------------------------------------------------------------------------
+    int         mStatus; // Status code or 0 if no response was received.
+    size_t      mHeaderCount; // Number of headers found.
+    size_t      mBodySize; // Size of the response body that was received and discarded.
+    Header      mHeaders[MAX_HEADERS]; // Headers found in the response.
+    char        mBuffer[BUFFER_SIZE]; // Raw status line and headers.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Quality of the network path to a master-server as seen by the kernel. Sampled through TCP_INFO
+ * after every response where the system supports it. Elsewhere the counters remain zero.
+*/
+struct PathStats
+{
+    uint64_t    mSamples; // Connections that were sampled.
+    uint32_t    mRtt; // Smoothed round trip time of the last connection. (microseconds)
+    uint32_t    mRttVar; // Round trip time variance of the last connection. (microseconds)
+    uint32_t    mMinRtt; // Best smoothed round trip time seen so far. (microseconds)
+    uint32_t    mLastRetransmits; // Segments retransmitted on the last connection.
+    uint64_t    mRetransmits; // Segments retransmitted on all connections.
+    uint64_t    mBytesAcked; // Bytes sent and acknowledged on all connections.
+    uint64_t    mBytesReceived; // Bytes received on all connections.
+    unsigned    mLossy; // Consecutive connections that needed retransmits.
+    bool        mDegraded; // Whether the path is considered degraded.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Minimal HTTP/1.1 client used to deliver announces. The resolved address is kept between announces
+ * and the caller supplies the encoded request and the response storage, so announcing on a healthy
+ * master-server does not allocate.
+*/
+class Transport
+{
+public:
+
+    // ---------------------------------------------------------------------------------------------
+#ifdef SMOD_OS_WINDOWS
+    typedef SOCKET Socket;
+    static constexpr Socket NO_SOCKET = INVALID_SOCKET; // Socket that was never created.
+#else
+    typedef int Socket;
+    static constexpr Socket NO_SOCKET = -1; // Socket that was never created.
+#endif // SMOD_OS_WINDOWS
+
+    // ---------------------------------------------------------------------------------------------
+    static constexpr int64_t RESOLVE_TTL = 300; // Seconds a resolved address is reused.
+    static constexpr unsigned LOOKUP_WAIT = 100; // Milliseconds between looks at a lookup in the background.
+    static constexpr time_t IO_TIMEOUT = 5; // Seconds to wait on a single read or write.
+    static constexpr unsigned DEGRADE_LOSSY = 3; // Consecutive lossy connections before a path is degraded.
+    static constexpr uint32_t DEGRADE_RTT_FACTOR = 4; // How many times the best RTT a degraded path takes.
+    static constexpr uint32_t DEGRADE_RTT_MARGIN = 50000; // Least RTT increase of a degraded path. (microseconds)
+
+    /* ---------------------------------------------------------------------------------------------
+     * Default constructor.
+    */
+    Transport()
+        : m_Host(), m_Port(), m_Timeout(IO_TIMEOUT), m_Resolved(), m_Address(), m_AddressLen(0), m_Path()
+        , m_Lookup(), m_LookupFailed(false)
+    {
+        /* ... */
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Specify where to connect. The address is resolved again on the next exchange.
+    */
+    void SetTarget(const String & host, const String & port)
+    {
+        m_Host.assign(host);
+        m_Port.assign(port);
+        m_AddressLen = 0;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Specify how many seconds to wait for the connection to be established.
+    */
+    void SetTimeout(time_t sec)
+    {
+        m_Timeout = sec;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the host that is connected to.
+    */
+    const String & GetHost() const
+    {
+        return m_Host;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the port that is connected to.
+    */
+    const String & GetPort() const
+    {
+        return m_Port;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Copy the resolved address into the specified buffer and tell how many seconds ago it was
+     * resolved. Returns its size or 0 if there is no address or it doesn't fit.
+    */
+    size_t ExportAddress(void * out, size_t size, int64_t & age) const;
+
+    /* ---------------------------------------------------------------------------------------------
+     * Use the specified address as if it was resolved the specified number of seconds ago.
+    */
+    void ImportAddress(const void * in, size_t size, int64_t age);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Retrieve the path quality sampled from the connections to the host.
+    */
+    const PathStats & GetPath() const
+    {
+        return m_Path;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Treat the resolved address as too old so that the next exchange resolves the host again. It
+     * remains the one used until a lookup finds a newer one.
+    */
+    void Forget()
+    {
+        m_Resolved = std::chrono::steady_clock::now() - std::chrono::seconds(RESOLVE_TTL);
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Find out whether an exchange can start without waiting on the system resolver. A lookup is
+     * started in the background when the host isn't a literal address and there's no address or it
+     * became too old. Returns false only while there's no address to use yet. Never blocks where
+     * lookups can be made in the background.
+    */
+    bool Prefetch();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Connect, send the encoded request and receive the response. Returns false if no response was
+     * received, in which case the resolved address is forgotten.
+    */
+    bool Exchange(const String & request, Response & res);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Connect and send the encoded request without waiting for the response. Returns NO_SOCKET if
+     * that failed, in which case the resolved address is forgotten. Otherwise the returned socket
+     * must be handed to Finish() or Abandon().
+    */
+    Socket Begin(const String & request);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Receive the response to a request sent by Begin() and close the connection.
+    */
+    bool Finish(Socket sock, Response & res);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Connect, send several encoded requests back to back and receive their responses in the same
+     * order through the one connection. Returns how many responses were received. The requests
+     * without one must be sent again on their own.
+    */
+    size_t Pipeline(const String & requests, Response * res, size_t count);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Close the connection of a request sent by Begin() without waiting for the response.
+    */
+    static void Abandon(Socket sock);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Wait up to the specified number of milliseconds for a response to start arriving on any of the
+     * specified sockets. Returns the index of the first one or -1 if the time ran out.
+    */
+    static int WaitAny(const Socket * socks, size_t count, int ms);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Resolve the host if needed and retrieve the address to connect to, for an I/O engine that
+     * drives the connection itself. Returns null if the host could not be resolved.
+    */
+    const struct sockaddr_storage * Address(socklen_t & len)
+    {
+        // Make sure we know where to connect
+        if (!Resolve())
+        {
+            return nullptr;
+        }
+        len = m_AddressLen;
+        return &m_Address;
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Account for a connection driven by an I/O engine, before the engine closes it. The path is
+     * sampled if a response was received, otherwise the resolved address is looked up again.
+    */
+    void Conclude(Socket sock, bool received)
+    {
+        // Did the exchange succeed?
+        if (received)
+        {
+            Sample(sock);
+        }
+        else
+        {
+            Forget();
+        }
+    }
+
+    /* ---------------------------------------------------------------------------------------------
+     * Parse the status line and headers at the start of the response buffer, which must be null
+     * terminated. Returns where the body starts or null if the headers are incomplete or malformed.
+    */
+    static char * ParseHead(Response & res, int & status, long & length, bool & chunked);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Send a single request to a host that is not worth remembering, such as a redirect target.
+     * The host is resolved every time and nothing is kept afterwards.
+    */
+    static bool Exchange(CCStr host, CCStr port, time_t timeout, CCStr request, size_t size, Response & res);
+
+private:
+
+    /* ---------------------------------------------------------------------------------------------
+     * Ends a lookup made in the background once the transport no longer needs it.
+    */
+    struct LookupEnd
+    {
+        void operator () (PendingLookup * lookup) const;
+    };
+
+    /* ---------------------------------------------------------------------------------------------
+     * Resolve the host if there's no address or it became too old. The last good address is kept
+     * if the host can't be resolved or a newer one is already being looked up in the background.
+    */
+    bool Resolve();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Resolve the specified host and port into the specified address. Only literal addresses are
+     * accepted unless the system resolver may be asked.
+    */
+    static bool Lookup(CCStr host, CCStr port, struct sockaddr_storage & addr, socklen_t & len, bool ask = true);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Create a non-blocking socket connected to the specified address.
+    */
+    static Socket Connect(const struct sockaddr_storage & addr, socklen_t len, time_t timeout);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Send the request and read the response through the specified socket.
+    */
+    static bool Communicate(Socket sock, CCStr request, size_t size, Response & res);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Send the whole request through the specified socket.
+    */
+    static bool Send(Socket sock, CCStr request, size_t size);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Read the response through the specified socket. When more responses follow on the same
+     * connection, whatever was read past the end of this one is moved into the carry buffer, which
+     * also holds the start of this response on entry. (Response::BUFFER_SIZE bytes)
+    */
+    static bool Receive(Socket sock, Response & res, char * carry = nullptr, size_t * carried = nullptr);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Read the rest of a chunked body, of which the specified bytes were already received, and
+     * move whatever follows its last chunk into the carry buffer.
+    */
+    static bool ReceiveChunks(Socket sock, Response & res, int status, CCStr rest, size_t size,
+                                char * carry, size_t * carried);
+
+    /* ---------------------------------------------------------------------------------------------
+     * Sample the path quality of the specified connection and decide whether it degraded.
+    */
+    void Sample(Socket sock);
+
+    // ---------------------------------------------------------------------------------------------
+    String                                  m_Host; // Host name or numeric address to connect to.
+    String                                  m_Port; // Port to connect to.
+    time_t                                  m_Timeout; // Seconds to wait for a connection.
+    std::chrono::steady_clock::time_point   m_Resolved; // When the address was resolved.
+    struct sockaddr_storage                 m_Address; // The resolved address.
+    socklen_t                               m_AddressLen; // Size of the resolved address or 0.
+    PathStats                               m_Path; // Path quality of the connections.
+    std::unique_ptr< PendingLookup, LookupEnd > m_Lookup; // Lookup under way in the background, if any.
+    bool                                    m_LookupFailed; // Whether the last lookup in the background found nothing.
+};
+
+} // Namespace:: SMod
+
+#endif // _LIBRARY_TRANSPORT_HPP_
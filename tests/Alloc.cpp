@@ -0,0 +1,59 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdlib>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(AllocCount, "alloc.count")
+{
+    const AllocCounters before = ThreadAllocations();
+    void * volatile block = malloc(100);
+    const AllocCounters after = ThreadAllocations();
+    free(block);
+#ifdef SMOD_ALLOC_STATS
+    // Every allocation of this thread is counted, along with its size
+    SMOD_CHECK(after.mCount == before.mCount + 1);
+    SMOD_CHECK(after.mBytes >= before.mBytes + 100);
+#else
+    // Nothing is counted unless asked to
+    SMOD_CHECK(before.mCount == 0 && after.mCount == 0);
+#endif
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(AllocSteady, "alloc.steady")
+{
+    LoadOptions("Pipelining=false\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String &) {
+        MockReply reply;
+        reply.mHeaders = "Server: mock\r\nX-Padding: 0123456789\r\n";
+        reply.mBody = "ok";
+        return reply;
+    });
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/a").c_str());
+    announcer.AddMaster(master.Address("/b").c_str());
+    announcer.SetPayload(67000, 8192);
+    // The first cycles resolve the addresses and size the buffers
+    RunCycles(announcer, 2);
+    const AnnounceStats & stats = announcer.GetStats();
+    // Past that, announcing on healthy master-servers allocates nothing
+    for (unsigned n = 0; n < 3; ++n)
+    {
+        RunCycles(announcer, 1);
+        SMOD_CHECK(stats.mLastAllocations == 0 && stats.mLastAllocatedBytes == 0);
+    }
+    SMOD_CHECK(stats.mSuccesses == 10);
+#ifdef SMOD_ALLOC_STATS
+    SMOD_CHECK(stats.mAllocations > 0);
+#else
+    SMOD_CHECK(stats.mAllocations == 0);
+#endif
+}
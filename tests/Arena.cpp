@@ -0,0 +1,94 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdint>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(ArenaBlocks, "arena.blocks")
+{
+    Arena arena;
+    SMOD_CHECK(arena.GetReserved() == 0);
+    // Aligned as asked, one after the other
+    char * a = static_cast< char * >(arena.Allocate(3, 1));
+    void * b = arena.Allocate(8, 8);
+    SMOD_CHECK(reinterpret_cast< uintptr_t >(b) % 8 == 0);
+    SMOD_CHECK(static_cast< char * >(b) >= a + 3 && static_cast< char * >(b) < a + 16);
+    SMOD_CHECK(arena.GetUsed() >= 11 && arena.GetUsed() <= 16);
+    SMOD_CHECK(arena.GetReserved() == Arena::BLOCK_SIZE);
+    // Larger than a block gets a block of its own
+    arena.Allocate(Arena::BLOCK_SIZE * 2, 16);
+    const size_t reserved = arena.GetReserved();
+    const size_t high = arena.GetHighWater();
+    SMOD_CHECK(reserved >= Arena::BLOCK_SIZE * 3);
+    SMOD_CHECK(high >= Arena::BLOCK_SIZE * 2);
+    // A reset forgets the memory but keeps the blocks and the high-water mark
+    arena.Reset();
+    SMOD_CHECK(arena.GetUsed() == 0);
+    SMOD_CHECK(arena.GetReserved() == reserved);
+    SMOD_CHECK(arena.GetHighWater() == high);
+    SMOD_CHECK(arena.Allocate(3, 1) == a);
+    // The same workload doesn't need more blocks
+    arena.Allocate(8, 8);
+    arena.Allocate(Arena::BLOCK_SIZE * 2, 16);
+    SMOD_CHECK(arena.GetReserved() == reserved);
+    // Moving hands the blocks over
+    Arena other(std::move(arena));
+    SMOD_CHECK(other.GetReserved() == reserved && arena.GetReserved() == 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(ArenaContainers, "arena.containers")
+{
+    Arena arena;
+    const ArenaAllocator< char > alloc(arena);
+    ArenaString str(alloc);
+    // Standard containers grow inside the arena
+    str.assign(200, 'x');
+    SMOD_CHECK(arena.GetUsed() > 200);
+    std::vector< int, ArenaAllocator< int > > numbers{ArenaAllocator< int >(arena)};
+    for (int i = 0; i < 1000; ++i)
+    {
+        numbers.push_back(i);
+    }
+    SMOD_CHECK(numbers[999] == 999 && str.size() == 200);
+    SMOD_CHECK(arena.GetUsed() > 200 + 1000 * sizeof(int));
+    SMOD_CHECK(ArenaAllocator< int >(arena) == alloc);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(ArenaCycle, "arena.cycle")
+{
+    LoadOptions("Pipelining=false\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    const String target = master.Address("/moved");
+    master.SetHandler([target](const String & path) {
+        MockReply reply;
+        // Send announces on elsewhere, just this once
+        if (path == "/a")
+        {
+            reply.mStatus = 302;
+            reply.mHeaders = "Location: http://" + target + "\r\n";
+        }
+        return reply;
+    });
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/a").c_str());
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 1);
+    const AnnounceStats & stats = announcer.GetStats();
+    // The redirect bookkeeping lives in the arena of the cycle
+    SMOD_CHECK(master.Requests("/moved") == 1);
+    SMOD_CHECK(stats.mLastArena > 0);
+    SMOD_CHECK(stats.mArenaHighWater >= stats.mLastArena);
+    const uint64_t high = stats.mArenaHighWater;
+    // Each cycle starts with an empty arena, so it doesn't grow from one to the next
+    RunCycles(announcer, 3);
+    SMOD_CHECK(master.Requests("/moved") == 4);
+    SMOD_CHECK(stats.mArenaHighWater == high);
+}
@@ -0,0 +1,81 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(BenchUri, "bench.uri")
+{
+    // The address forms benchmarked by announce-bench
+    const URI host("master.vc-mp.org");
+    SMOD_CHECK(host.mHost == "master.vc-mp.org" && host.mPort == "80" && host.mPath == "/");
+    SMOD_CHECK(host.mFull == "http://master.vc-mp.org:80/" && host.mAddr == "master.vc-mp.org:80");
+    const URI full("http://master.vc-mp.org:8080/announce.php");
+    SMOD_CHECK(full.mHost == "master.vc-mp.org" && full.mPort == "8080" && full.mPath == "/announce.php");
+    SMOD_CHECK(full.mFull == "http://master.vc-mp.org:8080/announce.php");
+    // The scheme is only ever plain HTTP
+    SMOD_CHECK(URI("https://master.vc-mp.org/a").mFull == "http://master.vc-mp.org:80/a");
+    SMOD_CHECK(URI("").mHost.empty());
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(BenchQueue, "bench.queue")
+{
+    const String path = ScratchFile("stdout");
+    // Catch what the server frame outputs
+    if (!SMOD_CHECK(freopen(path.c_str(), "w", stdout) != nullptr))
+    {
+        return;
+    }
+    const String longer(3000, 'y');
+    // Nothing pending is nothing output
+    FlushMessages();
+    // The sizes benchmarked, with one longer than the formatting buffer
+    for (unsigned round = 0; round < 2; ++round)
+    {
+        MtOutputMessage("short %u", round);
+        MtOutputMessage("%s", String(128, 'x').c_str());
+        MtOutputMessage("%s", longer.c_str());
+        FlushMessages();
+    }
+    fflush(stdout);
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    const String out = text.str();
+    // Every message came out whole and in the order it was queued, once
+    const size_t first = out.find("short 0"), second = out.find("short 1");
+    SMOD_CHECK(first != String::npos && second != String::npos && first < second);
+    SMOD_CHECK(out.find(String(128, 'x')) > first && out.find(String(128, 'x')) < second);
+    SMOD_CHECK(out.find(longer) != String::npos && out.find(longer, second) != String::npos);
+    SMOD_CHECK(out.find("short 0", first + 1) == String::npos);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(BenchRequest, "bench.request")
+{
+    Server server(URI("http://master.vc-mp.org:80/announce.php"));
+    server.ConfigureServer(67000, 8192);
+    const String request = server.GetRequest();
+    // Encoding again gives the same request, nothing appended to the previous one
+    server.Encode();
+    server.Encode();
+    SMOD_CHECK(server.GetRequest() == request);
+    SMOD_CHECK(request.find("POST /announce.php HTTP/1.1\r\n") == 0);
+    SMOD_CHECK(request.find("\r\nVCMP-Version: 67000\r\n") != String::npos);
+    SMOD_CHECK(request.compare(request.size() - 13, 13, "\r\n\r\nport=8192") == 0);
+    // A new payload replaces the old one
+    server.ConfigureServer(67001, 8193);
+    const String again = server.GetRequest();
+    SMOD_CHECK(again.find("\r\nVCMP-Version: 67001\r\n") != String::npos);
+    SMOD_CHECK(again.find("VCMP-Version: 67000") == String::npos);
+    SMOD_CHECK(again.find("VCMP-Version", again.find("VCMP-Version") + 1) == String::npos);
+    SMOD_CHECK(again.find("User-Agent: VCMP/0.4\r\n") != String::npos);
+    SMOD_CHECK(again.compare(again.size() - 13, 13, "\r\n\r\nport=8193") == 0);
+}
@@ -0,0 +1,210 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <thread>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CoordinateTickets, "coordinate.tickets")
+{
+    const String path = ScratchFile("coord");
+    Coordinator a, b;
+    // Two instances on the same machine
+    SMOD_CHECK(a.Open(path.c_str()));
+    SMOD_CHECK(b.Open(path.c_str()));
+    const URI master("master.example.com/announce");
+    const URI other("other.example.com:8080/announce");
+    // Each instance receives a different slot on the same master-server
+    SMOD_CHECK(a.Ticket(master) == 0);
+    SMOD_CHECK(b.Ticket(master) == 1);
+    SMOD_CHECK(a.Ticket(master) == 2);
+    // Other master-servers hand out their own
+    SMOD_CHECK(b.Ticket(other) == 0);
+    // The path doesn't matter, only the host and port
+    SMOD_CHECK(b.Ticket(URI("master.example.com:80/elsewhere")) == 3);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CoordinateLongHost, "coordinate.long-host")
+{
+    const String path = ScratchFile("coord");
+    Coordinator a, b;
+    SMOD_CHECK(a.Open(path.c_str()));
+    SMOD_CHECK(b.Open(path.c_str()));
+    // Longer than what the shared entry keeps of it
+    const String host = String(150, 'm') + ".example.com";
+    const URI master(host.c_str());
+    const URI similar((String(150, 'm') + ".example.net").c_str());
+    SMOD_CHECK(master.mAddr.size() > sizeof(SharedMaster::mHost));
+    // The same entry is found every time
+    SMOD_CHECK(a.Ticket(master) == 0);
+    SMOD_CHECK(b.Ticket(master) == 1);
+    SMOD_CHECK(a.Ticket(master) == 2);
+    // An address that only differs past what is kept still has an entry of its own
+    SMOD_CHECK(a.Ticket(similar) == 0);
+    SMOD_CHECK(b.Ticket(master) == 3);
+    // Failures are shared through it too
+    for (uint32_t n = 0; n < Coordinator::DOWN_AFTER; ++n)
+    {
+        a.Report(master, false);
+    }
+    SMOD_CHECK(b.IsDown(master));
+    SMOD_CHECK(!b.IsDown(similar));
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CoordinateDown, "coordinate.down")
+{
+    LoadOptions("UpdateInterval=1\nMaxInterval=1\n");
+    const String path = ScratchFile("coord");
+    Coordinator a, b;
+    SMOD_CHECK(a.Open(path.c_str()));
+    SMOD_CHECK(b.Open(path.c_str()));
+    const URI master("master.example.com/announce");
+    // A few failures aren't enough
+    for (uint32_t n = 1; n < Coordinator::DOWN_AFTER; ++n)
+    {
+        a.Report(master, false);
+    }
+    SMOD_CHECK(!b.IsDown(master));
+    // One more and everyone leaves it alone
+    b.Report(master, false);
+    SMOD_CHECK(a.IsDown(master));
+    SMOD_CHECK(b.IsDown(master));
+    // Once the wait is over, only one instance gets to probe it
+    std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+    SMOD_CHECK(!a.IsDown(master));
+    SMOD_CHECK(b.IsDown(master));
+    // Until it answers
+    a.Report(master, true);
+    SMOD_CHECK(!a.IsDown(master));
+    SMOD_CHECK(!b.IsDown(master));
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CoordinateResolve, "coordinate.resolve")
+{
+    const String path = ScratchFile("coord");
+    Coordinator a, b;
+    SMOD_CHECK(a.Open(path.c_str()));
+    SMOD_CHECK(b.Open(path.c_str()));
+    String host;
+    SMOD_CHECK(a.Resolve(URI("localhost:8192/"), host));
+    SMOD_CHECK(host == "127.0.0.1" || host == "::1");
+    // The other instance uses what the first one resolved
+    String shared;
+    SMOD_CHECK(b.Resolve(URI("localhost:8192/"), shared));
+    SMOD_CHECK(shared == host);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CoordinateRecover, "coordinate.recover")
+{
+    const String path = ScratchFile("coord");
+    LoadOptions(("UpdateInterval=1\nMaxInterval=1\nCoordinate=" + path + "\n").c_str());
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/").c_str());
+    announcer.SetPayload(0x5A, 8192);
+    RunCycles(announcer, 1);
+    SMOD_CHECK(announcer.GetStats().mSuccesses == 1);
+    // The master-server goes away long enough to be considered down
+    master.Stop();
+    RunCycles(announcer, Coordinator::DOWN_AFTER);
+    SMOD_CHECK(announcer.GetStats().mFailures == Coordinator::DOWN_AFTER);
+    RunCycles(announcer, 1);
+    SMOD_CHECK(announcer.GetStats().mSkipped == 1);
+    // Then comes back, which the probe finds out
+    SMOD_CHECK(master.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+    RunCycles(announcer, 2);
+    SMOD_CHECK(announcer.GetStats().mSuccesses == 3);
+    SMOD_CHECK(master.Requests("/") == 3);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Stop the master-server until the coordinator considers it down, then start it again and return
+ * how many announces were accepted once the probe was allowed.
+*/
+static uint64_t RecoverFromDown(MockMaster & master, Announcer & announcer)
+{
+    const AnnounceStats & stats = announcer.GetStats();
+    master.Stop();
+    // Fail until every instance is told to leave it alone
+    for (uint32_t n = 0; n <= Coordinator::DOWN_AFTER && stats.mSkipped == 0; ++n)
+    {
+        RunCycles(announcer, 1);
+    }
+    SMOD_CHECK(stats.mSkipped > 0);
+    SMOD_CHECK(master.Start());
+    std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+    const uint64_t before = stats.mSuccesses;
+    RunCycles(announcer, 2);
+    return stats.mSuccesses - before;
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CoordinatePipeline, "coordinate.pipeline")
+{
+    const String path = ScratchFile("coord");
+    LoadOptions(("UpdateInterval=1\nMaxInterval=1\nPipelining=true\nCoordinate=" + path + "\n").c_str());
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/a").c_str());
+    announcer.AddMaster(master.Address("/b").c_str());
+    announcer.SetPayload(0x5A, 8192);
+    RunCycles(announcer, 1);
+    SMOD_CHECK(announcer.GetStats().mPipelines == 1 && announcer.GetStats().mSuccesses == 2);
+    // The announces sent along with the probe are taken for its answer, and it comes back
+    SMOD_CHECK(RecoverFromDown(master, announcer) == 4);
+    SMOD_CHECK(announcer.GetStats().mPipelines >= 2);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Announce on a coordinated master-server through the specified engine while it goes down and
+ * comes back.
+*/
+static void RecoverThrough(CCStr engine)
+{
+    const String path = ScratchFile("coord");
+    LoadOptions(("UpdateInterval=1\nMaxInterval=1\nEngine=" + String(engine) + "\nCoordinate=" + path + "\n").c_str());
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/").c_str());
+    announcer.SetPayload(0x5A, 8192);
+    RunCycles(announcer, 1);
+    SMOD_CHECK(announcer.GetStats().mSuccesses == 1);
+    // The announce handed to the engine is the probe, and its answer is used
+    SMOD_CHECK(RecoverFromDown(master, announcer) == 2);
+    SMOD_CHECK(master.Requests("/") == 3);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CoordinateEpoll, "coordinate.epoll")
+{
+    RecoverThrough("epoll");
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CoordinateUring, "coordinate.io_uring")
+{
+    // Falls back to epoll where the kernel doesn't have it
+    RecoverThrough("io_uring");
+}
+
+#ifdef SMOD_COROUTINES
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CoordinateCoroutine, "coordinate.coroutine")
+{
+    RecoverThrough("coroutine");
+}
+
+#endif // SMOD_COROUTINES
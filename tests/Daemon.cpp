@@ -0,0 +1,183 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <signal.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+/* ------------------------------------------------------------------------------------------------
+ * Connect to the daemon listening on the specified path, waiting for it to start. Returns -1 if it
+ * never did.
+*/
+static int ConnectDaemon(const String & path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path.c_str());
+    int sock = -1;
+    // Keep trying while the daemon starts up
+    WaitFor([&]() {
+        sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(sock, reinterpret_cast< struct sockaddr * >(&addr), sizeof(addr)) == 0)
+        {
+            return true;
+        }
+        close(sock);
+        sock = -1;
+        return false;
+    }, 5000);
+    return sock;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Send the specified commands to the daemon and read one line of reply.
+*/
+static String Talk(int sock, const String & commands)
+{
+    if (send(sock, commands.data(), commands.size(), MSG_NOSIGNAL) != static_cast< ssize_t >(commands.size()))
+    {
+        return String();
+    }
+    String line;
+    char c = 0;
+    // Read until the end of the line or the connection
+    while (recv(sock, &c, 1, 0) == 1 && c != '\n')
+    {
+        line.push_back(c);
+    }
+    return line;
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(DaemonRegister, "daemon.register")
+{
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    const String sock = ScratchFile("sock");
+    const int pid = Spawn({SMOD_DAEMON_PATH, "-s", sock});
+    const int link = ConnectDaemon(sock);
+    if (!SMOD_CHECK(link >= 0))
+    {
+        Reap(pid, 0);
+        return;
+    }
+    // A game server registers itself and its master-servers
+    SMOD_CHECK(Talk(link, "ANNOUNCE 1\nVERSION 90\nPORT 8192\nMASTER " + master.Address("/a") + "\nMASTER " +
+                            master.Address("/b") + "\nCOMMIT\n") == "OK 2");
+    // The daemon announces on its behalf
+    SMOD_CHECK(WaitFor([&]() { return master.Requests("/a") == 1 && master.Requests("/b") == 1; }, 5000));
+    SMOD_CHECK(master.Last().find("port=8192") != String::npos);
+    SMOD_CHECK(master.Last().find("VCMP-Version: 90\r\n") != String::npos);
+    // Mistakes are pointed out without dropping the game server
+    SMOD_CHECK(Talk(link, "FROB 1\n") == "ERROR unknown command FROB");
+    SMOD_CHECK(Talk(link, "ANNOUNCE 1\nPORT 8193\nMASTER " + master.Address("/c") + "\nCOMMIT\n") == "OK 1");
+    SMOD_CHECK(WaitFor([&]() { return master.Requests("/c") == 1; }, 5000));
+    close(link);
+    // Asked to stop, it goes away cleanly and takes the socket with it
+    kill(pid, SIGTERM);
+    SMOD_CHECK(Reap(pid, 5000) == 0);
+    SMOD_CHECK(access(sock.c_str(), F_OK) != 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(DaemonProtocol, "daemon.protocol")
+{
+    const String sock = ScratchFile("sock");
+    const int pid = Spawn({SMOD_DAEMON_PATH, "-s", sock});
+    int link = ConnectDaemon(sock);
+    if (!SMOD_CHECK(link >= 0))
+    {
+        Reap(pid, 0);
+        return;
+    }
+    // Commands before the greeting are refused and the game server is dropped
+    SMOD_CHECK(Talk(link, "PORT 8192\n") == "ERROR expected ANNOUNCE");
+    SMOD_CHECK(Talk(link, "ANNOUNCE 1\n").empty());
+    close(link);
+    // So is a plug-in that speaks another version of the protocol
+    link = ConnectDaemon(sock);
+    SMOD_CHECK(Talk(link, "ANNOUNCE 99\n") == "ERROR unsupported protocol version 99");
+    close(link);
+    kill(pid, SIGTERM);
+    SMOD_CHECK(Reap(pid, 5000) == 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(DaemonConcurrent, "daemon.concurrent")
+{
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String & path) {
+        MockReply reply;
+        reply.mDelay = path == "/slow" ? 3000 : 0;
+        return reply;
+    });
+    const String sock = ScratchFile("sock");
+    const int pid = Spawn({SMOD_DAEMON_PATH, "-s", sock});
+    const int link = ConnectDaemon(sock);
+    if (!SMOD_CHECK(link >= 0))
+    {
+        Reap(pid, 0);
+        return;
+    }
+    SMOD_CHECK(Talk(link, "ANNOUNCE 1\nPORT 8192\nMASTER " + master.Address("/slow") + "\nMASTER " +
+                            master.Address("/fast") + "\nCOMMIT\n") == "OK 2");
+    // A master-server that takes its time doesn't hold up the ones after it
+    SMOD_CHECK(WaitFor([&]() { return master.Requests("/fast") == 1; }, 1500));
+    close(link);
+    kill(pid, SIGTERM);
+    SMOD_CHECK(Reap(pid, 10000) == 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(DaemonSocket, "daemon.socket")
+{
+    const String sock = ScratchFile("sock");
+    // Something that isn't a socket is left alone
+    FILE * fp = fopen(sock.c_str(), "w");
+    if (fp)
+    {
+        fclose(fp);
+    }
+    SMOD_CHECK(Reap(Spawn({SMOD_DAEMON_PATH, "-s", sock}), 5000) > 0);
+    SMOD_CHECK(access(sock.c_str(), F_OK) == 0);
+    unlink(sock.c_str());
+    const int pid = Spawn({SMOD_DAEMON_PATH, "-s", sock});
+    const int link = ConnectDaemon(sock);
+    if (!SMOD_CHECK(link >= 0))
+    {
+        Reap(pid, 0);
+        return;
+    }
+    // Only the owner and group of the daemon may connect
+    struct stat st;
+    SMOD_CHECK(stat(sock.c_str(), &st) == 0 && (st.st_mode & 0777) == 0660);
+    // A second daemon doesn't take the socket from the one listening on it
+    SMOD_CHECK(Reap(Spawn({SMOD_DAEMON_PATH, "-s", sock}), 5000) > 0);
+    SMOD_CHECK(Talk(link, "ANNOUNCE 1\nPORT 8192\nCOMMIT\n") == "OK 0");
+    close(link);
+    kill(pid, SIGTERM);
+    SMOD_CHECK(Reap(pid, 5000) == 0);
+    // While one left behind by a daemon that is gone is replaced
+    const int stale = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sock.c_str());
+    SMOD_CHECK(bind(stale, reinterpret_cast< struct sockaddr * >(&addr), sizeof(addr)) == 0);
+    close(stale);
+    const int again = Spawn({SMOD_DAEMON_PATH, "-s", sock});
+    const int relink = ConnectDaemon(sock);
+    SMOD_CHECK(relink >= 0);
+    close(relink);
+    kill(again, SIGTERM);
+    SMOD_CHECK(Reap(again, 5000) == 0);
+}
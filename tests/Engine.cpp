@@ -0,0 +1,64 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+/* ------------------------------------------------------------------------------------------------
+ * Announce through the specified engine on master-servers that answer every way they can. The
+ * engine is expected to send an announce that got no answer the specified number of times.
+*/
+static void AnnounceThrough(CCStr engine, unsigned tries)
+{
+    LoadOptions(("Engine=" + String(engine) + "\n").c_str());
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String & path) {
+        MockReply reply;
+        reply.mStatus = path == "/bad" ? 500 : 200;
+        reply.mBody = "answer to " + path;
+        reply.mChunked = path == "/chunked";
+        reply.mDrop = path == "/drop";
+        return reply;
+    });
+    Announcer announcer;
+    for (CCStr path : {"/ok", "/bad", "/chunked", "/drop"})
+    {
+        announcer.AddMaster(master.Address(path).c_str());
+    }
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 2);
+    const AnnounceStats & stats = announcer.GetStats();
+    // Each one was sent once per cycle, all at the same time, and tried again if that's what the engine does
+    SMOD_CHECK(master.Requests("/ok") == 2 && master.Requests("/bad") == 2 && master.Requests("/chunked") == 2);
+    SMOD_CHECK(master.Requests("/drop") == 2 * tries && master.Connections() == 6 + 2 * tries);
+    SMOD_CHECK(stats.mSuccesses == 4 && stats.mFailures == 4);
+    const MasterTable & table = announcer.GetTable();
+    // And each answer went to the master-server it came from
+    SMOD_CHECK(table.mFails[0] == 0 && table.mFails[1] == 2 && table.mFails[2] == 0 && table.mFails[3] == 2);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(EngineEpoll, "engine.epoll")
+{
+    AnnounceThrough("epoll", 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(EngineUring, "engine.io_uring")
+{
+    // Falls back to epoll where the kernel doesn't have it
+    AnnounceThrough("io_uring", 1);
+}
+
+#ifdef SMOD_COROUTINES
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(EngineCoroutine, "engine.coroutine")
+{
+    // Announces that got no answer are tried twice more
+    AnnounceThrough("coroutine", 3);
+}
+
+#endif // SMOD_COROUTINES
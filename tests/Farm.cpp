@@ -0,0 +1,89 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "MockFarm.hpp"
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FarmBehaviors, "farm.behaviors")
+{
+    FarmOptions options;
+    options.mMasters = 200;
+    options.mSeed = 7;
+    options.mReset = 20;
+    options.mDrip = 30;
+    options.mBlackhole = 10;
+    MockFarm farm(options), again(options);
+    unsigned counts[4] = {0, 0, 0, 0};
+    // The same seed always gives the same farm
+    for (unsigned id = 0; id < farm.Count(); ++id)
+    {
+        SMOD_CHECK(farm.GetKind(id) == again.GetKind(id));
+        ++counts[farm.GetKind(id)];
+    }
+    // Roughly in the configured proportions
+    SMOD_CHECK(farm.Count() == 200);
+    SMOD_CHECK(counts[MockFarm::Reset] > 20 && counts[MockFarm::Reset] < 60);
+    SMOD_CHECK(counts[MockFarm::SlowDrip] > 40 && counts[MockFarm::SlowDrip] < 80);
+    SMOD_CHECK(counts[MockFarm::Blackhole] > 5 && counts[MockFarm::Blackhole] < 40);
+    // Each master-server has a path of its own
+    SMOD_CHECK(farm.Address(42).compare(farm.Address(42).size() - 5, 5, "/m/42") == 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FarmAnnounce, "farm.announce")
+{
+    // Every mock master-server stands for a host of its own even though they share a port
+    LoadOptions("Pipelining=false\n");
+    FarmOptions options;
+    options.mMasters = 24;
+    options.mReset = 25;
+    options.mDrip = 25;
+    options.mDripBytes = 4;
+    options.mDripDelay = 10;
+    MockFarm farm(options);
+    if (!SMOD_CHECK(farm.Start()))
+    {
+        return;
+    }
+    Announcer announcer;
+    unsigned resets = 0;
+    for (unsigned id = 0; id < farm.Count(); ++id)
+    {
+        announcer.AddMaster(farm.Address(id).c_str());
+        resets += farm.GetKind(id) == MockFarm::Reset ? 1 : 0;
+    }
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 1);
+    // Slow bodies still get through, resets never do
+    SMOD_CHECK(resets > 0 && resets < farm.Count());
+    SMOD_CHECK(farm.Received() == farm.Count() - resets);
+    SMOD_CHECK(announcer.GetStats().mSuccesses == farm.Count() - resets);
+    SMOD_CHECK(announcer.GetStats().mFailures == resets);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FarmStatus, "farm.status")
+{
+    LoadOptions("Pipelining=false\n");
+    FarmOptions options;
+    options.mMasters = 8;
+    options.mStatus = "500=1,403=1,nonsense";
+    MockFarm farm(options);
+    if (!SMOD_CHECK(farm.Start()))
+    {
+        return;
+    }
+    Announcer announcer;
+    for (unsigned id = 0; id < farm.Count(); ++id)
+    {
+        announcer.AddMaster(farm.Address(id).c_str());
+    }
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 1);
+    // Refused everywhere, and nothing but the configured codes are answered with
+    SMOD_CHECK(farm.Received() == 8);
+    SMOD_CHECK(announcer.GetStats().mSuccesses == 0);
+    SMOD_CHECK(announcer.GetStats().mFailures == 8);
+}
@@ -0,0 +1,172 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+#include "Flight.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <vector>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+/* ------------------------------------------------------------------------------------------------
+ * Load the whole flight recorder file at the specified path, the way flight-dump reads it.
+*/
+static std::vector< char > LoadFlight(const String & path)
+{
+    std::vector< char > data;
+    FILE * fp = fopen(path.c_str(), "rb");
+    // Was there anything to read?
+    if (!fp)
+    {
+        return data;
+    }
+    char chunk[65536];
+    for (size_t n; (n = fread(chunk, 1, sizeof(chunk), fp)) > 0;)
+    {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(fp);
+    return data;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Retrieve the event recorded with the specified sequence number from a loaded file.
+*/
+static const FlightEvent & EventAt(const std::vector< char > & data, uint64_t seq)
+{
+    const FlightHeader & header = *reinterpret_cast< const FlightHeader * >(data.data());
+    const FlightEvent * events = reinterpret_cast< const FlightEvent * >(data.data() + FlightHeader::EVENTS_OFFSET);
+    return events[seq % header.mCapacity];
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FlightRing, "flight.ring")
+{
+    const String path = ScratchFile("flight");
+    FlightRecorder flight;
+    // Nothing is recorded before it's opened
+    SMOD_CHECK(!flight.IsOpen() && flight.Master("a") == FlightRecorder::NO_MASTER);
+    flight.Record(0, FlightSkip);
+    SMOD_CHECK(flight.Open(path.c_str(), 1500));
+    // Each address gets an index of its own, and keeps it
+    const uint16_t a = flight.Master("a.example.com:80/announce");
+    const uint16_t b = flight.Master("b.example.com:80/announce");
+    SMOD_CHECK(a == 0 && b == 1 && flight.Master("a.example.com:80/announce") == a);
+    // Go around the ring once and a bit
+    const uint64_t total = 2048 + 10;
+    for (uint64_t i = 0; i < total; ++i)
+    {
+        flight.Record(i % 2 ? b : a, FlightResponse, 200 + static_cast< int >(i % 100), static_cast< uint32_t >(i));
+    }
+    std::vector< char > data = LoadFlight(path);
+    if (!SMOD_CHECK(data.size() == FlightHeader::EVENTS_OFFSET + 2048 * sizeof(FlightEvent)))
+    {
+        return;
+    }
+    const FlightHeader & header = *reinterpret_cast< const FlightHeader * >(data.data());
+    // Room was rounded up to a power of two
+    SMOD_CHECK(header.mMagic == FlightHeader::MAGIC && header.mVersion == FlightHeader::VERSION);
+    SMOD_CHECK(header.mCapacity == 2048 && header.mEventSize == sizeof(FlightEvent));
+    SMOD_CHECK(header.mHead.load() == total && header.mMasterCount == 2);
+    SMOD_CHECK(strcmp(header.mMasters[b], "b.example.com:80/announce") == 0);
+    // Only the last lap is left, each event in its slot
+    for (uint64_t seq = total - 2048; seq < total; ++seq)
+    {
+        const FlightEvent & ev = EventAt(data, seq);
+        SMOD_CHECK(ev.mSeq == seq + 1 && ev.mLatency == seq && ev.mMaster == (seq % 2 ? b : a));
+        SMOD_CHECK(ev.mPhase == FlightResponse && ev.mStatus == 200 + seq % 100);
+    }
+    // The next run keeps what was recorded, and the indexes of the master-servers
+    flight.Close();
+    SMOD_CHECK(flight.Open(path.c_str(), 2048));
+    SMOD_CHECK(flight.Master("b.example.com:80/announce") == b);
+    flight.Record(b, FlightSkip);
+    flight.Close();
+    data = LoadFlight(path);
+    SMOD_CHECK(reinterpret_cast< const FlightHeader * >(data.data())->mHead.load() == total + 1);
+    SMOD_CHECK(EventAt(data, total).mSeq == total + 1 && EventAt(data, total).mPhase == FlightSkip);
+    SMOD_CHECK(EventAt(data, total - 1).mSeq == total);
+    // Unless it was asked for a different room
+    SMOD_CHECK(flight.Open(path.c_str(), 4096));
+    flight.Close();
+    data = LoadFlight(path);
+    SMOD_CHECK(reinterpret_cast< const FlightHeader * >(data.data())->mHead.load() == 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FlightAnnounce, "flight.announce")
+{
+    const String path = ScratchFile("flight");
+    LoadOptions(("Pipelining=false\nFlight=" + path + "\nFlightEvents=1024\n").c_str());
+    SMOD_CHECK(g_Flight.IsOpen());
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String & p) {
+        MockReply reply;
+        reply.mStatus = p == "/bad" ? 500 : 200;
+        return reply;
+    });
+    {
+        Announcer announcer;
+        announcer.AddMaster(master.Address("/ok").c_str());
+        announcer.AddMaster(master.Address("/bad").c_str());
+        announcer.SetPayload(67000, 8192);
+        RunCycles(announcer, 2);
+    }
+    g_Flight.Close();
+    const std::vector< char > data = LoadFlight(path);
+    if (!SMOD_CHECK(data.size() > FlightHeader::EVENTS_OFFSET))
+    {
+        return;
+    }
+    const FlightHeader & header = *reinterpret_cast< const FlightHeader * >(data.data());
+    SMOD_CHECK(header.mMasterCount == 2 && header.mHead.load() >= 4);
+    // Every announce ended in an event with what the master-server answered
+    unsigned ok = 0, bad = 0;
+    for (uint64_t seq = 0; seq < header.mHead.load(); ++seq)
+    {
+        const FlightEvent & ev = EventAt(data, seq);
+        SMOD_CHECK(ev.mSeq == seq + 1 && ev.mMaster < 2);
+        // Only the ends of the announces are counted
+        if (ev.mPhase != FlightResponse)
+        {
+            continue;
+        }
+        const bool is_bad = strstr(header.mMasters[ev.mMaster], "/bad") != nullptr;
+        SMOD_CHECK(ev.mStatus == (is_bad ? 500 : 200) && ev.mLatency > 0);
+        ++(is_bad ? bad : ok);
+    }
+    SMOD_CHECK(ok == 2 && bad == 2);
+#ifdef SMOD_FLIGHT_DUMP_PATH
+    // And it can be read back by the tool
+    FILE * out = popen((String(SMOD_FLIGHT_DUMP_PATH) + " -j " + path + " 2>/dev/null").c_str(), "r");
+    if (!SMOD_CHECK(out != nullptr))
+    {
+        return;
+    }
+    String text;
+    char chunk[4096];
+    for (size_t n; (n = fread(chunk, 1, sizeof(chunk), out)) > 0;)
+    {
+        text.append(chunk, n);
+    }
+    SMOD_CHECK(pclose(out) == 0);
+    SMOD_CHECK(text.find("\"phase\":\"response\",\"status\":500") != String::npos);
+    SMOD_CHECK(text.find("\"phase\":\"response\",\"status\":200") != String::npos);
+#endif // SMOD_FLIGHT_DUMP_PATH
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FlightDefaults, "flight.defaults")
+{
+    SMOD_CHECK(LoadShippedOptions());
+    // The recorder is always on, there's no telling in advance which announce will need explaining
+    SMOD_CHECK(g_Flight.IsOpen());
+    g_Flight.Close();
+    remove("announce.flight");
+}
@@ -0,0 +1,135 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <sys/stat.h>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+/* ------------------------------------------------------------------------------------------------
+ * Step the announcer the way server frames would until a whole cycle was done or time ran out.
+*/
+static bool StepCycle(Announcer & announcer, unsigned budget)
+{
+    const uint64_t cycles = announcer.GetStats().mCycles;
+    return WaitFor([&]() {
+        announcer.Step(budget);
+        return announcer.GetStats().mCycles > cycles;
+    }, 10000);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FrameRefuse, "frame.refuse")
+{
+    const String coord = ScratchFile("coord"), trace = ScratchFile("trace");
+    LoadOptions(("FrameBudget=2000\nCoordinate=" + coord + "\nCapture=" + trace + "\n").c_str());
+    struct stat st;
+    // Neither would be safe to wait on from a server frame
+    SMOD_CHECK(!g_Coordinator.IsOpen() && stat(coord.c_str(), &st) != 0);
+    SMOD_CHECK(!g_Recorder.IsOpen() && stat(trace.c_str(), &st) != 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FrameStep, "frame.step")
+{
+    LoadOptions("FrameBudget=2000\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    const String target = master.Address("/new");
+    master.SetHandler([target](const String & path) {
+        MockReply reply;
+        reply.mStatus = path == "/bad" ? 500 : 200;
+        // Redirects are followed on a later frame
+        if (path == "/old")
+        {
+            reply.mStatus = 302;
+            reply.mHeaders = "Location: http://" + target + "\r\n";
+        }
+        return reply;
+    });
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/ok").c_str());
+    announcer.AddMaster(master.Address("/bad").c_str());
+    announcer.AddMaster(master.Address("/old").c_str());
+    announcer.SetPayload(67000, 8192);
+    SMOD_CHECK(StepCycle(announcer, 2000));
+    const AnnounceStats & stats = announcer.GetStats();
+    // Every announce was made without a thread
+    SMOD_CHECK(master.Requests("/ok") == 1 && master.Requests("/bad") == 1 && master.Requests("/old") == 1);
+    SMOD_CHECK(stats.mSuccesses == 1 && stats.mFailures == 1 && stats.mSteps > 1);
+    // The redirect is followed right after, on frames of its own
+    SMOD_CHECK(master.Requests("/new") == 0);
+    SMOD_CHECK(StepCycle(announcer, 2000));
+    SMOD_CHECK(master.Requests("/old") == 1 && master.Requests("/new") == 1);
+    SMOD_CHECK(stats.mSuccesses == 2 && stats.mFailures == 1);
+    // Nothing more is sent until it's due again
+    for (unsigned n = 0; n < 10; ++n)
+    {
+        announcer.Step(2000);
+    }
+    SMOD_CHECK(master.Requests() == 4);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FrameEngine, "frame.engine")
+{
+    LoadOptions("FrameBudget=2000\nEngine=coroutine\n");
+    Announcer announcer;
+    announcer.AddMaster("127.0.0.1:8192/announce");
+    announcer.SetPayload(67000, 8192);
+    // The coroutines don't stop when the frame's time is up, so the engine that does is used instead
+    SMOD_CHECK(announcer.GetEngine() && strcmp(announcer.GetEngine()->Name(), "epoll") == 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FrameResolve, "frame.resolve")
+{
+    LoadOptions("FrameBudget=2000\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    // Announce on it by name instead of a literal address
+    String named = master.Address("/named");
+    named.replace(0, named.find(':'), "localhost");
+    Announcer announcer;
+    announcer.AddMaster(named.c_str());
+    announcer.SetPayload(67000, 8192);
+    const AnnounceStats & stats = announcer.GetStats();
+    announcer.Step(2000);
+#ifdef __GLIBC__
+    // The first frame only starts looking up the name, it doesn't wait on it
+    SMOD_CHECK(master.Requests("/named") == 0 && stats.mAnnounces == 0);
+#endif // __GLIBC__
+    // Once it's known, the announce goes out like any other
+    SMOD_CHECK(WaitFor([&]() {
+        announcer.Step(2000);
+        return stats.mAnnounces == 1;
+    }, 5000));
+    SMOD_CHECK(master.Requests("/named") == 1 && stats.mSuccesses == 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(FrameStale, "frame.stale")
+{
+    Transport transport;
+    transport.SetTarget("localhost", "8192");
+    socklen_t len = 0;
+    // Wait for the name to be looked up in the background
+    SMOD_CHECK(WaitFor([&]() { return transport.Prefetch(); }, 5000));
+    SMOD_CHECK(transport.Address(len) != nullptr && len > 0);
+    // A failed exchange has the name looked up again, the last good address is used meanwhile
+    transport.Conclude(Transport::NO_SOCKET, false);
+    SMOD_CHECK(transport.Prefetch());
+    len = 0;
+    SMOD_CHECK(transport.Address(len) != nullptr && len > 0);
+    SMOD_CHECK(WaitFor([&]() {
+        int64_t age = -1;
+        uint8_t addr[sizeof(struct sockaddr_storage)];
+        transport.Prefetch();
+        return transport.ExportAddress(addr, sizeof(addr), age) > 0 && age < Transport::RESOLVE_TTL;
+    }, 5000));
+    // Literal addresses are never looked up at all
+    transport.SetTarget("127.0.0.1", "8192");
+    SMOD_CHECK(transport.Prefetch());
+}
@@ -0,0 +1,177 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+/* ------------------------------------------------------------------------------------------------
+ * Start a master-server whose /slow mirror takes longer to answer than a mirror is given by
+ * default before hedging, and announce on it along with its /fast mirror.
+*/
+static void AnnounceOnMirrors(MockMaster & master, Announcer & announcer)
+{
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String & path) {
+        MockReply reply;
+        reply.mDelay = path == "/slow" ? MirrorGroup::HEDGE_DEFAULT / 1000 + 300 : 0;
+        return reply;
+    });
+    announcer.AddMaster((master.Address("/slow") + " " + master.Address("/fast")).c_str());
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 1);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Make a group of the specified number of mirrors that nothing is known about yet, the way the
+ * announcer does.
+*/
+static MirrorGroup MakeGroup(size_t count)
+{
+    MirrorGroup group;
+    for (size_t i = 0; i < count; ++i)
+    {
+        MirrorGroup::Member member{};
+        member.mIndex = i;
+        member.mSuccess = 1.0;
+        group.mMembers.push_back(member);
+    }
+    group.mOrder.resize(count);
+    group.mTried.resize(count);
+    group.mCycles = 1;
+    return group;
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(HedgeOff, "hedge.off")
+{
+    LoadOptions("Pipelining=false\n");
+    MockMaster master;
+    Announcer announcer;
+    AnnounceOnMirrors(master, announcer);
+    // Unless asked for, the slow mirror is simply waited for
+    SMOD_CHECK(master.Requests("/slow") == 1 && master.Requests("/fast") == 0);
+    SMOD_CHECK(announcer.GetStats().mHedged == 0 && announcer.GetStats().mSuccesses == 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(HedgeLoser, "hedge.loser")
+{
+    LoadOptions("Pipelining=false\nHedging=true\n");
+    MockMaster master;
+    Announcer announcer;
+    AnnounceOnMirrors(master, announcer);
+    const AnnounceStats & stats = announcer.GetStats();
+    // The next best mirror was raced against the slow one and won
+    SMOD_CHECK(master.Requests("/slow") == 1 && master.Requests("/fast") == 1);
+    SMOD_CHECK(stats.mHedged == 1 && stats.mHedgeWins == 1 && stats.mSuccesses == 1);
+    const MirrorGroup & group = announcer.GetGroups()[0];
+    SMOD_CHECK(group.mMembers[1].mSamples == 1 && group.mMembers[1].mSuccess == 1.0);
+    // The slow one never answered, so it isn't taken for a success
+    SMOD_CHECK(group.mMembers[0].mSamples == 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(HedgeDefaults, "hedge.defaults")
+{
+    SMOD_CHECK(LoadShippedOptions());
+    // Mirrors are only raced against each other when asked for
+    SMOD_CHECK(!g_Hedging);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(HedgeRank, "hedge.rank")
+{
+    MirrorGroup group = MakeGroup(3);
+    // Until something is known, the mirrors are tried in the order they were specified
+    group.Rank();
+    SMOD_CHECK(group.mOrder[0] == 0 && group.mOrder[1] == 1 && group.mOrder[2] == 2);
+    // The first observation replaces the guess
+    group.Observe(0, 5000, true);
+    group.Observe(1, 1000, true);
+    group.Observe(2, 500, false);
+    SMOD_CHECK(group.mMembers[1].mLatency == 1000.0 && group.mMembers[2].mSuccess == 0.0);
+    // Fast but failing is worth less than slower but reliable
+    group.Rank();
+    SMOD_CHECK(group.mOrder[0] == 1 && group.mOrder[1] == 0 && group.mOrder[2] == 2);
+    // Later ones move the averages only part of the way
+    group.Observe(1, 2000, false);
+    SMOD_CHECK(group.mMembers[1].mLatency > 1199.0 && group.mMembers[1].mLatency < 1201.0);
+    SMOD_CHECK(group.mMembers[1].mSuccess > 0.79 && group.mMembers[1].mSuccess < 0.81);
+    SMOD_CHECK(group.mMembers[1].mSamples == 2);
+    // 1200 / 0.8 is still ahead of 5000 / 1
+    group.Rank();
+    SMOD_CHECK(group.mOrder[0] == 1 && group.mOrder[1] == 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(HedgeP95, "hedge.p95")
+{
+    MirrorGroup group = MakeGroup(1);
+    // Too few samples to trust, so the default is used
+    for (uint32_t i = 1; i < MirrorGroup::HEDGE_SAMPLES; ++i)
+    {
+        group.Observe(0, i * 100, true);
+    }
+    SMOD_CHECK(group.P95(0) == MirrorGroup::HEDGE_DEFAULT);
+    // Then the 95th percentile of what was seen
+    for (uint32_t i = MirrorGroup::HEDGE_SAMPLES; i <= 20; ++i)
+    {
+        group.Observe(0, i * 100, true);
+    }
+    SMOD_CHECK(group.P95(0) == 1900);
+    // Only the most recent latencies count
+    for (size_t i = 0; i < MirrorGroup::HISTORY; ++i)
+    {
+        group.Observe(0, 50, true);
+    }
+    SMOD_CHECK(group.P95(0) == 50);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(HedgeProbe, "hedge.probe")
+{
+    MirrorGroup group = MakeGroup(3);
+    group.Observe(0, 100, true);
+    group.Observe(1, 200, true);
+    group.Observe(2, 300, true);
+    group.mMembers[0].mLastUsed = 19;
+    group.mMembers[1].mLastUsed = 18;
+    group.mMembers[2].mLastUsed = 3;
+    // Between probes, the best one goes first
+    group.mCycles = MirrorGroup::PROBE_EVERY - 1;
+    group.Rank();
+    SMOD_CHECK(group.mOrder[0] == 0 && group.mOrder[1] == 1 && group.mOrder[2] == 2);
+    // Every so often, the one that went the longest without an announce goes first instead
+    group.mCycles = MirrorGroup::PROBE_EVERY;
+    group.Rank();
+    SMOD_CHECK(group.mOrder[0] == 2 && group.mOrder[1] == 0 && group.mOrder[2] == 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(HedgeFailover, "hedge.failover")
+{
+    LoadOptions("Pipelining=false\nHedging=true\n");
+    // A mirror that refuses connections
+    MockMaster dead;
+    SMOD_CHECK(dead.Start());
+    const String gone = dead.Address("/dead");
+    dead.Stop();
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    Announcer announcer;
+    announcer.AddMaster((gone + " " + master.Address("/live")).c_str());
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 1);
+    const AnnounceStats & stats = announcer.GetStats();
+    // The announce moved on to the next mirror, with the first one counted as failed only once
+    SMOD_CHECK(master.Requests("/live") == 1);
+    SMOD_CHECK(stats.mAnnounces == 2 && stats.mFailures == 1 && stats.mSuccesses == 1);
+    SMOD_CHECK(stats.mHedged == 0);
+    const MirrorGroup & group = announcer.GetGroups()[0];
+    SMOD_CHECK(group.mMembers[0].mSamples == 1 && group.mMembers[0].mSuccess == 0.0);
+    SMOD_CHECK(group.mMembers[1].mSamples == 1 && group.mMembers[1].mSuccess == 1.0);
+    // Next time the one that answered goes first
+    RunCycles(announcer, 1);
+    SMOD_CHECK(master.Requests("/live") == 2 && stats.mFailures == 1 && stats.mSuccesses == 2);
+}
@@ -0,0 +1,111 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(IntervalHeaders, "interval.headers")
+{
+    Response res;
+    // Nothing asked for
+    SMOD_CHECK(ParseResponse("HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n", res));
+    SMOD_CHECK(IntervalFromResponse(res) == 0);
+    // Our own header
+    SMOD_CHECK(ParseResponse("HTTP/1.1 200 OK\r\nVCMP-Announce-Interval: 90\r\n\r\n", res));
+    SMOD_CHECK(IntervalFromResponse(res) == 90);
+    // Retry-After in seconds
+    SMOD_CHECK(ParseResponse("HTTP/1.1 503 Busy\r\nRetry-After: 120\r\n\r\n", res));
+    SMOD_CHECK(IntervalFromResponse(res) == 120);
+    // Retry-After as a date in the past means right away
+    SMOD_CHECK(ParseResponse("HTTP/1.1 503 Busy\r\nRetry-After: Sun, 06 Nov 1994 08:49:37 GMT\r\n\r\n", res));
+    SMOD_CHECK(IntervalFromResponse(res) == 1);
+    // Cache-Control among other directives, in any case
+    SMOD_CHECK(ParseResponse("HTTP/1.1 200 OK\r\nCache-Control: no-transform, Max-Age=45\r\n\r\n", res));
+    SMOD_CHECK(IntervalFromResponse(res) == 45);
+    // Our own header takes precedence over the others
+    SMOD_CHECK(ParseResponse("HTTP/1.1 200 OK\r\nCache-Control: max-age=45\r\nRetry-After: 120\r\n"
+                                "VCMP-Announce-Interval: 30\r\n\r\n", res));
+    SMOD_CHECK(IntervalFromResponse(res) == 30);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(IntervalHttpDate, "interval.http-date")
+{
+    std::time_t when = 0;
+    SMOD_CHECK(ParseHttpDate("Sun, 06 Nov 1994 08:49:37 GMT", when));
+    SMOD_CHECK(when == 784111777);
+    SMOD_CHECK(ParseHttpDate("Thu, 29 Feb 2024 23:59:59 GMT", when));
+    SMOD_CHECK(when == 1709251199);
+    SMOD_CHECK(!ParseHttpDate("Sun, 06 Foo 1994 08:49:37 GMT", when));
+    SMOD_CHECK(!ParseHttpDate("yesterday", when));
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(IntervalClamped, "interval.clamped")
+{
+    LoadOptions("UpdateInterval=60\nMinInterval=20\nMaxInterval=300\n");
+    MockMaster master;
+    master.SetHandler([](const String & path) {
+        MockReply reply;
+        // Each path asks for a different pace
+        if (path == "/asks")
+        {
+            reply.mHeaders = "VCMP-Announce-Interval: 120\r\n";
+        }
+        else if (path == "/fast")
+        {
+            reply.mHeaders = "Retry-After: 5\r\n";
+        }
+        else if (path == "/slow")
+        {
+            reply.mHeaders = "Cache-Control: max-age=86400\r\n";
+        }
+        return reply;
+    });
+    SMOD_CHECK(master.Start());
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/asks").c_str());
+    announcer.AddMaster(master.Address("/fast").c_str());
+    announcer.AddMaster(master.Address("/slow").c_str());
+    announcer.AddMaster(master.Address("/none").c_str());
+    announcer.SetPayload(0x5A, 8192);
+    RunCycles(announcer, 1);
+    const MasterTable & table = announcer.GetTable();
+    SMOD_CHECK(announcer.GetStats().mSuccesses == 4);
+    // Within the limits as asked, otherwise clamped, or the configured interval without a preference
+    SMOD_CHECK(table.mInterval[0] == 120);
+    SMOD_CHECK(table.mInterval[1] == 20);
+    SMOD_CHECK(table.mInterval[2] == 300);
+    SMOD_CHECK(table.mInterval[3] == 60);
+    // The next announce is due after the interval the master-server asked for
+    const auto wait = std::chrono::duration_cast< std::chrono::seconds >(table.mNext[0] - Server::Clock::now());
+    SMOD_CHECK(wait.count() > 100 && wait.count() <= 120);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(IntervalForgotten, "interval.forgotten")
+{
+    LoadOptions("UpdateInterval=60\n");
+    std::atomic< bool > asks(true);
+    MockMaster master;
+    master.SetHandler([&asks](const String &) {
+        MockReply reply;
+        if (asks)
+        {
+            reply.mHeaders = "VCMP-Announce-Interval: 240\r\n";
+        }
+        return reply;
+    });
+    SMOD_CHECK(master.Start());
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/").c_str());
+    announcer.SetPayload(0x5A, 8192);
+    RunCycles(announcer, 1);
+    SMOD_CHECK(announcer.GetTable().mInterval[0] == 240);
+    // Once the master-server stops asking, the configured interval applies again
+    asks = false;
+    RunCycles(announcer, 1);
+    SMOD_CHECK(announcer.GetTable().mInterval[0] == 60);
+}
@@ -0,0 +1,91 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <fstream>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(LibraryMasters, "library.masters")
+{
+    static const char ini[] = "[Servers]\n"
+                              "Address=master.vc-mp.org/announce.php\n"
+                              "Mirrors=a.example.com/announce, b.example.com/announce\n"
+                              "Address=http://c.example.com:8080/announce\n";
+    CSimpleIniA conf(false, true, true);
+    conf.LoadData(ini, sizeof(ini) - 1);
+    std::vector< String > masters;
+    ConfigureMasters(conf, masters);
+    // In the order they were specified, mirrors kept together
+    SMOD_CHECK(masters.size() == 3);
+    SMOD_CHECK(masters.size() == 3 && masters[1] == "a.example.com/announce, b.example.com/announce");
+    Announcer announcer;
+    for (const auto & address : masters)
+    {
+        SMOD_CHECK(announcer.AddMaster(address.c_str()));
+    }
+    // Nothing to announce on in an address without a host
+    SMOD_CHECK(!announcer.AddMaster(""));
+    SMOD_CHECK(!announcer.AddMaster(":8080/announce"));
+    SMOD_CHECK(announcer.Count() == 4);
+    SMOD_CHECK(announcer.GetGroups().size() == 1);
+    SMOD_CHECK(announcer.GetServers()[3].GetURI().mFull == "http://c.example.com:8080/announce");
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(LibraryRequest, "library.request")
+{
+    Announcer announcer;
+    announcer.AddMaster("master.example.com/announce.php");
+    announcer.AddMaster("other.example.com:8080/a;b");
+    announcer.SetPayload(0x5A, 8192);
+    // Exactly what the HTTP client of the plug-in always sent
+    SMOD_CHECK(announcer.GetServers()[0].GetRequest() ==
+        "POST /announce.php HTTP/1.1\r\n"
+        "Accept: */*\r\nConnection: close\r\nContent-Length: 9\r\n"
+        "Content-Type: application/x-www-form-urlencoded\r\n"
+        "Host: master.example.com\r\n"
+        "User-Agent: VCMP/0.4\r\nVCMP-Version: 90\r\n"
+        "\r\nport=8192");
+    // The port is named when it isn't the default and the path is escaped
+    const String & other = announcer.GetServers()[1].GetRequest();
+    SMOD_CHECK(other.compare(0, 27, "POST /a%3Bb HTTP/1.1\r\nAccep") == 0);
+    SMOD_CHECK(other.find("\r\nHost: other.example.com:8080\r\n") != String::npos);
+}
+
+#ifdef SMOD_CLI_PATH
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CliCycles, "cli.cycles")
+{
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    const String ini = ScratchFile("announce.ini");
+    {
+        std::ofstream out(ini);
+        out << "[Servers]\nAddress=" << master.Address("/announce") << "\n";
+    }
+    // A fixed number of cycles, regardless of the schedule
+    SMOD_CHECK(Reap(Spawn({SMOD_CLI_PATH, "-c", ini, "-n", "3", "-p", "8193", "-V", "77"}), 10000) == 0);
+    SMOD_CHECK(master.Requests("/announce") == 3);
+    SMOD_CHECK(master.Last().find("port=8193") != String::npos);
+    SMOD_CHECK(master.Last().find("VCMP-Version: 77\r\n") != String::npos);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(CliNoMasters, "cli.no-masters")
+{
+    const String ini = ScratchFile("announce.ini");
+    {
+        std::ofstream out(ini);
+        out << "[Options]\nVerbose=true\n";
+    }
+    // Nothing to announce on is a mistake, so is a missing configuration
+    SMOD_CHECK(Reap(Spawn({SMOD_CLI_PATH, "-c", ini, "-n", "1"}), 10000) == EXIT_FAILURE);
+    SMOD_CHECK(Reap(Spawn({SMOD_CLI_PATH, "-c", ini + ".missing", "-n", "1"}), 10000) == EXIT_FAILURE);
+}
+
+#endif // SMOD_CLI_PATH
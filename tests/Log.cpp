@@ -0,0 +1,120 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Log.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <fstream>
+#include <sstream>
+
+// ------------------------------------------------------------------------------------------------
+#include <unistd.h>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+/* ------------------------------------------------------------------------------------------------
+ * Retrieve the contents of the specified file or an empty string if there's no such file.
+*/
+static String ReadFile(const String & path)
+{
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Count the occurrences of the specified text in the specified string.
+*/
+static unsigned Occurrences(const String & str, const String & text)
+{
+    unsigned count = 0;
+    for (size_t pos = str.find(text); pos != String::npos; pos = str.find(text, pos + text.size()))
+    {
+        ++count;
+    }
+    return count;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Hand the specified message to a sink with the specified announce context.
+*/
+static void WriteEvent(FileSink & sink, const String & text, CCStr master, int status)
+{
+    LogEvent ev;
+    ev.mError = status >= 400;
+    ev.mVerbose = status == 0;
+    ev.mText = text.data();
+    ev.mLength = text.size();
+    ev.mMaster = master;
+    ev.mPhase = master ? "response" : nullptr;
+    ev.mLatency = master ? 1500 : 0;
+    ev.mStatus = status;
+    sink.Write(ev);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(LogJson, "log.json")
+{
+    const String path = ScratchFile("log");
+    {
+        FileSink sink;
+        SMOD_CHECK(sink.Open(path.c_str(), 0, 0) && sink.Start());
+        WriteEvent(sink, "refused \"the\" announce\n\x01", "http://a.example.com:80/", 403);
+        WriteEvent(sink, "quiet", nullptr, 0);
+    }
+    std::istringstream lines(ReadFile(path));
+    String first, second, extra;
+    std::getline(lines, first);
+    std::getline(lines, second);
+    // One object per line, everything the reader needs to filter by
+    SMOD_CHECK(first.compare(0, 7, "{\"ts\":\"") == 0 && first.back() == '}');
+    SMOD_CHECK(first.find(",\"level\":\"error\",\"master\":\"http://a.example.com:80/\",\"phase\":\"response\","
+                          "\"latency_us\":1500,\"status\":403,") != String::npos);
+    // Quotes and control characters are escaped so the line stays valid JSON
+    SMOD_CHECK(first.find("\"msg\":\"refused \\\"the\\\" announce\\u000a\\u0001\"}") != String::npos);
+    // Without a context only the message is there, marked if verbose
+    SMOD_CHECK(second.find("\"level\":\"info\",\"verbose\":true,\"msg\":\"quiet\"}") != String::npos);
+    SMOD_CHECK(second.find("\"master\"") == String::npos);
+    SMOD_CHECK(!std::getline(lines, extra));
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(LogRotate, "log.rotate")
+{
+    const String path = ScratchFile("log");
+    ScratchFile("log.1");
+    ScratchFile("log.2");
+    ScratchFile("log.3");
+    const String filler(1000, 'x');
+    {
+        FileSink sink;
+        SMOD_CHECK(sink.Open(path.c_str(), 100 * 1024, 2) && sink.Start());
+        // Each round is large enough to be written right away, whatever is left follows shortly
+        for (unsigned round = 1; round <= 4; ++round)
+        {
+            const String mark = "round " + std::to_string(round) + " ";
+            for (unsigned n = 0; n < 70; ++n)
+            {
+                WriteEvent(sink, mark + filler, nullptr, 200);
+            }
+            SMOD_CHECK(WaitFor([&]() { return Occurrences(ReadFile(path), mark) == 70; }, 5000));
+        }
+    }
+    // Only the newest round fits in the file, the older ones were moved out of the way
+    const String current = ReadFile(path), older = ReadFile(path + ".1"), oldest = ReadFile(path + ".2");
+    SMOD_CHECK(current.find("round 4") != String::npos && current.find("round 3") == String::npos);
+    SMOD_CHECK(older.find("round 3") != String::npos && older.find("round 2") == String::npos);
+    SMOD_CHECK(oldest.find("round 2") != String::npos);
+    SMOD_CHECK(current.size() <= 100 * 1024 && older.size() <= 100 * 1024);
+    // Only as many as asked to keep
+    SMOD_CHECK(access((path + ".3").c_str(), F_OK) != 0);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(LogDefaults, "log.defaults")
+{
+    SMOD_CHECK(LoadShippedOptions());
+    // The shipped configuration leaves the messages where the plug-in always put them
+    SMOD_CHECK(!HasLogSinks());
+}
@@ -0,0 +1,241 @@
+// ------------------------------------------------------------------------------------------------
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <chrono>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * Send the whole buffer through the specified socket.
+*/
+static bool SendAll(int sock, CCStr data, size_t size)
+{
+    while (size > 0)
+    {
+        const ssize_t n = send(sock, data, size, MSG_NOSIGNAL);
+        // Did the peer go away?
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        size -= static_cast< size_t >(n);
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool MockMaster::Start()
+{
+    m_Listen = socket(AF_INET, SOCK_STREAM, 0);
+    // Could we create the socket?
+    if (m_Listen < 0)
+    {
+        return false;
+    }
+    const int yes = 1;
+    // Connections of the previous run may still linger on the port
+    setsockopt(m_Listen, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast< uint16_t >(m_Port));
+    socklen_t len = sizeof(addr);
+    // Let the system choose the port the first time
+    if (bind(m_Listen, reinterpret_cast< struct sockaddr * >(&addr), sizeof(addr)) != 0 || listen(m_Listen, 64) != 0 ||
+        getsockname(m_Listen, reinterpret_cast< struct sockaddr * >(&addr), &len) != 0)
+    {
+        close(m_Listen);
+        m_Listen = -1;
+        return false;
+    }
+    m_Port = ntohs(addr.sin_port);
+    m_Running = true;
+    m_Thread = std::thread(&MockMaster::AcceptLoop, this);
+    // Ready to answer
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void MockMaster::Stop()
+{
+    // Was it even started?
+    if (!m_Running.exchange(false))
+    {
+        return;
+    }
+    m_Thread.join();
+    close(m_Listen);
+    m_Listen = -1;
+    std::vector< std::thread > workers;
+    {
+        std::lock_guard< std::mutex > lock(m_Mutex);
+        // Wake up the threads waiting on their connection
+        for (const int sock : m_Clients)
+        {
+            shutdown(sock, SHUT_RDWR);
+        }
+        workers.swap(m_Workers);
+    }
+    for (auto & t : workers)
+    {
+        t.join();
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+String MockMaster::Address(CCStr path) const
+{
+    char addr[64];
+    snprintf(addr, sizeof(addr), "127.0.0.1:%d", m_Port);
+    return String(addr).append(path);
+}
+
+// ------------------------------------------------------------------------------------------------
+unsigned MockMaster::Requests(CCStr path) const
+{
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    const auto itr = m_Requests.find(path);
+    return itr == m_Requests.end() ? 0 : itr->second;
+}
+
+// ------------------------------------------------------------------------------------------------
+unsigned MockMaster::Requests() const
+{
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    unsigned count = 0;
+    for (const auto & r : m_Requests)
+    {
+        count += r.second;
+    }
+    return count;
+}
+
+// ------------------------------------------------------------------------------------------------
+void MockMaster::AcceptLoop()
+{
+    struct pollfd pfd;
+    pfd.fd = m_Listen;
+    pfd.events = POLLIN;
+    // Look at the flag every now and then
+    while (m_Running)
+    {
+        if (poll(&pfd, 1, 20) <= 0)
+        {
+            continue;
+        }
+        const int sock = accept(m_Listen, nullptr, nullptr);
+        // Did the connection go away already?
+        if (sock < 0)
+        {
+            continue;
+        }
+        ++m_Connections;
+        std::lock_guard< std::mutex > lock(m_Mutex);
+        m_Clients.push_back(sock);
+        m_Workers.emplace_back(&MockMaster::Serve, this, sock);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void MockMaster::Serve(int sock)
+{
+    String data;
+    char buffer[4096];
+    bool open = true;
+    // Answer requests for as long as the client keeps the connection
+    while (open && m_Running)
+    {
+        const size_t head = data.find("\r\n\r\n");
+        // Is there a whole request to answer?
+        size_t length = 0;
+        if (head != String::npos)
+        {
+            CCStr cl = strcasestr(data.c_str(), "\r\nContent-Length:");
+            length = cl && static_cast< size_t >(cl - data.c_str()) < head ? strtoul(cl + 17, nullptr, 10) : 0;
+        }
+        if (head == String::npos || data.size() < head + 4 + length)
+        {
+            const ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+            // Did the client go away?
+            if (n <= 0)
+            {
+                break;
+            }
+            data.append(buffer, static_cast< size_t >(n));
+            continue;
+        }
+        const String request(data, 0, head + 4 + length);
+        data.erase(0, head + 4 + length);
+        // The path is the second word of the request line
+        const size_t from = request.find(' ') + 1;
+        const String path(request, from, request.find(' ', from) - from);
+        Handler handler;
+        {
+            std::lock_guard< std::mutex > lock(m_Mutex);
+            ++m_Requests[path];
+            m_Last = request;
+            handler = m_Handler;
+        }
+        const MockReply reply = handler ? handler(path) : MockReply();
+        // Take as long as the test wants
+        if (reply.mDelay)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(reply.mDelay));
+        }
+        // Go away without a word?
+        if (reply.mDrop)
+        {
+            break;
+        }
+        open = strcasestr(request.c_str(), "\r\nConnection: close\r\n") == nullptr;
+        char line[64];
+        snprintf(line, sizeof(line), "HTTP/1.1 %d Mock\r\n", reply.mStatus);
+        String response(line);
+        response.append(reply.mHeaders);
+        // How is the body delimited?
+        if (reply.mChunked)
+        {
+            response.append("Transfer-Encoding: chunked\r\n\r\n");
+            // Small chunks, with an extension on the first one, to exercise the decoder
+            for (size_t i = 0; i < reply.mBody.size(); i += 5)
+            {
+                const size_t n = std::min< size_t >(5, reply.mBody.size() - i);
+                snprintf(line, sizeof(line), i == 0 ? "%zx;mock=1\r\n" : "%zx\r\n", n);
+                response.append(line).append(reply.mBody, i, n).append("\r\n");
+            }
+            response.append("0\r\nMock-Trailer: 1\r\n\r\n");
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "Content-Length: %zu\r\n\r\n", reply.mBody.size());
+            response.append(line).append(reply.mBody);
+        }
+        // Did the client go away?
+        if (!SendAll(sock, response.data(), response.size()))
+        {
+            break;
+        }
+    }
+    std::lock_guard< std::mutex > lock(m_Mutex);
+    m_Clients.erase(std::remove(m_Clients.begin(), m_Clients.end(), sock), m_Clients.end());
+    close(sock);
+}
+
+} // Namespace:: SMod
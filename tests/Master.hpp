@@ -0,0 +1,155 @@
+#ifndef _TESTS_MASTER_HPP_
+#define _TESTS_MASTER_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+typedef ::std::string String;
+
+/* ------------------------------------------------------------------------------------------------
+ * How the mock master-server answers a single announce.
+*/
+struct MockReply
+{
+    int         mStatus = 200; // Status code of the response.
+    String      mHeaders; // Extra header lines, each ending with CRLF.
+    String      mBody; // Response body.
+    bool        mChunked = false; // Send the body with chunked transfer encoding.
+    unsigned    mDelay = 0; // Milliseconds to wait before answering.
+    bool        mDrop = false; // Close the connection without answering.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * A master-server on loopback that answers each announce the way the test tells it to. Every
+ * connection gets a thread of its own and may carry several requests, pipelined or not.
+*/
+class MockMaster
+{
+public:
+
+    /* --------------------------------------------------------------------------------------------
+     * Decides the answer to an announce on the specified path.
+    */
+    typedef std::function< MockReply (const String & path) > Handler;
+
+    /* --------------------------------------------------------------------------------------------
+     * Base constructor. Answers every announce with a plain 200 until told otherwise.
+    */
+    MockMaster()
+        : m_Handler(), m_Mutex(), m_Requests(), m_Last(), m_Connections(0), m_Listen(-1), m_Port(0)
+        , m_Running(false), m_Thread(), m_Clients(), m_Workers()
+    {
+        /* ... */
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    MockMaster(const MockMaster &) = delete;
+
+    /* --------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~MockMaster()
+    {
+        Stop();
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    MockMaster & operator = (const MockMaster &) = delete;
+
+    /* --------------------------------------------------------------------------------------------
+     * Specify how announces are answered from now on.
+    */
+    void SetHandler(Handler handler)
+    {
+        std::lock_guard< std::mutex > lock(m_Mutex);
+        m_Handler = std::move(handler);
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Start listening on loopback. After a Stop() the same port is used again.
+    */
+    bool Start();
+
+    /* --------------------------------------------------------------------------------------------
+     * Stop listening, drop every connection and wait for them to finish.
+    */
+    void Stop();
+
+    /* --------------------------------------------------------------------------------------------
+     * Retrieve the address of the specified path on this master-server.
+    */
+    String Address(CCStr path) const;
+
+    /* --------------------------------------------------------------------------------------------
+     * Retrieve the number of announces received on the specified path.
+    */
+    unsigned Requests(CCStr path) const;
+
+    /* --------------------------------------------------------------------------------------------
+     * Retrieve the number of announces received on every path.
+    */
+    unsigned Requests() const;
+
+    /* --------------------------------------------------------------------------------------------
+     * Retrieve the last announce received, request line, headers and body.
+    */
+    String Last() const
+    {
+        std::lock_guard< std::mutex > lock(m_Mutex);
+        return m_Last;
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Retrieve the number of connections accepted.
+    */
+    unsigned Connections() const
+    {
+        return m_Connections.load();
+    }
+
+private:
+
+    /* --------------------------------------------------------------------------------------------
+     * Accept connections until stopped.
+    */
+    void AcceptLoop();
+
+    /* --------------------------------------------------------------------------------------------
+     * Answer the requests that arrive on the specified connection until it closes.
+    */
+    void Serve(int sock);
+
+    // --------------------------------------------------------------------------------------------
+    Handler                         m_Handler; // Decides the answers.
+    mutable std::mutex              m_Mutex; // Protects the handler, counters and connections.
+    std::map< String, unsigned >    m_Requests; // Announces received by path.
+    String                          m_Last; // Last announce received.
+    std::atomic< unsigned >         m_Connections; // Connections accepted.
+    int                             m_Listen; // Listening socket.
+    int                             m_Port; // Port listened on.
+    std::atomic< bool >             m_Running; // Whether the listener should keep going.
+    std::thread                     m_Thread; // Accepts connections.
+    std::vector< int >              m_Clients; // Connections that are open.
+    std::vector< std::thread >      m_Workers; // Threads serving the connections.
+};
+
+} // Namespace:: SMod
+
+#endif // _TESTS_MASTER_HPP_
@@ -0,0 +1,98 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <atomic>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+/* ------------------------------------------------------------------------------------------------
+ * Answer announces on /old by sending them to /new with the specified status code. /new answers
+ * with whatever status the test last asked for.
+*/
+static MockMaster::Handler MovedTo(const String & target, int status, std::atomic< int > & answer)
+{
+    return [target, status, &answer](const String & path) {
+        MockReply reply;
+        // Point the announce elsewhere
+        if (path == "/old")
+        {
+            reply.mStatus = status;
+            reply.mHeaders = "Location: http://" + target + "\r\n";
+        }
+        else
+        {
+            reply.mStatus = answer.load();
+        }
+        return reply;
+    };
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(MovedPermanent, "moved.permanent")
+{
+    LoadOptions("Pipelining=false\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    std::atomic< int > answer(200);
+    master.SetHandler(MovedTo(master.Address("/new"), 301, answer));
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/old").c_str());
+    announcer.SetPayload(67000, 8192);
+    // The first announce follows the redirect
+    RunCycles(announcer, 1);
+    SMOD_CHECK(master.Requests("/old") == 1 && master.Requests("/new") == 1);
+    // The following ones go straight to where it moved
+    RunCycles(announcer, 3);
+    SMOD_CHECK(master.Requests("/old") == 1 && master.Requests("/new") == 4);
+    SMOD_CHECK(master.Last().compare(0, 14, "POST /new HTTP") == 0);
+    SMOD_CHECK(announcer.GetStats().mSuccesses == 4);
+    // Once it stops accepting there, the configured address is asked again right away
+    answer = 500;
+    RunCycles(announcer, 1);
+    SMOD_CHECK(master.Requests("/old") == 2);
+    answer = 200;
+    RunCycles(announcer, 1);
+    SMOD_CHECK(master.Requests("/old") == 3 && master.Requests("/new") == 7);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(MovedTemporary, "moved.temporary")
+{
+    LoadOptions("Pipelining=false\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    std::atomic< int > answer(200);
+    master.SetHandler(MovedTo(master.Address("/new"), 307, answer));
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/old").c_str());
+    announcer.SetPayload(67000, 8192);
+    // Temporary redirects are followed every time
+    RunCycles(announcer, 3);
+    SMOD_CHECK(master.Requests("/old") == 3 && master.Requests("/new") == 3);
+    SMOD_CHECK(announcer.GetStats().mSuccesses == 3);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(MovedHttps, "moved.https")
+{
+    LoadOptions("Pipelining=false\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    const String target = master.Address("/new");
+    master.SetHandler([target](const String & path) {
+        MockReply reply;
+        reply.mStatus = path == "/old" ? 301 : 200;
+        reply.mHeaders = "Location: https://" + target + "\r\n";
+        return reply;
+    });
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/old").c_str());
+    announcer.SetPayload(67000, 8192);
+    // An announce is never sent over plain HTTP where it was meant to go over TLS
+    RunCycles(announcer, 2);
+    SMOD_CHECK(master.Requests("/old") == 2 && master.Requests("/new") == 0);
+    SMOD_CHECK(announcer.GetStats().mSuccesses == 0 && announcer.GetStats().mFailures == 2);
+}
@@ -0,0 +1,90 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(PacingOffsets, "pacing.offsets")
+{
+    LoadOptions("UpdateInterval=60\n");
+    const uint32_t hash = StableHash("http://master.example.com:80/");
+    std::vector< long > offsets;
+    // Slots handed out one after the other
+    for (uint32_t slot = 0; slot < 16; ++slot)
+    {
+        offsets.push_back(static_cast< long >(PhaseOffset(hash, slot).count()));
+        SMOD_CHECK(offsets.back() >= 0 && offsets.back() < 60000);
+    }
+    std::sort(offsets.begin(), offsets.end());
+    offsets.push_back(offsets.front() + 60000);
+    // Evenly staggered: no two slots much closer or farther apart than an even split would be
+    for (size_t i = 1; i < offsets.size(); ++i)
+    {
+        const long gap = offsets[i] - offsets[i - 1];
+        SMOD_CHECK(gap >= 60000 / 16 / 3 && gap <= 60000 / 16 * 3);
+    }
+    // The same master-server and slot always land on the same offset
+    SMOD_CHECK(PhaseOffset(hash, 3) == PhaseOffset(hash, 3));
+    // The hash doesn't change between runs or builds (FNV-1a)
+    SMOD_CHECK(StableHash("") == 0x811C9DC5u);
+    SMOD_CHECK(StableHash("a") == 0xE40C292Cu);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(PacingSpread, "pacing.spread")
+{
+    LoadOptions("UpdateInterval=60\nPacing=true\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    Announcer announcer;
+    for (const CCStr path : {"/a", "/b", "/c", "/d", "/e", "/f"})
+    {
+        announcer.AddMaster(master.Address(path).c_str());
+    }
+    const Server::TimePoint start = Server::Clock::now();
+    announcer.SetPayload(0x5A, 8192);
+    const Server::TimePoint end = Server::Clock::now();
+    const MasterTable & table = announcer.GetTable();
+    // Each master-server is given the phase of its address within the interval
+    for (size_t i = 0; i < table.Size(); ++i)
+    {
+        const auto offset = PhaseOffset(StableHash(announcer.GetServers()[i].GetURI().mFull), 8192);
+        SMOD_CHECK(table.mNext[i] >= start + offset && table.mNext[i] <= end + offset);
+    }
+    std::vector< Server::TimePoint > next(table.mNext);
+    std::sort(next.begin(), next.end());
+    // The first announces are spread across the interval instead of being sent at once
+    SMOD_CHECK(next.front() >= start && next.back() < end + std::chrono::seconds(60));
+    SMOD_CHECK(std::adjacent_find(next.begin(), next.end()) == next.end());
+    // Only those that are due are announced on
+    const Server::TimePoint now = next[2] + std::chrono::milliseconds(1);
+    announcer.Process(now, now + std::chrono::seconds(60));
+    FlushMessages();
+    SMOD_CHECK(master.Requests() == 3);
+    // Each keeps its phase from one interval to the next
+    for (size_t i = 0; i < table.Size(); ++i)
+    {
+        SMOD_CHECK(table.mNext[i] > now);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(PacingOff, "pacing.off")
+{
+    LoadOptions("UpdateInterval=60\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/a").c_str());
+    announcer.AddMaster(master.Address("/b").c_str());
+    announcer.SetPayload(0x5A, 8192);
+    const MasterTable & table = announcer.GetTable();
+    // Without pacing, every master-server is due right away
+    SMOD_CHECK(table.mNext[0] == table.mNext[1] && table.mNext[0] <= Server::Clock::now());
+    const Server::TimePoint now = Server::Clock::now();
+    announcer.Process(now, now + std::chrono::seconds(60));
+    FlushMessages();
+    SMOD_CHECK(master.Requests() == 2);
+}
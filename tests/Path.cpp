@@ -0,0 +1,38 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(PathSample, "path.sample")
+{
+    LoadOptions("Pipelining=false\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String &) {
+        MockReply reply;
+        reply.mBody = String(1000, 'x');
+        return reply;
+    });
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/a").c_str());
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 3);
+    const Server & server = announcer.GetServers()[0];
+    const PathStats & path = server.GetPath();
+#ifdef __linux__
+    // Every connection is sampled after its response
+    SMOD_CHECK(path.mSamples == 3);
+    SMOD_CHECK(path.mRtt > 0 && path.mMinRtt > 0 && path.mMinRtt <= path.mRtt * 4);
+    // Everything sent was acknowledged and the whole response was received
+    SMOD_CHECK(path.mBytesAcked >= 3 * server.GetRequest().size());
+    SMOD_CHECK(path.mBytesReceived >= 3 * 1000);
+    // Loopback doesn't lose anything
+    SMOD_CHECK(path.mRetransmits == 0 && path.mLossy == 0);
+    SMOD_CHECK(!path.mDegraded && announcer.GetStats().mDegraded == 0);
+#else
+    SMOD_CHECK(path.mSamples == 0);
+#endif // __linux__
+}
@@ -0,0 +1,87 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+/* ------------------------------------------------------------------------------------------------
+ * Announce once on the specified paths of the master-server.
+*/
+static void AnnounceOnPaths(MockMaster & master, Announcer & announcer, std::initializer_list< CCStr > paths)
+{
+    for (CCStr path : paths)
+    {
+        announcer.AddMaster(master.Address(path).c_str());
+    }
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(PipelineOff, "pipeline.off")
+{
+    LoadOptions("");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    Announcer announcer;
+    AnnounceOnPaths(master, announcer, {"/a", "/b"});
+    // Unless asked for, every announce has a connection of its own
+    SMOD_CHECK(master.Connections() == 2 && announcer.GetStats().mPipelines == 0);
+    SMOD_CHECK(announcer.GetStats().mSuccesses == 2);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(PipelineShared, "pipeline.shared")
+{
+    LoadOptions("Pipelining=true\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String & path) {
+        MockReply reply;
+        reply.mStatus = path == "/b" ? 500 : 200;
+        reply.mBody = "answer to " + path;
+        return reply;
+    });
+    Announcer announcer;
+    AnnounceOnPaths(master, announcer, {"/a", "/b", "/c"});
+    const AnnounceStats & stats = announcer.GetStats();
+    // One connection carried all of them and each got its own answer
+    SMOD_CHECK(master.Connections() == 1 && master.Requests() == 3);
+    SMOD_CHECK(stats.mPipelines == 1 && stats.mPipelined == 3);
+    SMOD_CHECK(stats.mSuccesses == 2 && stats.mFailures == 1);
+    SMOD_CHECK(announcer.GetTable().mFails[1] == 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(PipelineChunked, "pipeline.chunked")
+{
+    LoadOptions("Pipelining=true\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String & path) {
+        MockReply reply;
+        reply.mStatus = path == "/b" ? 500 : 200;
+        reply.mBody = "a chunked answer to " + path;
+        reply.mChunked = true;
+        return reply;
+    });
+    Announcer announcer;
+    const Server::TimePoint start = Server::Clock::now();
+    AnnounceOnPaths(master, announcer, {"/a", "/b", "/c"});
+    const AnnounceStats & stats = announcer.GetStats();
+    // Chunked bodies end where their last chunk does, not when the connection is closed
+    SMOD_CHECK(master.Connections() == 1 && master.Requests() == 3);
+    SMOD_CHECK(stats.mPipelines == 1 && stats.mPipelined == 3);
+    SMOD_CHECK(stats.mSuccesses == 2 && stats.mFailures == 1);
+    SMOD_CHECK(announcer.GetTable().mFails[1] == 1);
+    SMOD_CHECK(Server::Clock::now() - start < std::chrono::seconds(Transport::IO_TIMEOUT));
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(PipelineDefaults, "pipeline.defaults")
+{
+    SMOD_CHECK(LoadShippedOptions());
+    // Announces only share a connection when asked for
+    SMOD_CHECK(!g_Pipelining);
+}
@@ -0,0 +1,99 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <fstream>
+
+// ------------------------------------------------------------------------------------------------
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// ------------------------------------------------------------------------------------------------
+#include <vcmp.h>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+typedef unsigned int (*PluginInit)(PluginFuncs *, PluginCallbacks *, PluginInfo *);
+
+/* ------------------------------------------------------------------------------------------------
+ * Stub server functions used by the plug-in.
+*/
+static uint32_t GetServerVersion()
+{
+    return 67000;
+}
+
+static vcmpError GetServerSettings(ServerSettings * settings)
+{
+    settings->port = 8192;
+    settings->maxPlayers = 100;
+    return vcmpErrorNone;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Load the plug-in the way the game server does, from a directory of its own with the specified
+ * configuration. Returns false if it refused to load.
+*/
+static bool LoadPlugin(CCStr config, PluginCallbacks & callbacks)
+{
+    // The plug-in loads its configuration from the working directory
+    const String dir = ScratchFile("server");
+    mkdir(dir.c_str(), 0755);
+    if (chdir(dir.c_str()) != 0)
+    {
+        return false;
+    }
+    std::ofstream("announce.ini") << config;
+    void * handle = dlopen(SMOD_PLUGIN_PATH, RTLD_NOW | RTLD_LOCAL);
+    PluginInit init = handle ? reinterpret_cast< PluginInit >(dlsym(handle, "VcmpPluginInit")) : nullptr;
+    // Is this even a plug-in?
+    if (!SMOD_CHECK(init != nullptr))
+    {
+        return false;
+    }
+    static PluginFuncs funcs;
+    static PluginInfo info;
+    memset(&funcs, 0, sizeof(funcs));
+    memset(&callbacks, 0, sizeof(callbacks));
+    memset(&info, 0, sizeof(info));
+    funcs.structSize = sizeof(funcs);
+    funcs.GetServerVersion = GetServerVersion;
+    funcs.GetServerSettings = GetServerSettings;
+    callbacks.structSize = sizeof(callbacks);
+    info.structSize = sizeof(info);
+    // Let the plug-in initialize
+    return init(&funcs, &callbacks, &info) != 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(PluginLoad, "plugin.load")
+{
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    PluginCallbacks callbacks;
+    if (!SMOD_CHECK(LoadPlugin(("[Servers]\nAddress=" + master.Address("/announce") + "\n").c_str(), callbacks)))
+    {
+        return;
+    }
+    // Everything the game server calls into
+    SMOD_CHECK(callbacks.OnServerInitialise && callbacks.OnServerShutdown && callbacks.OnServerFrame);
+    SMOD_CHECK(callbacks.OnServerInitialise() != 0);
+    // The announce thread announces right away, the frames only hand over its messages
+    SMOD_CHECK(WaitFor([&]() { callbacks.OnServerFrame(0.02f); return master.Requests("/announce") > 0; }, 5000));
+    SMOD_CHECK(master.Last().find("port=8192") != String::npos);
+    SMOD_CHECK(master.Last().find("VCMP-Version: 67000\r\n") != String::npos);
+    callbacks.OnServerShutdown();
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(PluginNoMasters, "plugin.no-masters")
+{
+    PluginCallbacks callbacks;
+    // Without master-servers there's no reason for the plug-in to load
+    SMOD_CHECK(!LoadPlugin("[Options]\nVerbose=true\n", callbacks));
+    SMOD_CHECK(!LoadPlugin("[Servers]\nAddress=:8080/announce\n", callbacks));
+}
@@ -0,0 +1,116 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+#include "Log.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <mutex>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+static std::mutex               g_SeenMutex; // Protects the messages seen by the sink.
+static std::vector< String >    g_Seen; // Messages handed to the sink or to the repeat handler.
+
+/* ------------------------------------------------------------------------------------------------
+ * Keeps every message it receives.
+*/
+struct KeepSink : public LogSink
+{
+    /* --------------------------------------------------------------------------------------------
+     * Receive an event.
+    */
+    void Write(const LogEvent & ev) override
+    {
+        std::lock_guard< std::mutex > lock(g_SeenMutex);
+        g_Seen.emplace_back(ev.mText, ev.mLength);
+    }
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Receives the summaries of suppressed repeats.
+*/
+static void KeepSummary(bool, bool, CCStr text, size_t length)
+{
+    std::lock_guard< std::mutex > lock(g_SeenMutex);
+    g_Seen.emplace_back(text, length);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Count the messages seen so far that contain the specified text.
+*/
+static unsigned Seen(CCStr text)
+{
+    std::lock_guard< std::mutex > lock(g_SeenMutex);
+    unsigned count = 0;
+    for (const auto & line : g_Seen)
+    {
+        count += line.find(text) != String::npos ? 1 : 0;
+    }
+    return count;
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(RepeatWindow, "repeat.window")
+{
+    LoadOptions("LogRepeatWindow=1\n");
+    static const char site[] = "Master-list (%s) responded with code: %d";
+    SetLogContext("http://a.example.com:80/", "response", 0, 500);
+    // The first one is let through and quoted by the summary later
+    SMOD_CHECK(!SuppressRepeat(site, false, true, KeepSummary));
+    RememberRepeat("first one", 9);
+    // The same message about the same master-server and status is only counted
+    SMOD_CHECK(SuppressRepeat(site, false, true, KeepSummary));
+    SMOD_CHECK(SuppressRepeat(site, false, true, KeepSummary));
+    SMOD_CHECK(SuppressRepeat(site, false, true, KeepSummary));
+    // Anything that tells something else is not
+    SMOD_CHECK(!SuppressRepeat("Another message", false, true, KeepSummary));
+    SetLogContext("http://a.example.com:80/", "response", 0, 403);
+    SMOD_CHECK(!SuppressRepeat(site, false, true, KeepSummary));
+    SetLogContext("http://b.example.com:80/", "response", 0, 500);
+    SMOD_CHECK(!SuppressRepeat(site, false, true, KeepSummary));
+    // Nothing is summarized while the window lasts
+    SweepRepeats(KeepSummary);
+    SMOD_CHECK(Seen("Repeated") == 0);
+    usleep(1100000);
+    // Then the repeats are summarized once, quoting the message
+    SweepRepeats(KeepSummary);
+    SweepRepeats(KeepSummary);
+    SMOD_CHECK(Seen("Repeated 3 times in the last 1 seconds: first one") == 1);
+    SMOD_CHECK(Seen("Repeated") == 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(RepeatAnnounce, "repeat.announce")
+{
+    LoadOptions("Pipelining=false\nLogRepeatWindow=1\n");
+    AddLogSink(std::unique_ptr< LogSink >(new KeepSink()));
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String &) {
+        MockReply reply;
+        reply.mStatus = 500;
+        return reply;
+    });
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/a").c_str());
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 4);
+    // Four refusals, one message
+    SMOD_CHECK(master.Requests("/a") == 4);
+    SMOD_CHECK(Seen("responded with code: 500") == 1);
+    usleep(1100000);
+    // Once the window runs out, the cycle tells how many were left out
+    RunCycles(announcer, 1);
+    SMOD_CHECK(Seen("Repeated 3 times in the last 1 seconds: Master-list") == 1);
+    ClearLogSinks();
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(RepeatDefaults, "repeat.defaults")
+{
+    SMOD_CHECK(LoadShippedOptions());
+    // Every message is shown unless asked otherwise, the way the plug-in always did
+    SMOD_CHECK(g_LogRepeatWindow == 0);
+}
@@ -0,0 +1,138 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(StateFind, "state.find")
+{
+    const String path = ScratchFile("state");
+    StateFile state;
+    SMOD_CHECK(state.Open(path.c_str()));
+    const URI master("master.example.com/announce");
+    // Longer than what the entry keeps of it
+    const URI longer(("master.example.com/" + String(200, 'p')).c_str());
+    SMOD_CHECK(longer.mFull.size() >= sizeof(SavedMaster::mFull));
+    SavedMaster * a = state.Find(master, 8192);
+    SavedMaster * b = state.Find(longer, 8192);
+    SMOD_CHECK(a != nullptr && b != nullptr && a != b);
+    // The same entry is found every time
+    SMOD_CHECK(state.Find(master, 8192) == a);
+    SMOD_CHECK(state.Find(longer, 8192) == b);
+    SMOD_CHECK(state.Find(longer, 8192) == b);
+    // Another game server on the same master-server has an entry of its own
+    SMOD_CHECK(state.Find(longer, 8193) != b);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(StateRestart, "state.restart")
+{
+    const String path = ScratchFile("state");
+    LoadOptions(("Pipelining=false\nState=" + path + "\n").c_str());
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    const String target = master.Address("/new");
+    master.SetHandler([target](const String & p) {
+        MockReply reply;
+        // One asks for a longer interval, one refuses and one moved for good
+        if (p == "/slow")
+        {
+            reply.mHeaders = "VCMP-Announce-Interval: 120\r\n";
+        }
+        else if (p == "/bad")
+        {
+            reply.mStatus = 500;
+        }
+        else if (p == "/old")
+        {
+            reply.mStatus = 301;
+            reply.mHeaders = "Location: http://" + target + "\r\n";
+        }
+        return reply;
+    });
+    const String addresses[] = {master.Address("/slow"), master.Address("/bad"), master.Address("/old")};
+    {
+        Announcer announcer;
+        for (const auto & address : addresses)
+        {
+            announcer.AddMaster(address.c_str());
+        }
+        announcer.SetPayload(67000, 8192);
+        RunCycles(announcer, 1);
+        SMOD_CHECK(master.Requests("/old") == 1 && master.Requests("/new") == 1);
+    }
+    // The game server restarts
+    g_State.Close();
+    LoadOptions(("Pipelining=false\nState=" + path + "\n").c_str());
+    Announcer announcer;
+    for (const auto & address : addresses)
+    {
+        announcer.AddMaster(address.c_str());
+    }
+    const Server::TimePoint start = Server::Clock::now();
+    announcer.SetPayload(67000, 8192);
+    const MasterTable & table = announcer.GetTable();
+    // It continues where the previous run left off
+    SMOD_CHECK(table.mInterval[0] == 120);
+    SMOD_CHECK(table.mNext[0] > start + std::chrono::seconds(100));
+    SMOD_CHECK(table.mFails[1] == 1);
+    // Including where the master-server moved
+    const Server::TimePoint now = table.mNext[2] + std::chrono::milliseconds(1);
+    announcer.Process(now, now + std::chrono::hours(1));
+    FlushMessages();
+    SMOD_CHECK(master.Requests("/old") == 1 && master.Requests("/new") == 2);
+    SMOD_CHECK(master.Requests("/slow") == 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(StateInvalid, "state.invalid")
+{
+    const String path = ScratchFile("state");
+    LoadOptions(("Pipelining=false\nState=" + path + "\n").c_str());
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String & p) {
+        MockReply reply;
+        reply.mStatus = p == "/gone" ? 500 : 200;
+        return reply;
+    });
+    const String addresses[] = {master.Address("/back"), master.Address("/gone")};
+    {
+        Announcer announcer;
+        for (const auto & address : addresses)
+        {
+            announcer.AddMaster(address.c_str());
+        }
+        announcer.SetPayload(67000, 8192);
+        RunCycles(announcer, 1);
+    }
+    // Both were given up on by the previous run
+    for (const auto & address : addresses)
+    {
+        SavedMaster * saved = g_State.Find(URI(address.c_str()), 8192);
+        saved->mState = MasterTable::Invalid;
+        saved->mFails = Server::INVALID_AFTER;
+    }
+    // The game server restarts
+    g_State.Close();
+    LoadOptions(("Pipelining=false\nState=" + path + "\n").c_str());
+    Announcer announcer;
+    for (const auto & address : addresses)
+    {
+        announcer.AddMaster(address.c_str());
+    }
+    const Server::TimePoint start = Server::Clock::now();
+    announcer.SetPayload(67000, 8192);
+    const MasterTable & table = announcer.GetTable();
+    // Each is probed once right away
+    SMOD_CHECK(table.mState[0] == MasterTable::Active && table.mState[1] == MasterTable::Active);
+    SMOD_CHECK(table.mNext[0] <= start + std::chrono::seconds(1) && table.mNext[1] <= start + std::chrono::seconds(1));
+    announcer.Process(start + std::chrono::seconds(1), start + std::chrono::hours(1));
+    FlushMessages();
+    SMOD_CHECK(master.Requests("/back") == 2 && master.Requests("/gone") == 2);
+    // The one that answers is back, the other is given up on again after that one failure
+    SMOD_CHECK(table.mState[0] == MasterTable::Active && table.mFails[0] == 0);
+    SMOD_CHECK(table.mState[1] == MasterTable::Invalid);
+}
@@ -0,0 +1,72 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(TableLayout, "table.layout")
+{
+    LoadOptions("UpdateInterval=45\n");
+    Announcer announcer;
+    announcer.AddMaster("a.example.com/announce");
+    announcer.AddMaster("b.example.com/announce c.example.com/announce");
+    announcer.AddMaster("d.example.com/announce");
+    const MasterTable & table = announcer.GetTable();
+    // One entry per master-server, every array the same length
+    SMOD_CHECK(table.Size() == 4 && announcer.Count() == 4);
+    SMOD_CHECK(table.mInterval.size() == 4 && table.mLatency.size() == 4 && table.mFails.size() == 4);
+    SMOD_CHECK(table.mState.size() == 4 && table.mGroup.size() == 4 && table.mPipeline.size() == 4);
+    for (size_t i = 0; i < table.Size(); ++i)
+    {
+        SMOD_CHECK(table.mInterval[i] == 45);
+        SMOD_CHECK(table.mFails[i] == 0 && table.mState[i] == MasterTable::Active);
+    }
+    // Mirrors know their group, the others have none
+    SMOD_CHECK(table.mGroup[0] == MasterTable::NO_GROUP && table.mGroup[3] == MasterTable::NO_GROUP);
+    SMOD_CHECK(table.mGroup[1] == 0 && table.mGroup[2] == 0);
+    SMOD_CHECK(announcer.GetGroups().size() == 1 && announcer.GetGroups()[0].mMembers.size() == 2);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(TableSchedule, "table.schedule")
+{
+    LoadOptions("UpdateInterval=60\nPipelining=false\n");
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String & path) {
+        MockReply reply;
+        reply.mStatus = path == "/bad" ? 500 : 200;
+        return reply;
+    });
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/ok").c_str());
+    announcer.AddMaster(master.Address("/bad").c_str());
+    const Server::TimePoint start = Server::Clock::now();
+    announcer.SetPayload(67000, 8192);
+    const MasterTable & table = announcer.GetTable();
+    const Server::TimePoint now = Server::Clock::now() + std::chrono::milliseconds(1);
+    const Server::TimePoint far = now + std::chrono::hours(1);
+    // Everything is due right away
+    const Server::TimePoint next = announcer.Process(now, far);
+    FlushMessages();
+    SMOD_CHECK(master.Requests("/ok") == 1 && master.Requests("/bad") == 1);
+    // Each one is kept with what happened to it, and announced on again an interval after it was due
+    SMOD_CHECK(table.mFails[0] == 0 && table.mFails[1] == 1);
+    SMOD_CHECK(table.mLatency[0] > 0);
+    SMOD_CHECK(table.mNext[0] >= start + std::chrono::seconds(60));
+    SMOD_CHECK(table.mNext[1] > now);
+    // Wake up for whichever is due first
+    SMOD_CHECK(next == std::min(table.mNext[0], table.mNext[1]));
+    // Nothing is sent before it's due
+    SMOD_CHECK(announcer.Process(now, far) == next);
+    FlushMessages();
+    SMOD_CHECK(master.Requests() == 2);
+    // Then only what is due
+    const Server::TimePoint later = table.mNext[0];
+    announcer.Process(later, far);
+    FlushMessages();
+    SMOD_CHECK(master.Requests("/ok") == 2);
+    SMOD_CHECK(table.mNext[0] >= later + std::chrono::seconds(60));
+}
@@ -0,0 +1,178 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+static CCStr                g_Running = ""; // Name of the test case that runs.
+static unsigned             g_Failed = 0; // Checks that did not hold.
+
+/* ------------------------------------------------------------------------------------------------
+ * Every registered test case, in the order they were registered.
+*/
+static std::vector< TestCase > & Cases()
+{
+    static std::vector< TestCase > cases;
+    return cases;
+}
+
+// ------------------------------------------------------------------------------------------------
+TestCase::TestCase(CCStr name, Body body)
+    : mName(name), mBody(body)
+{
+    Cases().push_back(*this);
+}
+
+// ------------------------------------------------------------------------------------------------
+bool Check(bool cond, CCStr text, CCStr file, int line)
+{
+    // Did it hold?
+    if (!cond)
+    {
+        // Output what was queued so far so the failure shows up after what led to it
+        FlushMessages();
+        printf("%s:%d: check failed: %s\n", file, line, text);
+        fflush(stdout);
+        ++g_Failed;
+    }
+    return cond;
+}
+
+// ------------------------------------------------------------------------------------------------
+void LoadOptions(CCStr options)
+{
+    CSimpleIniA conf(false, true, true);
+    // Put the options where the announcer looks for them
+    const String data = String("[Options]\n") + options;
+    conf.LoadData(data.c_str(), data.size());
+    ConfigureOptions(conf);
+}
+
+// ------------------------------------------------------------------------------------------------
+bool LoadShippedOptions()
+{
+    CSimpleIniA conf(false, true, true);
+    // Is the shipped configuration where the build said it is?
+    if (conf.LoadFile(SMOD_CONFIG_PATH) != SI_OK)
+    {
+        return false;
+    }
+    ConfigureOptions(conf);
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+String ScratchFile(CCStr name)
+{
+    String path(g_Running);
+    path.append("-").append(name);
+    // Start from nothing
+    unlink(path.c_str());
+    return path;
+}
+
+// ------------------------------------------------------------------------------------------------
+bool ParseResponse(CCStr raw, Response & res)
+{
+    res.Clear();
+    snprintf(res.mBuffer, sizeof(res.mBuffer), "%s", raw);
+    int status = 0;
+    long length = -1;
+    bool chunked = false;
+    // Parse it in place like a received one
+    if (!Transport::ParseHead(res, status, length, chunked))
+    {
+        return false;
+    }
+    res.mStatus = status;
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void RunCycles(Announcer & announcer, unsigned count)
+{
+    for (unsigned n = 0; n < count; ++n)
+    {
+        announcer.Cycle();
+        FlushMessages();
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+int Spawn(const std::vector< String > & args)
+{
+    std::vector< char * > argv;
+    for (const auto & arg : args)
+    {
+        argv.push_back(const_cast< char * >(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    // Keep the output of both in order
+    fflush(stdout);
+    const pid_t pid = fork();
+    // Are we the child?
+    if (pid == 0)
+    {
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+// ------------------------------------------------------------------------------------------------
+int Reap(int pid, unsigned ms)
+{
+    int status = 0;
+    // Give it some time to exit on its own
+    if (!WaitFor([pid, &status]() { return waitpid(pid, &status, WNOHANG) == pid; }, ms))
+    {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+} // Namespace:: SMod
+
+// ------------------------------------------------------------------------------------------------
+int main(int argc, char ** argv)
+{
+    using namespace SMod;
+    // Without a name, list what can be run
+    if (argc < 2)
+    {
+        for (const auto & c : Cases())
+        {
+            printf("%s\n", c.mName);
+        }
+        return EXIT_SUCCESS;
+    }
+    // Find the test case that was asked for
+    for (const auto & c : Cases())
+    {
+        if (strcmp(c.mName, argv[1]) != 0)
+        {
+            continue;
+        }
+        g_Running = c.mName;
+        c.mBody();
+        // Output whatever the announcer still has queued
+        FlushMessages();
+        printf("%s: %s\n", c.mName, g_Failed ? "FAILED" : "passed");
+        return g_Failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    printf("Unknown test case: %s\n", argv[1]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,108 @@
+#ifndef _LIBRARY_TEST_HPP_
+#define _LIBRARY_TEST_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Announce.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------------------------------------------
+#include <unistd.h>
+
+/* ------------------------------------------------------------------------------------------------
+ * Define a test case that runs the body below it. The name is what ctest and the command line use.
+*/
+#define SMOD_TEST(func, name) \
+    static void func(); \
+    static const ::SMod::TestCase func##Case(name, &func); \
+    static void func()
+
+/* ------------------------------------------------------------------------------------------------
+ * Report the condition if it doesn't hold and let the test carry on. Evaluates to the condition.
+*/
+#define SMOD_CHECK(cond) ::SMod::Check(static_cast< bool >(cond), #cond, __FILE__, __LINE__)
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * Registers a test case when constructed at namespace scope.
+*/
+struct TestCase
+{
+    typedef void (*Body)();
+
+    /* ---------------------------------------------------------------------------------------------
+     * Base constructor.
+    */
+    TestCase(CCStr name, Body body);
+
+    // ---------------------------------------------------------------------------------------------
+    CCStr   mName; // Name of the test case.
+    Body    mBody; // What the test case runs.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Account for a condition checked by a test case and report it if it doesn't hold.
+*/
+bool Check(bool cond, CCStr text, CCStr file, int line);
+
+/* ------------------------------------------------------------------------------------------------
+ * Load the specified [Options] lines into the announce options, as a configuration file would.
+*/
+void LoadOptions(CCStr options);
+
+/* ------------------------------------------------------------------------------------------------
+ * Load the announce options from the announce.ini shipped with the plug-in.
+*/
+bool LoadShippedOptions();
+
+/* ------------------------------------------------------------------------------------------------
+ * Retrieve the path of a scratch file that belongs to the running test case. Any file left there
+ * by a previous run is removed.
+*/
+String ScratchFile(CCStr name);
+
+/* ------------------------------------------------------------------------------------------------
+ * Parse a raw response (status line, headers and any body) the way the transport would.
+*/
+bool ParseResponse(CCStr raw, Response & res);
+
+/* ------------------------------------------------------------------------------------------------
+ * Announce on every master-server the specified number of times and output the messages.
+*/
+void RunCycles(Announcer & announcer, unsigned count);
+
+/* ------------------------------------------------------------------------------------------------
+ * Start the specified program with the specified arguments. Returns its process id or -1.
+*/
+int Spawn(const std::vector< String > & args);
+
+/* ------------------------------------------------------------------------------------------------
+ * Wait up to the specified number of milliseconds for the specified process to exit, then kill it.
+ * Returns its exit status or -1 if it had to be killed.
+*/
+int Reap(int pid, unsigned ms);
+
+/* ------------------------------------------------------------------------------------------------
+ * Wait up to the specified number of milliseconds for the condition to hold. Returns whether it did.
+*/
+template < typename F > bool WaitFor(F cond, unsigned ms)
+{
+    for (unsigned n = 0; !cond(); n += 10)
+    {
+        // Did time run out?
+        if (n >= ms)
+        {
+            return false;
+        }
+        usleep(10000);
+    }
+    return true;
+}
+
+} // Namespace:: SMod
+
+#endif // _LIBRARY_TEST_HPP_
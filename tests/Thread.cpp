@@ -0,0 +1,143 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Thread.hpp"
+#include "Log.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <fstream>
+#include <sstream>
+
+// ------------------------------------------------------------------------------------------------
+#include <sched.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+/* ------------------------------------------------------------------------------------------------
+ * How a thread found itself to be scheduled.
+*/
+struct Scheduled
+{
+    cpu_set_t   mCpus; // CPUs it may run on.
+    int         mClass; // Scheduling class.
+    int         mNice; // Nice value.
+    size_t      mStack; // Stack size in bytes.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * Find out how the calling thread is scheduled.
+*/
+static void LookAtSelf(void * out)
+{
+    Scheduled & s = *static_cast< Scheduled * >(out);
+    sched_getaffinity(0, sizeof(s.mCpus), &s.mCpus);
+    s.mClass = sched_getscheduler(0);
+    s.mNice = getpriority(PRIO_PROCESS, static_cast< id_t >(syscall(SYS_gettid)));
+    pthread_attr_t attr;
+    // Ask for the attributes the thread was created with
+    if (pthread_getattr_np(pthread_self(), &attr) == 0)
+    {
+        pthread_attr_getstacksize(&attr, &s.mStack);
+        pthread_attr_destroy(&attr);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(ThreadCpuList, "thread.cpus")
+{
+    std::vector< unsigned > cpus;
+    // Numbers and ranges, in any order and repeated
+    SMOD_CHECK(ParseCpuList("0,2-3", cpus) && cpus == std::vector< unsigned >({0, 2, 3}));
+    SMOD_CHECK(ParseCpuList("5,1-2,2,1", cpus) && cpus == std::vector< unsigned >({1, 2, 5}));
+    SMOD_CHECK(ParseCpuList("7", cpus) && cpus == std::vector< unsigned >({7}));
+    // Anything malformed is refused as a whole
+    for (CCStr bad : {"", "a", ",1", "3-1", "1-", "1;2", "1,x", "1024", "0-1024", "-1"})
+    {
+        SMOD_CHECK(!ParseCpuList(bad, cpus));
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(ThreadDescribe, "thread.describe")
+{
+    ThreadPolicy policy;
+    String text;
+    policy.Describe(text);
+    SMOD_CHECK(!policy.IsSet() && text == "cpus any, class normal");
+    // Runs of CPUs are shown as ranges and only what was configured is mentioned
+    policy.mCpus = {0, 1, 2, 5, 7, 8};
+    policy.mClass = ThreadBatch;
+    policy.mNiced = true;
+    policy.mNice = 0;
+    policy.mStack = 256 * 1024;
+    policy.Describe(text);
+    SMOD_CHECK(policy.IsSet() && text == "cpus 0-2,5,7-8, class batch, nice 0, stack 256 KiB");
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(ThreadApplied, "thread.policy")
+{
+    cpu_set_t allowed;
+    SMOD_CHECK(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+    unsigned cpu = 0;
+    // Pin to a CPU this process may actually use
+    while (cpu < CPU_SETSIZE && !CPU_ISSET(cpu, &allowed))
+    {
+        ++cpu;
+    }
+    const String options = "ThreadCpus=" + std::to_string(cpu) + "\nThreadPolicy=idle\nThreadNice=7\nThreadStack=512\n";
+    LoadOptions(options.c_str());
+    SMOD_CHECK(g_ThreadPolicy.mCpus == std::vector< unsigned >({cpu}) && g_ThreadPolicy.mClass == ThreadIdle);
+    SMOD_CHECK(g_ThreadPolicy.mNiced && g_ThreadPolicy.mNice == 7 && g_ThreadPolicy.mStack == 512 * 1024);
+    Scheduled s;
+    memset(&s, 0, sizeof(s));
+    {
+        Thread thread;
+        SMOD_CHECK(thread.Start(&LookAtSelf, &s, "test"));
+    }
+    FlushMessages();
+    // The thread scheduled itself before running anything
+    SMOD_CHECK(CPU_COUNT(&s.mCpus) == 1 && CPU_ISSET(cpu, &s.mCpus));
+    SMOD_CHECK(s.mClass == SCHED_IDLE && s.mNice == 7);
+    SMOD_CHECK(s.mStack >= 512 * 1024);
+    // While the one that started it wasn't touched
+    SMOD_CHECK(sched_getscheduler(0) == SCHED_OTHER);
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(ThreadInvalid, "thread.invalid")
+{
+    LoadOptions("ThreadCpus=1-x\nThreadPolicy=fast\nThreadNice=\nThreadStack=-4\n");
+    // Mistakes leave the threads scheduled like the game thread
+    SMOD_CHECK(!g_ThreadPolicy.IsSet());
+    LoadOptions("ThreadNice=0\n");
+    // But a nice value of zero is a choice
+    SMOD_CHECK(g_ThreadPolicy.mNiced && g_ThreadPolicy.mNice == 0 && g_ThreadPolicy.IsSet());
+}
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(ThreadReport, "thread.report")
+{
+    const String path = ScratchFile("log");
+    LoadOptions(("ThreadNice=0\nLogFile=" + path + "\n").c_str());
+    SMOD_CHECK(HasLogSinks());
+    Scheduled s;
+    {
+        Thread thread;
+        SMOD_CHECK(thread.Start(&LookAtSelf, &s, "test"));
+    }
+    // Writes whatever is left
+    ClearLogSinks();
+    std::ifstream file(path);
+    std::stringstream text;
+    text << file.rdbuf();
+    // Both threads were reported on by the thread that started them, through the log like any other message
+    SMOD_CHECK(text.str().find("The log writer thread runs with cpus any, class normal, nice 0") != String::npos);
+    SMOD_CHECK(text.str().find("The test thread runs with cpus any, class normal, nice 0") != String::npos);
+}
@@ -0,0 +1,193 @@
+// ------------------------------------------------------------------------------------------------
+#include "Test.hpp"
+#include "Master.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#include <signal.h>
+#include <sys/stat.h>
+
+// ------------------------------------------------------------------------------------------------
+using namespace SMod;
+
+/* ------------------------------------------------------------------------------------------------
+ * Reads back the entries of a captured trace.
+*/
+struct TraceReader
+{
+    /* --------------------------------------------------------------------------------------------
+     * Base constructor. Opens the trace at the specified path.
+    */
+    explicit TraceReader(const String & path)
+        : mFile(fopen(path.c_str(), "rb"))
+    {
+        /* ... */
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~TraceReader()
+    {
+        // Was the trace even found?
+        if (mFile)
+        {
+            fclose(mFile);
+        }
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Read an integer from the trace.
+    */
+    template < typename T > T Get()
+    {
+        T value = T();
+        // A short read leaves the value empty and the file at its end
+        if (!mFile || fread(&value, sizeof(value), 1, mFile) != 1)
+        {
+            mFailed = true;
+        }
+        return value;
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Read a length prefixed string from the trace.
+    */
+    String GetString()
+    {
+        String str(Get< uint16_t >(), '\0');
+        // A short read leaves the file at its end
+        if (!str.empty() && fread(&str[0], 1, str.size(), mFile) != str.size())
+        {
+            mFailed = true;
+        }
+        return str;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    std::FILE * mFile; // The trace file.
+    bool        mFailed = false; // Whether the trace ended early.
+};
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(TraceCapture, "trace.capture")
+{
+    MockMaster master;
+    SMOD_CHECK(master.Start());
+    master.SetHandler([](const String & path) {
+        MockReply reply;
+        reply.mStatus = path == "/a" ? 200 : 403;
+        reply.mHeaders = "X-Mock: yes\r\n";
+        reply.mBody = "0123456789";
+        return reply;
+    });
+    const String trace = ScratchFile("trace");
+    LoadOptions(("Pipelining=false\nCapture=" + trace + "\n").c_str());
+    Announcer announcer;
+    announcer.AddMaster(master.Address("/a").c_str());
+    announcer.AddMaster(master.Address("/b").c_str());
+    // Nothing listens on this one
+    announcer.AddMaster("127.0.0.1:1/dead");
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 2);
+    g_Recorder.Close();
+    TraceReader in(trace);
+    SMOD_CHECK(in.Get< uint32_t >() == SMOD_TRACE_MAGIC);
+    SMOD_CHECK(in.Get< uint32_t >() == SMOD_TRACE_VERSION);
+    std::vector< String > masters;
+    unsigned responses = 0;
+    // Walk through every entry
+    for (uint8_t entry = in.Get< uint8_t >(); !in.mFailed; entry = in.Get< uint8_t >())
+    {
+        const uint32_t id = in.Get< uint32_t >();
+        // Each master-server is named once, before its first response
+        if (entry == Recorder::EntryMaster)
+        {
+            SMOD_CHECK(id == masters.size());
+            masters.push_back(in.GetString());
+            continue;
+        }
+        else if (!SMOD_CHECK(entry == Recorder::EntryResponse && id < masters.size()))
+        {
+            break;
+        }
+        ++responses;
+        SMOD_CHECK(in.Get< uint64_t >() > 0);
+        in.Get< uint32_t >();
+        const uint16_t status = in.Get< uint16_t >();
+        const uint32_t size = in.Get< uint32_t >();
+        const uint16_t count = in.Get< uint16_t >();
+        std::vector< std::pair< String, String > > headers;
+        for (uint16_t h = 0; h < count; ++h)
+        {
+            const String name = in.GetString();
+            headers.emplace_back(name, in.GetString());
+        }
+        // Exactly how each one answered
+        if (masters[id].find("/dead") != String::npos)
+        {
+            SMOD_CHECK(status == 0 && size == 0 && count == 0);
+        }
+        else
+        {
+            SMOD_CHECK(status == (masters[id].find("/a") != String::npos ? 200 : 403));
+            SMOD_CHECK(size == 10);
+            SMOD_CHECK(std::find(headers.begin(), headers.end(), std::make_pair(String("X-Mock"), String("yes"))) !=
+                        headers.end());
+        }
+    }
+    SMOD_CHECK(masters.size() == 3);
+    SMOD_CHECK(responses == 6);
+}
+
+#ifdef SMOD_REPLAY_PATH
+
+// ------------------------------------------------------------------------------------------------
+SMOD_TEST(TraceReplay, "trace.replay")
+{
+    const String trace = ScratchFile("trace");
+    {
+        MockMaster master;
+        SMOD_CHECK(master.Start());
+        master.SetHandler([](const String & path) {
+            MockReply reply;
+            reply.mStatus = path == "/a" ? 200 : 500;
+            return reply;
+        });
+        LoadOptions(("Pipelining=false\nCapture=" + trace + "\n").c_str());
+        Announcer announcer;
+        announcer.AddMaster(master.Address("/a").c_str());
+        announcer.AddMaster(master.Address("/b").c_str());
+        announcer.SetPayload(67000, 8192);
+        RunCycles(announcer, 1);
+        g_Recorder.Close();
+    }
+    const String ini = ScratchFile("announce.ini");
+    const int pid = Spawn({SMOD_REPLAY_PATH, "-w", ini, trace});
+    struct stat st;
+    // The configuration is written once the replay listens
+    SMOD_CHECK(WaitFor([&]() { return stat(ini.c_str(), &st) == 0 && st.st_size > 0; }, 5000));
+    CSimpleIniA conf(false, true, true);
+    std::vector< String > masters;
+    SMOD_CHECK(conf.LoadFile(ini.c_str()) == SI_OK);
+    ConfigureMasters(conf, masters);
+    LoadOptions("Pipelining=false\n");
+    Announcer announcer;
+    for (const auto & address : masters)
+    {
+        announcer.AddMaster(address.c_str());
+    }
+    announcer.SetPayload(67000, 8192);
+    RunCycles(announcer, 1);
+    // The replayed master-servers answer the way the real ones did
+    SMOD_CHECK(masters.size() == 2);
+    SMOD_CHECK(announcer.GetStats().mSuccesses == 1);
+    SMOD_CHECK(announcer.GetStats().mFailures == 1);
+    kill(pid, SIGTERM);
+    SMOD_CHECK(Reap(pid, 5000) == 0);
+}
+
+#endif // SMOD_REPLAY_PATH
@@ -0,0 +1,248 @@
+// ------------------------------------------------------------------------------------------------
+#include "Announce.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+// ------------------------------------------------------------------------------------------------
+#include <unistd.h>
+
+/* ------------------------------------------------------------------------------------------------
+ * Micro-benchmarks for the hot and semi-hot pieces of the announcer. Results are written as one
+ * JSON object per line so that bench-compare.py can compare two builds.
+*/
+
+// ------------------------------------------------------------------------------------------------
+#ifndef SMOD_BENCH_CONFIG
+    #define SMOD_BENCH_CONFIG "announce.ini"
+#endif
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+typedef std::function< void (size_t) > BenchFunc; // Runs the specified number of iterations.
+
+// ------------------------------------------------------------------------------------------------
+static FILE *               g_Report = nullptr; // Where the human readable results go.
+static FILE *               g_Results = nullptr; // Where the machine readable results go.
+static CCStr                g_Filter = nullptr; // Only run benchmarks containing this text.
+static double               g_MinTime = 0.1; // Seconds each sample should take at least.
+static unsigned             g_Samples = 5; // Samples taken of each benchmark.
+static volatile size_t      g_Sink = 0; // Keeps the optimizer from discarding results.
+
+/* ------------------------------------------------------------------------------------------------
+ * Hand a result to the sink so it can't be optimized away. A plain load and store, since compound
+ * assignment to a volatile is deprecated.
+*/
+static inline void Consume(size_t value)
+{
+    g_Sink = g_Sink + value;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Measure how long the specified function takes per iteration and report it.
+*/
+static void Bench(CCStr name, const BenchFunc & func)
+{
+    // Was this benchmark filtered out?
+    if (g_Filter && !strstr(name, g_Filter))
+    {
+        return;
+    }
+    using Clock = std::chrono::steady_clock;
+    size_t iterations = 1;
+    // Find out how many iterations fill a sample
+    for (;;)
+    {
+        const Clock::time_point start = Clock::now();
+        func(iterations);
+        const double elapsed = std::chrono::duration< double >(Clock::now() - start).count();
+        // Is this enough?
+        if (elapsed >= g_MinTime || iterations >= (1ULL << 30))
+        {
+            break;
+        }
+        // Aim a bit past the minimum time
+        iterations = std::max(iterations * 2, static_cast< size_t >(iterations * (g_MinTime * 1.2 / std::max(elapsed, 1e-9))));
+    }
+    std::vector< double > samples;
+    // Take the samples
+    for (unsigned n = 0; n < g_Samples; ++n)
+    {
+        const Clock::time_point start = Clock::now();
+        func(iterations);
+        samples.push_back(std::chrono::duration< double, std::nano >(Clock::now() - start).count() / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+    const double median = samples[samples.size() / 2];
+    // Report the results
+    fprintf(g_Report, "%-32s %14.1f ns/op %14.1f min %14.1f max %12zu iterations\n", name, median,
+            samples.front(), samples.back(), iterations);
+    fflush(g_Report);
+    if (g_Results)
+    {
+        fprintf(g_Results, "{\"name\":\"%s\",\"ns_per_op\":%.3f,\"min\":%.3f,\"max\":%.3f,\"iterations\":%zu,\"samples\":%u}\n",
+                name, median, samples.front(), samples.back(), iterations, g_Samples);
+        fflush(g_Results);
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Queue the specified number of messages.
+*/
+static void Queue(size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        MtOutputMessage("Master-list (%s) responded with code: %d", "http://master.vc-mp.org/announce.php", 200);
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Run every benchmark.
+*/
+static void RunAll(CCStr config)
+{
+    // URI construction from the address forms found in configurations
+    Bench("uri/host", [](size_t n) {
+        for (size_t i = 0; i < n; ++i)
+        {
+            URI addr("master.vc-mp.org");
+            Consume(addr.mHost.size());
+        }
+    });
+    Bench("uri/full", [](size_t n) {
+        for (size_t i = 0; i < n; ++i)
+        {
+            URI addr("http://master.vc-mp.org:8080/announce.php");
+            Consume(addr.mPath.size());
+        }
+    });
+    // Message formatting and queueing at different message sizes
+    for (const size_t size : {16, 128, 1024})
+    {
+        const String text(size, 'x');
+        const String name = "queue/" + std::to_string(size);
+        Bench(name.c_str(), [&text](size_t n) {
+            for (size_t i = 0; i < n; ++i)
+            {
+                MtOutputMessage("%s", text.c_str());
+                // Keep the queue from growing without bounds
+                if ((i & 1023) == 1023)
+                {
+                    FlushMessages();
+                }
+            }
+            FlushMessages();
+        });
+    }
+    // Flushing the queue from the server frame with a different number of pending messages
+    Bench("flush/0", [](size_t n) {
+        for (size_t i = 0; i < n; ++i)
+        {
+            FlushMessages();
+        }
+    });
+    for (const size_t pending : {1, 100})
+    {
+        const String name = "flush/" + std::to_string(pending);
+        // The messages must be queued again each time so queueing is part of the measurement
+        Bench(name.c_str(), [pending](size_t n) {
+            for (size_t i = 0; i < n; ++i)
+            {
+                Queue(pending);
+                FlushMessages();
+            }
+        });
+    }
+    // Request encoding as done on every announce
+    {
+        Server server(URI("http://master.vc-mp.org:80/announce.php"));
+        server.ConfigureServer(67000, 8192);
+        Bench("request/encode", [&server](size_t n) {
+            for (size_t i = 0; i < n; ++i)
+            {
+                server.Encode();
+                Consume(server.GetRequest().size());
+            }
+        });
+    }
+    // Loading the configuration
+    Bench("ini/load", [config](size_t n) {
+        for (size_t i = 0; i < n; ++i)
+        {
+            CSimpleIniA conf(false, true, true);
+            Consume(conf.LoadFile(config) < 0 ? 0 : 1);
+        }
+    });
+}
+
+} // Namespace:: SMod
+
+// ------------------------------------------------------------------------------------------------
+int main(int argc, char ** argv)
+{
+    using namespace SMod;
+    CCStr config = SMOD_BENCH_CONFIG;
+    CCStr output = nullptr;
+    // Process the command line
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            config = argv[++i];
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            g_Filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            g_MinTime = std::max(0.001, std::strtod(argv[++i], nullptr));
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            g_Samples = std::max(1UL, std::strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            printf("Usage: %s [-o results.json] [-c announce.ini] [-f filter] [-t seconds] [-s samples]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    // Keep the report separate from the messages produced by the announcer
+    g_Report = fdopen(dup(STDOUT_FILENO), "w");
+    if (!g_Report || !freopen("/dev/null", "w", stdout))
+    {
+        fprintf(stderr, "Unable to redirect the announcer output\n");
+        return EXIT_FAILURE;
+    }
+    // Should the results be saved?
+    if (output && !(g_Results = fopen(output, "w")))
+    {
+        fprintf(stderr, "Unable to create the results file: %s\n", output);
+        return EXIT_FAILURE;
+    }
+    RunAll(config);
+    // Clean up
+    if (g_Results)
+    {
+        fclose(g_Results);
+    }
+    fclose(g_Report);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+// ------------------------------------------------------------------------------------------------
+#include "MockFarm.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+
+// ------------------------------------------------------------------------------------------------
+#include <chrono>
+#include <thread>
+
+/* ------------------------------------------------------------------------------------------------
+ * Serve a farm of mock master-servers until interrupted. Optionally writes a configuration that
+ * points the plug-in, the daemon or announce-cli at the farm.
+*/
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+static volatile sig_atomic_t g_Running = 1; // Allow the farm to continue
+
+/* ------------------------------------------------------------------------------------------------
+ * Stop the farm when asked to terminate.
+*/
+static void StopHandler(int)
+{
+    g_Running = 0;
+}
+
+} // Namespace:: SMod
+
+// ------------------------------------------------------------------------------------------------
+int main(int argc, char ** argv)
+{
+    using namespace SMod;
+    FarmOptions options;
+    CCStr config = nullptr;
+    // Process the command line
+    for (int i = 1; i < argc; ++i)
+    {
+        if (options.Parse(argc, argv, i))
+        {
+            continue;
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            config = argv[++i];
+        }
+        else
+        {
+            printf("Usage: %s [options] [-w announce.ini]\n", argv[0]);
+            FarmOptions::Usage();
+            printf("  -w file           write a configuration that announces on every mock\n");
+            return EXIT_FAILURE;
+        }
+    }
+    MockFarm farm(options);
+    // Start the mock master-servers
+    if (!farm.Start())
+    {
+        fprintf(stderr, "Unable to start the mock master-servers\n");
+        return EXIT_FAILURE;
+    }
+    printf("Serving %u mock master-servers (http %d, reset %d, blackhole %d)\n", farm.Count(),
+            farm.GetPorts()[0], farm.GetPorts()[1], farm.GetPorts()[2]);
+    // Should we write a configuration?
+    if (config)
+    {
+        FILE * fp = fopen(config, "w");
+        // Could we create the file?
+        if (!fp)
+        {
+            fprintf(stderr, "Unable to write the configuration: %s\n", config);
+            return EXIT_FAILURE;
+        }
+        fprintf(fp, "[Options]\nVerbose=false\nUpdateInterval=60\n\n[Servers]\n");
+        for (unsigned id = 0; id < farm.Count(); ++id)
+        {
+            fprintf(fp, "Address=%s\n", farm.Address(id).c_str());
+        }
+        fclose(fp);
+        printf("Configuration written to: %s\n", config);
+    }
+    fflush(stdout);
+    // Stop gracefully when asked to
+    signal(SIGINT, StopHandler);
+    signal(SIGTERM, StopHandler);
+    // Report the traffic from time to time
+    unsigned long last = 0;
+    for (unsigned ticks = 0; g_Running; ++ticks)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Report every ten seconds if there was traffic
+        if (ticks % 100 == 99 && farm.Received() != last)
+        {
+            last = farm.Received();
+            printf("Announces received: %lu\n", last);
+            fflush(stdout);
+        }
+    }
+    // Clean up
+    farm.Stop();
+    printf("Announces received: %lu\n", farm.Received());
+    // Done!
+    return EXIT_SUCCESS;
+}
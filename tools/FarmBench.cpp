@@ -0,0 +1,249 @@
+// ------------------------------------------------------------------------------------------------
+#include "Announce.hpp"
+#include "MockFarm.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+/* ------------------------------------------------------------------------------------------------
+ * Announce on a growing farm of mock master-servers and report how the announcer scales. The farm
+ * runs in its own process and every size is measured from a fresh process, so the CPU time and
+ * memory belong to the announcer alone.
+*/
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * Retrieve the resident memory of this process in kilobytes.
+*/
+static long ResidentMemory()
+{
+    FILE * fp = fopen("/proc/self/statm", "r");
+    long pages = 0, resident = 0;
+    // Could we read the memory usage?
+    if (!fp)
+    {
+        return 0;
+    }
+    else if (fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+    {
+        resident = 0;
+    }
+    fclose(fp);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Retrieve the CPU time used by this process in microseconds.
+*/
+static uint64_t CpuTime()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast< uint64_t >(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL +
+            static_cast< uint64_t >(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Announce on the first master-servers of the farm and report the results.
+*/
+static int Measure(const MockFarm & farm, unsigned masters, unsigned cycles, FILE * out)
+{
+    const long base = ResidentMemory();
+    Announcer announcer;
+    // Announce on the first master-servers of the farm
+    for (unsigned id = 0; id < masters; ++id)
+    {
+        announcer.AddMaster(farm.Address(id).c_str());
+    }
+    announcer.SetPayload(67000, 8192);
+    FlushMessages();
+    uint64_t total = 0, worst = 0;
+    const uint64_t cpu = CpuTime();
+    // Run the cycles
+    for (unsigned n = 0; n < cycles; ++n)
+    {
+        announcer.Cycle();
+        total += announcer.GetStats().mLastCycle;
+        worst = std::max(worst, announcer.GetStats().mLastCycle);
+        // Keep the message queue from growing
+        FlushMessages();
+    }
+    const uint64_t used = CpuTime() - cpu;
+    const AnnounceStats & stats = announcer.GetStats();
+    // Report the results
+    fprintf(out, "%8u %7u %12.3f %12.3f %12.3f %8llu %8llu %10ld %12llu\n", masters, cycles,
+            total / 1000.0 / cycles, worst / 1000.0, used / 1000.0 / cycles,
+            static_cast< unsigned long long >(stats.mSuccesses),
+            static_cast< unsigned long long >(stats.mFailures),
+            ResidentMemory() - base,
+            static_cast< unsigned long long >(stats.mAllocations / std::max(1ULL, static_cast< unsigned long long >(stats.mCycles))));
+    fflush(out);
+    return EXIT_SUCCESS;
+}
+
+} // Namespace:: SMod
+
+// ------------------------------------------------------------------------------------------------
+int main(int argc, char ** argv)
+{
+    using namespace SMod;
+    FarmOptions options;
+    std::vector< unsigned > sizes;
+    unsigned cycles = 3;
+    // Every mock master-server stands for a host of its own even though they share a port
+    g_Pipelining = false;
+    // Process the command line
+    for (int i = 1; i < argc; ++i)
+    {
+        if (options.Parse(argc, argv, i))
+        {
+            continue;
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            // Parse the list of farm sizes
+            for (char * itr = argv[++i]; *itr != '\0'; itr += (*itr == ',') ? 1 : 0)
+            {
+                const unsigned long size = std::strtoul(itr, &itr, 10);
+                // Ignore nonsense
+                if (size > 0)
+                {
+                    sizes.push_back(static_cast< unsigned >(size));
+                }
+                else if (*itr != ',')
+                {
+                    break;
+                }
+            }
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+        {
+            cycles = std::max(1UL, std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-pipeline") == 0)
+        {
+            g_Pipelining = true;
+        }
+        else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+        {
+            ++i;
+            // Which engine should announce?
+            if (strcmp(argv[i], "io_uring") == 0)
+            {
+                g_IoBackend = IoUring;
+            }
+            else if (strcmp(argv[i], "epoll") == 0)
+            {
+                g_IoBackend = IoEpoll;
+            }
+            else if (strcmp(argv[i], "coroutine") == 0)
+            {
+                g_IoBackend = IoCoroutine;
+            }
+            else
+            {
+                g_IoBackend = IoSequential;
+            }
+        }
+        else
+        {
+            printf("Usage: %s [-n 1,10,100,1000,5000] [-c cycles] [-e sequential|epoll|io_uring|coroutine] [-pipeline] [farm options]\n", argv[0]);
+            FarmOptions::Usage();
+            return EXIT_FAILURE;
+        }
+    }
+    // Use the default sizes if none were specified
+    if (sizes.empty())
+    {
+        sizes = {1, 10, 100, 1000, 5000};
+    }
+    // The farm must be large enough for every size
+    options.mMasters = *std::max_element(sizes.begin(), sizes.end());
+    MockFarm farm(options);
+    int ports[2], control[2];
+    // Create the pipes used to talk to the farm process
+    if (pipe(ports) != 0 || pipe(control) != 0)
+    {
+        fprintf(stderr, "Unable to create the farm pipes\n");
+        return EXIT_FAILURE;
+    }
+    const pid_t farm_pid = fork();
+    // Is this the farm process?
+    if (farm_pid == 0)
+    {
+        close(ports[0]);
+        close(control[1]);
+        // Start the mock master-servers and let the parent know where they are
+        if (!farm.Start() || write(ports[1], farm.GetPorts(), sizeof(farm.GetPorts())) != sizeof(farm.GetPorts()))
+        {
+            _exit(EXIT_FAILURE);
+        }
+        char c;
+        // Serve until the parent goes away
+        while (read(control[0], &c, 1) > 0)
+        {
+            /* ... */
+        }
+        farm.Stop();
+        _exit(EXIT_SUCCESS);
+    }
+    close(ports[1]);
+    close(control[0]);
+    int farm_ports[3];
+    // Wait for the farm to start
+    if (farm_pid < 0 || read(ports[0], farm_ports, sizeof(farm_ports)) != sizeof(farm_ports))
+    {
+        fprintf(stderr, "Unable to start the mock master-servers\n");
+        return EXIT_FAILURE;
+    }
+    farm.Adopt(farm_ports);
+    printf("Farm: %s latency, %s status, %u%% reset, %u%% drip, %u%% blackhole\n", options.mLatency.c_str(),
+            options.mStatus.c_str(), options.mReset, options.mDrip, options.mBlackhole);
+    static CCStr engines[] = {"sequential", "epoll", "io_uring", "coroutine"};
+    printf("Engine: %s\n\n", engines[g_IoBackend]);
+    printf("%8s %7s %12s %12s %12s %8s %8s %10s %12s\n", "masters", "cycles", "avg (ms)", "max (ms)",
+            "cpu (ms)", "ok", "failed", "rss (KB)", "allocs/cycle");
+    fflush(stdout);
+    int status = EXIT_SUCCESS;
+    // Measure each size from a fresh process
+    for (const unsigned size : sizes)
+    {
+        const pid_t pid = fork();
+        // Is this the measuring process?
+        if (pid == 0)
+        {
+            FILE * out = fdopen(dup(STDOUT_FILENO), "w");
+            // Keep the announcer output out of the report
+            if (!freopen("/dev/null", "w", stdout))
+            {
+                _exit(EXIT_FAILURE);
+            }
+            _exit(Measure(farm, size, cycles, out));
+        }
+        int ret = EXIT_FAILURE;
+        // Wait for the measurement to finish
+        if (pid < 0 || waitpid(pid, &ret, 0) != pid || !WIFEXITED(ret) || WEXITSTATUS(ret) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "Measuring %u master-servers failed\n", size);
+            status = EXIT_FAILURE;
+        }
+    }
+    // Stop the farm
+    close(control[1]);
+    waitpid(farm_pid, nullptr, 0);
+    return status;
+}
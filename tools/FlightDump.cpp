@@ -0,0 +1,173 @@
+// ------------------------------------------------------------------------------------------------
+#include "Flight.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <vector>
+#include <chrono>
+
+/* ------------------------------------------------------------------------------------------------
+ * Decode the flight recorder file left by the announcer, while it runs or after it stopped or
+ * crashed. Events are written in the order they happened, oldest first, one per line.
+*/
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * Retrieve the name of the specified phase.
+*/
+static CCStr PhaseName(uint8_t phase)
+{
+    switch (phase)
+    {
+        case FlightSkip: return "skip";
+        case FlightRedirect: return "redirect";
+        case FlightResponse: return "response";
+        case FlightHedge: return "hedge";
+        case FlightMoved: return "moved";
+        case FlightRevalidate: return "revalidate";
+        default: return "unknown";
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Output a single event.
+*/
+static void Dump(const FlightHeader & header, const FlightEvent & ev, bool json)
+{
+    const time_t sec = static_cast< time_t >(ev.mTime / 1000000);
+    const unsigned usec = static_cast< unsigned >(ev.mTime % 1000000);
+    CCStr master = "?";
+    char name[FlightHeader::NAME_SIZE + 1];
+    // Find the address of the master-server
+    if (ev.mMaster < FlightHeader::MASTERS && ev.mMaster < header.mMasterCount)
+    {
+        memcpy(name, header.mMasters[ev.mMaster], FlightHeader::NAME_SIZE);
+        name[FlightHeader::NAME_SIZE] = '\0';
+        master = name;
+    }
+    struct tm tm;
+    localtime_r(&sec, &tm);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    // Which format was requested?
+    if (json)
+    {
+        printf("{\"ts\":%llu,\"master\":\"%s\",\"phase\":\"%s\",\"status\":%u,\"latency\":%u}\n",
+                static_cast< unsigned long long >(ev.mTime), master, PhaseName(ev.mPhase),
+                static_cast< unsigned >(ev.mStatus), ev.mLatency);
+    }
+    else
+    {
+        printf("%s.%06u  %-10s %3u %10u us  %s\n", stamp, usec, PhaseName(ev.mPhase),
+                static_cast< unsigned >(ev.mStatus), ev.mLatency, master);
+    }
+}
+
+} // Namespace:: SMod
+
+// ------------------------------------------------------------------------------------------------
+int main(int argc, char ** argv)
+{
+    using namespace SMod;
+    CCStr path = nullptr;
+    double minutes = 0;
+    size_t limit = 0;
+    bool json = false;
+    // Process the command line
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            minutes = std::strtod(argv[++i], nullptr);
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            limit = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-j") == 0)
+        {
+            json = true;
+        }
+        else if (argv[i][0] != '-' && !path)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            path = nullptr;
+            break;
+        }
+    }
+    // Was a file specified?
+    if (!path)
+    {
+        printf("Usage: %s [-m minutes] [-n events] [-j] announce.flight\n", argv[0]);
+        printf("  -m only outputs the events of the last minutes.\n");
+        printf("  -n only outputs the most recent events.\n");
+        printf("  -j outputs one JSON object per event.\n");
+        return EXIT_FAILURE;
+    }
+    FILE * fp = fopen(path, "rb");
+    // Could we open it?
+    if (!fp)
+    {
+        fprintf(stderr, "Unable to open the flight recorder: %s\n", path);
+        return EXIT_FAILURE;
+    }
+    // Load the whole file so the announcer can keep writing while we decode it
+    std::vector< char > data;
+    char chunk[65536];
+    for (size_t n; (n = fread(chunk, 1, sizeof(chunk), fp)) > 0;)
+    {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(fp);
+    const FlightHeader & header = *reinterpret_cast< const FlightHeader * >(data.data());
+    // Is this a flight recorder file we understand?
+    if (data.size() < FlightHeader::EVENTS_OFFSET || header.mMagic != FlightHeader::MAGIC ||
+        header.mVersion != FlightHeader::VERSION || header.mEventSize != sizeof(FlightEvent) ||
+        data.size() < FlightHeader::EVENTS_OFFSET + static_cast< size_t >(header.mCapacity) * sizeof(FlightEvent))
+    {
+        fprintf(stderr, "Not a flight recorder file: %s\n", path);
+        return EXIT_FAILURE;
+    }
+    const FlightEvent * events = reinterpret_cast< const FlightEvent * >(data.data() + FlightHeader::EVENTS_OFFSET);
+    const uint64_t head = header.mHead.load();
+    // Only the last lap around the ring is still there
+    uint64_t first = head > header.mCapacity ? head - header.mCapacity : 0;
+    // Was a number of events requested?
+    if (limit && head - first > limit)
+    {
+        first = head - limit;
+    }
+    const uint64_t since = minutes > 0 ? static_cast< uint64_t >(std::chrono::duration_cast< std::chrono::microseconds >(
+                            std::chrono::system_clock::now().time_since_epoch()).count() - minutes * 60e6) : 0;
+    size_t count = 0, torn = 0;
+    // Walk the ring from the oldest event
+    for (uint64_t seq = first; seq < head; ++seq)
+    {
+        const FlightEvent & ev = events[seq % header.mCapacity];
+        // Was the event overwritten or never completed?
+        if (ev.mSeq != static_cast< uint32_t >(seq + 1))
+        {
+            ++torn;
+            continue;
+        }
+        // Is it recent enough?
+        if (ev.mTime >= since)
+        {
+            Dump(header, ev, json);
+            ++count;
+        }
+    }
+    fprintf(stderr, "%zu events (%llu recorded in total, %zu incomplete or overwritten)\n", count,
+            static_cast< unsigned long long >(head), torn);
+    return EXIT_SUCCESS;
+}
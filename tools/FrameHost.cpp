@@ -0,0 +1,327 @@
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// ------------------------------------------------------------------------------------------------
+#include <httplib.h>
+#include <vcmp.h>
+
+/* ------------------------------------------------------------------------------------------------
+ * Fake game server that loads the announce plug-in and measures how long each server frame spends
+ * inside it. Every scenario runs in its own process so that the plug-in always starts clean.
+*/
+
+// ------------------------------------------------------------------------------------------------
+#ifndef SMOD_PLUGIN_PATH
+    #define SMOD_PLUGIN_PATH "announce-linux64.so"
+#endif
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+typedef unsigned int (*PluginInit)(PluginFuncs *, PluginCallbacks *, PluginInfo *);
+
+/* ------------------------------------------------------------------------------------------------
+ * Description of a measured scenario.
+*/
+struct Scenario
+{
+    CCStr       mName; // Name shown in the report.
+    bool        mVerbose; // Whether the plug-in outputs verbose messages.
+    unsigned    mMasters; // How many master-servers are announced on.
+    bool        mOutage; // Whether the master-servers are unreachable.
+};
+
+// ------------------------------------------------------------------------------------------------
+static const Scenario g_Scenarios[] = {
+    {"idle",            false,  1,      false},
+    {"verbose-burst",   true,   64,     false},
+    {"outage",          true,   16,     true},
+};
+
+// ------------------------------------------------------------------------------------------------
+static unsigned             g_Rate = 50; // Server frames per second.
+static unsigned             g_Duration = 10; // Seconds to run each scenario for.
+static unsigned             g_Budget = 0; // Microseconds the plug-in announces for on each frame, if any.
+static std::vector< CCStr > g_Extra; // Further options given to the plug-in, such as the thread policy.
+static int                  g_Port = 0; // Port of the mock master-server.
+
+/* ------------------------------------------------------------------------------------------------
+ * Stub server functions used by the plug-in.
+*/
+static uint32_t GetServerVersion()
+{
+    return 67000;
+}
+
+static vcmpError GetServerSettings(ServerSettings * settings)
+{
+    settings->port = 8192;
+    settings->maxPlayers = 100;
+    return vcmpErrorNone;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Write the plug-in configuration for the specified scenario.
+*/
+static bool WriteConfig(const Scenario & scn)
+{
+    FILE * fp = fopen("announce.ini", "w");
+    // Could we create the file?
+    if (!fp)
+    {
+        return false;
+    }
+    fprintf(fp, "[Options]\nVerbose=%s\nUpdateInterval=1\nMinInterval=1\nFrameBudget=%u\n",
+                scn.mVerbose ? "true" : "false", g_Budget);
+    // Add whatever else was asked for
+    for (CCStr option : g_Extra)
+    {
+        fprintf(fp, "%s\n", option);
+    }
+    fprintf(fp, "\n[Servers]\n");
+    // Port 1 on loopback refuses connections which is as good as an outage
+    for (unsigned i = 0; i < scn.mMasters; ++i)
+    {
+        fprintf(fp, "Address=http://127.0.0.1:%d/announce/%u\n", scn.mOutage ? 1 : g_Port, i);
+    }
+    fclose(fp);
+    return true;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Load the plug-in and drive it at the configured tick rate. Returns the duration of each frame.
+*/
+static bool Drive(CCStr path, std::vector< uint64_t > & frames)
+{
+    void * handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    // Could we load the plug-in?
+    if (!handle)
+    {
+        fprintf(stderr, "Unable to load the plug-in: %s\n", dlerror());
+        return false;
+    }
+    PluginInit init = reinterpret_cast< PluginInit >(dlsym(handle, "VcmpPluginInit"));
+    // Is this even a plug-in?
+    if (!init)
+    {
+        fprintf(stderr, "The plug-in does not export VcmpPluginInit\n");
+        return false;
+    }
+    static PluginFuncs funcs;
+    static PluginCallbacks callbacks;
+    static PluginInfo info;
+    memset(&funcs, 0, sizeof(funcs));
+    memset(&callbacks, 0, sizeof(callbacks));
+    memset(&info, 0, sizeof(info));
+    funcs.structSize = sizeof(funcs);
+    funcs.GetServerVersion = GetServerVersion;
+    funcs.GetServerSettings = GetServerSettings;
+    callbacks.structSize = sizeof(callbacks);
+    info.structSize = sizeof(info);
+    // Let the plug-in initialize
+    if (!init(&funcs, &callbacks, &info))
+    {
+        fprintf(stderr, "The plug-in refused to load\n");
+        return false;
+    }
+    else if (callbacks.OnServerInitialise)
+    {
+        callbacks.OnServerInitialise();
+    }
+    const auto tick = std::chrono::nanoseconds(1000000000ULL / g_Rate);
+    const size_t count = static_cast< size_t >(g_Rate) * g_Duration;
+    frames.reserve(count);
+    // Drive the server frames at a steady rate
+    auto next = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        // This is what the game thread pays for the plug-in
+        if (callbacks.OnServerFrame)
+        {
+            callbacks.OnServerFrame(std::chrono::duration< float >(tick).count());
+        }
+        frames.push_back(static_cast< uint64_t >(std::chrono::duration_cast< std::chrono::nanoseconds >(
+                            std::chrono::steady_clock::now() - start).count()));
+        // Wait for the next frame
+        next += tick;
+        std::this_thread::sleep_until(next);
+    }
+    // Let the plug-in shut down
+    if (callbacks.OnServerShutdown)
+    {
+        callbacks.OnServerShutdown();
+    }
+    // The plug-in is not unloaded because its thread may have been detached
+    return true;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Run a scenario from a freshly forked process and report the frame percentiles.
+*/
+static int Run(CCStr path, const Scenario & scn, FILE * out)
+{
+    // Serve the announces from this process
+    httplib::Server master;
+    master.Post(R"(/announce/\d+)", [](const httplib::Request &, httplib::Response & res) {
+        res.status = 200;
+    });
+    g_Port = master.bind_to_any_port("127.0.0.1");
+    std::thread listener([&master]() { master.listen_after_bind(); });
+    // Give the plug-in a configuration to load
+    if (!WriteConfig(scn))
+    {
+        fprintf(stderr, "Unable to write the plug-in configuration\n");
+        return EXIT_FAILURE;
+    }
+    std::vector< uint64_t > frames;
+    // Drive the plug-in
+    const bool ok = Drive(path, frames);
+    // Stop the master-server
+    master.stop();
+    listener.join();
+    // Did the plug-in run?
+    if (!ok || frames.empty())
+    {
+        return EXIT_FAILURE;
+    }
+    std::sort(frames.begin(), frames.end());
+    // Report the percentiles
+    fprintf(out, "%-16s %8u %12llu %12llu %12llu\n", scn.mName, static_cast< unsigned >(frames.size()),
+                static_cast< unsigned long long >(frames[frames.size() / 2]),
+                static_cast< unsigned long long >(frames[(frames.size() * 99) / 100]),
+                static_cast< unsigned long long >(frames.back()));
+    fflush(out);
+    return EXIT_SUCCESS;
+}
+
+} // Namespace:: SMod
+
+// ------------------------------------------------------------------------------------------------
+int main(int argc, char ** argv)
+{
+    using namespace SMod;
+    CCStr path = SMOD_PLUGIN_PATH;
+    CCStr only = nullptr;
+    bool quiet = true;
+    // Process the command line
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            g_Rate = std::max(1UL, std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            g_Duration = std::max(1UL, std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            g_Budget = static_cast< unsigned >(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc)
+        {
+            g_Extra.push_back(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            only = argv[++i];
+        }
+        else if (strcmp(argv[i], "-o") == 0)
+        {
+            quiet = false;
+        }
+        else if (argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            printf("Usage: %s [-r frames/sec] [-d seconds] [-b us] [-x key=value]... [-s scenario] [-o] [plugin.so]\n", argv[0]);
+            printf("  -b announces from the server frames for up to that long instead of a thread.\n");
+            printf("  -x adds an option to the plug-in configuration, such as ThreadPolicy=idle.\n");
+            printf("  -o shows the plug-in output instead of discarding it.\n");
+            return EXIT_FAILURE;
+        }
+    }
+    // Resolve the plug-in path before changing directory
+    char resolved[4096];
+    if (!realpath(path, resolved))
+    {
+        fprintf(stderr, "Unable to find the plug-in: %s\n", path);
+        return EXIT_FAILURE;
+    }
+    // The plug-in loads its configuration from the working directory
+    char dir[] = "/tmp/frame-host-XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0)
+    {
+        fprintf(stderr, "Unable to create a working directory\n");
+        return EXIT_FAILURE;
+    }
+    printf("Plug-in: %s\n", resolved);
+    printf("Rate: %u frames/sec, %u sec per scenario\n", g_Rate, g_Duration);
+    printf("Frame budget: %s\n", g_Budget ? std::to_string(g_Budget).append(" us").c_str() : "none (thread)");
+    for (CCStr option : g_Extra)
+    {
+        printf("Option: %s\n", option);
+    }
+    printf("\n");
+    printf("%-16s %8s %12s %12s %12s\n", "scenario", "frames", "p50 (ns)", "p99 (ns)", "max (ns)");
+    fflush(stdout);
+    int status = EXIT_SUCCESS;
+    // Run each scenario in a separate process
+    for (const auto & scn : g_Scenarios)
+    {
+        // Was a specific scenario requested?
+        if (only && strcmp(only, scn.mName) != 0)
+        {
+            continue;
+        }
+        const pid_t pid = fork();
+        // Is this the scenario process?
+        if (pid == 0)
+        {
+            FILE * out = fdopen(dup(STDOUT_FILENO), "w");
+            // Keep the plug-in output out of the report
+            if (quiet && !freopen("/dev/null", "w", stdout))
+            {
+                _exit(EXIT_FAILURE);
+            }
+            const int ret = Run(resolved, scn, out);
+            fflush(stdout);
+            _exit(ret);
+        }
+        int ret = EXIT_FAILURE;
+        // Wait for the scenario to finish
+        if (pid < 0 || waitpid(pid, &ret, 0) != pid || !WIFEXITED(ret) || WEXITSTATUS(ret) != EXIT_SUCCESS)
+        {
+            fprintf(stderr, "Scenario '%s' failed\n", scn.mName);
+            status = EXIT_FAILURE;
+        }
+    }
+    // Clean up the working directory
+    unlink("announce.ini");
+    if (chdir("/") == 0)
+    {
+        rmdir(dir);
+    }
+    return status;
+}
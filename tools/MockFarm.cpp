@@ -0,0 +1,342 @@
+// ------------------------------------------------------------------------------------------------
+#include "MockFarm.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ------------------------------------------------------------------------------------------------
+#include <chrono>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * Create a socket listening on a random loopback port. Returns the socket and stores the port.
+*/
+static int ListenLoopback(int backlog, int & port)
+{
+    const int sock = socket(AF_INET, SOCK_STREAM, 0);
+    // Could we create the socket?
+    if (sock < 0)
+    {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    // Let the system choose the port
+    if (bind(sock, reinterpret_cast< struct sockaddr * >(&addr), sizeof(addr)) != 0 || listen(sock, backlog) != 0 ||
+        getsockname(sock, reinterpret_cast< struct sockaddr * >(&addr), &len) != 0)
+    {
+        close(sock);
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    // Socket is ready
+    return sock;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Raise the backlog of the socket listening on the specified loopback port. The HTTP server listens
+ * with a backlog of 5, which drops the connections of concurrent announces.
+*/
+static void RaiseBacklog(int port, int backlog)
+{
+    // Look through the descriptors of the process for the listening socket
+    for (int fd = 3; fd < 1024; ++fd)
+    {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        int listening = 0;
+        socklen_t size = sizeof(listening);
+        // Is this the socket we're looking for?
+        if (getsockname(fd, reinterpret_cast< struct sockaddr * >(&addr), &len) == 0 && addr.sin_family == AF_INET &&
+            ntohs(addr.sin_port) == port && getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &size) == 0 &&
+            listening)
+        {
+            // Listening again only changes the backlog
+            listen(fd, backlog);
+            return;
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+bool FarmOptions::Parse(int argc, char ** argv, int & i)
+{
+    // All farm options take a value
+    if (i + 1 >= argc)
+    {
+        return false;
+    }
+    else if (strcmp(argv[i], "-m") == 0)
+    {
+        mMasters = std::max(1UL, std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (strcmp(argv[i], "-seed") == 0)
+    {
+        mSeed = static_cast< unsigned >(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (strcmp(argv[i], "-latency") == 0)
+    {
+        mLatency.assign(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-status") == 0)
+    {
+        mStatus.assign(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-reset") == 0)
+    {
+        mReset = static_cast< unsigned >(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (strcmp(argv[i], "-drip") == 0)
+    {
+        mDrip = static_cast< unsigned >(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (strcmp(argv[i], "-blackhole") == 0)
+    {
+        mBlackhole = static_cast< unsigned >(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (strcmp(argv[i], "-threads") == 0)
+    {
+        mThreads = static_cast< unsigned >(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void FarmOptions::Usage()
+{
+    printf("  -m count          number of mock master-servers (default 1)\n");
+    printf("  -seed n           seed of every random choice (default 1)\n");
+    printf("  -latency spec     none, fixed:ms, uniform:lo:hi or exp:mean (default none)\n");
+    printf("  -status mix       weighted status codes (default 200=100), e.g. 200=90,400=2,408=2,500=6\n");
+    printf("  -reset pct        percent of master-servers that reset the connection\n");
+    printf("  -drip pct         percent of master-servers that drip the response body\n");
+    printf("  -blackhole pct    percent of master-servers that never answer\n");
+    printf("  -threads n        threads answering requests, to serve concurrent announces (default 1 per cpu)\n");
+}
+
+// ------------------------------------------------------------------------------------------------
+MockFarm::MockFarm(const FarmOptions & options)
+    : m_Options(options), m_Kinds(), m_Statuses(), m_Mix(), m_Random(options.mSeed), m_Mutex(), m_Server()
+    , m_Ports{0, 0, 0}, m_Reset(-1), m_Blackhole(-1), m_Running(false), m_Received(0)
+    , m_HttpThread(), m_ResetThread()
+{
+    std::vector< double > weights;
+    // Parse the status code mix
+    for (CCStr itr = m_Options.mStatus.c_str(); *itr != '\0';)
+    {
+        char * end = nullptr;
+        const long code = std::strtol(itr, &end, 10);
+        const double weight = (*end == '=') ? std::strtod(end + 1, &end) : 1.0;
+        // Ignore anything that doesn't resemble a status code
+        if (code >= 100 && code <= 599 && weight > 0.0)
+        {
+            m_Statuses.push_back(static_cast< int >(code));
+            weights.push_back(weight);
+        }
+        // Move to the next one
+        itr = (*end == ',') ? end + 1 : end + strlen(end);
+    }
+    // Always have something to answer with
+    if (m_Statuses.empty())
+    {
+        m_Statuses.push_back(200);
+        weights.push_back(1.0);
+    }
+    m_Mix = std::discrete_distribution< size_t >(weights.begin(), weights.end());
+    // Decide the behavior of each master-server
+    std::uniform_int_distribution< unsigned > percent(0, 99);
+    for (unsigned i = 0; i < m_Options.mMasters; ++i)
+    {
+        const unsigned roll = percent(m_Random);
+        // Pick the behavior according to the configured proportions
+        if (roll < m_Options.mReset)
+        {
+            m_Kinds.push_back(Reset);
+        }
+        else if (roll < m_Options.mReset + m_Options.mDrip)
+        {
+            m_Kinds.push_back(SlowDrip);
+        }
+        else if (roll < m_Options.mReset + m_Options.mDrip + m_Options.mBlackhole)
+        {
+            m_Kinds.push_back(Blackhole);
+        }
+        else
+        {
+            m_Kinds.push_back(Normal);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+bool MockFarm::Start()
+{
+    // Serve the normal and slow master-servers
+    m_Server.Post(R"(/m/(\d+))", [this](const httplib::Request & req, httplib::Response & res) {
+        Announce(req, res);
+    });
+    // Answer many announces at once, as separate master-servers would
+    if (m_Options.mThreads > 0)
+    {
+        const size_t threads = m_Options.mThreads;
+        m_Server.new_task_queue = [threads]() { return new httplib::ThreadPool(threads); };
+    }
+    m_Ports[0] = m_Server.bind_to_any_port("127.0.0.1");
+    RaiseBacklog(m_Ports[0], 4096);
+    // Create the raw sockets
+    m_Reset = ListenLoopback(128, m_Ports[1]);
+    m_Blackhole = ListenLoopback(4096, m_Ports[2]);
+    // Did everything work?
+    if (m_Ports[0] <= 0 || m_Reset < 0 || m_Blackhole < 0)
+    {
+        Stop();
+        return false;
+    }
+    m_Running = true;
+    // Start the listeners
+    m_HttpThread = std::thread([this]() { m_Server.listen_after_bind(); });
+    m_ResetThread = std::thread([this]() { ResetLoop(); });
+    // Give the HTTP server a moment to start accepting
+    while (!m_Server.is_running())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+void MockFarm::Stop()
+{
+    m_Running = false;
+    // Stop the HTTP server
+    m_Server.stop();
+    if (m_HttpThread.joinable())
+    {
+        m_HttpThread.join();
+    }
+    // Stop the reset socket
+    if (m_ResetThread.joinable())
+    {
+        m_ResetThread.join();
+    }
+    // Close the raw sockets
+    if (m_Reset >= 0)
+    {
+        close(m_Reset);
+        m_Reset = -1;
+    }
+    if (m_Blackhole >= 0)
+    {
+        close(m_Blackhole);
+        m_Blackhole = -1;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+String MockFarm::Address(unsigned id) const
+{
+    int port = m_Ports[0];
+    // Resets and blackholes have their own socket
+    if (m_Kinds[id] == Reset)
+    {
+        port = m_Ports[1];
+    }
+    else if (m_Kinds[id] == Blackhole)
+    {
+        port = m_Ports[2];
+    }
+    return "http://127.0.0.1:" + std::to_string(port) + "/m/" + std::to_string(id);
+}
+
+// ------------------------------------------------------------------------------------------------
+void MockFarm::Announce(const httplib::Request & req, httplib::Response & res)
+{
+    const unsigned long id = std::strtoul(req.matches[1].str().c_str(), nullptr, 10);
+    unsigned latency = 0;
+    int status = 200;
+    ++m_Received;
+    // Choose the latency and status code of this response
+    {
+        std::lock_guard< std::mutex > lock(m_Mutex);
+        // Identify the latency distribution
+        if (m_Options.mLatency.compare(0, 6, "fixed:") == 0)
+        {
+            latency = static_cast< unsigned >(std::strtoul(m_Options.mLatency.c_str() + 6, nullptr, 10));
+        }
+        else if (m_Options.mLatency.compare(0, 8, "uniform:") == 0)
+        {
+            char * end = nullptr;
+            const unsigned long lo = std::strtoul(m_Options.mLatency.c_str() + 8, &end, 10);
+            const unsigned long hi = (*end == ':') ? std::strtoul(end + 1, nullptr, 10) : lo;
+            latency = std::uniform_int_distribution< unsigned >(lo, std::max(lo, hi))(m_Random);
+        }
+        else if (m_Options.mLatency.compare(0, 4, "exp:") == 0)
+        {
+            const double mean = std::max(std::strtod(m_Options.mLatency.c_str() + 4, nullptr), 0.001);
+            latency = static_cast< unsigned >(std::exponential_distribution< double >(1.0 / mean)(m_Random));
+        }
+        status = m_Statuses[m_Mix(m_Random)];
+    }
+    // Simulate the time the master-server needs to answer
+    if (latency > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(latency));
+    }
+    res.status = status;
+    // Should the body be dripped?
+    if (id < m_Kinds.size() && m_Kinds[id] == SlowDrip)
+    {
+        const unsigned delay = m_Options.mDripDelay;
+        res.set_content_provider(m_Options.mDripBytes, [delay](size_t, size_t, httplib::DataSink & sink) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            sink.write(".", 1);
+        });
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void MockFarm::ResetLoop()
+{
+    struct pollfd pfd = {m_Reset, POLLIN, 0};
+    // Keep going until asked to stop
+    while (m_Running)
+    {
+        // Wait a bit for a connection so that we notice when asked to stop
+        if (poll(&pfd, 1, 100) <= 0)
+        {
+            continue;
+        }
+        const int sock = accept(m_Reset, nullptr, nullptr);
+        // Did we get a connection?
+        if (sock < 0)
+        {
+            continue;
+        }
+        // Closing with a zero linger time sends a reset instead of a graceful shutdown
+        struct linger lng = {1, 0};
+        setsockopt(sock, SOL_SOCKET, SO_LINGER, &lng, sizeof(lng));
+        close(sock);
+    }
+}
+
+} // Namespace:: SMod
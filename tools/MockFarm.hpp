@@ -0,0 +1,191 @@
+#ifndef _TOOLS_MOCKFARM_HPP_
+#define _TOOLS_MOCKFARM_HPP_
+
+// ------------------------------------------------------------------------------------------------
+#include "Base.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <mutex>
+#include <algorithm>
+
+// ------------------------------------------------------------------------------------------------
+#include <httplib.h>
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+// ------------------------------------------------------------------------------------------------
+typedef ::std::string String;
+
+/* ------------------------------------------------------------------------------------------------
+ * How the mock master-servers of a farm should behave.
+*/
+struct FarmOptions
+{
+    /* --------------------------------------------------------------------------------------------
+     * Default constructor. Healthy master-servers that answer right away.
+    */
+    FarmOptions()
+        : mMasters(1), mSeed(1), mLatency("none"), mStatus("200=100")
+        , mReset(0), mDrip(0), mBlackhole(0), mDripBytes(32), mDripDelay(100), mThreads(0)
+    {
+        /* ... */
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Parse the command line option at the specified index. Returns false if it is not a farm option.
+    */
+    bool Parse(int argc, char ** argv, int & i);
+
+    /* --------------------------------------------------------------------------------------------
+     * Output the farm options accepted on the command line.
+    */
+    static void Usage();
+
+    // --------------------------------------------------------------------------------------------
+    unsigned        mMasters; // How many master-servers the farm serves.
+    unsigned        mSeed; // Seed of every random choice so runs can be repeated.
+    String          mLatency; // Response latency: none, fixed:ms, uniform:lo:hi or exp:mean.
+    String          mStatus; // Weighted status codes, e.g. 200=90,400=2,403=2,408=2,500=4.
+    unsigned        mReset; // Percent of master-servers that reset every connection.
+    unsigned        mDrip; // Percent of master-servers that drip their response body.
+    unsigned        mBlackhole; // Percent of master-servers that never answer.
+    unsigned        mDripBytes; // Size of the body dripped by the slow master-servers.
+    unsigned        mDripDelay; // Milliseconds between each dripped byte.
+    unsigned        mThreads; // Threads answering the HTTP requests or 0 for one per processor.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * A number of mock master-servers on loopback. Healthy and slow master-servers share one HTTP server
+ * and are told apart by path, while resets and blackholes get a raw listening socket each.
+*/
+class MockFarm
+{
+public:
+
+    /* --------------------------------------------------------------------------------------------
+     * Behavior of a single master-server.
+    */
+    enum Kind
+    {
+        Normal = 0, // Answer with the configured latency and status codes.
+        Reset, // Reset the connection as soon as it is accepted.
+        SlowDrip, // Send the response body a byte at a time.
+        Blackhole // Accept the connection but never read or answer.
+    };
+
+    /* --------------------------------------------------------------------------------------------
+     * Base constructor. Decides the behavior of every master-server but doesn't listen yet.
+    */
+    explicit MockFarm(const FarmOptions & options);
+
+    /* --------------------------------------------------------------------------------------------
+     * Copy constructor. (disabled)
+    */
+    MockFarm(const MockFarm &) = delete;
+
+    /* --------------------------------------------------------------------------------------------
+     * Destructor.
+    */
+    ~MockFarm()
+    {
+        Stop();
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Copy assignment operator. (disabled)
+    */
+    MockFarm & operator = (const MockFarm &) = delete;
+
+    /* --------------------------------------------------------------------------------------------
+     * Start listening on loopback.
+    */
+    bool Start();
+
+    /* --------------------------------------------------------------------------------------------
+     * Stop listening and wait for the listeners to finish.
+    */
+    void Stop();
+
+    /* --------------------------------------------------------------------------------------------
+     * Use the ports of a farm that was started by another process.
+    */
+    void Adopt(const int (&ports)[3])
+    {
+        std::copy(ports, ports + 3, m_Ports);
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Retrieve the ports the farm listens on.
+    */
+    const int (&GetPorts() const)[3]
+    {
+        return m_Ports;
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Retrieve the number of master-servers in the farm.
+    */
+    unsigned Count() const
+    {
+        return static_cast< unsigned >(m_Kinds.size());
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Retrieve the behavior of the specified master-server.
+    */
+    Kind GetKind(unsigned id) const
+    {
+        return m_Kinds[id];
+    }
+
+    /* --------------------------------------------------------------------------------------------
+     * Retrieve the address of the specified master-server.
+    */
+    String Address(unsigned id) const;
+
+    /* --------------------------------------------------------------------------------------------
+     * Retrieve the number of announces the farm received.
+    */
+    unsigned long Received() const
+    {
+        return m_Received.load();
+    }
+
+private:
+
+    /* --------------------------------------------------------------------------------------------
+     * Handle an announce received by the HTTP server.
+    */
+    void Announce(const httplib::Request & req, httplib::Response & res);
+
+    /* --------------------------------------------------------------------------------------------
+     * Accept connections on the reset socket and reset them.
+    */
+    void ResetLoop();
+
+    // --------------------------------------------------------------------------------------------
+    FarmOptions                 m_Options; // How the farm was configured.
+    std::vector< Kind >         m_Kinds; // Behavior of each master-server.
+    std::vector< int >          m_Statuses; // Status codes to choose from.
+    std::discrete_distribution< size_t > m_Mix; // Weights of the status codes.
+    std::mt19937                m_Random; // Source of latencies and status codes.
+    std::mutex                  m_Mutex; // Protect the random source from the server threads.
+    httplib::Server             m_Server; // Serves the normal and slow master-servers.
+    int                         m_Ports[3]; // HTTP, reset and blackhole ports.
+    int                         m_Reset; // Socket that resets every connection.
+    int                         m_Blackhole; // Socket that never accepts.
+    std::atomic< bool >         m_Running; // Whether the listeners should keep going.
+    std::atomic< unsigned long > m_Received; // Announces received by the HTTP server.
+    std::thread                 m_HttpThread; // Runs the HTTP server.
+    std::thread                 m_ResetThread; // Runs the reset socket.
+};
+
+} // Namespace:: SMod
+
+#endif // _TOOLS_MOCKFARM_HPP_
@@ -0,0 +1,394 @@
+// ------------------------------------------------------------------------------------------------
+#include "Announce.hpp"
+
+// ------------------------------------------------------------------------------------------------
+#include <httplib.h>
+
+// ------------------------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+
+// ------------------------------------------------------------------------------------------------
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+// ------------------------------------------------------------------------------------------------
+#include <poll.h>
+#include <unistd.h>
+#include <strings.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+/* ------------------------------------------------------------------------------------------------
+ * Reproduce a captured announce trace on loopback. Every master-server found in the trace gets a
+ * path on a local HTTP endpoint which answers with the recorded latency, status code, headers and
+ * body size, in the order they were recorded. Unreachable entries reset the connection after the
+ * recorded latency.
+*/
+
+// ------------------------------------------------------------------------------------------------
+namespace SMod {
+
+/* ------------------------------------------------------------------------------------------------
+ * A recorded response.
+*/
+struct Reply
+{
+    uint64_t                                        mTime; // When it was recorded (us since epoch).
+    uint32_t                                        mLatency; // How long it took (us).
+    uint16_t                                        mStatus; // Status code or 0 if unreachable.
+    uint32_t                                        mSize; // Size of the body.
+    std::vector< std::pair< String, String > >      mHeaders; // Response headers.
+};
+
+/* ------------------------------------------------------------------------------------------------
+ * A recorded master-server and the responses it gave, in order.
+*/
+struct Master
+{
+    String                  mAddress; // Address the traffic was captured from.
+    std::vector< Reply >    mReplies; // Recorded responses.
+    size_t                  mNext; // Next response to replay.
+};
+
+// ------------------------------------------------------------------------------------------------
+static std::vector< Master >    g_Masters; // Master-servers found in the trace.
+static std::mutex               g_Mutex; // Protect the replay position.
+static volatile sig_atomic_t    g_Running = 1; // Allow the replay to continue.
+
+/* ------------------------------------------------------------------------------------------------
+ * Stop the replay when asked to terminate.
+*/
+static void StopHandler(int)
+{
+    g_Running = 0;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Read an integer from the trace.
+*/
+template < typename T > static bool Get(FILE * fp, T & value)
+{
+    return fread(&value, sizeof(value), 1, fp) == 1;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Read a length prefixed string from the trace.
+*/
+static bool Get(FILE * fp, String & str)
+{
+    uint16_t len = 0;
+    // Read the length first
+    if (!Get(fp, len))
+    {
+        return false;
+    }
+    str.resize(len);
+    return len == 0 || fread(&str[0], 1, len, fp) == len;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Load the trace at the specified path.
+*/
+static bool Load(CCStr path)
+{
+    FILE * fp = fopen(path, "rb");
+    uint32_t magic = 0, version = 0;
+    // Is this a trace we understand?
+    if (!fp || !Get(fp, magic) || !Get(fp, version) || magic != SMOD_TRACE_MAGIC || version != SMOD_TRACE_VERSION)
+    {
+        fprintf(stderr, "Not an announce trace: %s\n", path);
+        if (fp)
+        {
+            fclose(fp);
+        }
+        return false;
+    }
+    std::map< uint32_t, size_t > index;
+    uint8_t type = 0;
+    uint32_t id = 0;
+    // Read every entry
+    while (Get(fp, type) && Get(fp, id))
+    {
+        // Is this a new master-server?
+        if (type == Recorder::EntryMaster)
+        {
+            Master master;
+            master.mNext = 0;
+            if (!Get(fp, master.mAddress))
+            {
+                break;
+            }
+            index[id] = g_Masters.size();
+            g_Masters.push_back(std::move(master));
+            continue;
+        }
+        else if (type != Recorder::EntryResponse || index.find(id) == index.end())
+        {
+            fprintf(stderr, "Corrupt entry in the announce trace, stopping here\n");
+            break;
+        }
+        Reply reply;
+        uint16_t count = 0;
+        // Read the response
+        if (!Get(fp, reply.mTime) || !Get(fp, reply.mLatency) || !Get(fp, reply.mStatus) ||
+            !Get(fp, reply.mSize) || !Get(fp, count))
+        {
+            break;
+        }
+        // Read the headers
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            String name, value;
+            if (!Get(fp, name) || !Get(fp, value))
+            {
+                break;
+            }
+            reply.mHeaders.emplace_back(std::move(name), std::move(value));
+        }
+        g_Masters[index[id]].mReplies.push_back(std::move(reply));
+    }
+    fclose(fp);
+    return true;
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Output the contents of the loaded trace.
+*/
+static void Dump()
+{
+    for (size_t id = 0; id < g_Masters.size(); ++id)
+    {
+        printf("master %u: %s (%u responses)\n", static_cast< unsigned >(id), g_Masters[id].mAddress.c_str(),
+                static_cast< unsigned >(g_Masters[id].mReplies.size()));
+        // Output each response
+        for (const auto & reply : g_Masters[id].mReplies)
+        {
+            printf("  %llu.%06llu  %8.3f ms  status %3u  body %u\n",
+                    static_cast< unsigned long long >(reply.mTime / 1000000ULL),
+                    static_cast< unsigned long long >(reply.mTime % 1000000ULL),
+                    reply.mLatency / 1000.0, reply.mStatus, reply.mSize);
+            for (const auto & hdr : reply.mHeaders)
+            {
+                printf("    %s: %s\n", hdr.first.c_str(), hdr.second.c_str());
+            }
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------
+ * Serve a single announce on the specified connection.
+*/
+static void Serve(int sock)
+{
+    String request;
+    char buffer[4096];
+    size_t expected = String::npos;
+    // Read the request headers and body
+    while (request.size() < expected)
+    {
+        const ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+        // Did the client go away?
+        if (n <= 0)
+        {
+            close(sock);
+            return;
+        }
+        request.append(buffer, static_cast< size_t >(n));
+        const size_t end = request.find("\r\n\r\n");
+        // Do we have the headers yet?
+        if (end != String::npos && expected == String::npos)
+        {
+            size_t length = 0;
+            // Find out how large the body is
+            for (size_t pos = request.find("\r\n"); pos < end; pos = request.find("\r\n", pos + 2))
+            {
+                if (strncasecmp(request.c_str() + pos + 2, "Content-Length:", 15) == 0)
+                {
+                    length = std::strtoul(request.c_str() + pos + 17, nullptr, 10);
+                }
+            }
+            expected = end + 4 + length;
+        }
+    }
+    // Identify the master-server from the path
+    const size_t path = request.find(" /r/");
+    const unsigned long id = (path != String::npos) ? std::strtoul(request.c_str() + path + 4, nullptr, 10) : ~0UL;
+    Reply reply;
+    // Pick the next recorded response of this master-server
+    {
+        std::lock_guard< std::mutex > lock(g_Mutex);
+        // Is this a known master-server with something to replay?
+        if (id >= g_Masters.size() || g_Masters[id].mReplies.empty())
+        {
+            reply.mLatency = 0;
+            reply.mStatus = 404;
+            reply.mSize = 0;
+        }
+        else
+        {
+            Master & master = g_Masters[id];
+            reply = master.mReplies[master.mNext];
+            master.mNext = (master.mNext + 1) % master.mReplies.size();
+        }
+    }
+    // Take as long as the master-server did
+    std::this_thread::sleep_for(std::chrono::microseconds(reply.mLatency));
+    // Was the master-server unreachable?
+    if (reply.mStatus == 0)
+    {
+        struct linger lng = {1, 0};
+        setsockopt(sock, SOL_SOCKET, SO_LINGER, &lng, sizeof(lng));
+        close(sock);
+        return;
+    }
+    String response = "HTTP/1.1 " + std::to_string(reply.mStatus) + " " + httplib::detail::status_message(reply.mStatus) + "\r\n";
+    // Include the recorded headers, except those describing the connection
+    for (const auto & hdr : reply.mHeaders)
+    {
+        if (strcasecmp(hdr.first.c_str(), "Content-Length") != 0 &&
+            strcasecmp(hdr.first.c_str(), "Transfer-Encoding") != 0 &&
+            strcasecmp(hdr.first.c_str(), "Connection") != 0)
+        {
+            response += hdr.first + ": " + hdr.second + "\r\n";
+        }
+    }
+    response += "Content-Length: " + std::to_string(reply.mSize) + "\r\nConnection: close\r\n\r\n";
+    response.append(reply.mSize, '.');
+    // Send the response
+    for (size_t sent = 0; sent < response.size();)
+    {
+        const ssize_t n = send(sock, response.data() + sent, response.size() - sent, SMOD_MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            break;
+        }
+        sent += static_cast< size_t >(n);
+    }
+    close(sock);
+}
+
+} // Namespace:: SMod
+
+// ------------------------------------------------------------------------------------------------
+int main(int argc, char ** argv)
+{
+    using namespace SMod;
+    CCStr trace = nullptr;
+    CCStr config = nullptr;
+    bool dump = false;
+    int port = 0;
+    // Process the command line
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+        {
+            config = argv[++i];
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+        {
+            port = std::atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-d") == 0)
+        {
+            dump = true;
+        }
+        else if (argv[i][0] != '-' && !trace)
+        {
+            trace = argv[i];
+        }
+        else
+        {
+            trace = nullptr;
+            break;
+        }
+    }
+    // Was a trace specified?
+    if (!trace)
+    {
+        printf("Usage: %s [-d] [-p port] [-w announce.ini] announce.trace\n", argv[0]);
+        printf("  -d outputs the trace instead of replaying it.\n");
+        printf("  -w writes a configuration that announces on the replayed master-servers.\n");
+        return EXIT_FAILURE;
+    }
+    // Load the trace
+    if (!Load(trace))
+    {
+        return EXIT_FAILURE;
+    }
+    // Should we just output it?
+    else if (dump)
+    {
+        Dump();
+        return EXIT_SUCCESS;
+    }
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast< uint16_t >(port));
+    socklen_t len = sizeof(addr);
+    const int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    // Start listening on loopback
+    if (listener < 0 || bind(listener, reinterpret_cast< struct sockaddr * >(&addr), sizeof(addr)) != 0 ||
+        listen(listener, 128) != 0 || getsockname(listener, reinterpret_cast< struct sockaddr * >(&addr), &len) != 0)
+    {
+        fprintf(stderr, "Unable to listen on loopback\n");
+        return EXIT_FAILURE;
+    }
+    port = ntohs(addr.sin_port);
+    printf("Replaying %u master-servers on port %d\n", static_cast< unsigned >(g_Masters.size()), port);
+    // Should we write a configuration?
+    if (config)
+    {
+        FILE * fp = fopen(config, "w");
+        // Could we create the file?
+        if (!fp)
+        {
+            fprintf(stderr, "Unable to write the configuration: %s\n", config);
+            return EXIT_FAILURE;
+        }
+        fprintf(fp, "[Options]\nVerbose=false\nUpdateInterval=60\n\n[Servers]\n");
+        for (size_t id = 0; id < g_Masters.size(); ++id)
+        {
+            // Keep the original address around for reference
+            fprintf(fp, "# %s\nAddress=http://127.0.0.1:%d/r/%u\n", g_Masters[id].mAddress.c_str(),
+                    port, static_cast< unsigned >(id));
+        }
+        fclose(fp);
+        printf("Configuration written to: %s\n", config);
+    }
+    fflush(stdout);
+    // Stop gracefully when asked to
+    signal(SIGINT, StopHandler);
+    signal(SIGTERM, StopHandler);
+    signal(SIGPIPE, SIG_IGN);
+    struct pollfd pfd = {listener, POLLIN, 0};
+    // Serve announces until interrupted
+    while (g_Running)
+    {
+        // Wait a bit for a connection so that we notice when asked to stop
+        if (poll(&pfd, 1, 100) <= 0)
+        {
+            continue;
+        }
+        const int sock = accept(listener, nullptr, nullptr);
+        // Serve each announce from its own thread so latencies overlap like they would for real
+        if (sock >= 0)
+        {
+            std::thread(Serve, sock).detach();
+        }
+    }
+    close(listener);
+    // Done!
+    return EXIT_SUCCESS;
+}
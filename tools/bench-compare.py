@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Compare two announce-bench result files and flag regressions.
+
+Usage: bench-compare.py [--threshold PCT] baseline.json candidate.json
+
+Each file holds one JSON object per line as written by `announce-bench -o`.
+Exits with status 1 when any benchmark got slower by more than the threshold.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    results = {}
+    with open(path) as fp:
+        for line in fp:
+            line = line.strip()
+            if line:
+                entry = json.loads(line)
+                results[entry["name"]] = entry
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two announce-bench result files.")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="percent slowdown that counts as a regression (default 10)")
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    cand = load(args.candidate)
+    regressions = 0
+
+    print("%-32s %14s %14s %9s" % ("benchmark", "baseline", "candidate", "change"))
+    for name in sorted(set(base) | set(cand)):
+        if name not in base or name not in cand:
+            print("%-32s %14s %14s %9s" % (name, "-" if name not in base else "%.1f" % base[name]["ns_per_op"],
+                                           "-" if name not in cand else "%.1f" % cand[name]["ns_per_op"], "n/a"))
+            continue
+        old = base[name]["ns_per_op"]
+        new = cand[name]["ns_per_op"]
+        change = (new - old) / old * 100.0 if old > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            flag = "  improved"
+        print("%-32s %14.1f %14.1f %+8.1f%%%s" % (name, old, new, change, flag))
+
+    if regressions:
+        print("\n%d benchmark(s) regressed by more than %.1f%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())